@@ -0,0 +1,128 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+#include "firelink/acceptor.hpp"
+
+#include <string>
+
+/*
+ * Connection rate of a loopback server that closes every connection right after accepting it. Clients
+ * connect and close in several concurrent chains. Compares the Acceptor with a single posted accept
+ * (the re-arm-from-the-handler pattern of the echo server example) against several posted accepts,
+ * and with the accepted sockets spread over two IOCores.
+ */
+
+namespace
+{
+  constexpr std::uint32_t CHAINS = 16;
+  constexpr std::uint32_t CONNECTIONS_PER_CHAIN = 250;
+
+  void connect_chain(std::shared_ptr<firelink::IOCore> io_core, firelink::Endpoint dst,
+                     std::shared_ptr<std::atomic<std::uint64_t>> done, std::uint32_t remaining)
+  {
+    if (remaining == 0)
+      return;
+
+    auto sock = firelink_bench::make_tcp_socket(io_core);
+    if (!sock.has_value())
+    {
+      done->fetch_add(remaining);
+      return;
+    }
+
+    firelink::ErrorCode err = sock.value()->start_connect(dst, [io_core, dst, done, remaining](
+                                                          std::shared_ptr<firelink::Socket> caller,
+                                                          firelink::ErrorCode, firelink::ConnectTag)
+    {
+      caller->close();
+      done->fetch_add(1);
+      connect_chain(io_core, dst, done, remaining - 1);
+    });
+
+    if (err != firelink::ErrorCode::Success)
+    {
+      sock.value()->close();
+      done->fetch_add(remaining);
+    }
+  }
+
+  void run_acceptor(firelink_bench::Report& report, std::uint32_t pending_accepts, std::uint32_t server_cores,
+                    const std::string& name)
+  {
+    std::vector<std::shared_ptr<firelink::IOCore>> io_cores{};
+    for (std::uint32_t i = 0; i < server_cores + 1; ++i)
+    {
+      auto io_core = firelink_bench::make_io_core(2, 2);
+      if (!io_core.has_value())
+      {
+        std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core.error()) << std::endl;
+        for (std::shared_ptr<firelink::IOCore>& created : io_cores)
+          created->release();
+        return;
+      }
+
+      io_cores.push_back(io_core.value());
+    }
+
+    // The last IOCore drives the clients
+    std::shared_ptr<firelink::IOCore> client_core = io_cores.back();
+    std::vector<std::shared_ptr<firelink::IOCore>> server(io_cores.begin(), io_cores.end() - 1);
+
+    auto acceptor = firelink::Acceptor::create(server, {pending_accepts, 512});
+    firelink::Endpoint server_ep{};
+    firelink::ErrorCode err = acceptor.has_value() ? acceptor.value()->open(firelink::AddressFamily::IPv4,
+                                                                            firelink::IPv4Address::loopback(0))
+                                                   : acceptor.error();
+    if (err == firelink::ErrorCode::Success)
+      err = acceptor.value()->get_local_endpoint(server_ep);
+
+    auto accepted = std::make_shared<std::atomic<std::uint64_t>>(0);
+    if (err == firelink::ErrorCode::Success)
+    {
+      err = acceptor.value()->start([accepted](std::shared_ptr<firelink::Socket> socket, const firelink::Endpoint&,
+                                               firelink::ErrorCode error, firelink::ConnectionTag)
+      {
+        if (error != firelink::ErrorCode::Success)
+          return;
+
+        socket->close();
+        accepted->fetch_add(1);
+      });
+    }
+
+    if (err == firelink::ErrorCode::Success)
+    {
+      auto done = std::make_shared<std::atomic<std::uint64_t>>(0);
+      std::uint64_t total = static_cast<std::uint64_t>(CHAINS) * CONNECTIONS_PER_CHAIN;
+
+      std::uint64_t start = firelink_bench::now_ns();
+      for (std::uint32_t c = 0; c < CHAINS; ++c)
+        connect_chain(client_core, server_ep, done, CONNECTIONS_PER_CHAIN);
+
+      if (!firelink_bench::wait_until([&]() { return done->load() == total && accepted->load() >= total; }))
+        std::cerr << "acceptor: " << name << " timed out" << std::endl;
+
+      std::uint64_t elapsed = firelink_bench::now_ns() - start;
+      report.add(name, static_cast<double>(accepted->load()) / (static_cast<double>(elapsed) / 1e9), "conn/s");
+    }
+    else
+    {
+      std::cerr << "acceptor: " << name << " setup error " << static_cast<int>(err) << std::endl;
+    }
+
+    if (acceptor.has_value())
+      acceptor.value()->stop();
+
+    for (std::shared_ptr<firelink::IOCore>& io_core : io_cores)
+      io_core->release();
+  }
+
+  void acceptor_bench(firelink_bench::Report& report)
+  {
+    run_acceptor(report, 1, 1, "pending_1");
+    run_acceptor(report, 16, 1, "pending_16");
+    run_acceptor(report, 16, 2, "pending_16_two_cores");
+  }
+
+  firelink_bench::Registrar registrar("acceptor", "accepts per second with 1 vs 16 posted accepts",
+                                      acceptor_bench);
+}
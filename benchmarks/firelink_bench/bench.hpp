@@ -0,0 +1,103 @@
+#ifndef FIRELINK_BENCH_H
+#define FIRELINK_BENCH_H
+
+#include "firelink/latency_histogram.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace firelink_bench
+{
+  struct Result
+  {
+    std::string name;
+    double value;
+    std::string unit;
+  };
+
+  // Collects the results of a single benchmark
+  class Report
+  {
+    public:
+    void add(std::string_view name, double value, std::string_view unit)
+    {
+      results_.push_back(Result{std::string(name), value, std::string(unit)});
+    }
+
+    // Adds the percentiles of a histogram of nanosecond values, in microseconds
+    void add_latency(std::string_view name, const firelink::LatencyHistogram& histogram)
+    {
+      std::string prefix(name);
+      add(prefix + "_p50", static_cast<double>(histogram.percentile(50.0)) / 1000.0, "us");
+      add(prefix + "_p90", static_cast<double>(histogram.percentile(90.0)) / 1000.0, "us");
+      add(prefix + "_p99", static_cast<double>(histogram.percentile(99.0)) / 1000.0, "us");
+      add(prefix + "_p99.9", static_cast<double>(histogram.percentile(99.9)) / 1000.0, "us");
+      add(prefix + "_max", static_cast<double>(histogram.max()) / 1000.0, "us");
+      add(prefix + "_mean", histogram.mean() / 1000.0, "us");
+    }
+
+    const std::vector<Result>& results() const { return results_; }
+
+    private:
+    std::vector<Result> results_;
+  };
+
+  // Scenario parameters of the loopback benchmarks, set from the command line
+  struct Options
+  {
+    std::size_t message_size = 64;
+    std::uint32_t connections = 64;
+    std::uint32_t duration_ms = 2000;
+    std::uint32_t io_threads = 2;
+    std::uint32_t user_threads = 2;
+  };
+
+  inline Options& options()
+  {
+    static Options opts{};
+    return opts;
+  }
+
+  using BenchFunction = void(*)(Report& report);
+
+  struct Benchmark
+  {
+    const char* name;
+    const char* description;
+    BenchFunction func;
+  };
+
+  inline std::vector<Benchmark>& registry()
+  {
+    static std::vector<Benchmark> benchmarks{};
+    return benchmarks;
+  }
+
+  // Benchmarks register themselves from their own translation unit with a static Registrar
+  struct Registrar
+  {
+    Registrar(const char* name, const char* description, BenchFunction func)
+    {
+      registry().push_back(Benchmark{name, description, func});
+    }
+  };
+
+  inline std::uint64_t now_ns()
+  {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+  // Prevents the compiler from optimizing away a computed value
+  template<typename T>
+  inline void do_not_optimize(const T& value)
+  {
+    asm volatile("" : : "r,m"(value) : "memory");
+  }
+}
+
+#endif /* FIRELINK_BENCH_H */
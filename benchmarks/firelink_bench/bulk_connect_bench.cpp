@@ -0,0 +1,104 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+#include "firelink/acceptor.hpp"
+#include "firelink/bulk_connect.hpp"
+
+#include <string>
+
+/*
+ * Connection rate of connect_bulk against a loopback server that closes every connection right after
+ * accepting it. The destinations are the same server repeated, with different in-flight limits, and with
+ * and without SO_REUSE_UNICASTPORT. The client sockets stay open until the whole batch has completed.
+ */
+
+namespace
+{
+  constexpr std::uint32_t DESTINATIONS = 2000;
+
+  void run_bulk(firelink_bench::Report& report, std::shared_ptr<firelink::IOCore> client_core,
+                const firelink::Endpoint& server_ep, const firelink::BulkConnectConfig& config, const std::string& name)
+  {
+    std::vector<firelink::Endpoint> destinations(DESTINATIONS, server_ep);
+    auto done = std::make_shared<std::atomic<bool>>(false);
+    auto connected = std::make_shared<std::atomic<std::uint64_t>>(0);
+
+    std::uint64_t start = firelink_bench::now_ns();
+    firelink::ErrorCode err = firelink::connect_bulk(client_core, std::move(destinations),
+                                                     [done, connected](std::vector<firelink::ConnectResult>& results,
+                                                                       firelink::BulkConnectTag)
+    {
+      for (firelink::ConnectResult& result : results)
+      {
+        if (result.error_ != firelink::ErrorCode::Success)
+          continue;
+
+        connected->fetch_add(1);
+        result.socket_->close();
+      }
+
+      done->store(true);
+    }, config);
+
+    if (err != firelink::ErrorCode::Success || !firelink_bench::wait_until([&]() { return done->load(); }))
+    {
+      std::cerr << "bulk_connect: " << name << " failed" << std::endl;
+      return;
+    }
+
+    std::uint64_t elapsed = firelink_bench::now_ns() - start;
+    report.add(name, static_cast<double>(connected->load()) / (static_cast<double>(elapsed) / 1e9), "conn/s");
+  }
+
+  void bulk_connect_bench(firelink_bench::Report& report)
+  {
+    auto server_core = firelink_bench::make_io_core(2, 2);
+    auto client_core = firelink_bench::make_io_core(2, 2);
+    if (!server_core.has_value() || !client_core.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error" << std::endl;
+      if (server_core.has_value())
+        server_core.value()->release();
+      if (client_core.has_value())
+        client_core.value()->release();
+      return;
+    }
+
+    auto acceptor = firelink::Acceptor::create({server_core.value()}, {16, 1024});
+    firelink::Endpoint server_ep{};
+    firelink::ErrorCode err = acceptor.has_value() ? acceptor.value()->open(firelink::AddressFamily::IPv4,
+                                                                            firelink::IPv4Address::loopback(0))
+                                                   : acceptor.error();
+    if (err == firelink::ErrorCode::Success)
+      err = acceptor.value()->get_local_endpoint(server_ep);
+
+    if (err == firelink::ErrorCode::Success)
+    {
+      err = acceptor.value()->start([](std::shared_ptr<firelink::Socket> socket, const firelink::Endpoint&,
+                                       firelink::ErrorCode error, firelink::ConnectionTag)
+      {
+        if (error == firelink::ErrorCode::Success)
+          socket->close();
+      });
+    }
+
+    if (err == firelink::ErrorCode::Success)
+    {
+      run_bulk(report, client_core.value(), server_ep, {64, true}, "in_flight_64");
+      run_bulk(report, client_core.value(), server_ep, {512, true}, "in_flight_512");
+      run_bulk(report, client_core.value(), server_ep, {512, false}, "in_flight_512_no_port_reuse");
+    }
+    else
+    {
+      std::cerr << "bulk_connect: setup error " << static_cast<int>(err) << std::endl;
+    }
+
+    if (acceptor.has_value())
+      acceptor.value()->stop();
+
+    client_core.value()->release();
+    server_core.value()->release();
+  }
+
+  firelink_bench::Registrar registrar("bulk_connect", "connections per second of connect_bulk with 64 vs 512 in flight",
+                                      bulk_connect_bench);
+}
@@ -0,0 +1,133 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+
+#include <algorithm>
+#include <string>
+
+/*
+ * Busy polling. Runs echo round trips over loopback and reports p50/p99/p99.9 of the round trip time three
+ * times: without busy polling, with it enabled only on the client socket (Socket::set_busy_poll), and with it
+ * enabled for every socket of the IOCore (IOCoreConfig::busy_poll_us_). Busy polling trades the spinning
+ * threads' CPU time for latency, so the runs are only comparable on an otherwise idle machine.
+ */
+
+namespace
+{
+  constexpr std::uint32_t ROUND_TRIPS = 20'000;
+  constexpr std::size_t MESSAGE_SIZE = 64;
+  constexpr std::uint32_t BUSY_POLL_US = 50;
+
+  struct RoundTrips
+  {
+    std::vector<std::uint64_t> samples_ns_;
+    std::atomic<std::uint32_t> done_{0};
+    std::uint64_t sent_ns_ = 0;
+  };
+
+  void ping_pong(std::shared_ptr<firelink::Socket> socket, std::shared_ptr<std::vector<std::byte>> buffer,
+                 std::shared_ptr<RoundTrips> round_trips, std::uint32_t remaining)
+  {
+    if (remaining == 0)
+      return;
+
+    round_trips->sent_ns_ = firelink_bench::now_ns();
+    socket->start_send(*buffer, [buffer, round_trips, remaining](std::shared_ptr<firelink::Socket> caller,
+                                                                 firelink::ErrorCode error, std::int32_t, firelink::WriteTag)
+    {
+      if (error != firelink::ErrorCode::Success)
+      {
+        round_trips->done_.fetch_add(remaining);
+        return;
+      }
+
+      caller->start_recv(*buffer, [buffer, round_trips, remaining](std::shared_ptr<firelink::Socket> caller,
+                                                                   firelink::ErrorCode error, std::int32_t, firelink::ReadTag)
+      {
+        if (error != firelink::ErrorCode::Success)
+        {
+          round_trips->done_.fetch_add(remaining);
+          return;
+        }
+
+        round_trips->samples_ns_.push_back(firelink_bench::now_ns() - round_trips->sent_ns_);
+        round_trips->done_.fetch_add(1);
+        ping_pong(std::move(caller), buffer, round_trips, remaining - 1);
+      });
+    });
+  }
+
+  // Returns the sorted round trip times, empty on error
+  std::vector<std::uint64_t> run(std::uint32_t core_busy_poll_us, std::uint32_t client_busy_poll_us)
+  {
+    firelink::IOCoreConfig config{2, 2, 2, 2};
+    config.busy_poll_us_ = core_busy_poll_us;
+
+    auto created = firelink::IOCore::create(config);
+    if (!created.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(created.error()) << std::endl;
+      return {};
+    }
+
+    std::shared_ptr<firelink::IOCore> io_core(std::move(created.value()));
+
+    firelink::Endpoint listener_ep{};
+    auto listener = firelink_bench::make_listener(io_core, 1, listener_ep);
+    auto client = firelink_bench::make_tcp_socket(io_core);
+    firelink::ErrorCode err = listener.has_value() ? firelink::ErrorCode::Success : listener.error();
+    if (err == firelink::ErrorCode::Success)
+      err = client.has_value() ? client.value()->connect(listener_ep) : client.error();
+
+    if (err != firelink::ErrorCode::Success)
+    {
+      std::cerr << "busy_poll: setup error " << static_cast<int>(err) << std::endl;
+      io_core->release();
+      return {};
+    }
+
+    if (client_busy_poll_us != 0)
+      client.value()->set_busy_poll(client_busy_poll_us);
+
+    firelink_bench::serve_echo(io_core, listener.value());
+
+    auto round_trips = std::make_shared<RoundTrips>();
+    round_trips->samples_ns_.reserve(ROUND_TRIPS);
+    ping_pong(client.value(), std::make_shared<std::vector<std::byte>>(MESSAGE_SIZE), round_trips, ROUND_TRIPS);
+    if (!firelink_bench::wait_until([&]() { return round_trips->done_.load() == ROUND_TRIPS; }))
+      std::cerr << "busy_poll: round trips timed out" << std::endl;
+
+    client.value()->close();
+    listener.value()->close();
+    io_core->release();
+
+    std::vector<std::uint64_t> samples = std::move(round_trips->samples_ns_);
+    std::sort(samples.begin(), samples.end());
+    return samples;
+  }
+
+  void report_percentiles(firelink_bench::Report& report, const std::string& prefix, const std::vector<std::uint64_t>& samples)
+  {
+    if (samples.empty())
+      return;
+
+    auto percentile = [&samples](double p)
+    {
+      std::size_t index = static_cast<std::size_t>(p / 100.0 * static_cast<double>(samples.size() - 1));
+      return static_cast<double>(samples[index]) / 1000.0;
+    };
+
+    report.add(prefix + "_p50", percentile(50.0), "us");
+    report.add(prefix + "_p99", percentile(99.0), "us");
+    report.add(prefix + "_p99.9", percentile(99.9), "us");
+  }
+
+  void busy_poll_bench(firelink_bench::Report& report)
+  {
+    report_percentiles(report, "rtt_off", run(0, 0));
+    report_percentiles(report, "rtt_client_socket", run(0, BUSY_POLL_US));
+    report_percentiles(report, "rtt_io_core", run(BUSY_POLL_US, 0));
+  }
+
+  firelink_bench::Registrar registrar("busy_poll", "echo round trip percentiles with and without busy polling",
+                                      busy_poll_bench);
+}
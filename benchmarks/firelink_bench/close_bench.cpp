@@ -0,0 +1,104 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+
+#include <string>
+
+/*
+ * Closing sockets with a pending receive. Opens PAIRS loopback pairs, posts a receive on every client and
+ * closes the clients, once with cancel() and the blocking close() and once with start_close(). Reports the
+ * time the closing thread spent per socket, and the time until every aborted receive and close handler ran.
+ */
+
+namespace
+{
+  constexpr std::uint32_t PAIRS = 256;
+  constexpr std::size_t BUFFER_SIZE = 64;
+
+  struct Closing
+  {
+    std::atomic<std::uint32_t> recvs_done_{0};
+    std::atomic<std::uint32_t> closes_done_{0};
+  };
+
+  void run(firelink_bench::Report& report, const std::string& prefix, bool async)
+  {
+    auto io_core = firelink_bench::make_io_core();
+    if (!io_core.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core.error()) << std::endl;
+      return;
+    }
+
+    std::vector<firelink_bench::LoopbackPair> pairs;
+    pairs.reserve(PAIRS);
+    for (std::uint32_t i = 0; i < PAIRS; ++i)
+    {
+      auto pair = firelink_bench::make_loopback_pair(io_core.value());
+      if (!pair.has_value())
+      {
+        std::cerr << "close: make_loopback_pair error " << static_cast<int>(pair.error()) << std::endl;
+        break;
+      }
+
+      pairs.push_back(pair.value());
+    }
+
+    auto closing = std::make_shared<Closing>();
+    auto buffers = std::make_shared<std::vector<std::vector<std::byte>>>(pairs.size(), std::vector<std::byte>(BUFFER_SIZE));
+    for (std::size_t i = 0; i < pairs.size(); ++i)
+    {
+      pairs[i].client->start_recv((*buffers)[i], [closing, buffers](std::shared_ptr<firelink::Socket>, firelink::ErrorCode,
+                                                                    std::int32_t, firelink::ReadTag)
+      {
+        closing->recvs_done_.fetch_add(1);
+      });
+    }
+
+    std::uint64_t start = firelink_bench::now_ns();
+    for (firelink_bench::LoopbackPair& pair : pairs)
+    {
+      if (!async)
+      {
+        // close() waits for the callbacks of pending operations, so the receive has to be aborted first
+        pair.client->cancel();
+        pair.client->close();
+        continue;
+      }
+
+      pair.client->start_close([closing](std::shared_ptr<firelink::Socket>, firelink::ErrorCode, firelink::CloseTag)
+      {
+        closing->closes_done_.fetch_add(1);
+      });
+    }
+    std::uint64_t caller_ns = firelink_bench::now_ns() - start;
+
+    std::uint32_t expected = static_cast<std::uint32_t>(pairs.size());
+    bool finished = firelink_bench::wait_until([&]()
+    {
+      return closing->recvs_done_.load() == expected && (!async || closing->closes_done_.load() == expected);
+    });
+    std::uint64_t total_ns = firelink_bench::now_ns() - start;
+
+    if (!finished)
+      std::cerr << "close: " << prefix << " handlers timed out" << std::endl;
+
+    for (firelink_bench::LoopbackPair& pair : pairs)
+      pair.server->close();
+    io_core.value()->release();
+
+    if (pairs.empty())
+      return;
+
+    report.add(prefix + "_caller", static_cast<double>(caller_ns) / static_cast<double>(pairs.size()), "ns/socket");
+    report.add(prefix + "_all_handlers", static_cast<double>(total_ns) / 1000.0, "us");
+  }
+
+  void close_bench(firelink_bench::Report& report)
+  {
+    run(report, "close", false);
+    run(report, "start_close", true);
+  }
+
+  firelink_bench::Registrar registrar("close", "blocking close and start_close of sockets with a pending receive",
+                                      close_bench);
+}
@@ -0,0 +1,347 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+#include "firelink/connect_any.hpp"
+
+#include <expected>
+#include <string>
+
+/*
+ * Time to a connected socket when the preferred address is blackholed. The first endpoint is a loopback port
+ * that is bound but not listening (Windows retries the SYN there for about two seconds before giving up),
+ * the second one a listener. Compares trying the endpoints one after another with connect_any.
+ *
+ * Then checks the race itself, each scenario on its own IOCore so the connect counters start at zero:
+ *   fallback      the listener wins, and its attempt started no earlier than the attempt delay
+ *   cancellation  the blackholed loser completes with OperationAborted right after the win, long before its
+ *                 SYN retries would have run out
+ *   failure       with two blackholed endpoints the handler is called once, without a socket and with the
+ *                 error of the last attempt
+ * Every scenario reports its time and the number of checks that failed, which are also printed to stderr.
+ */
+
+namespace
+{
+  constexpr std::uint32_t ROUNDS = 5;
+  constexpr std::uint32_t FALLBACK_DELAY_MS = 100;
+
+  // Windows gives up on a loopback port that is not listening after about two seconds. A loser has to be gone
+  // well before that to count as cancelled.
+  constexpr std::chrono::milliseconds CANCEL_DEADLINE{500};
+
+  struct Outcome
+  {
+    std::atomic<std::uint32_t> calls_{0};
+    std::atomic<bool> done_{false};
+    std::shared_ptr<firelink::Socket> socket_;
+    firelink::Endpoint endpoint_{};
+    firelink::ErrorCode error_ = firelink::ErrorCode::Success;
+    std::uint64_t elapsed_ns_ = 0;
+  };
+
+  // Binds a TCP socket to an ephemeral loopback port without listening on it, so connects to it hang
+  std::expected<std::shared_ptr<firelink::Socket>, firelink::ErrorCode>
+  make_blackhole(std::shared_ptr<firelink::IOCore> io_core, firelink::Endpoint& local_endpoint)
+  {
+    auto blackhole = firelink_bench::make_tcp_socket(io_core);
+    if (!blackhole.has_value())
+      return blackhole;
+
+    firelink::ErrorCode err = blackhole.value()->bind(firelink::IPv4Address::loopback(0));
+    if (err == firelink::ErrorCode::Success)
+      err = blackhole.value()->get_sock_name(local_endpoint);
+
+    if (err != firelink::ErrorCode::Success)
+    {
+      blackhole.value()->close();
+      return std::unexpected(err);
+    }
+
+    return blackhole;
+  }
+
+  // Runs connect_any and waits for its handler
+  std::shared_ptr<Outcome> race(std::shared_ptr<firelink::IOCore> io_core, std::vector<firelink::Endpoint> endpoints,
+                                const firelink::ConnectAnyConfig& config)
+  {
+    auto outcome = std::make_shared<Outcome>();
+    std::uint64_t start = firelink_bench::now_ns();
+    firelink::ErrorCode err = firelink::connect_any(io_core, std::move(endpoints),
+      [outcome, start](std::shared_ptr<firelink::Socket> socket, const firelink::Endpoint& endpoint,
+                       firelink::ErrorCode error, firelink::ConnectAnyTag)
+    {
+      if (outcome->calls_.fetch_add(1) != 0)
+      {
+        if (socket)
+          socket->close();
+        return;
+      }
+
+      outcome->elapsed_ns_ = firelink_bench::now_ns() - start;
+      outcome->socket_ = std::move(socket);
+      outcome->endpoint_ = endpoint;
+      outcome->error_ = error;
+      outcome->done_.store(true);
+    }, config);
+
+    if (err != firelink::ErrorCode::Success)
+    {
+      outcome->error_ = err;
+      outcome->calls_.store(1);
+      outcome->done_.store(true);
+      return outcome;
+    }
+
+    firelink_bench::wait_until([&]() { return outcome->done_.load(); });
+    return outcome;
+  }
+
+  std::uint64_t count_error(const firelink::IOCoreStats& stats, firelink::ErrorCode error)
+  {
+    for (const firelink::ErrorCount& count : stats.errors_)
+    {
+      if (count.error_ == error)
+        return count.count_;
+    }
+
+    return 0;
+  }
+
+  class Checks
+  {
+    public:
+    explicit Checks(std::string scenario) : scenario_(std::move(scenario)) {}
+
+    void expect(bool passed, const char* what)
+    {
+      if (passed)
+        return;
+
+      failed_++;
+      std::cerr << "connect_any: " << scenario_ << ": " << what << std::endl;
+    }
+
+    std::uint32_t failed() const { return failed_; }
+
+    private:
+    std::string scenario_;
+    std::uint32_t failed_ = 0;
+  };
+
+  // start_connect to each endpoint in turn until one succeeds
+  void connect_sequential(std::shared_ptr<firelink::IOCore> io_core, std::vector<firelink::Endpoint> endpoints,
+                          std::size_t index, std::shared_ptr<std::atomic<bool>> done)
+  {
+    if (index == endpoints.size())
+    {
+      done->store(true);
+      return;
+    }
+
+    auto sock = firelink_bench::make_tcp_socket(io_core);
+    if (!sock.has_value())
+    {
+      done->store(true);
+      return;
+    }
+
+    firelink::Endpoint dst = endpoints[index];
+    firelink::ErrorCode err = sock.value()->start_connect(dst, [io_core, endpoints, index, done](
+                                                          std::shared_ptr<firelink::Socket> caller,
+                                                          firelink::ErrorCode error, firelink::ConnectTag)
+    {
+      caller->close();
+      if (error == firelink::ErrorCode::Success)
+        done->store(true);
+      else
+        connect_sequential(io_core, endpoints, index + 1, done);
+    });
+
+    if (err != firelink::ErrorCode::Success)
+    {
+      sock.value()->close();
+      connect_sequential(io_core, endpoints, index + 1, done);
+    }
+  }
+
+  // The preferred endpoint is blackholed: the listener wins once the attempt delay has passed, and the
+  // blackholed attempt is cancelled and closed
+  void check_fallback(firelink_bench::Report& report)
+  {
+    auto io_core = firelink_bench::make_io_core(2, 2);
+    if (!io_core.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core.error()) << std::endl;
+      return;
+    }
+
+    firelink::Endpoint listener_ep{};
+    firelink::Endpoint blackhole_ep{};
+    auto listener = firelink_bench::make_listener(io_core.value(), 64, listener_ep);
+    auto blackhole = make_blackhole(io_core.value(), blackhole_ep);
+    if (!listener.has_value() || !blackhole.has_value())
+    {
+      std::cerr << "connect_any: fallback setup error" << std::endl;
+      io_core.value()->release();
+      return;
+    }
+
+    firelink_bench::serve_echo(io_core.value(), listener.value());
+
+    firelink::ConnectAnyConfig config{};
+    config.attempt_delay_ms_ = FALLBACK_DELAY_MS;
+    std::shared_ptr<Outcome> outcome = race(io_core.value(), {blackhole_ep, listener_ep}, config);
+
+    Checks fallback("fallback");
+    fallback.expect(outcome->done_.load(), "handler was not called");
+    fallback.expect(outcome->error_ == firelink::ErrorCode::Success && outcome->socket_ != nullptr,
+                    "no connected socket");
+    fallback.expect(outcome->endpoint_ == listener_ep, "won by the wrong endpoint");
+
+    // Timers may fire up to a tick early
+    fallback.expect(outcome->elapsed_ns_ >= (FALLBACK_DELAY_MS - 16) * 1000000ull, "second attempt started before the delay");
+    fallback.expect(outcome->elapsed_ns_ < std::chrono::nanoseconds(CANCEL_DEADLINE).count() + FALLBACK_DELAY_MS * 1000000ull,
+                    "second attempt started long after the delay");
+
+    // Both attempts have completed once the loser's connect is aborted
+    Checks cancellation("cancellation");
+    bool losers_gone = firelink_bench::wait_until([&]()
+    {
+      const firelink::OperationStats connects = io_core.value()->stats().operation(firelink::Operation::Connect);
+      return connects.started_ == 2 && connects.completed_ == 2;
+    }, CANCEL_DEADLINE);
+
+    firelink::IOCoreStats stats = io_core.value()->stats();
+    cancellation.expect(losers_gone, "blackholed attempt still pending");
+    cancellation.expect(count_error(stats, firelink::ErrorCode::OperationAborted) == 1,
+                        "blackholed attempt did not end with OperationAborted");
+    cancellation.expect(outcome->calls_.load() == 1, "handler called more than once");
+
+    report.add("check_fallback_connect", static_cast<double>(outcome->elapsed_ns_) / 1e6, "ms");
+    report.add("check_fallback_failed", static_cast<double>(fallback.failed()), "checks");
+    report.add("check_cancellation_failed", static_cast<double>(cancellation.failed()), "checks");
+
+    if (outcome->socket_)
+      outcome->socket_->close();
+    listener.value()->cancel();
+    listener.value()->close();
+    blackhole.value()->close();
+    io_core.value()->release();
+  }
+
+  // Every endpoint is blackholed: the handler is called once, without a socket, after the last attempt failed
+  void check_failure(firelink_bench::Report& report)
+  {
+    auto io_core = firelink_bench::make_io_core(2, 2);
+    if (!io_core.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core.error()) << std::endl;
+      return;
+    }
+
+    firelink::Endpoint first_ep{};
+    firelink::Endpoint second_ep{};
+    auto first = make_blackhole(io_core.value(), first_ep);
+    auto second = make_blackhole(io_core.value(), second_ep);
+    if (!first.has_value() || !second.has_value())
+    {
+      std::cerr << "connect_any: failure setup error" << std::endl;
+      io_core.value()->release();
+      return;
+    }
+
+    firelink::ConnectAnyConfig config{};
+    config.attempt_delay_ms_ = FALLBACK_DELAY_MS;
+    std::shared_ptr<Outcome> outcome = race(io_core.value(), {first_ep, second_ep}, config);
+
+    // Give a second, wrong call of the handler the time to show up
+    std::this_thread::sleep_for(std::chrono::milliseconds(FALLBACK_DELAY_MS));
+
+    Checks failure("failure");
+    firelink::OperationStats connects = io_core.value()->stats().operation(firelink::Operation::Connect);
+    failure.expect(outcome->done_.load(), "handler was not called");
+    failure.expect(outcome->calls_.load() == 1, "handler called more than once");
+    failure.expect(outcome->socket_ == nullptr, "handler got a socket");
+    failure.expect(outcome->error_ != firelink::ErrorCode::Success &&
+                   outcome->error_ != firelink::ErrorCode::OperationAborted, "handler did not get the connect error");
+    failure.expect(connects.started_ == 2 && connects.failed_ == 2, "not every endpoint was tried");
+
+    report.add("check_failure_handler", static_cast<double>(outcome->elapsed_ns_) / 1e6, "ms");
+    report.add("check_failure_failed", static_cast<double>(failure.failed()), "checks");
+
+    if (outcome->socket_)
+      outcome->socket_->close();
+    first.value()->close();
+    second.value()->close();
+    io_core.value()->release();
+  }
+
+  void connect_any_bench(firelink_bench::Report& report)
+  {
+    auto io_core = firelink_bench::make_io_core(2, 2);
+    if (!io_core.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core.error()) << std::endl;
+      return;
+    }
+
+    firelink::Endpoint listener_ep{};
+    auto listener = firelink_bench::make_listener(io_core.value(), 64, listener_ep);
+
+    firelink::Endpoint blackhole_ep{};
+    auto blackhole = make_blackhole(io_core.value(), blackhole_ep);
+    firelink::ErrorCode err = listener.has_value() ? firelink::ErrorCode::Success : listener.error();
+    if (err == firelink::ErrorCode::Success && !blackhole.has_value())
+      err = blackhole.error();
+
+    if (err != firelink::ErrorCode::Success)
+    {
+      std::cerr << "connect_any: setup error " << static_cast<int>(err) << std::endl;
+      io_core.value()->release();
+      return;
+    }
+
+    firelink_bench::serve_echo(io_core.value(), listener.value());
+    std::vector<firelink::Endpoint> endpoints{blackhole_ep, listener_ep};
+
+    std::uint64_t sequential_ns = 0;
+    std::uint64_t racing_ns = 0;
+    for (std::uint32_t r = 0; r < ROUNDS; ++r)
+    {
+      auto done = std::make_shared<std::atomic<bool>>(false);
+      std::uint64_t start = firelink_bench::now_ns();
+      connect_sequential(io_core.value(), endpoints, 0, done);
+      if (!firelink_bench::wait_until([&]() { return done->load(); }))
+        std::cerr << "connect_any: sequential connect timed out" << std::endl;
+      sequential_ns += firelink_bench::now_ns() - start;
+
+      auto raced = std::make_shared<std::atomic<bool>>(false);
+      start = firelink_bench::now_ns();
+      err = firelink::connect_any(io_core.value(), endpoints, [raced](std::shared_ptr<firelink::Socket> socket,
+                                                                     const firelink::Endpoint&,
+                                                                     firelink::ErrorCode, firelink::ConnectAnyTag)
+      {
+        if (socket)
+          socket->close();
+        raced->store(true);
+      });
+
+      if (err != firelink::ErrorCode::Success || !firelink_bench::wait_until([&]() { return raced->load(); }))
+        std::cerr << "connect_any: connect_any failed" << std::endl;
+      racing_ns += firelink_bench::now_ns() - start;
+    }
+
+    report.add("sequential_fallback", static_cast<double>(sequential_ns) / ROUNDS / 1e6, "ms");
+    report.add("connect_any_250ms_delay", static_cast<double>(racing_ns) / ROUNDS / 1e6, "ms");
+
+    listener.value()->cancel();
+    listener.value()->close();
+    blackhole.value()->close();
+    io_core.value()->release();
+
+    check_fallback(report);
+    check_failure(report);
+  }
+
+  firelink_bench::Registrar registrar("connect_any", "time to connect with a blackholed first address, sequential vs connect_any",
+                                      connect_any_bench);
+}
@@ -0,0 +1,187 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+#include "firelink/connection_pool.hpp"
+
+#include <array>
+#include <functional>
+
+/*
+ * Small request/response exchanges against a loopback echo server. Compares opening a fresh connection
+ * for every request (connect, request, close) against borrowing a warm connection from a ConnectionPool
+ * (acquire, request, release). Several chains run concurrently, each issuing its next request as soon as
+ * the previous one has completed.
+ */
+
+namespace
+{
+  constexpr std::uint32_t CHAINS = 8;
+  constexpr std::uint32_t REQUESTS_PER_CHAIN = 1000;
+  constexpr std::size_t REQUEST_SIZE = 64;
+
+  // One blocking request/response on a connected socket
+  bool round_trip(firelink::Socket& socket)
+  {
+    std::array<std::byte, REQUEST_SIZE> request{};
+    std::array<std::byte, REQUEST_SIZE> response{};
+    request.fill(std::byte{0x2A});
+
+    if (socket.send(request) != static_cast<std::int32_t>(REQUEST_SIZE))
+      return false;
+
+    std::size_t received = 0;
+    while (received < REQUEST_SIZE)
+    {
+      std::int32_t n = socket.recv(std::span<std::byte>(response).subspan(received));
+      if (n <= 0)
+        return false;
+
+      received += static_cast<std::size_t>(n);
+    }
+
+    return true;
+  }
+
+  struct ChainState
+  {
+    std::atomic<std::uint64_t> completed{0};
+    std::atomic<std::uint64_t> failed{0};
+  };
+
+  void fresh_chain(std::shared_ptr<firelink::IOCore> io_core, firelink::Endpoint dst,
+                   std::shared_ptr<ChainState> state, std::uint32_t remaining)
+  {
+    if (remaining == 0)
+      return;
+
+    auto sock = firelink_bench::make_tcp_socket(io_core);
+    if (!sock.has_value())
+    {
+      state->failed.fetch_add(remaining);
+      return;
+    }
+
+    firelink::ErrorCode err = sock.value()->start_connect(dst, [io_core, dst, state, remaining](
+                                                          std::shared_ptr<firelink::Socket> caller,
+                                                          firelink::ErrorCode error, firelink::ConnectTag)
+    {
+      if (error == firelink::ErrorCode::Success && round_trip(*caller))
+        state->completed.fetch_add(1);
+      else
+        state->failed.fetch_add(1);
+
+      caller->close();
+      fresh_chain(io_core, dst, state, remaining - 1);
+    });
+
+    if (err != firelink::ErrorCode::Success)
+    {
+      sock.value()->close();
+      state->failed.fetch_add(remaining);
+    }
+  }
+
+  void pooled_chain(std::shared_ptr<firelink::ConnectionPool> pool, firelink::Endpoint dst,
+                    std::shared_ptr<ChainState> state, std::uint32_t remaining)
+  {
+    if (remaining == 0)
+      return;
+
+    firelink::ErrorCode err = pool->async_acquire(dst, [pool, dst, state, remaining](std::shared_ptr<firelink::Socket> socket,
+                                                                                   firelink::ErrorCode error,
+                                                                                   firelink::AcquireTag)
+    {
+      if (error == firelink::ErrorCode::Success && round_trip(*socket))
+      {
+        state->completed.fetch_add(1);
+        pool->release(std::move(socket));
+      }
+      else
+      {
+        state->failed.fetch_add(1);
+        pool->release(std::move(socket), false);
+      }
+
+      pooled_chain(pool, dst, state, remaining - 1);
+    });
+
+    if (err != firelink::ErrorCode::Success)
+      state->failed.fetch_add(remaining);
+  }
+
+  template<typename StartChain>
+  double run_chains(StartChain&& start_chain, const char* name)
+  {
+    auto state = std::make_shared<ChainState>();
+    std::uint64_t total = static_cast<std::uint64_t>(CHAINS) * REQUESTS_PER_CHAIN;
+
+    std::uint64_t start = firelink_bench::now_ns();
+    for (std::uint32_t c = 0; c < CHAINS; ++c)
+      start_chain(state);
+
+    bool done = firelink_bench::wait_until([&]()
+    {
+      return state->completed.load() + state->failed.load() == total;
+    });
+
+    std::uint64_t elapsed = firelink_bench::now_ns() - start;
+    if (!done)
+      std::cerr << "connection_pool: " << name << " timed out" << std::endl;
+    if (state->failed.load() != 0)
+      std::cerr << "connection_pool: " << name << " had " << state->failed.load() << " failed requests" << std::endl;
+
+    return static_cast<double>(state->completed.load()) / (static_cast<double>(elapsed) / 1e9);
+  }
+
+  void connection_pool_bench(firelink_bench::Report& report)
+  {
+    auto io_core = firelink_bench::make_io_core(4, 4);
+    if (!io_core.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core.error()) << std::endl;
+      return;
+    }
+
+    firelink::Endpoint server_ep{};
+    auto listener = firelink_bench::make_listener(io_core.value(), 512, server_ep);
+    if (!listener.has_value())
+    {
+      std::cerr << "connection_pool: listener error " << static_cast<int>(listener.error()) << std::endl;
+      io_core.value()->release();
+      return;
+    }
+
+    firelink_bench::serve_echo(io_core.value(), listener.value());
+
+    double fresh_rate = run_chains([&](std::shared_ptr<ChainState> state)
+    {
+      fresh_chain(io_core.value(), server_ep, state, REQUESTS_PER_CHAIN);
+    }, "connect_per_request");
+    report.add("connect_per_request", fresh_rate, "req/s");
+
+    auto pool = firelink::ConnectionPool::create(io_core.value(), {CHAINS, CHAINS, 60000, true});
+    if (pool.has_value())
+    {
+      double pooled_rate = run_chains([&](std::shared_ptr<ChainState> state)
+      {
+        pooled_chain(pool.value(), server_ep, state, REQUESTS_PER_CHAIN);
+      }, "pooled");
+      report.add("pooled", pooled_rate, "req/s");
+
+      firelink::ConnectionPoolStats stats = pool.value()->stats();
+      report.add("pooled_connects", static_cast<double>(stats.connects_), "connections");
+      report.add("pooled_reuses", static_cast<double>(stats.reuses_), "acquires");
+      pool.value()->clear();
+    }
+    else
+    {
+      std::cerr << "firelink::ConnectionPool::create error " << static_cast<int>(pool.error()) << std::endl;
+    }
+
+    listener.value()->cancel();
+    listener.value()->close();
+    io_core.value()->release();
+  }
+
+  firelink_bench::Registrar registrar("connection_pool", "request/response with a fresh vs pooled connection",
+                                      connection_pool_bench);
+}
@@ -0,0 +1,127 @@
+#include "bench.hpp"
+#include "firelink/endpoint_map.hpp"
+
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Per-peer session lookup as done by a UDP server on every datagram. A table of peers is filled once, then
+ * looked up in random order, half of the lookups for peers that are not in the table. Compares EndpointMap
+ * against std::unordered_map with std::hash<Endpoint>.
+ */
+
+namespace
+{
+  constexpr std::size_t LOOKUPS = 4'000'000;
+
+  struct Session
+  {
+    std::uint64_t last_seen = 0;
+    std::uint64_t datagrams = 0;
+  };
+
+  std::vector<firelink::Endpoint> make_peers(std::size_t count, std::uint32_t seed)
+  {
+    std::mt19937 rng(seed);
+    std::vector<firelink::Endpoint> peers{};
+    peers.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      // Mostly IPv4 clients from a few /16 networks with ephemeral ports, plus some IPv6 ones
+      if (rng() % 8 != 0)
+      {
+        std::uint32_t r = rng();
+        peers.push_back(firelink::IPv4Address({10, static_cast<std::uint8_t>(r % 4), static_cast<std::uint8_t>(r >> 8),
+                                               static_cast<std::uint8_t>(r >> 16)},
+                                              static_cast<std::uint16_t>(49152 + rng() % 16384)));
+      }
+      else
+      {
+        firelink::IPv6Address addr{};
+        addr.bytes[0] = 0x20;
+        addr.bytes[1] = 0x01;
+        for (std::size_t b = 8; b < 16; ++b)
+          addr.bytes[b] = static_cast<std::uint8_t>(rng());
+        addr.port = static_cast<std::uint16_t>(49152 + rng() % 16384);
+        peers.push_back(addr);
+      }
+    }
+
+    return peers;
+  }
+
+  std::vector<firelink::Endpoint> make_probes(const std::vector<firelink::Endpoint>& present,
+                                              const std::vector<firelink::Endpoint>& absent)
+  {
+    std::mt19937 rng(7);
+    std::vector<firelink::Endpoint> probes(LOOKUPS);
+    for (firelink::Endpoint& probe : probes)
+    {
+      const std::vector<firelink::Endpoint>& from = (rng() & 1) ? present : absent;
+      probe = from[rng() % from.size()];
+    }
+
+    return probes;
+  }
+
+  double per_op_ns(std::uint64_t elapsed_ns, std::size_t ops)
+  {
+    return static_cast<double>(elapsed_ns) / static_cast<double>(ops);
+  }
+
+  void run_size(firelink_bench::Report& report, std::size_t peers_count, const std::string& prefix)
+  {
+    std::vector<firelink::Endpoint> peers = make_peers(peers_count, 1);
+    std::vector<firelink::Endpoint> strangers = make_peers(peers_count, 2);
+    std::vector<firelink::Endpoint> probes = make_probes(peers, strangers);
+
+    std::uint64_t sink = 0;
+
+    {
+      std::uint64_t start = firelink_bench::now_ns();
+      std::unordered_map<firelink::Endpoint, Session> sessions{};
+      for (const firelink::Endpoint& peer : peers)
+        sessions[peer].datagrams++;
+      report.add(prefix + "_unordered_map_insert", per_op_ns(firelink_bench::now_ns() - start, peers.size()), "ns/op");
+
+      start = firelink_bench::now_ns();
+      for (const firelink::Endpoint& probe : probes)
+      {
+        auto it = sessions.find(probe);
+        if (it != sessions.end())
+          sink += ++it->second.datagrams;
+      }
+      report.add(prefix + "_unordered_map_find", per_op_ns(firelink_bench::now_ns() - start, probes.size()), "ns/op");
+    }
+
+    {
+      std::uint64_t start = firelink_bench::now_ns();
+      firelink::EndpointMap<Session> sessions{};
+      for (const firelink::Endpoint& peer : peers)
+        sessions[peer].datagrams++;
+      report.add(prefix + "_endpoint_map_insert", per_op_ns(firelink_bench::now_ns() - start, peers.size()), "ns/op");
+
+      start = firelink_bench::now_ns();
+      for (const firelink::Endpoint& probe : probes)
+      {
+        if (Session* session = sessions.find(probe))
+          sink += ++session->datagrams;
+      }
+      report.add(prefix + "_endpoint_map_find", per_op_ns(firelink_bench::now_ns() - start, probes.size()), "ns/op");
+    }
+
+    firelink_bench::do_not_optimize(sink);
+  }
+
+  void endpoint_map_bench(firelink_bench::Report& report)
+  {
+    run_size(report, 10'000, "peers_10k");
+    run_size(report, 1'000'000, "peers_1m");
+    run_size(report, 4'000'000, "peers_4m");
+  }
+
+  firelink_bench::Registrar registrar("endpoint_map", "per-peer lookups, EndpointMap vs std::unordered_map",
+                                      endpoint_map_bench);
+}
@@ -0,0 +1,199 @@
+#include "bench.hpp"
+#include "firelink/endpoint.hpp"
+
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Endpoint text conversion as done by access logging and config reloads. Compares the string based
+ * inet_ntop/inet_pton that firelink used to ship (reproduced below) against to_chars/from_chars and the
+ * batch parser.
+ */
+
+namespace
+{
+  constexpr std::size_t ADDRESSES = 4096;
+  constexpr std::uint32_t ROUNDS = 100;
+
+  std::string legacy_ntop(const firelink::IPv4Address& addr)
+  {
+    char buf[INET_ADDRSTRLEN]{};
+    if (::inet_ntop(AF_INET, addr.bytes.data(), buf, INET_ADDRSTRLEN) == nullptr)
+      return {};
+
+    return std::string(buf) + ":" + std::to_string(addr.port);
+  }
+
+  std::string legacy_ntop(const firelink::IPv6Address& addr)
+  {
+    char buf[INET6_ADDRSTRLEN]{};
+    if (::inet_ntop(AF_INET6, addr.bytes.data(), buf, INET6_ADDRSTRLEN) == nullptr)
+      return {};
+
+    return "[" + std::string(buf) + "]" + ":" + std::to_string(addr.port);
+  }
+
+  bool legacy_pton(std::string_view str, firelink::IPv4Address& out)
+  {
+    std::string trimmed_addr{};
+    std::size_t pos = str.rfind(':');
+    if (pos != std::string_view::npos && pos > str.find_last_of('.'))
+    {
+      trimmed_addr = std::string(str.substr(0, pos));
+      out.port = static_cast<std::uint16_t>(std::stoi(std::string(str.substr(pos + 1))));
+    }
+    else
+    {
+      trimmed_addr = std::string(str);
+    }
+
+    return ::inet_pton(AF_INET, trimmed_addr.data(), out.bytes.data()) == 1;
+  }
+
+  bool legacy_pton(std::string_view str, firelink::IPv6Address& out)
+  {
+    std::string trimmed_addr{};
+    std::size_t pos = str.rfind(':');
+    if (pos != std::string_view::npos && pos > str.rfind(']'))
+    {
+      trimmed_addr = std::string(str.substr(0, pos));
+      trimmed_addr.erase(0, 1);
+      trimmed_addr.pop_back();
+      out.port = static_cast<std::uint16_t>(std::stoi(std::string(str.substr(pos + 1))));
+    }
+    else
+    {
+      trimmed_addr = std::string(str);
+    }
+
+    return ::inet_pton(AF_INET6, trimmed_addr.data(), out.bytes.data()) == 1;
+  }
+
+  template<typename Address>
+  std::vector<Address> make_addresses()
+  {
+    std::mt19937 rng(99);
+    std::vector<Address> addrs(ADDRESSES);
+    for (Address& addr : addrs)
+    {
+      // Mostly zero IPv6 groups, like real addresses, so "::" compression is exercised
+      for (std::uint8_t& b : addr.bytes)
+        b = (sizeof(addr.bytes) == 16 && rng() % 3 == 0) ? 0 : static_cast<std::uint8_t>(rng() & 0xFF);
+
+      addr.port = static_cast<std::uint16_t>(rng() & 0xFFFF);
+    }
+
+    return addrs;
+  }
+
+  double per_op_ns(std::uint64_t elapsed_ns)
+  {
+    return static_cast<double>(elapsed_ns) / static_cast<double>(ADDRESSES * ROUNDS);
+  }
+
+  template<typename Address>
+  void run_family(firelink_bench::Report& report, const std::string& prefix)
+  {
+    std::vector<Address> addrs = make_addresses<Address>();
+
+    std::vector<std::string> texts{};
+    std::vector<std::string_view> views{};
+    for (const Address& addr : addrs)
+      texts.push_back(firelink::inet_ntop(addr));
+    for (const std::string& text : texts)
+      views.push_back(text);
+
+    std::uint64_t sink = 0;
+
+    // Formatting
+    std::uint64_t start = firelink_bench::now_ns();
+    for (std::uint32_t r = 0; r < ROUNDS; ++r)
+    {
+      for (const Address& addr : addrs)
+        sink += legacy_ntop(addr).size();
+    }
+    report.add(prefix + "_legacy_ntop", per_op_ns(firelink_bench::now_ns() - start), "ns/op");
+
+    start = firelink_bench::now_ns();
+    for (std::uint32_t r = 0; r < ROUNDS; ++r)
+    {
+      for (const Address& addr : addrs)
+      {
+        char buf[firelink::IPV6_ENDPOINT_MAX_CHARS];
+        std::to_chars_result res = firelink::to_chars(buf, buf + sizeof(buf), addr);
+        sink += static_cast<std::uint64_t>(res.ptr - buf);
+      }
+    }
+    report.add(prefix + "_to_chars", per_op_ns(firelink_bench::now_ns() - start), "ns/op");
+
+    // Parsing
+    start = firelink_bench::now_ns();
+    for (std::uint32_t r = 0; r < ROUNDS; ++r)
+    {
+      for (std::string_view text : views)
+      {
+        Address addr{};
+        sink += legacy_pton(text, addr) ? addr.port : 0;
+      }
+    }
+    report.add(prefix + "_legacy_pton", per_op_ns(firelink_bench::now_ns() - start), "ns/op");
+
+    start = firelink_bench::now_ns();
+    for (std::uint32_t r = 0; r < ROUNDS; ++r)
+    {
+      for (std::string_view text : views)
+      {
+        Address addr{};
+        std::from_chars_result res = firelink::from_chars(text.data(), text.data() + text.size(), addr);
+        sink += res.ec == std::errc{} ? addr.port : 0;
+      }
+    }
+    report.add(prefix + "_from_chars", per_op_ns(firelink_bench::now_ns() - start), "ns/op");
+
+    std::vector<Address> parsed(views.size());
+    std::vector<std::errc> errors(views.size());
+    std::size_t failed = 0;
+    start = firelink_bench::now_ns();
+    for (std::uint32_t r = 0; r < ROUNDS; ++r)
+      failed += firelink::from_chars_batch(views, parsed, errors);
+    report.add(prefix + "_from_chars_batch", per_op_ns(firelink_bench::now_ns() - start), "ns/op");
+
+    if (failed != 0)
+      std::cerr << "endpoint_text: " << prefix << " batch parse failed " << failed << " times" << std::endl;
+
+    for (std::size_t i = 0; i < addrs.size(); ++i)
+    {
+      if (parsed[i].bytes != addrs[i].bytes || parsed[i].port != addrs[i].port)
+      {
+        std::cerr << "endpoint_text: " << prefix << " round trip mismatch for " << texts[i] << std::endl;
+        break;
+      }
+    }
+
+    firelink_bench::do_not_optimize(sink);
+  }
+
+  void endpoint_text_bench(firelink_bench::Report& report)
+  {
+    // The legacy functions call winsock, which needs to be initialized
+    WSADATA wsa_data{};
+    if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0)
+    {
+      std::cerr << "endpoint_text: WSAStartup failed" << std::endl;
+      return;
+    }
+
+    run_family<firelink::IPv4Address>(report, "ipv4");
+    run_family<firelink::IPv6Address>(report, "ipv6");
+
+    WSACleanup();
+  }
+
+  firelink_bench::Registrar registrar("endpoint_text", "legacy inet_ntop/inet_pton vs to_chars/from_chars",
+                                      endpoint_text_bench);
+}
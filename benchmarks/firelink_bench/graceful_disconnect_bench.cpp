@@ -0,0 +1,110 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+
+#include <string>
+
+/*
+ * Graceful disconnect of many connections. Opens PAIRS loopback pairs with an echo server behind each, has
+ * every client send MESSAGE_SIZE bytes and then disconnect gracefully, so the echoed bytes have to be drained
+ * before the server's FIN. Reports the time until all of them disconnected with the blocking disconnect()
+ * called one after the other and with start_graceful_disconnect() on an IOCore with a single IO thread.
+ * A last run has silent peers that never close and reports how long it takes all deadlines to pass.
+ */
+
+namespace
+{
+  constexpr std::uint32_t PAIRS = 256;
+  constexpr std::size_t MESSAGE_SIZE = 4096;
+  constexpr std::uint32_t TIMEOUT_MS = 200;
+
+  enum class Mode
+  {
+    Blocking,
+    Async,
+    AsyncSilentPeers
+  };
+
+  void run(firelink_bench::Report& report, const std::string& prefix, Mode mode)
+  {
+    auto io_core = firelink_bench::make_io_core(1, 2);
+    if (!io_core.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core.error()) << std::endl;
+      return;
+    }
+
+    std::vector<firelink_bench::LoopbackPair> pairs;
+    pairs.reserve(PAIRS);
+    for (std::uint32_t i = 0; i < PAIRS; ++i)
+    {
+      auto pair = firelink_bench::make_loopback_pair(io_core.value());
+      if (!pair.has_value())
+      {
+        std::cerr << "graceful_disconnect: make_loopback_pair error " << static_cast<int>(pair.error()) << std::endl;
+        break;
+      }
+
+      if (mode != Mode::AsyncSilentPeers)
+        firelink_bench::echo(pair.value().server, std::make_shared<std::vector<std::byte>>(MESSAGE_SIZE));
+
+      pairs.push_back(pair.value());
+    }
+
+    std::vector<std::byte> message(MESSAGE_SIZE);
+    std::atomic<std::uint32_t> done{0};
+    std::atomic<std::uint32_t> failed{0};
+
+    std::uint64_t start = firelink_bench::now_ns();
+    for (firelink_bench::LoopbackPair& pair : pairs)
+    {
+      pair.client->send(message);
+
+      if (mode == Mode::Blocking)
+      {
+        if (pair.client->disconnect(static_cast<int>(TIMEOUT_MS)) != firelink::ErrorCode::Success)
+          failed.fetch_add(1);
+        done.fetch_add(1);
+        continue;
+      }
+
+      firelink::ErrorCode err = pair.client->start_graceful_disconnect(TIMEOUT_MS,
+        [&done, &failed](std::shared_ptr<firelink::Socket>, firelink::ErrorCode error, firelink::DisconnectTag)
+      {
+        if (error != firelink::ErrorCode::Success)
+          failed.fetch_add(1);
+        done.fetch_add(1);
+      });
+
+      if (err != firelink::ErrorCode::Success)
+      {
+        failed.fetch_add(1);
+        done.fetch_add(1);
+      }
+    }
+
+    std::uint32_t expected = static_cast<std::uint32_t>(pairs.size());
+    if (!firelink_bench::wait_until([&]() { return done.load() == expected; }))
+      std::cerr << "graceful_disconnect: " << prefix << " timed out" << std::endl;
+    std::uint64_t elapsed_ns = firelink_bench::now_ns() - start;
+
+    for (firelink_bench::LoopbackPair& pair : pairs)
+    {
+      pair.client->close();
+      pair.server->close();
+    }
+    io_core.value()->release();
+
+    report.add(prefix + "_total", static_cast<double>(elapsed_ns) / 1e6, "ms");
+    report.add(prefix + "_not_graceful", static_cast<double>(failed.load()), "connections");
+  }
+
+  void graceful_disconnect_bench(firelink_bench::Report& report)
+  {
+    run(report, "blocking", Mode::Blocking);
+    run(report, "async", Mode::Async);
+    run(report, "async_silent_peers", Mode::AsyncSilentPeers);
+  }
+
+  firelink_bench::Registrar registrar("graceful_disconnect", "blocking and asynchronous graceful disconnect of many connections",
+                                      graceful_disconnect_bench);
+}
@@ -0,0 +1,133 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+#include "firelink/latency_histogram.hpp"
+
+#include <random>
+
+/*
+ * Latency histograms. Measures the cost of recording into and reading percentiles from a LatencyHistogram,
+ * then runs echo round trips over loopback and reports p50/p99/p99.9 of each stage of the client's sends and
+ * receives: to the IO thread completion, through the user threadpool hop, and in the handler. The stage
+ * percentiles need firelink built with FIRELINK_ENABLE_LATENCY_HISTOGRAMS=1.
+ */
+
+namespace
+{
+  constexpr std::uint32_t RECORDS = 10'000'000;
+  constexpr std::uint32_t ROUND_TRIPS = 20'000;
+  constexpr std::size_t MESSAGE_SIZE = 64;
+
+  void ping_pong(std::shared_ptr<firelink::Socket> socket, std::shared_ptr<std::vector<std::byte>> buffer,
+                 std::shared_ptr<std::atomic<std::uint32_t>> done, std::uint32_t remaining)
+  {
+    if (remaining == 0)
+      return;
+
+    socket->start_send(*buffer, [buffer, done, remaining](std::shared_ptr<firelink::Socket> caller, firelink::ErrorCode error,
+                                                          std::int32_t, firelink::WriteTag)
+    {
+      if (error != firelink::ErrorCode::Success)
+      {
+        done->fetch_add(remaining);
+        return;
+      }
+
+      caller->start_recv(*buffer, [buffer, done, remaining](std::shared_ptr<firelink::Socket> caller,
+                                                            firelink::ErrorCode error, std::int32_t, firelink::ReadTag)
+      {
+        if (error != firelink::ErrorCode::Success)
+        {
+          done->fetch_add(remaining);
+          return;
+        }
+
+        done->fetch_add(1);
+        ping_pong(std::move(caller), buffer, done, remaining - 1);
+      });
+    });
+  }
+
+  void report_stages(firelink_bench::Report& report, const firelink::LatencyStats& stats, firelink::Operation op,
+                     const std::string& prefix)
+  {
+    const char* stage_names[firelink::LATENCY_STAGE_COUNT] = {"completion", "dispatch", "handler"};
+    for (std::size_t stage = 0; stage < firelink::LATENCY_STAGE_COUNT; ++stage)
+    {
+      const firelink::LatencyHistogram& h = stats.get(op, static_cast<firelink::LatencyStage>(stage));
+      std::string name = prefix + "_" + stage_names[stage];
+      report.add(name + "_p50", static_cast<double>(h.percentile(50.0)) / 1000.0, "us");
+      report.add(name + "_p99", static_cast<double>(h.percentile(99.0)) / 1000.0, "us");
+      report.add(name + "_p99.9", static_cast<double>(h.percentile(99.9)) / 1000.0, "us");
+    }
+  }
+
+  void latency_bench(firelink_bench::Report& report)
+  {
+    std::mt19937_64 rng(42);
+    std::lognormal_distribution<double> distribution(10.0, 1.5);
+    std::vector<std::uint64_t> values(4096);
+    for (std::uint64_t& value : values)
+      value = static_cast<std::uint64_t>(distribution(rng));
+
+    firelink::LatencyHistogram histogram{};
+    std::uint64_t start = firelink_bench::now_ns();
+    for (std::uint32_t i = 0; i < RECORDS; ++i)
+      histogram.record(values[i & (values.size() - 1)]);
+    report.add("histogram_record", static_cast<double>(firelink_bench::now_ns() - start) / RECORDS, "ns/op");
+
+    start = firelink_bench::now_ns();
+    std::uint64_t p99 = histogram.percentile(99.0);
+    report.add("histogram_p99_query", static_cast<double>(firelink_bench::now_ns() - start) / 1000.0, "us");
+    firelink_bench::do_not_optimize(p99);
+
+    auto io_core = firelink_bench::make_io_core(2, 2);
+    if (!io_core.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core.error()) << std::endl;
+      return;
+    }
+
+    firelink::Endpoint listener_ep{};
+    auto listener = firelink_bench::make_listener(io_core.value(), 1, listener_ep);
+    auto client = firelink_bench::make_tcp_socket(io_core.value());
+    firelink::ErrorCode err = listener.has_value() ? firelink::ErrorCode::Success : listener.error();
+    if (err == firelink::ErrorCode::Success)
+      err = client.has_value() ? client.value()->connect(listener_ep) : client.error();
+
+    if (err != firelink::ErrorCode::Success)
+    {
+      std::cerr << "latency: setup error " << static_cast<int>(err) << std::endl;
+      io_core.value()->release();
+      return;
+    }
+
+    firelink_bench::serve_echo(io_core.value(), listener.value());
+
+    auto done = std::make_shared<std::atomic<std::uint32_t>>(0);
+    ping_pong(client.value(), std::make_shared<std::vector<std::byte>>(MESSAGE_SIZE), done, ROUND_TRIPS);
+    if (!firelink_bench::wait_until([&]() { return done->load() == ROUND_TRIPS; }))
+      std::cerr << "latency: round trips timed out" << std::endl;
+
+    start = firelink_bench::now_ns();
+    firelink::LatencyStats stats = io_core.value()->latency_stats();
+    report.add("latency_stats_merge", static_cast<double>(firelink_bench::now_ns() - start) / 1000.0, "us");
+
+    if (stats.get(firelink::Operation::Recv, firelink::LatencyStage::Completion).count() == 0)
+    {
+      std::cerr << "latency: no stage histograms, firelink was built without FIRELINK_ENABLE_LATENCY_HISTOGRAMS" << std::endl;
+    }
+    else
+    {
+      report_stages(report, stats, firelink::Operation::Send, "send");
+      report_stages(report, stats, firelink::Operation::Recv, "recv");
+    }
+
+    client.value()->close();
+    listener.value()->cancel();
+    listener.value()->close();
+    io_core.value()->release();
+  }
+
+  firelink_bench::Registrar registrar("latency", "latency histogram cost and per-stage percentiles of echo round trips",
+                                      latency_bench);
+}
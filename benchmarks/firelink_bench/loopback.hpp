@@ -0,0 +1,180 @@
+#ifndef FIRELINK_BENCH_LOOPBACK_H
+#define FIRELINK_BENCH_LOOPBACK_H
+
+#include "firelink/io_core.hpp"
+#include "firelink/socket.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <expected>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace firelink_bench
+{
+  struct LoopbackPair
+  {
+    std::shared_ptr<firelink::Socket> client;
+    std::shared_ptr<firelink::Socket> server;
+  };
+
+  inline std::expected<std::shared_ptr<firelink::IOCore>, firelink::ErrorCode>
+  make_io_core(std::uint32_t io_threads = 2, std::uint32_t user_threads = 2)
+  {
+    auto io_core = firelink::IOCore::create({io_threads, io_threads, user_threads, user_threads});
+    if (!io_core.has_value())
+      return std::unexpected(io_core.error());
+
+    return std::shared_ptr<firelink::IOCore>(std::move(io_core.value()));
+  }
+
+  inline std::expected<std::shared_ptr<firelink::Socket>, firelink::ErrorCode>
+  make_tcp_socket(std::shared_ptr<firelink::IOCore> io_core)
+  {
+    auto sock = firelink::Socket::create(io_core);
+    if (!sock.has_value())
+      return std::unexpected(sock.error());
+
+    firelink::ErrorCode err = sock.value()->socket(firelink::AddressFamily::IPv4, firelink::SocketType::Stream,
+                                                   firelink::Protocol::Tcp);
+    if (err != firelink::ErrorCode::Success)
+      return std::unexpected(err);
+
+    return sock.value();
+  }
+
+  // Creates a listener on an ephemeral loopback port
+  inline std::expected<std::shared_ptr<firelink::Socket>, firelink::ErrorCode>
+  make_listener(std::shared_ptr<firelink::IOCore> io_core, std::int32_t backlog, firelink::Endpoint& local_endpoint)
+  {
+    auto listener = make_tcp_socket(io_core);
+    if (!listener.has_value())
+      return listener;
+
+    firelink::ErrorCode err = listener.value()->bind(firelink::IPv4Address::loopback(0));
+    if (err == firelink::ErrorCode::Success)
+      err = listener.value()->listen(backlog);
+    if (err == firelink::ErrorCode::Success)
+      err = listener.value()->get_sock_name(local_endpoint);
+
+    if (err != firelink::ErrorCode::Success)
+    {
+      listener.value()->close();
+      return std::unexpected(err);
+    }
+
+    return listener;
+  }
+
+  // Creates a connected TCP pair on loopback using the synchronous API
+  inline std::expected<LoopbackPair, firelink::ErrorCode> make_loopback_pair(std::shared_ptr<firelink::IOCore> io_core)
+  {
+    firelink::Endpoint listener_ep{};
+    auto listener = make_listener(io_core, 1, listener_ep);
+    if (!listener.has_value())
+      return std::unexpected(listener.error());
+
+    auto client = make_tcp_socket(io_core);
+    auto server = firelink::Socket::create(io_core);
+    if (!client.has_value() || !server.has_value())
+    {
+      listener.value()->close();
+      return std::unexpected(firelink::ErrorCode::SystemError);
+    }
+
+    firelink::ErrorCode err = client.value()->connect(listener_ep);
+    if (err == firelink::ErrorCode::Success)
+      err = listener.value()->accept(server.value());
+
+    listener.value()->close();
+    if (err != firelink::ErrorCode::Success)
+    {
+      client.value()->close();
+      return std::unexpected(err);
+    }
+
+    return LoopbackPair{client.value(), server.value()};
+  }
+
+  // Receives and discards everything arriving on the socket, counting the bytes
+  inline void drain(std::shared_ptr<firelink::Socket> socket, std::shared_ptr<std::vector<std::byte>> buffer,
+                    std::atomic<std::uint64_t>* bytes_received)
+  {
+    socket->start_recv(*buffer, [buffer, bytes_received](std::shared_ptr<firelink::Socket> caller,
+                                                         firelink::ErrorCode error, std::int32_t bytes_transferred,
+                                                         firelink::ReadTag)
+    {
+      if (error != firelink::ErrorCode::Success || bytes_transferred <= 0)
+        return;
+
+      bytes_received->fetch_add(static_cast<std::uint64_t>(bytes_transferred));
+      drain(std::move(caller), buffer, bytes_received);
+    });
+  }
+
+  // Sends back everything arriving on the socket and closes it when the peer does
+  inline void echo(std::shared_ptr<firelink::Socket> socket, std::shared_ptr<std::vector<std::byte>> buffer)
+  {
+    socket->start_recv(*buffer, [buffer](std::shared_ptr<firelink::Socket> caller, firelink::ErrorCode error,
+                                         std::int32_t bytes_transferred, firelink::ReadTag)
+    {
+      if (error != firelink::ErrorCode::Success || bytes_transferred <= 0)
+      {
+        caller->close();
+        return;
+      }
+
+      std::span<std::byte> data(buffer->data(), static_cast<std::size_t>(bytes_transferred));
+      caller->start_send(data, [buffer](std::shared_ptr<firelink::Socket> caller, firelink::ErrorCode error,
+                                        std::int32_t, firelink::WriteTag)
+      {
+        if (error != firelink::ErrorCode::Success)
+        {
+          caller->close();
+          return;
+        }
+
+        echo(std::move(caller), buffer);
+      });
+    });
+  }
+
+  // Accepts connections and echoes on each of them until the listener is cancelled or closed
+  inline void serve_echo(std::shared_ptr<firelink::IOCore> io_core, std::shared_ptr<firelink::Socket> listener)
+  {
+    auto accept_socket = firelink::Socket::create(io_core);
+    if (!accept_socket.has_value())
+      return;
+
+    listener->start_accept(accept_socket.value(), [io_core](std::shared_ptr<firelink::Socket> caller,
+                                                            std::shared_ptr<firelink::Socket> accepted_socket,
+                                                            const firelink::Endpoint&, const firelink::Endpoint&,
+                                                            firelink::ErrorCode error, firelink::AcceptTag)
+    {
+      if (error != firelink::ErrorCode::Success)
+        return;
+
+      echo(accepted_socket, std::make_shared<std::vector<std::byte>>(4096));
+      serve_echo(io_core, std::move(caller));
+    });
+  }
+
+  template<typename Predicate>
+  inline bool wait_until(Predicate&& done, std::chrono::milliseconds timeout = std::chrono::seconds(60))
+  {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!done())
+    {
+      if (std::chrono::steady_clock::now() > deadline)
+        return false;
+
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    return true;
+  }
+}
+
+#endif /* FIRELINK_BENCH_LOOPBACK_H */
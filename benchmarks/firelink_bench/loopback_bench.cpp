@@ -0,0 +1,499 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+
+#include <algorithm>
+
+/*
+ * Loopback scenarios, each against a server on the same IOCore and sized by the command line options
+ * (--message-size, --connections, --duration-ms, --io-threads, --user-threads). Every scenario runs for the
+ * configured duration, then stops issuing operations and waits for the outstanding ones.
+ *
+ *   loopback_ping_pong  one connection, one message in flight, round trip latency percentiles
+ *   loopback_stream     one connection, several sends in flight, throughput at the receiver
+ *   loopback_echo_many  --connections connections doing ping-pong concurrently, aggregate rate and percentiles
+ *   loopback_udp        datagrams of --message-size with several sends and receives in flight, sent and received pps
+ *   loopback_accept     --connections chains connecting and closing, accepted connections per second
+ */
+
+namespace
+{
+  constexpr std::uint32_t STREAM_SENDS_IN_FLIGHT = 4;
+  constexpr std::uint32_t UDP_SENDS_IN_FLIGHT = 8;
+  constexpr std::uint32_t UDP_RECVS_IN_FLIGHT = 16;
+  constexpr std::size_t UDP_MAX_PAYLOAD = 65507;
+  constexpr std::uint32_t MAX_ACCEPT_CHAINS = 64;
+
+  double per_second(std::uint64_t count, std::uint64_t elapsed_ns)
+  {
+    return elapsed_ns != 0 ? static_cast<double>(count) / (static_cast<double>(elapsed_ns) / 1e9) : 0.0;
+  }
+
+  std::shared_ptr<firelink::IOCore> create_io_core()
+  {
+    const firelink_bench::Options& opts = firelink_bench::options();
+    auto io_core = firelink_bench::make_io_core(opts.io_threads, opts.user_threads);
+    if (!io_core.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core.error()) << std::endl;
+      return nullptr;
+    }
+
+    return io_core.value();
+  }
+
+  // Sleeps for the configured duration, then tells the chains to stop and waits until they have
+  std::uint64_t run_for_duration(std::atomic<bool>& stop, const std::atomic<std::uint32_t>& finished, std::uint32_t chains,
+                                 const char* scenario)
+  {
+    std::uint64_t start = firelink_bench::now_ns();
+    std::this_thread::sleep_for(std::chrono::milliseconds(firelink_bench::options().duration_ms));
+    stop.store(true);
+    std::uint64_t elapsed = firelink_bench::now_ns() - start;
+
+    if (!firelink_bench::wait_until([&]() { return finished.load() == chains; }, std::chrono::seconds(10)))
+      std::cerr << scenario << ": outstanding operations did not finish" << std::endl;
+
+    return elapsed;
+  }
+
+  /*
+   * Sends a message and waits for all of it to come back before sending the next one, timing each
+   * round trip. One operation is in flight at a time, so the handlers never run concurrently.
+   */
+  class PingPong : public std::enable_shared_from_this<PingPong>
+  {
+    public:
+    PingPong(std::shared_ptr<firelink::Socket> socket, std::size_t message_size, const std::atomic<bool>* stop,
+             std::atomic<std::uint32_t>* finished) :
+      socket_(std::move(socket)),
+      buffer_(message_size),
+      stop_(stop),
+      finished_(finished)
+    {
+    }
+
+    void start()
+    {
+      send();
+    }
+
+    // Only once finished
+    const firelink::LatencyHistogram& latencies() const { return latencies_; }
+
+    private:
+    void send()
+    {
+      if (stop_->load(std::memory_order_relaxed))
+      {
+        finished_->fetch_add(1);
+        return;
+      }
+
+      sent_ns_ = firelink_bench::now_ns();
+      received_ = 0;
+      firelink::ErrorCode err = socket_->start_send(buffer_, [self = shared_from_this()](std::shared_ptr<firelink::Socket>,
+                                                                                          firelink::ErrorCode error, std::int32_t,
+                                                                                          firelink::WriteTag)
+      {
+        if (error != firelink::ErrorCode::Success)
+        {
+          self->finished_->fetch_add(1);
+          return;
+        }
+
+        self->recv();
+      });
+
+      if (err != firelink::ErrorCode::Success)
+        finished_->fetch_add(1);
+    }
+
+    void recv()
+    {
+      std::span<std::byte> rest(buffer_.data() + received_, buffer_.size() - received_);
+      firelink::ErrorCode err = socket_->start_recv(rest, [self = shared_from_this()](std::shared_ptr<firelink::Socket>,
+                                                                                      firelink::ErrorCode error,
+                                                                                      std::int32_t bytes_transferred,
+                                                                                      firelink::ReadTag)
+      {
+        if (error != firelink::ErrorCode::Success || bytes_transferred <= 0)
+        {
+          self->finished_->fetch_add(1);
+          return;
+        }
+
+        // The echo may come back in pieces
+        self->received_ += static_cast<std::size_t>(bytes_transferred);
+        if (self->received_ < self->buffer_.size())
+        {
+          self->recv();
+          return;
+        }
+
+        self->latencies_.record(firelink_bench::now_ns() - self->sent_ns_);
+        self->send();
+      });
+
+      if (err != firelink::ErrorCode::Success)
+        finished_->fetch_add(1);
+    }
+
+    std::shared_ptr<firelink::Socket> socket_;
+    std::vector<std::byte> buffer_;
+    std::size_t received_ = 0;
+    std::uint64_t sent_ns_ = 0;
+    firelink::LatencyHistogram latencies_{};
+    const std::atomic<bool>* stop_;
+    std::atomic<std::uint32_t>* finished_;
+  };
+
+  /*
+   * Connects --connections clients to an echo server and runs a PingPong on each of them. Returns the
+   * merged round trip latencies and the elapsed time.
+   */
+  bool run_ping_pongs(std::shared_ptr<firelink::IOCore> io_core, std::uint32_t connections, const char* scenario,
+                      firelink::LatencyHistogram& latencies, std::uint64_t& elapsed_ns)
+  {
+    firelink::Endpoint listener_ep{};
+    auto listener = firelink_bench::make_listener(io_core, static_cast<std::int32_t>(std::min(connections, 512u)), listener_ep);
+    if (!listener.has_value())
+    {
+      std::cerr << scenario << ": listener error " << static_cast<int>(listener.error()) << std::endl;
+      return false;
+    }
+
+    firelink_bench::serve_echo(io_core, listener.value());
+
+    std::vector<std::shared_ptr<firelink::Socket>> clients{};
+    for (std::uint32_t i = 0; i < connections; ++i)
+    {
+      auto client = firelink_bench::make_tcp_socket(io_core);
+      firelink::ErrorCode err = client.has_value() ? client.value()->connect(listener_ep) : client.error();
+      if (err != firelink::ErrorCode::Success)
+      {
+        std::cerr << scenario << ": connect error " << static_cast<int>(err) << std::endl;
+        if (client.has_value())
+          client.value()->close();
+        break;
+      }
+
+      clients.push_back(client.value());
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint32_t> finished{0};
+    std::vector<std::shared_ptr<PingPong>> ping_pongs{};
+    for (std::shared_ptr<firelink::Socket>& client : clients)
+      ping_pongs.push_back(std::make_shared<PingPong>(client, firelink_bench::options().message_size, &stop, &finished));
+    for (std::shared_ptr<PingPong>& ping_pong : ping_pongs)
+      ping_pong->start();
+
+    elapsed_ns = run_for_duration(stop, finished, static_cast<std::uint32_t>(ping_pongs.size()), scenario);
+
+    for (std::shared_ptr<PingPong>& ping_pong : ping_pongs)
+      latencies.merge(ping_pong->latencies());
+
+    for (std::shared_ptr<firelink::Socket>& client : clients)
+      client->close();
+    listener.value()->cancel();
+    listener.value()->close();
+    return !clients.empty();
+  }
+
+  void ping_pong_bench(firelink_bench::Report& report)
+  {
+    std::shared_ptr<firelink::IOCore> io_core = create_io_core();
+    if (io_core == nullptr)
+      return;
+
+    firelink::LatencyHistogram latencies{};
+    std::uint64_t elapsed = 0;
+    if (run_ping_pongs(io_core, 1, "loopback_ping_pong", latencies, elapsed))
+    {
+      report.add("round_trips", per_second(latencies.count(), elapsed), "rt/s");
+      report.add_latency("round_trip", latencies);
+    }
+
+    io_core->release();
+  }
+
+  void echo_many_bench(firelink_bench::Report& report)
+  {
+    std::shared_ptr<firelink::IOCore> io_core = create_io_core();
+    if (io_core == nullptr)
+      return;
+
+    firelink::LatencyHistogram latencies{};
+    std::uint64_t elapsed = 0;
+    if (run_ping_pongs(io_core, firelink_bench::options().connections, "loopback_echo_many", latencies, elapsed))
+    {
+      report.add("round_trips", per_second(latencies.count(), elapsed), "rt/s");
+      report.add("throughput", per_second(latencies.count() * firelink_bench::options().message_size * 2, elapsed) /
+                 (1024.0 * 1024.0), "MiB/s");
+      report.add_latency("round_trip", latencies);
+    }
+
+    io_core->release();
+  }
+
+  // Keeps sending the same buffer until told to stop
+  void send_chain(std::shared_ptr<firelink::Socket> socket, std::shared_ptr<std::vector<std::byte>> buffer,
+                  const std::atomic<bool>* stop, std::atomic<std::uint32_t>* finished)
+  {
+    if (stop->load(std::memory_order_relaxed))
+    {
+      finished->fetch_add(1);
+      return;
+    }
+
+    firelink::ErrorCode err = socket->start_send(*buffer, [buffer, stop, finished](std::shared_ptr<firelink::Socket> caller,
+                                                                                   firelink::ErrorCode error, std::int32_t,
+                                                                                   firelink::WriteTag)
+    {
+      if (error != firelink::ErrorCode::Success)
+      {
+        finished->fetch_add(1);
+        return;
+      }
+
+      send_chain(std::move(caller), buffer, stop, finished);
+    });
+
+    if (err != firelink::ErrorCode::Success)
+      finished->fetch_add(1);
+  }
+
+  void stream_bench(firelink_bench::Report& report)
+  {
+    std::shared_ptr<firelink::IOCore> io_core = create_io_core();
+    if (io_core == nullptr)
+      return;
+
+    auto pair = firelink_bench::make_loopback_pair(io_core);
+    if (!pair.has_value())
+    {
+      std::cerr << "loopback_stream: loopback setup error " << static_cast<int>(pair.error()) << std::endl;
+      io_core->release();
+      return;
+    }
+
+    std::size_t message_size = firelink_bench::options().message_size;
+    std::atomic<std::uint64_t> bytes_received{0};
+    firelink_bench::drain(pair.value().server, std::make_shared<std::vector<std::byte>>(std::max<std::size_t>(message_size, 65536)),
+                          &bytes_received);
+
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint32_t> finished{0};
+    for (std::uint32_t i = 0; i < STREAM_SENDS_IN_FLIGHT; ++i)
+      send_chain(pair.value().client, std::make_shared<std::vector<std::byte>>(message_size), &stop, &finished);
+
+    // Only what arrived within the duration counts
+    std::uint64_t start = firelink_bench::now_ns();
+    std::this_thread::sleep_for(std::chrono::milliseconds(firelink_bench::options().duration_ms));
+    std::uint64_t received = bytes_received.load();
+    std::uint64_t elapsed = firelink_bench::now_ns() - start;
+    stop.store(true);
+
+    if (!firelink_bench::wait_until([&]() { return finished.load() == STREAM_SENDS_IN_FLIGHT; }, std::chrono::seconds(10)))
+      std::cerr << "loopback_stream: outstanding sends did not finish" << std::endl;
+
+    report.add("throughput", per_second(received, elapsed) / (1024.0 * 1024.0), "MiB/s");
+    report.add("messages", per_second(received / message_size, elapsed), "msg/s");
+
+    pair.value().client->close();
+    pair.value().server->close();
+    io_core->release();
+  }
+
+  // Keeps a receive posted on the datagram socket until it is closed
+  void recv_datagrams(std::shared_ptr<firelink::Socket> socket, std::shared_ptr<std::vector<std::byte>> buffer,
+                      std::atomic<std::uint64_t>* received)
+  {
+    socket->start_recv_from(*buffer, [buffer, received](std::shared_ptr<firelink::Socket> caller, firelink::ErrorCode error,
+                                                        std::int32_t, firelink::ReadTag)
+    {
+      if (error != firelink::ErrorCode::Success)
+        return;
+
+      received->fetch_add(1);
+      recv_datagrams(std::move(caller), buffer, received);
+    });
+  }
+
+  void send_datagrams(std::shared_ptr<firelink::Socket> socket, std::shared_ptr<std::vector<std::byte>> buffer,
+                      firelink::Endpoint dst, std::atomic<std::uint64_t>* sent, const std::atomic<bool>* stop,
+                      std::atomic<std::uint32_t>* finished)
+  {
+    if (stop->load(std::memory_order_relaxed))
+    {
+      finished->fetch_add(1);
+      return;
+    }
+
+    firelink::ErrorCode err = socket->start_send_to(*buffer, dst, [buffer, dst, sent, stop, finished](
+                                                    std::shared_ptr<firelink::Socket> caller, firelink::ErrorCode error,
+                                                    std::int32_t, firelink::WriteTag)
+    {
+      if (error != firelink::ErrorCode::Success)
+      {
+        finished->fetch_add(1);
+        return;
+      }
+
+      sent->fetch_add(1);
+      send_datagrams(std::move(caller), buffer, dst, sent, stop, finished);
+    });
+
+    if (err != firelink::ErrorCode::Success)
+      finished->fetch_add(1);
+  }
+
+  std::expected<std::shared_ptr<firelink::Socket>, firelink::ErrorCode> make_udp_socket(std::shared_ptr<firelink::IOCore> io_core)
+  {
+    auto sock = firelink::Socket::create(io_core);
+    if (!sock.has_value())
+      return std::unexpected(sock.error());
+
+    firelink::ErrorCode err = sock.value()->socket(firelink::AddressFamily::IPv4, firelink::SocketType::Datagram,
+                                                   firelink::Protocol::Udp);
+    if (err != firelink::ErrorCode::Success)
+      return std::unexpected(err);
+
+    return sock.value();
+  }
+
+  void udp_bench(firelink_bench::Report& report)
+  {
+    std::shared_ptr<firelink::IOCore> io_core = create_io_core();
+    if (io_core == nullptr)
+      return;
+
+    std::size_t payload = std::min(firelink_bench::options().message_size, UDP_MAX_PAYLOAD);
+    firelink::Endpoint receiver_ep{};
+    auto receiver = make_udp_socket(io_core);
+    auto sender = make_udp_socket(io_core);
+    firelink::ErrorCode err = receiver.has_value() ? receiver.value()->bind(firelink::IPv4Address::loopback(0)) : receiver.error();
+    if (err == firelink::ErrorCode::Success)
+      err = receiver.value()->get_sock_name(receiver_ep);
+    if (err == firelink::ErrorCode::Success)
+      err = sender.has_value() ? firelink::ErrorCode::Success : sender.error();
+
+    if (err != firelink::ErrorCode::Success)
+    {
+      std::cerr << "loopback_udp: setup error " << static_cast<int>(err) << std::endl;
+      if (receiver.has_value())
+        receiver.value()->close();
+      io_core->release();
+      return;
+    }
+
+    std::atomic<std::uint64_t> received{0};
+    for (std::uint32_t i = 0; i < UDP_RECVS_IN_FLIGHT; ++i)
+      recv_datagrams(receiver.value(), std::make_shared<std::vector<std::byte>>(UDP_MAX_PAYLOAD), &received);
+
+    std::atomic<std::uint64_t> sent{0};
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint32_t> finished{0};
+    for (std::uint32_t i = 0; i < UDP_SENDS_IN_FLIGHT; ++i)
+      send_datagrams(sender.value(), std::make_shared<std::vector<std::byte>>(payload), receiver_ep, &sent, &stop, &finished);
+
+    std::uint64_t elapsed = run_for_duration(stop, finished, UDP_SENDS_IN_FLIGHT, "loopback_udp");
+
+    // Datagrams still in the receive buffer are not lost, give them a moment
+    firelink_bench::wait_until([&]() { return received.load() >= sent.load(); }, std::chrono::milliseconds(200));
+
+    std::uint64_t total_sent = sent.load();
+    std::uint64_t total_received = received.load();
+    report.add("sent", per_second(total_sent, elapsed), "pkt/s");
+    report.add("received", per_second(total_received, elapsed), "pkt/s");
+    report.add("received_throughput", per_second(total_received * payload, elapsed) / (1024.0 * 1024.0), "MiB/s");
+    report.add("loss", total_sent != 0 ? 100.0 * static_cast<double>(total_sent - std::min(total_received, total_sent)) /
+               static_cast<double>(total_sent) : 0.0, "%");
+
+    sender.value()->close();
+    receiver.value()->close();
+    io_core->release();
+  }
+
+  // Connects and closes until told to stop
+  void connect_chain(std::shared_ptr<firelink::IOCore> io_core, firelink::Endpoint dst, std::atomic<std::uint64_t>* connected,
+                     const std::atomic<bool>* stop, std::atomic<std::uint32_t>* finished)
+  {
+    if (stop->load(std::memory_order_relaxed))
+    {
+      finished->fetch_add(1);
+      return;
+    }
+
+    auto sock = firelink_bench::make_tcp_socket(io_core);
+    if (!sock.has_value())
+    {
+      finished->fetch_add(1);
+      return;
+    }
+
+    firelink::ErrorCode err = sock.value()->start_connect(dst, [io_core, dst, connected, stop, finished](
+                                                          std::shared_ptr<firelink::Socket> caller,
+                                                          firelink::ErrorCode error, firelink::ConnectTag)
+    {
+      caller->close();
+      if (error != firelink::ErrorCode::Success)
+      {
+        finished->fetch_add(1);
+        return;
+      }
+
+      connected->fetch_add(1);
+      connect_chain(io_core, dst, connected, stop, finished);
+    });
+
+    if (err != firelink::ErrorCode::Success)
+    {
+      sock.value()->close();
+      finished->fetch_add(1);
+    }
+  }
+
+  void accept_bench(firelink_bench::Report& report)
+  {
+    std::shared_ptr<firelink::IOCore> io_core = create_io_core();
+    if (io_core == nullptr)
+      return;
+
+    firelink::Endpoint listener_ep{};
+    auto listener = firelink_bench::make_listener(io_core, 512, listener_ep);
+    if (!listener.has_value())
+    {
+      std::cerr << "loopback_accept: listener error " << static_cast<int>(listener.error()) << std::endl;
+      io_core->release();
+      return;
+    }
+
+    // The echo server closes each connection when it sees the client's close
+    firelink_bench::serve_echo(io_core, listener.value());
+
+    std::uint32_t chains = std::min(firelink_bench::options().connections, MAX_ACCEPT_CHAINS);
+    std::atomic<std::uint64_t> connected{0};
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint32_t> finished{0};
+    for (std::uint32_t i = 0; i < chains; ++i)
+      connect_chain(io_core, listener_ep, &connected, &stop, &finished);
+
+    std::uint64_t elapsed = run_for_duration(stop, finished, chains, "loopback_accept");
+    report.add("connections", per_second(connected.load(), elapsed), "conn/s");
+
+    listener.value()->cancel();
+    listener.value()->close();
+    io_core->release();
+  }
+
+  firelink_bench::Registrar ping_pong_registrar("loopback_ping_pong", "round trip latency of one echo connection",
+                                                ping_pong_bench);
+  firelink_bench::Registrar stream_registrar("loopback_stream", "one-way streaming throughput of one connection",
+                                             stream_bench);
+  firelink_bench::Registrar echo_many_registrar("loopback_echo_many", "round trips over many concurrent echo connections",
+                                                echo_many_bench);
+  firelink_bench::Registrar udp_registrar("loopback_udp", "datagrams per second sent and received over loopback",
+                                          udp_bench);
+  firelink_bench::Registrar accept_registrar("loopback_accept", "connections accepted per second", accept_bench);
+}
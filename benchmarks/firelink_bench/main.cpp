@@ -0,0 +1,13 @@
+#include "runner.hpp"
+
+/*
+ * Usage: firelink_bench.exe [--list] [--json file] [--message-size bytes] [--connections n] [--duration-ms ms]
+ *                           [--io-threads n] [--user-threads n] [filter...]
+ * Runs every registered benchmark whose name contains one of the filters, or all of them if no filter is given.
+ * The options size the loopback scenarios. With --json the results are also written to the file, for
+ * comparing runs across releases.
+ */
+int main(int argc, char** argv)
+{
+  return firelink_bench::run(argc, argv, "firelink_bench.exe");
+}
@@ -0,0 +1,161 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+#include "firelink/metrics.hpp"
+
+#include <thread>
+
+/*
+ * Cost of the IOCore metrics. Records a started and a completed operation per iteration into a MetricsRegistry
+ * from 1 and 4 threads, next to a single shared atomic counter incremented by the same threads. Then runs
+ * echo round trips over loopback and relates the recording cost (four operations per round trip) to the
+ * round trip time, and times a stats() snapshot taken while the IOCore is busy.
+ */
+
+namespace
+{
+  constexpr std::uint64_t RECORDS_PER_THREAD = 10'000'000;
+  constexpr std::uint32_t ROUND_TRIPS = 20'000;
+  constexpr std::size_t MESSAGE_SIZE = 64;
+
+  template<typename Record>
+  double ns_per_record(std::uint32_t threads, Record&& record)
+  {
+    std::vector<std::thread> workers{};
+    std::uint64_t start = firelink_bench::now_ns();
+    for (std::uint32_t t = 0; t < threads; ++t)
+    {
+      workers.emplace_back([&record]()
+      {
+        for (std::uint64_t i = 0; i < RECORDS_PER_THREAD; ++i)
+          record(i);
+      });
+    }
+
+    for (std::thread& worker : workers)
+      worker.join();
+
+    return static_cast<double>(firelink_bench::now_ns() - start) / RECORDS_PER_THREAD;
+  }
+
+  void ping_pong(std::shared_ptr<firelink::Socket> socket, std::shared_ptr<std::vector<std::byte>> buffer,
+                 std::shared_ptr<std::atomic<std::uint32_t>> done, std::uint32_t remaining)
+  {
+    if (remaining == 0)
+      return;
+
+    socket->start_send(*buffer, [buffer, done, remaining](std::shared_ptr<firelink::Socket> caller, firelink::ErrorCode error,
+                                                          std::int32_t, firelink::WriteTag)
+    {
+      if (error != firelink::ErrorCode::Success)
+      {
+        done->fetch_add(remaining);
+        return;
+      }
+
+      caller->start_recv(*buffer, [buffer, done, remaining](std::shared_ptr<firelink::Socket> caller,
+                                                            firelink::ErrorCode error, std::int32_t, firelink::ReadTag)
+      {
+        if (error != firelink::ErrorCode::Success)
+        {
+          done->fetch_add(remaining);
+          return;
+        }
+
+        done->fetch_add(1);
+        ping_pong(std::move(caller), buffer, done, remaining - 1);
+      });
+    });
+  }
+
+  void metrics_bench(firelink_bench::Report& report)
+  {
+#if !FIRELINK_ENABLE_METRICS
+    std::cerr << "metrics: built with FIRELINK_ENABLE_METRICS=0, recording is compiled out" << std::endl;
+#endif
+
+    double record_ns[2] = {};
+    double shared_ns[2] = {};
+    const std::uint32_t thread_counts[2] = {1, 4};
+    for (std::size_t t = 0; t < 2; ++t)
+    {
+      firelink::MetricsRegistry registry{};
+      record_ns[t] = ns_per_record(thread_counts[t], [&registry](std::uint64_t i)
+      {
+        registry.operation_started(firelink::Operation::Recv);
+        registry.operation_completed(firelink::Operation::Recv, firelink::ErrorCode::Success, static_cast<std::int32_t>(i & 0xff));
+      });
+
+      std::atomic<std::uint64_t> shared{0};
+      shared_ns[t] = ns_per_record(thread_counts[t], [&shared](std::uint64_t i)
+      {
+        shared.fetch_add(1, std::memory_order_relaxed);
+        shared.fetch_add(i & 0xff, std::memory_order_relaxed);
+      });
+
+      firelink_bench::do_not_optimize(registry.snapshot().bytes_received_);
+    }
+
+    report.add("record_1_thread", record_ns[0], "ns/op");
+    report.add("record_4_threads", record_ns[1], "ns/op");
+    report.add("shared_atomic_1_thread", shared_ns[0], "ns/op");
+    report.add("shared_atomic_4_threads", shared_ns[1], "ns/op");
+
+    auto io_core = firelink_bench::make_io_core(2, 2);
+    if (!io_core.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core.error()) << std::endl;
+      return;
+    }
+
+    firelink::Endpoint listener_ep{};
+    auto listener = firelink_bench::make_listener(io_core.value(), 1, listener_ep);
+    auto client = firelink_bench::make_tcp_socket(io_core.value());
+    firelink::ErrorCode err = listener.has_value() ? firelink::ErrorCode::Success : listener.error();
+    if (err == firelink::ErrorCode::Success)
+      err = client.has_value() ? client.value()->connect(listener_ep) : client.error();
+
+    if (err != firelink::ErrorCode::Success)
+    {
+      std::cerr << "metrics: setup error " << static_cast<int>(err) << std::endl;
+      io_core.value()->release();
+      return;
+    }
+
+    firelink_bench::serve_echo(io_core.value(), listener.value());
+
+    auto done = std::make_shared<std::atomic<std::uint32_t>>(0);
+    std::uint64_t start = firelink_bench::now_ns();
+    ping_pong(client.value(), std::make_shared<std::vector<std::byte>>(MESSAGE_SIZE), done, ROUND_TRIPS);
+
+    // Snapshots while the round trips run
+    std::uint64_t snapshots = 0;
+    std::uint64_t snapshot_ns = 0;
+    while (done->load() < ROUND_TRIPS && firelink_bench::now_ns() - start < 60'000'000'000ull)
+    {
+      std::uint64_t snapshot_start = firelink_bench::now_ns();
+      firelink::IOCoreStats stats = io_core.value()->stats();
+      snapshot_ns += firelink_bench::now_ns() - snapshot_start;
+      firelink_bench::do_not_optimize(stats.outstanding_operations_);
+      ++snapshots;
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    double round_trip_ns = static_cast<double>(firelink_bench::now_ns() - start) / ROUND_TRIPS;
+    firelink::IOCoreStats stats = io_core.value()->stats();
+
+    report.add("echo_round_trip", round_trip_ns / 1000.0, "us");
+    report.add("recording_share_of_round_trip", 4.0 * record_ns[0] / round_trip_ns * 100.0, "%");
+    report.add("stats_snapshot", snapshots != 0 ? static_cast<double>(snapshot_ns) / snapshots / 1000.0 : 0.0, "us");
+    report.add("recv_completed", static_cast<double>(stats.operation(firelink::Operation::Recv).completed_), "ops");
+    report.add("bytes_sent", static_cast<double>(stats.bytes_sent_), "bytes");
+
+    client.value()->close();
+    listener.value()->cancel();
+    listener.value()->close();
+    io_core.value()->release();
+  }
+
+  firelink_bench::Registrar registrar("metrics", "cost of recording IOCore metrics per operation vs a shared atomic counter",
+                                      metrics_bench);
+}
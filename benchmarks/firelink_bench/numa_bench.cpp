@@ -0,0 +1,126 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+#include "firelink/numa.hpp"
+
+/*
+ * NUMA placement. Measures the cost of committing and releasing a node-local buffer, then runs echo round
+ * trips over loopback with a default IOCore and with a NUMA-aware one and reports the round trip rate of each.
+ * For the NUMA-aware run the handler placement from numa_stats() is reported as well. On machines with one
+ * NUMA node the counters stay 0 and both runs use the same threadpools.
+ */
+
+namespace
+{
+  constexpr std::uint32_t ALLOCATIONS = 10'000;
+  constexpr std::size_t BUFFER_SIZE = 64 * 1024;
+  constexpr std::uint32_t ROUND_TRIPS = 20'000;
+  constexpr std::size_t MESSAGE_SIZE = 64;
+
+  void ping_pong(std::shared_ptr<firelink::Socket> socket, std::shared_ptr<std::vector<std::byte>> buffer,
+                 std::shared_ptr<std::atomic<std::uint32_t>> done, std::uint32_t remaining)
+  {
+    if (remaining == 0)
+      return;
+
+    socket->start_send(*buffer, [buffer, done, remaining](std::shared_ptr<firelink::Socket> caller, firelink::ErrorCode error,
+                                                          std::int32_t, firelink::WriteTag)
+    {
+      if (error != firelink::ErrorCode::Success)
+      {
+        done->fetch_add(remaining);
+        return;
+      }
+
+      caller->start_recv(*buffer, [buffer, done, remaining](std::shared_ptr<firelink::Socket> caller,
+                                                            firelink::ErrorCode error, std::int32_t, firelink::ReadTag)
+      {
+        if (error != firelink::ErrorCode::Success)
+        {
+          done->fetch_add(remaining);
+          return;
+        }
+
+        done->fetch_add(1);
+        ping_pong(std::move(caller), buffer, done, remaining - 1);
+      });
+    });
+  }
+
+  // Returns round trips per second, 0 on error. stats is filled from the IOCore before it is released.
+  double echo_rate(bool numa_aware, firelink::NumaStats& stats)
+  {
+    firelink::IOCoreConfig config{2, 2, 2, 2};
+    config.numa_aware_ = numa_aware;
+
+    auto created = firelink::IOCore::create(config);
+    if (!created.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(created.error()) << std::endl;
+      return 0.0;
+    }
+
+    std::shared_ptr<firelink::IOCore> io_core(std::move(created.value()));
+
+    firelink::Endpoint listener_ep{};
+    auto listener = firelink_bench::make_listener(io_core, 1, listener_ep);
+    auto client = firelink_bench::make_tcp_socket(io_core);
+    firelink::ErrorCode err = listener.has_value() ? firelink::ErrorCode::Success : listener.error();
+    if (err == firelink::ErrorCode::Success)
+      err = client.has_value() ? client.value()->connect(listener_ep) : client.error();
+
+    if (err != firelink::ErrorCode::Success)
+    {
+      std::cerr << "numa: setup error " << static_cast<int>(err) << std::endl;
+      io_core->release();
+      return 0.0;
+    }
+
+    firelink_bench::serve_echo(io_core, listener.value());
+
+    auto done = std::make_shared<std::atomic<std::uint32_t>>(0);
+    std::uint64_t start = firelink_bench::now_ns();
+    ping_pong(client.value(), std::make_shared<std::vector<std::byte>>(MESSAGE_SIZE), done, ROUND_TRIPS);
+    if (!firelink_bench::wait_until([&]() { return done->load() == ROUND_TRIPS; }))
+      std::cerr << "numa: round trips timed out" << std::endl;
+    std::uint64_t elapsed_ns = firelink_bench::now_ns() - start;
+
+    stats = io_core->numa_stats();
+    client.value()->close();
+    listener.value()->close();
+    io_core->release();
+
+    return elapsed_ns == 0 ? 0.0 : static_cast<double>(done->load()) * 1e9 / static_cast<double>(elapsed_ns);
+  }
+
+  void numa_bench(firelink_bench::Report& report)
+  {
+    report.add("numa_nodes", static_cast<double>(firelink::numa_node_count()), "nodes");
+
+    std::uint32_t node = firelink::current_numa_node();
+    std::uint64_t start = firelink_bench::now_ns();
+    for (std::uint32_t i = 0; i < ALLOCATIONS; ++i)
+    {
+      auto buffer = firelink::NodeBuffer::allocate(BUFFER_SIZE, node);
+      if (!buffer.has_value())
+      {
+        std::cerr << "numa: NodeBuffer::allocate error " << static_cast<int>(buffer.error()) << std::endl;
+        return;
+      }
+
+      // Touch the first page so it is actually placed
+      buffer.value().data()[0] = std::byte{1};
+      firelink_bench::do_not_optimize(buffer.value().data());
+    }
+    report.add("node_buffer_alloc_free", static_cast<double>(firelink_bench::now_ns() - start) / ALLOCATIONS, "ns/op");
+
+    firelink::NumaStats stats{};
+    report.add("echo_default", echo_rate(false, stats), "round trips/s");
+    report.add("echo_numa_aware", echo_rate(true, stats), "round trips/s");
+    report.add("nic_local_handlers", static_cast<double>(stats.nic_local_handlers_), "handlers");
+    report.add("nic_remote_handlers", static_cast<double>(stats.nic_remote_handlers_), "handlers");
+    report.add("cross_node_hops_avoided", static_cast<double>(stats.cross_node_hops_avoided_), "completions");
+  }
+
+  firelink_bench::Registrar registrar("numa", "node-local buffers and echo round trips with NUMA-aware threadpools",
+                                      numa_bench);
+}
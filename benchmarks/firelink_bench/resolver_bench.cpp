@@ -0,0 +1,179 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+#include "firelink/resolver.hpp"
+
+#include <string>
+#include <thread>
+
+/*
+ * Name resolution against a stub DNS server on loopback that answers every A query with 127.0.0.1.
+ * Measures lookups that go to the server (cache disabled), lookups answered from the cache, and bursts of
+ * lookups for the same name that are coalesced into a single query.
+ */
+
+namespace
+{
+  constexpr std::uint32_t LOOKUPS = 2000;
+  constexpr std::uint32_t BURST = 64;
+
+  // Answers queries until a datagram shorter than a DNS header arrives
+  void run_stub_server(std::shared_ptr<firelink::Socket> server, std::shared_ptr<std::atomic<std::uint64_t>> answered)
+  {
+    std::vector<std::byte> buffer(1232);
+    for (;;)
+    {
+      firelink::Endpoint client{};
+      std::int32_t bytes = server->recv_from(buffer, client);
+      if (bytes < 12)
+        return;
+
+      // Header and question of the query, its OPT record dropped
+      std::size_t question_end = 12;
+      while (question_end < static_cast<std::size_t>(bytes) && buffer[question_end] != std::byte{0})
+        question_end += 1 + static_cast<std::size_t>(buffer[question_end]);
+      question_end += 5;
+
+      std::vector<std::byte> reply(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(question_end));
+      reply[2] = std::byte{0x81};
+      reply[3] = std::byte{0x80};
+      reply[7] = std::byte{1};   // ANCOUNT
+      reply[11] = std::byte{0};  // ARCOUNT
+
+      // Answer pointing back at the question name, type A, class IN, TTL 300, 127.0.0.1
+      const std::uint8_t answer[] = {0xC0, 0x0C, 0, 1, 0, 1, 0, 0, 0x01, 0x2C, 0, 4, 127, 0, 0, 1};
+      for (std::uint8_t b : answer)
+        reply.push_back(static_cast<std::byte>(b));
+
+      server->send_to(reply, client);
+      answered->fetch_add(1);
+    }
+  }
+
+  // Runs count lookups one after another and returns the time they took
+  std::uint64_t sequential_lookups(std::shared_ptr<firelink::Resolver> resolver, std::uint32_t count,
+                                   std::uint32_t& failed)
+  {
+    auto done = std::make_shared<std::atomic<std::uint32_t>>(0);
+    auto errors = std::make_shared<std::atomic<std::uint32_t>>(0);
+
+    std::uint64_t start = firelink_bench::now_ns();
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+      std::uint32_t target = i + 1;
+      resolver->async_resolve("bench.firelink.test", 80, firelink::AddressFamily::IPv4,
+                              [done, errors](const std::vector<firelink::Endpoint>&, firelink::ErrorCode error,
+                                             firelink::ResolveTag)
+      {
+        if (error != firelink::ErrorCode::Success)
+          errors->fetch_add(1);
+        done->fetch_add(1);
+      });
+
+      firelink_bench::wait_until([&]() { return done->load() == target; });
+    }
+
+    failed = errors->load();
+    return firelink_bench::now_ns() - start;
+  }
+
+  void resolver_bench(firelink_bench::Report& report)
+  {
+    auto io_core = firelink_bench::make_io_core(2, 2);
+    if (!io_core.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core.error()) << std::endl;
+      return;
+    }
+
+    auto server = firelink::Socket::create(io_core.value());
+    firelink::Endpoint server_ep{};
+    firelink::ErrorCode err = server.has_value() ? server.value()->socket(firelink::AddressFamily::IPv4,
+                                                                          firelink::SocketType::Datagram,
+                                                                          firelink::Protocol::Udp)
+                                                 : server.error();
+    if (err == firelink::ErrorCode::Success)
+      err = server.value()->bind(firelink::IPv4Address::loopback(0));
+    if (err == firelink::ErrorCode::Success)
+      err = server.value()->get_sock_name(server_ep);
+
+    if (err != firelink::ErrorCode::Success)
+    {
+      std::cerr << "resolver: stub server setup error " << static_cast<int>(err) << std::endl;
+      io_core.value()->release();
+      return;
+    }
+
+    auto answered = std::make_shared<std::atomic<std::uint64_t>>(0);
+    std::thread stub(run_stub_server, server.value(), answered);
+
+    firelink::ResolverConfig uncached_conf{};
+    uncached_conf.nameservers_ = {server_ep};
+    uncached_conf.max_cache_entries_ = 0;
+
+    firelink::ResolverConfig cached_conf{};
+    cached_conf.nameservers_ = {server_ep};
+
+    auto uncached = firelink::Resolver::create(io_core.value(), uncached_conf);
+    auto cached = firelink::Resolver::create(io_core.value(), cached_conf);
+    if (uncached.has_value() && cached.has_value())
+    {
+      std::uint32_t failed = 0;
+      std::uint64_t elapsed = sequential_lookups(uncached.value(), LOOKUPS, failed);
+      report.add("uncached_lookup", static_cast<double>(elapsed) / LOOKUPS / 1000.0, "us/op");
+      if (failed != 0)
+        std::cerr << "resolver: " << failed << " uncached lookups failed" << std::endl;
+
+      // The first lookup fills the cache
+      sequential_lookups(cached.value(), 1, failed);
+      elapsed = sequential_lookups(cached.value(), LOOKUPS, failed);
+      report.add("cached_lookup", static_cast<double>(elapsed) / LOOKUPS / 1000.0, "us/op");
+
+      // Same name looked up BURST times at once with the cache disabled
+      std::uint64_t answered_before = answered->load();
+      auto done = std::make_shared<std::atomic<std::uint32_t>>(0);
+      std::uint64_t start = firelink_bench::now_ns();
+      for (std::uint32_t i = 0; i < BURST; ++i)
+      {
+        uncached.value()->async_resolve("burst.firelink.test", 80, firelink::AddressFamily::IPv4,
+                                        [done](const std::vector<firelink::Endpoint>&, firelink::ErrorCode,
+                                               firelink::ResolveTag)
+        {
+          done->fetch_add(1);
+        });
+      }
+
+      if (!firelink_bench::wait_until([&]() { return done->load() == BURST; }))
+        std::cerr << "resolver: burst timed out" << std::endl;
+
+      report.add("burst_64_same_name", static_cast<double>(firelink_bench::now_ns() - start) / 1000.0, "us");
+      report.add("burst_64_queries_sent", static_cast<double>(answered->load() - answered_before), "queries");
+    }
+    else
+    {
+      std::cerr << "resolver: create error" << std::endl;
+    }
+
+    // A short datagram stops the stub server
+    auto stopper = firelink::Socket::create(io_core.value());
+    if (stopper.has_value() && stopper.value()->socket(firelink::AddressFamily::IPv4, firelink::SocketType::Datagram,
+                                                       firelink::Protocol::Udp) == firelink::ErrorCode::Success)
+    {
+      std::byte stop_byte{0};
+      stopper.value()->send_to(std::span<std::byte>(&stop_byte, 1), server_ep);
+      stopper.value()->close();
+    }
+
+    stub.join();
+    server.value()->close();
+
+    if (uncached.has_value())
+      uncached.value()->cancel();
+    if (cached.has_value())
+      cached.value()->cancel();
+
+    io_core.value()->release();
+  }
+
+  firelink_bench::Registrar registrar("resolver", "DNS lookups against a loopback stub server, cached and uncached",
+                                      resolver_bench);
+}
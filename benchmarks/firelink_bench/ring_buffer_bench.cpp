@@ -0,0 +1,228 @@
+#include "bench.hpp"
+#include "firelink/ring_buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <span>
+#include <vector>
+
+/*
+ * Parses a stream of length-prefixed frames (4 byte little endian length + payload) that arrives in
+ * randomly sized chunks, like the data returned by consecutive recv completions. The classic ring buffer
+ * has to copy frames that wrap around its end into a scratch buffer before they can be parsed, the
+ * mirrored ring buffer parses every frame in place.
+ */
+
+namespace
+{
+  constexpr std::size_t RING_CAPACITY = 64 * 1024;
+  constexpr std::size_t STREAM_BYTES = 64 * 1024 * 1024;
+
+  struct ParseStats
+  {
+    std::uint64_t frames = 0;
+    std::uint64_t checksum = 0;
+    std::uint64_t bytes_copied = 0;
+  };
+
+  std::vector<std::byte> make_stream()
+  {
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<std::uint32_t> payload_len(16, 1500);
+
+    std::vector<std::byte> stream{};
+    stream.reserve(STREAM_BYTES + 2048);
+    while (stream.size() < STREAM_BYTES)
+    {
+      std::uint32_t len = payload_len(rng);
+      for (int i = 0; i < 4; ++i)
+        stream.push_back(static_cast<std::byte>((len >> (8 * i)) & 0xFF));
+
+      for (std::uint32_t i = 0; i < len; ++i)
+        stream.push_back(static_cast<std::byte>(rng() & 0xFF));
+    }
+
+    return stream;
+  }
+
+  std::vector<std::size_t> make_chunks(std::size_t total)
+  {
+    std::mt19937 rng(4321);
+    std::uniform_int_distribution<std::size_t> chunk_len(1, 8192);
+
+    std::vector<std::size_t> chunks{};
+    std::size_t fed = 0;
+    while (fed < total)
+    {
+      std::size_t len = std::min(chunk_len(rng), total - fed);
+      chunks.push_back(len);
+      fed += len;
+    }
+
+    return chunks;
+  }
+
+  inline std::uint64_t parse_payload(const std::byte* payload, std::uint32_t len)
+  {
+    // FNV-1a, stands in for real protocol parsing
+    std::uint64_t hash = 14695981039346656037ull;
+    for (std::uint32_t i = 0; i < len; ++i)
+    {
+      hash ^= static_cast<std::uint64_t>(payload[i]);
+      hash *= 1099511628211ull;
+    }
+
+    return hash;
+  }
+
+  inline std::uint32_t read_len(const std::byte* p)
+  {
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8) |
+           (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+  }
+
+  // Conventional ring buffer over a flat array. Reading or writing across the end takes two segments.
+  class ClassicRing
+  {
+    public:
+    explicit ClassicRing(std::size_t capacity) : data_(capacity) {}
+
+    std::size_t space() const { return data_.size() - size_; }
+    std::size_t size() const { return size_; }
+
+    void write(const std::byte* src, std::size_t len)
+    {
+      std::size_t write_pos = (read_ + size_) % data_.size();
+      std::size_t first = std::min(len, data_.size() - write_pos);
+      std::memcpy(data_.data() + write_pos, src, first);
+      std::memcpy(data_.data(), src + first, len - first);
+      size_ += len;
+    }
+
+    // Returns a pointer to len contiguous readable bytes at offset, copying into scratch if they wrap
+    const std::byte* peek(std::size_t offset, std::size_t len, std::vector<std::byte>& scratch, ParseStats& stats)
+    {
+      std::size_t pos = (read_ + offset) % data_.size();
+      if (pos + len <= data_.size())
+        return data_.data() + pos;
+
+      scratch.resize(len);
+      std::size_t first = data_.size() - pos;
+      std::memcpy(scratch.data(), data_.data() + pos, first);
+      std::memcpy(scratch.data() + first, data_.data(), len - first);
+      stats.bytes_copied += len;
+      return scratch.data();
+    }
+
+    void consume(std::size_t len)
+    {
+      read_ = (read_ + len) % data_.size();
+      size_ -= len;
+    }
+
+    private:
+    std::vector<std::byte> data_;
+    std::size_t read_ = 0;
+    std::size_t size_ = 0;
+  };
+
+  ParseStats run_classic(const std::vector<std::byte>& stream, const std::vector<std::size_t>& chunks)
+  {
+    ParseStats stats{};
+    ClassicRing ring(RING_CAPACITY);
+    std::vector<std::byte> scratch{};
+    std::size_t fed = 0;
+
+    for (std::size_t chunk : chunks)
+    {
+      ring.write(stream.data() + fed, chunk);
+      fed += chunk;
+
+      for (;;)
+      {
+        if (ring.size() < 4)
+          break;
+
+        std::uint32_t len = read_len(ring.peek(0, 4, scratch, stats));
+        if (ring.size() < 4 + static_cast<std::size_t>(len))
+          break;
+
+        stats.checksum ^= parse_payload(ring.peek(4, len, scratch, stats), len);
+        stats.frames++;
+        ring.consume(4 + len);
+      }
+    }
+
+    return stats;
+  }
+
+  ParseStats run_mirrored(firelink::MirroredRingBuffer& ring, const std::vector<std::byte>& stream,
+                          const std::vector<std::size_t>& chunks)
+  {
+    ParseStats stats{};
+    std::size_t fed = 0;
+
+    for (std::size_t chunk : chunks)
+    {
+      // Stand-in for start_recv(ring, ...) completing with chunk bytes
+      std::memcpy(ring.writable_span().data(), stream.data() + fed, chunk);
+      ring.commit(chunk);
+      fed += chunk;
+
+      for (;;)
+      {
+        std::span<std::byte> readable = ring.readable_span();
+        if (readable.size() < 4)
+          break;
+
+        std::uint32_t len = read_len(readable.data());
+        if (readable.size() < 4 + static_cast<std::size_t>(len))
+          break;
+
+        stats.checksum ^= parse_payload(readable.data() + 4, len);
+        stats.frames++;
+        ring.consume(4 + len);
+      }
+    }
+
+    return stats;
+  }
+
+  void ring_buffer_bench(firelink_bench::Report& report)
+  {
+    std::vector<std::byte> stream = make_stream();
+    std::vector<std::size_t> chunks = make_chunks(stream.size());
+
+    auto ring = firelink::MirroredRingBuffer::create(RING_CAPACITY);
+    if (!ring.has_value())
+    {
+      std::cerr << "firelink::MirroredRingBuffer::create error " << static_cast<int>(ring.error()) << std::endl;
+      return;
+    }
+
+    std::uint64_t start = firelink_bench::now_ns();
+    ParseStats classic = run_classic(stream, chunks);
+    std::uint64_t classic_ns = firelink_bench::now_ns() - start;
+
+    start = firelink_bench::now_ns();
+    ParseStats mirrored = run_mirrored(ring.value(), stream, chunks);
+    std::uint64_t mirrored_ns = firelink_bench::now_ns() - start;
+
+    firelink_bench::do_not_optimize(classic.checksum);
+    firelink_bench::do_not_optimize(mirrored.checksum);
+
+    if (classic.checksum != mirrored.checksum || classic.frames != mirrored.frames)
+      std::cerr << "ring_buffer: parsers disagree!" << std::endl;
+
+    double mb = static_cast<double>(stream.size()) / (1024.0 * 1024.0);
+    report.add("frames", static_cast<double>(classic.frames), "frames");
+    report.add("classic_throughput", mb / (static_cast<double>(classic_ns) / 1e9), "MiB/s");
+    report.add("classic_reassembly_copies", static_cast<double>(classic.bytes_copied), "bytes");
+    report.add("mirrored_throughput", mb / (static_cast<double>(mirrored_ns) / 1e9), "MiB/s");
+    report.add("mirrored_reassembly_copies", static_cast<double>(mirrored.bytes_copied), "bytes");
+  }
+
+  firelink_bench::Registrar registrar("ring_buffer", "frame parsing over a classic vs mirrored ring buffer",
+                                      ring_buffer_bench);
+}
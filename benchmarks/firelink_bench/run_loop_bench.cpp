@@ -0,0 +1,160 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+
+#include <algorithm>
+#include <string>
+
+/*
+ * Caller-driven event loop. Runs echo round trips over loopback, client and echo server on the same IOCore,
+ * and reports round trips per second and p50/p99 of the round trip time for each way of running handlers:
+ * in the user threadpool, and with HandlerDispatch::RunLoop driven by this thread through run_one, through
+ * poll in a spin, and through run_for in 1 ms frames like a game loop would.
+ */
+
+namespace
+{
+  constexpr std::uint32_t ROUND_TRIPS = 20'000;
+  constexpr std::size_t MESSAGE_SIZE = 64;
+  constexpr std::chrono::milliseconds FRAME{1};
+
+  enum class Driver
+  {
+    Threadpool,
+    RunOne,
+    Poll,
+    RunFor
+  };
+
+  struct RoundTrips
+  {
+    std::vector<std::uint64_t> samples_ns_;
+    std::atomic<std::uint32_t> done_{0};
+    std::uint64_t sent_ns_ = 0;
+  };
+
+  void ping_pong(std::shared_ptr<firelink::Socket> socket, std::shared_ptr<std::vector<std::byte>> buffer,
+                 std::shared_ptr<RoundTrips> round_trips, std::uint32_t remaining)
+  {
+    if (remaining == 0)
+      return;
+
+    round_trips->sent_ns_ = firelink_bench::now_ns();
+    socket->start_send(*buffer, [buffer, round_trips, remaining](std::shared_ptr<firelink::Socket> caller,
+                                                                 firelink::ErrorCode error, std::int32_t, firelink::WriteTag)
+    {
+      if (error != firelink::ErrorCode::Success)
+      {
+        round_trips->done_.fetch_add(remaining);
+        return;
+      }
+
+      caller->start_recv(*buffer, [buffer, round_trips, remaining](std::shared_ptr<firelink::Socket> caller,
+                                                                   firelink::ErrorCode error, std::int32_t, firelink::ReadTag)
+      {
+        if (error != firelink::ErrorCode::Success)
+        {
+          round_trips->done_.fetch_add(remaining);
+          return;
+        }
+
+        round_trips->samples_ns_.push_back(firelink_bench::now_ns() - round_trips->sent_ns_);
+        round_trips->done_.fetch_add(1);
+        ping_pong(std::move(caller), buffer, round_trips, remaining - 1);
+      });
+    });
+  }
+
+  // Runs handlers on this thread until all round trips are done or the deadline has passed
+  bool drive(firelink::IOCore& io_core, Driver driver, const RoundTrips& round_trips)
+  {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+    while (round_trips.done_.load() != ROUND_TRIPS)
+    {
+      if (std::chrono::steady_clock::now() > deadline)
+        return false;
+
+      if (driver == Driver::RunOne)
+        io_core.run_one();
+      else if (driver == Driver::Poll)
+        io_core.poll();
+      else
+        io_core.run_for(FRAME);
+    }
+
+    return true;
+  }
+
+  void run(firelink_bench::Report& report, const std::string& prefix, Driver driver)
+  {
+    firelink::IOCoreConfig config{1, 1, 1, 1};
+    if (driver != Driver::Threadpool)
+      config.handler_dispatch_ = firelink::HandlerDispatch::RunLoop;
+
+    auto created = firelink::IOCore::create(config);
+    if (!created.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(created.error()) << std::endl;
+      return;
+    }
+
+    std::shared_ptr<firelink::IOCore> io_core(std::move(created.value()));
+
+    firelink::Endpoint listener_ep{};
+    auto listener = firelink_bench::make_listener(io_core, 1, listener_ep);
+    auto client = firelink_bench::make_tcp_socket(io_core);
+    firelink::ErrorCode err = listener.has_value() ? firelink::ErrorCode::Success : listener.error();
+    if (err == firelink::ErrorCode::Success)
+      err = client.has_value() ? client.value()->connect(listener_ep) : client.error();
+
+    if (err != firelink::ErrorCode::Success)
+    {
+      std::cerr << "run_loop: setup error " << static_cast<int>(err) << std::endl;
+      io_core->release();
+      return;
+    }
+
+    firelink_bench::serve_echo(io_core, listener.value());
+
+    auto round_trips = std::make_shared<RoundTrips>();
+    round_trips->samples_ns_.reserve(ROUND_TRIPS);
+
+    std::uint64_t start = firelink_bench::now_ns();
+    ping_pong(client.value(), std::make_shared<std::vector<std::byte>>(MESSAGE_SIZE), round_trips, ROUND_TRIPS);
+
+    bool finished = driver == Driver::Threadpool
+      ? firelink_bench::wait_until([&]() { return round_trips->done_.load() == ROUND_TRIPS; })
+      : drive(*io_core, driver, *round_trips);
+    std::uint64_t elapsed_ns = firelink_bench::now_ns() - start;
+
+    if (!finished)
+      std::cerr << "run_loop: " << prefix << " round trips timed out" << std::endl;
+
+    client.value()->close();
+    listener.value()->close();
+
+    // Let the closed sockets' handlers run before the IOCore goes away
+    if (driver != Driver::Threadpool)
+      io_core->poll();
+    io_core->release();
+
+    std::vector<std::uint64_t> samples = std::move(round_trips->samples_ns_);
+    if (samples.empty() || elapsed_ns == 0)
+      return;
+
+    std::sort(samples.begin(), samples.end());
+    report.add(prefix + "_rate", static_cast<double>(samples.size()) * 1e9 / static_cast<double>(elapsed_ns), "round trips/s");
+    report.add(prefix + "_p50", static_cast<double>(samples[samples.size() / 2]) / 1000.0, "us");
+    report.add(prefix + "_p99", static_cast<double>(samples[(samples.size() - 1) * 99 / 100]) / 1000.0, "us");
+  }
+
+  void run_loop_bench(firelink_bench::Report& report)
+  {
+    run(report, "threadpool", Driver::Threadpool);
+    run(report, "run_one", Driver::RunOne);
+    run(report, "poll", Driver::Poll);
+    run(report, "run_for", Driver::RunFor);
+  }
+
+  firelink_bench::Registrar registrar("run_loop", "echo round trips with handlers in the user threadpool or on the caller",
+                                      run_loop_bench);
+}
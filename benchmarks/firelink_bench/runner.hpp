@@ -0,0 +1,205 @@
+#ifndef FIRELINK_BENCH_RUNNER_H
+#define FIRELINK_BENCH_RUNNER_H
+
+#include "bench.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+// The command line driver shared by the benchmark executables
+namespace firelink_bench
+{
+  struct BenchRun
+  {
+    const Benchmark* bench;
+    Report report;
+  };
+
+  template<typename T>
+  inline bool parse_number(std::string_view text, T& value)
+  {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc{} && result.ptr == text.data() + text.size();
+  }
+
+  inline void append_json_string(std::string& out, std::string_view text)
+  {
+    out.push_back('"');
+    for (char c : text)
+    {
+      if (c == '"' || c == '\\')
+        out.push_back('\\');
+      out.push_back(c);
+    }
+    out.push_back('"');
+  }
+
+  inline void append_json_number(std::string& out, double value)
+  {
+    if (!std::isfinite(value))
+    {
+      out.append("null");
+      return;
+    }
+
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+  }
+
+  // One object per run: the scenario options, then every benchmark with its results
+  inline std::string to_json(const std::vector<BenchRun>& runs)
+  {
+    const Options& opts = options();
+
+    std::string out{};
+    out.append("{\n  \"options\": {\"message_size\": ");
+    out.append(std::to_string(opts.message_size));
+    out.append(", \"connections\": ");
+    out.append(std::to_string(opts.connections));
+    out.append(", \"duration_ms\": ");
+    out.append(std::to_string(opts.duration_ms));
+    out.append(", \"io_threads\": ");
+    out.append(std::to_string(opts.io_threads));
+    out.append(", \"user_threads\": ");
+    out.append(std::to_string(opts.user_threads));
+    out.append("},\n  \"benchmarks\": [");
+
+    for (std::size_t i = 0; i < runs.size(); ++i)
+    {
+      out.append(i == 0 ? "\n    {\"name\": " : ",\n    {\"name\": ");
+      append_json_string(out, runs[i].bench->name);
+      out.append(", \"description\": ");
+      append_json_string(out, runs[i].bench->description);
+      out.append(", \"results\": [");
+
+      const std::vector<Result>& results = runs[i].report.results();
+      for (std::size_t j = 0; j < results.size(); ++j)
+      {
+        out.append(j == 0 ? "\n      {\"name\": " : ",\n      {\"name\": ");
+        append_json_string(out, results[j].name);
+        out.append(", \"value\": ");
+        append_json_number(out, results[j].value);
+        out.append(", \"unit\": ");
+        append_json_string(out, results[j].unit);
+        out.push_back('}');
+      }
+
+      out.append(results.empty() ? "]}" : "\n    ]}");
+    }
+
+    out.append(runs.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    return out;
+  }
+
+  inline void print_usage(std::string_view program)
+  {
+    std::cerr << "Usage: " << program << " [--list] [--json file] [--message-size bytes] [--connections n]"
+              << " [--duration-ms ms] [--io-threads n] [--user-threads n] [filter...]" << std::endl;
+  }
+
+  // Parses the options and runs the selected benchmarks, see firelink_bench's main.cpp for the usage
+  inline int run(int argc, char** argv, std::string_view program)
+  {
+    std::vector<std::string_view> filters{};
+    bool list_only = false;
+    std::string json_path{};
+    Options& opts = options();
+
+    for (int i = 1; i < argc; ++i)
+    {
+      std::string_view arg(argv[i]);
+      if (arg == "--list")
+      {
+        list_only = true;
+        continue;
+      }
+
+      if (!arg.starts_with("--"))
+      {
+        filters.push_back(arg);
+        continue;
+      }
+
+      if (i + 1 >= argc)
+      {
+        std::cerr << "Missing value for " << arg << std::endl;
+        print_usage(program);
+        return 1;
+      }
+
+      std::string_view value(argv[++i]);
+      bool valid = true;
+      if (arg == "--json")
+        json_path = value;
+      else if (arg == "--message-size")
+        valid = parse_number(value, opts.message_size) && opts.message_size > 0;
+      else if (arg == "--connections")
+        valid = parse_number(value, opts.connections) && opts.connections > 0;
+      else if (arg == "--duration-ms")
+        valid = parse_number(value, opts.duration_ms) && opts.duration_ms > 0;
+      else if (arg == "--io-threads")
+        valid = parse_number(value, opts.io_threads) && opts.io_threads > 0;
+      else if (arg == "--user-threads")
+        valid = parse_number(value, opts.user_threads) && opts.user_threads > 0;
+      else
+        valid = false;
+
+      if (!valid)
+      {
+        std::cerr << "Invalid argument " << arg << " " << value << std::endl;
+        print_usage(program);
+        return 1;
+      }
+    }
+
+    std::vector<BenchRun> runs{};
+    for (const Benchmark& bench : registry())
+    {
+      if (list_only)
+      {
+        std::cout << bench.name << " - " << bench.description << std::endl;
+        continue;
+      }
+
+      bool selected = filters.empty();
+      for (std::string_view filter : filters)
+      {
+        if (std::string_view(bench.name).find(filter) != std::string_view::npos)
+          selected = true;
+      }
+
+      if (!selected)
+        continue;
+
+      std::cout << "[" << bench.name << "] " << bench.description << std::endl;
+
+      Report report{};
+      bench.func(report);
+
+      for (const Result& result : report.results())
+        std::cout << "  " << result.name << ": " << result.value << " " << result.unit << std::endl;
+
+      runs.push_back(BenchRun{&bench, std::move(report)});
+    }
+
+    if (!json_path.empty() && !list_only)
+    {
+      std::ofstream file(json_path, std::ios::binary);
+      file << to_json(runs);
+      if (!file)
+      {
+        std::cerr << "Failed to write " << json_path << std::endl;
+        return 1;
+      }
+    }
+
+    return 0;
+  }
+}
+
+#endif /* FIRELINK_BENCH_RUNNER_H */
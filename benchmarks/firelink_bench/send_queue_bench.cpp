@@ -0,0 +1,162 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+
+#include <deque>
+#include <mutex>
+#include <thread>
+
+/*
+ * Many producer threads sending small messages on one socket. Compares the built-in post_send queue, which
+ * coalesces everything queued during a write into one WSASend, against the mutex-guarded queue applications
+ * had to build on top of start_send (one WSASend per message).
+ */
+
+namespace
+{
+  constexpr std::uint32_t PRODUCERS = 8;
+  constexpr std::uint32_t MESSAGES_PER_PRODUCER = 20000;
+  constexpr std::size_t MESSAGE_SIZE = 64;
+
+  // The pattern the built-in queue replaces: a locked queue with one start_send in flight
+  class MutexSendQueue : public std::enable_shared_from_this<MutexSendQueue>
+  {
+    public:
+    MutexSendQueue(std::shared_ptr<firelink::Socket> socket, std::atomic<std::uint64_t>* sent) :
+      socket_(std::move(socket)), sent_(sent) {}
+
+    void send(std::span<std::byte> data)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back(data);
+      if (!in_flight_)
+      {
+        in_flight_ = true;
+        send_front();
+      }
+    }
+
+    private:
+    // Called with mutex_ held
+    void send_front()
+    {
+      auto self = shared_from_this();
+      socket_->start_send(queue_.front(), [self](std::shared_ptr<firelink::Socket>, firelink::ErrorCode,
+                                                  std::int32_t, firelink::WriteTag)
+      {
+        self->sent_->fetch_add(1);
+
+        std::lock_guard<std::mutex> lock(self->mutex_);
+        self->queue_.pop_front();
+        if (self->queue_.empty())
+          self->in_flight_ = false;
+        else
+          self->send_front();
+      });
+    }
+
+    std::shared_ptr<firelink::Socket> socket_;
+    std::atomic<std::uint64_t>* sent_;
+    std::mutex mutex_;
+    std::deque<std::span<std::byte>> queue_;
+    bool in_flight_ = false;
+  };
+
+  template<typename SendFunc>
+  double run_producers(firelink_bench::LoopbackPair& pair, std::atomic<std::uint64_t>& sent, SendFunc&& send)
+  {
+    std::atomic<std::uint64_t> received{0};
+    auto buffer = std::make_shared<std::vector<std::byte>>(64 * 1024);
+    firelink_bench::drain(pair.server, buffer, &received);
+
+    std::vector<std::vector<std::byte>> payloads(PRODUCERS, std::vector<std::byte>(MESSAGE_SIZE, std::byte{0x2A}));
+    std::uint64_t total_messages = static_cast<std::uint64_t>(PRODUCERS) * MESSAGES_PER_PRODUCER;
+
+    std::uint64_t start = firelink_bench::now_ns();
+
+    std::vector<std::thread> producers{};
+    for (std::uint32_t p = 0; p < PRODUCERS; ++p)
+    {
+      producers.emplace_back([&, p]()
+      {
+        for (std::uint32_t i = 0; i < MESSAGES_PER_PRODUCER; ++i)
+          send(std::span<std::byte>(payloads[p]));
+      });
+    }
+
+    for (std::thread& producer : producers)
+      producer.join();
+
+    bool done = firelink_bench::wait_until([&]()
+    {
+      return sent.load() == total_messages && received.load() == total_messages * MESSAGE_SIZE;
+    });
+
+    std::uint64_t elapsed = firelink_bench::now_ns() - start;
+    if (!done)
+      std::cerr << "send_queue: timed out" << std::endl;
+
+    return static_cast<double>(total_messages) / (static_cast<double>(elapsed) / 1e9);
+  }
+
+  void send_queue_bench(firelink_bench::Report& report)
+  {
+    auto io_core = firelink_bench::make_io_core(4, 4);
+    if (!io_core.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core.error()) << std::endl;
+      return;
+    }
+
+    // Built-in lock-free queue
+    {
+      auto pair = firelink_bench::make_loopback_pair(io_core.value());
+      if (!pair.has_value())
+      {
+        std::cerr << "send_queue: loopback setup error " << static_cast<int>(pair.error()) << std::endl;
+        io_core.value()->release();
+        return;
+      }
+
+      std::atomic<std::uint64_t> sent{0};
+      double rate = run_producers(pair.value(), sent, [&](std::span<std::byte> data)
+      {
+        pair.value().client->post_send(data, [&sent](std::shared_ptr<firelink::Socket>, firelink::ErrorCode,
+                                                     std::int32_t, firelink::WriteTag)
+        {
+          sent.fetch_add(1);
+        });
+      });
+
+      report.add("post_send", rate, "msg/s");
+      pair.value().client->close();
+      pair.value().server->close();
+    }
+
+    // Mutex-guarded queue over start_send
+    {
+      auto pair = firelink_bench::make_loopback_pair(io_core.value());
+      if (!pair.has_value())
+      {
+        std::cerr << "send_queue: loopback setup error " << static_cast<int>(pair.error()) << std::endl;
+        io_core.value()->release();
+        return;
+      }
+
+      std::atomic<std::uint64_t> sent{0};
+      auto queue = std::make_shared<MutexSendQueue>(pair.value().client, &sent);
+      double rate = run_producers(pair.value(), sent, [&](std::span<std::byte> data)
+      {
+        queue->send(data);
+      });
+
+      report.add("mutex_queue_start_send", rate, "msg/s");
+      pair.value().client->close();
+      pair.value().server->close();
+    }
+
+    io_core.value()->release();
+  }
+
+  firelink_bench::Registrar registrar("send_queue", "8 producers sending 64 byte messages on one socket",
+                                      send_queue_bench);
+}
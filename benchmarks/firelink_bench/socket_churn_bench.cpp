@@ -0,0 +1,144 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+
+#include <array>
+
+/*
+ * Short-lived connections against a loopback server. The server accepts, waits for the client to close
+ * and disconnects the accepted socket with reuse_socket, so both the Socket object and its native handle
+ * can be recycled for the next accept. Runs once with the socket pool disabled and once with it enabled
+ * and reports the connection rate and how many objects and handles were reused.
+ */
+
+namespace
+{
+  constexpr std::uint32_t CHAINS = 8;
+  constexpr std::uint32_t CONNECTIONS_PER_CHAIN = 250;
+
+  // Accepts connections, each one is disconnected for reuse as soon as the client closes it
+  void serve_churn(std::shared_ptr<firelink::IOCore> io_core, std::shared_ptr<firelink::Socket> listener,
+                   std::shared_ptr<std::atomic<std::uint64_t>> accepted)
+  {
+    auto accept_socket = firelink::Socket::create(io_core);
+    if (!accept_socket.has_value())
+      return;
+
+    listener->start_accept(accept_socket.value(), [io_core, accepted](std::shared_ptr<firelink::Socket> caller,
+                                                                      std::shared_ptr<firelink::Socket> accepted_socket,
+                                                                      const firelink::Endpoint&, const firelink::Endpoint&,
+                                                                      firelink::ErrorCode error, firelink::AcceptTag)
+    {
+      if (error != firelink::ErrorCode::Success)
+        return;
+
+      accepted->fetch_add(1);
+      serve_churn(io_core, std::move(caller), accepted);
+
+      auto buffer = std::make_shared<std::array<std::byte, 64>>();
+      accepted_socket->start_recv(*buffer, [buffer](std::shared_ptr<firelink::Socket> caller, firelink::ErrorCode,
+                                                    std::int32_t, firelink::ReadTag)
+      {
+        firelink::ErrorCode err = caller->start_disconnect(true, [](std::shared_ptr<firelink::Socket> caller,
+                                                                    firelink::ErrorCode, firelink::DisconnectTag)
+        {
+          caller->close();
+        });
+
+        if (err != firelink::ErrorCode::Success)
+          caller->close();
+      });
+    });
+  }
+
+  void client_chain(std::shared_ptr<firelink::IOCore> io_core, firelink::Endpoint dst,
+                    std::shared_ptr<std::atomic<std::uint64_t>> done, std::uint32_t remaining)
+  {
+    if (remaining == 0)
+      return;
+
+    auto sock = firelink_bench::make_tcp_socket(io_core);
+    if (!sock.has_value())
+    {
+      done->fetch_add(remaining);
+      return;
+    }
+
+    firelink::ErrorCode err = sock.value()->start_connect(dst, [io_core, dst, done, remaining](
+                                                          std::shared_ptr<firelink::Socket> caller,
+                                                          firelink::ErrorCode, firelink::ConnectTag)
+    {
+      caller->close();
+      done->fetch_add(1);
+      client_chain(io_core, dst, done, remaining - 1);
+    });
+
+    if (err != firelink::ErrorCode::Success)
+    {
+      sock.value()->close();
+      done->fetch_add(remaining);
+    }
+  }
+
+  void run_churn(firelink_bench::Report& report, std::uint32_t socket_pool_capacity, const std::string& prefix)
+  {
+    firelink::IOCoreConfig config{4, 4, 4, 4};
+    config.socket_pool_capacity_ = socket_pool_capacity;
+
+    auto created = firelink::IOCore::create(config);
+    if (!created.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(created.error()) << std::endl;
+      return;
+    }
+
+    std::shared_ptr<firelink::IOCore> io_core = std::move(created.value());
+
+    firelink::Endpoint server_ep{};
+    auto listener = firelink_bench::make_listener(io_core, 512, server_ep);
+    if (!listener.has_value())
+    {
+      std::cerr << "socket_churn: listener error " << static_cast<int>(listener.error()) << std::endl;
+      io_core->release();
+      return;
+    }
+
+    auto accepted = std::make_shared<std::atomic<std::uint64_t>>(0);
+    auto done = std::make_shared<std::atomic<std::uint64_t>>(0);
+    std::uint64_t total = static_cast<std::uint64_t>(CHAINS) * CONNECTIONS_PER_CHAIN;
+
+    serve_churn(io_core, listener.value(), accepted);
+
+    std::uint64_t start = firelink_bench::now_ns();
+    for (std::uint32_t c = 0; c < CHAINS; ++c)
+      client_chain(io_core, server_ep, done, CONNECTIONS_PER_CHAIN);
+
+    if (!firelink_bench::wait_until([&]() { return done->load() == total && accepted->load() >= total; }))
+      std::cerr << "socket_churn: " << prefix << " timed out" << std::endl;
+
+    std::uint64_t elapsed = firelink_bench::now_ns() - start;
+
+    // Give the last disconnects a moment so the counters include them
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    firelink::SocketPoolStats stats = io_core->get_socket_pool_stats();
+
+    double objects = static_cast<double>(stats.objects_created_ + stats.objects_reused_);
+    double handles = static_cast<double>(stats.handles_created_ + stats.handles_reused_);
+
+    report.add(prefix + "_rate", static_cast<double>(accepted->load()) / (static_cast<double>(elapsed) / 1e9), "conn/s");
+    report.add(prefix + "_objects_reused", objects > 0 ? 100.0 * static_cast<double>(stats.objects_reused_) / objects : 0.0, "%");
+    report.add(prefix + "_handles_reused", handles > 0 ? 100.0 * static_cast<double>(stats.handles_reused_) / handles : 0.0, "%");
+
+    listener.value()->cancel();
+    listener.value()->close();
+    io_core->release();
+  }
+
+  void socket_churn_bench(firelink_bench::Report& report)
+  {
+    run_churn(report, 0, "no_pool");
+    run_churn(report, 256, "pooled");
+  }
+
+  firelink_bench::Registrar registrar("socket_churn", "accept churn with and without Socket recycling",
+                                      socket_churn_bench);
+}
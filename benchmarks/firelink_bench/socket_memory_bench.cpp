@@ -0,0 +1,189 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+#include "firelink/tcp_stream.hpp"
+#include "firelink/udp_socket.hpp"
+
+#include <Windows.h>
+#include <Psapi.h>
+
+#include <array>
+#include <iostream>
+#include <variant>
+#include <vector>
+
+/*
+ * Memory per connection. The sizes of the per-object state are reported as they are compiled, next to the
+ * IOData every pending operation used to carry before accept-only state was split off (iodata_before).
+ * win_socket_stream_only is the part of WinSocket only streams use, what a datagram socket would save with
+ * a backend of its own. idle_connection is measured: private bytes of the process per connected TCP stream
+ * with one posted recv, over CONNECTIONS loopback pairs, so it includes the allocator and threadpool IO
+ * overhead. idle_udp_socket is the same for bound UDP sockets with one posted receive.
+ */
+
+namespace
+{
+  constexpr std::uint32_t CONNECTIONS = 2000;
+  constexpr std::size_t RECV_SIZE = 64;
+
+  // The IOData layout before AcceptData, kept here only to size it
+  struct IODataBefore
+  {
+    OVERLAPPED overlapped_{};
+    std::span<std::byte> user_buffer_;
+    std::array<std::byte, ACCEPTEX_BUF_LEN> accept_address_buffer_{};
+    SOCKADDR_STORAGE local_win_addr_{};
+    SOCKADDR_STORAGE peer_win_addr_{};
+    std::shared_ptr<firelink::Socket> socket_;
+    std::shared_ptr<firelink::Socket> accept_socket_;
+    std::variant<firelink::AcceptHandler, firelink::ConnectHandler, firelink::ReadHandler, firelink::WriteHandler,
+                 firelink::DisconnectHandler, firelink::platform::SendBatch> user_handler_;
+    firelink::ErrorCode error_code_ = firelink::ErrorCode::Success;
+    std::int32_t bytes_transferred_ = 0;
+    bool reuse_socket_ = false;
+    firelink::Operation operation_ = firelink::Operation::Unknown;
+    std::uint64_t submitted_ns_ = 0;
+    std::uint64_t completed_ns_ = 0;
+  };
+
+  // The WinSocket members post_send and the handle reuse of disconnect need, in their order in WinSocket
+  struct StreamOnlyState
+  {
+    std::atomic<firelink::platform::SendRequest*> send_queue_head_;
+    std::atomic<bool> send_in_flight_;
+    firelink::platform::SendRequest* send_pending_head_;
+    firelink::platform::SendRequest* send_pending_tail_;
+    bool handle_reusable_;
+  };
+
+  std::uint64_t private_bytes()
+  {
+    PROCESS_MEMORY_COUNTERS_EX counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PPROCESS_MEMORY_COUNTERS>(&counters), sizeof(counters)))
+      return 0;
+
+    return static_cast<std::uint64_t>(counters.PrivateUsage);
+  }
+
+  // Opens the connections, each side with a recv posted, and returns the private bytes they added per stream
+  double idle_connection_bytes(std::shared_ptr<firelink::IOCore> io_core)
+  {
+    firelink::Endpoint listener_ep{};
+    auto listener = firelink_bench::make_listener(io_core, static_cast<std::int32_t>(CONNECTIONS), listener_ep);
+    if (!listener.has_value())
+    {
+      std::cerr << "socket_memory: listener error " << static_cast<int>(listener.error()) << std::endl;
+      return 0.0;
+    }
+
+    std::vector<firelink::TcpStream> streams{};
+    streams.reserve(CONNECTIONS * 2);
+    std::vector<std::byte> buffers(CONNECTIONS * 2 * RECV_SIZE);
+
+    std::uint64_t before = private_bytes();
+    for (std::uint32_t i = 0; i < CONNECTIONS; ++i)
+    {
+      auto client = firelink::TcpStream::open(io_core);
+      auto server = firelink::TcpStream::create(io_core);
+      if (!client.has_value() || !server.has_value())
+        break;
+
+      if (client.value().connect(listener_ep) != firelink::ErrorCode::Success ||
+          listener.value()->accept(server.value().as_socket()) != firelink::ErrorCode::Success)
+      {
+        client.value().close();
+        break;
+      }
+
+      streams.push_back(std::move(client.value()));
+      streams.push_back(std::move(server.value()));
+    }
+
+    for (std::size_t i = 0; i < streams.size(); ++i)
+      streams[i].start_recv(std::span<std::byte>(buffers.data() + i * RECV_SIZE, RECV_SIZE));
+    std::uint64_t after = private_bytes();
+
+    listener.value()->close();
+    for (firelink::TcpStream& stream : streams)
+      stream.close();
+
+    if (streams.size() != CONNECTIONS * 2)
+      std::cerr << "socket_memory: opened " << streams.size() / 2 << " of " << CONNECTIONS << " connections" << std::endl;
+
+    if (streams.empty() || after < before)
+      return 0.0;
+
+    return static_cast<double>(after - before) / static_cast<double>(streams.size());
+  }
+
+  // Opens bound UDP sockets, each with a receive posted, and returns the private bytes they added per socket
+  double idle_udp_bytes(std::shared_ptr<firelink::IOCore> io_core)
+  {
+    std::vector<firelink::UdpSocket> sockets{};
+    sockets.reserve(CONNECTIONS);
+    std::vector<std::byte> buffers(CONNECTIONS * RECV_SIZE);
+
+    std::uint64_t before = private_bytes();
+    for (std::uint32_t i = 0; i < CONNECTIONS; ++i)
+    {
+      auto sock = firelink::UdpSocket::open(io_core);
+      if (!sock.has_value())
+        break;
+
+      if (sock.value().bind(firelink::IPv4Address::loopback(0)) != firelink::ErrorCode::Success)
+      {
+        sock.value().close();
+        break;
+      }
+
+      sockets.push_back(std::move(sock.value()));
+    }
+
+    for (std::size_t i = 0; i < sockets.size(); ++i)
+    {
+      sockets[i].start_recv_from(std::span<std::byte>(buffers.data() + i * RECV_SIZE, RECV_SIZE),
+                                 [](std::shared_ptr<firelink::Socket>, firelink::ErrorCode, std::int32_t,
+                                    const firelink::Endpoint&, firelink::ReadTag) {});
+    }
+    std::uint64_t after = private_bytes();
+
+    for (firelink::UdpSocket& sock : sockets)
+    {
+      sock.cancel();
+      sock.close();
+    }
+
+    if (sockets.size() != CONNECTIONS)
+      std::cerr << "socket_memory: opened " << sockets.size() << " of " << CONNECTIONS << " UDP sockets" << std::endl;
+
+    if (sockets.empty() || after < before)
+      return 0.0;
+
+    return static_cast<double>(after - before) / static_cast<double>(sockets.size());
+  }
+
+  void socket_memory_bench(firelink_bench::Report& report)
+  {
+    report.add("socket_base", static_cast<double>(sizeof(firelink::Socket)), "bytes");
+    report.add("win_socket", static_cast<double>(sizeof(firelink::platform::WinSocket)), "bytes");
+    report.add("win_socket_stream_only", static_cast<double>(sizeof(StreamOnlyState)), "bytes");
+    report.add("tcp_stream", static_cast<double>(sizeof(firelink::TcpStream)), "bytes");
+    report.add("udp_socket", static_cast<double>(sizeof(firelink::UdpSocket)), "bytes");
+    report.add("iodata", static_cast<double>(sizeof(firelink::platform::IOData)), "bytes");
+    report.add("iodata_before", static_cast<double>(sizeof(IODataBefore)), "bytes");
+    report.add("accept_data", static_cast<double>(sizeof(firelink::platform::AcceptData)), "bytes");
+
+    auto io_core = firelink_bench::make_io_core(2, 2);
+    if (!io_core.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core.error()) << std::endl;
+      return;
+    }
+
+    report.add("idle_connection", idle_connection_bytes(io_core.value()), "bytes/stream");
+    report.add("idle_udp_socket", idle_udp_bytes(io_core.value()), "bytes/socket");
+    io_core.value()->release();
+  }
+
+  firelink_bench::Registrar registrar("socket_memory", "per-object state sizes and private bytes per idle TCP stream and UDP socket",
+                                      socket_memory_bench);
+}
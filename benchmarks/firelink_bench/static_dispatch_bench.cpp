@@ -0,0 +1,120 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+#include "firelink/basic_socket.hpp"
+
+#include <array>
+#include <iostream>
+#include <thread>
+
+/*
+ * The polymorphic Socket against the statically dispatched NativeSocket on the same connection:
+ *
+ *   is_valid     a call the backend defines in its header, through the vtable vs inlined
+ *   ping_pong    synchronous 64 byte round trips over loopback, the client and the echoing server both
+ *                calling send/recv through the same interface
+ *
+ * The ping-pong is dominated by the system calls. The difference left is what the virtual calls and the
+ * lost inlining cost per round trip.
+ */
+
+namespace
+{
+  constexpr std::uint32_t CALLS = 10'000'000;
+  constexpr std::uint32_t ROUND_TRIPS = 100'000;
+  constexpr std::size_t MESSAGE_SIZE = 64;
+
+  template<typename S>
+  bool transfer_all(S& socket, std::span<std::byte> buffer, bool sending)
+  {
+    std::size_t done = 0;
+    while (done < buffer.size())
+    {
+      std::int32_t n = sending ? socket.send(buffer.subspan(done)) : socket.recv(buffer.subspan(done));
+      if (n <= 0)
+        return false;
+
+      done += static_cast<std::size_t>(n);
+    }
+
+    return true;
+  }
+
+  // Runs the round trips and returns the average in ns, 0 if the connection failed
+  template<typename S>
+  double ping_pong(S& client, S& server)
+  {
+    std::thread echo_thread([&server]()
+    {
+      std::array<std::byte, MESSAGE_SIZE> buffer{};
+      for (std::uint32_t i = 0; i < ROUND_TRIPS; ++i)
+      {
+        if (!transfer_all(server, buffer, false) || !transfer_all(server, buffer, true))
+          return;
+      }
+    });
+
+    std::array<std::byte, MESSAGE_SIZE> buffer{};
+    bool ok = true;
+    std::uint64_t start = firelink_bench::now_ns();
+    for (std::uint32_t i = 0; i < ROUND_TRIPS && ok; ++i)
+      ok = transfer_all(client, buffer, true) && transfer_all(client, buffer, false);
+    std::uint64_t elapsed = firelink_bench::now_ns() - start;
+
+    if (!ok)
+      server.shutdown(firelink::ShutdownHow::Both);
+    echo_thread.join();
+
+    return ok ? static_cast<double>(elapsed) / ROUND_TRIPS : 0.0;
+  }
+
+  void static_dispatch_bench(firelink_bench::Report& report)
+  {
+    auto io_core = firelink_bench::make_io_core(1, 1);
+    if (!io_core.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core.error()) << std::endl;
+      return;
+    }
+
+    auto pair = firelink_bench::make_loopback_pair(io_core.value());
+    if (!pair.has_value())
+    {
+      std::cerr << "static_dispatch: loopback pair error " << static_cast<int>(pair.error()) << std::endl;
+      io_core.value()->release();
+      return;
+    }
+
+    firelink::Socket& virtual_client = *pair.value().client;
+    firelink::Socket& virtual_server = *pair.value().server;
+    firelink::NativeSocket native_client(std::static_pointer_cast<firelink::NativeSocket::backend_type>(pair.value().client));
+    firelink::NativeSocket native_server(std::static_pointer_cast<firelink::NativeSocket::backend_type>(pair.value().server));
+
+    std::uint64_t start = firelink_bench::now_ns();
+    for (std::uint32_t i = 0; i < CALLS; ++i)
+      firelink_bench::do_not_optimize(virtual_client.is_valid());
+    report.add("is_valid_virtual", static_cast<double>(firelink_bench::now_ns() - start) / CALLS, "ns/call");
+
+    start = firelink_bench::now_ns();
+    for (std::uint32_t i = 0; i < CALLS; ++i)
+      firelink_bench::do_not_optimize(native_client.is_valid());
+    report.add("is_valid_static", static_cast<double>(firelink_bench::now_ns() - start) / CALLS, "ns/call");
+
+    // Alternated and run twice each, so neither variant is favoured by a warm-up
+    double virtual_ns = 0.0;
+    double static_ns = 0.0;
+    for (int run = 0; run < 2; ++run)
+    {
+      virtual_ns += ping_pong(virtual_client, virtual_server);
+      static_ns += ping_pong(native_client, native_server);
+    }
+    report.add("ping_pong_virtual", virtual_ns / 2.0, "ns/rt");
+    report.add("ping_pong_static", static_ns / 2.0, "ns/rt");
+
+    native_client.close();
+    native_server.close();
+    io_core.value()->release();
+  }
+
+  firelink_bench::Registrar registrar("static_dispatch", "Socket virtual calls vs the statically dispatched NativeSocket",
+                                      static_dispatch_bench);
+}
@@ -0,0 +1,143 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+#include "firelink/trace_recorder.hpp"
+
+#include <fstream>
+#include <thread>
+
+/*
+ * Tracing hooks. Measures the cost of a record into a TraceRecorder from one and from several threads, and of
+ * exporting a full ring as Chrome trace JSON. Then runs echo round trips over loopback with the recorder
+ * installed and writes what it saw to firelink_trace.json. The IO path only records when firelink is built
+ * with FIRELINK_ENABLE_TRACING=1.
+ */
+
+namespace
+{
+  constexpr std::uint32_t RECORDS = 4'000'000;
+  constexpr std::uint32_t THREADS = 4;
+  constexpr std::uint32_t ROUND_TRIPS = 5'000;
+  constexpr std::size_t MESSAGE_SIZE = 64;
+
+  void record_many(firelink::TraceRecorder& recorder, std::uint32_t count)
+  {
+    for (std::uint32_t i = 0; i < count; ++i)
+      firelink::trace<firelink::SinkTracePolicy>(firelink::TraceEvent::OperationSubmitted, &recorder, i,
+                                                 firelink::Operation::Send);
+  }
+
+  void ping_pong(std::shared_ptr<firelink::Socket> socket, std::shared_ptr<std::vector<std::byte>> buffer,
+                 std::shared_ptr<std::atomic<std::uint32_t>> done, std::uint32_t remaining)
+  {
+    if (remaining == 0)
+      return;
+
+    socket->start_send(*buffer, [buffer, done, remaining](std::shared_ptr<firelink::Socket> caller, firelink::ErrorCode error,
+                                                          std::int32_t, firelink::WriteTag)
+    {
+      if (error != firelink::ErrorCode::Success)
+      {
+        done->fetch_add(remaining);
+        return;
+      }
+
+      caller->start_recv(*buffer, [buffer, done, remaining](std::shared_ptr<firelink::Socket> caller,
+                                                            firelink::ErrorCode error, std::int32_t, firelink::ReadTag)
+      {
+        if (error != firelink::ErrorCode::Success)
+        {
+          done->fetch_add(remaining);
+          return;
+        }
+
+        done->fetch_add(1);
+        ping_pong(std::move(caller), buffer, done, remaining - 1);
+      });
+    });
+  }
+
+  void echo_trace(firelink_bench::Report& report, firelink::TraceRecorder& recorder)
+  {
+    auto io_core = firelink_bench::make_io_core(2, 2);
+    if (!io_core.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core.error()) << std::endl;
+      return;
+    }
+
+    firelink::Endpoint listener_ep{};
+    auto listener = firelink_bench::make_listener(io_core.value(), 1, listener_ep);
+    auto client = firelink_bench::make_tcp_socket(io_core.value());
+    firelink::ErrorCode err = listener.has_value() ? firelink::ErrorCode::Success : listener.error();
+    if (err == firelink::ErrorCode::Success)
+      err = client.has_value() ? client.value()->connect(listener_ep) : client.error();
+
+    if (err != firelink::ErrorCode::Success)
+    {
+      std::cerr << "trace: setup error " << static_cast<int>(err) << std::endl;
+      io_core.value()->release();
+      return;
+    }
+
+    firelink_bench::serve_echo(io_core.value(), listener.value());
+
+    recorder.clear();
+    recorder.start();
+    firelink::set_trace_sink(&recorder);
+
+    auto done = std::make_shared<std::atomic<std::uint32_t>>(0);
+    std::uint64_t start = firelink_bench::now_ns();
+    ping_pong(client.value(), std::make_shared<std::vector<std::byte>>(MESSAGE_SIZE), done, ROUND_TRIPS);
+    if (!firelink_bench::wait_until([&]() { return done->load() == ROUND_TRIPS; }))
+      std::cerr << "trace: round trips timed out" << std::endl;
+    report.add("echo_round_trip", static_cast<double>(firelink_bench::now_ns() - start) / ROUND_TRIPS / 1000.0, "us");
+
+    client.value()->close();
+    listener.value()->cancel();
+    listener.value()->close();
+    io_core.value()->release();
+
+    // The IOCore is gone, nothing traces into the recorder anymore
+    firelink::set_trace_sink(nullptr);
+    recorder.stop();
+
+    report.add("echo_trace_records", static_cast<double>(recorder.total_recorded()), "records");
+    if (recorder.size() == 0)
+    {
+      std::cerr << "trace: no records, firelink was built without FIRELINK_ENABLE_TRACING" << std::endl;
+      return;
+    }
+
+    std::ofstream file("firelink_trace.json", std::ios::binary);
+    file << recorder.export_chrome_json();
+    std::cerr << "trace: wrote firelink_trace.json" << std::endl;
+  }
+
+  void trace_bench(firelink_bench::Report& report)
+  {
+    firelink::TraceRecorder recorder{};
+
+    std::uint64_t start = firelink_bench::now_ns();
+    record_many(recorder, RECORDS);
+    report.add("record_1_thread", static_cast<double>(firelink_bench::now_ns() - start) / RECORDS, "ns/op");
+
+    std::vector<std::thread> threads{};
+    start = firelink_bench::now_ns();
+    for (std::uint32_t i = 0; i < THREADS; ++i)
+      threads.emplace_back([&recorder]() { record_many(recorder, RECORDS / THREADS); });
+    for (std::thread& thread : threads)
+      thread.join();
+    report.add("record_" + std::to_string(THREADS) + "_threads", static_cast<double>(firelink_bench::now_ns() - start) / RECORDS,
+               "ns/op");
+
+    recorder.stop();
+    start = firelink_bench::now_ns();
+    std::string json = recorder.export_chrome_json();
+    report.add("export_chrome_json", static_cast<double>(firelink_bench::now_ns() - start) / 1'000'000.0, "ms");
+    report.add("export_size", static_cast<double>(json.size()) / (1024.0 * 1024.0), "MiB");
+
+    echo_trace(report, recorder);
+  }
+
+  firelink_bench::Registrar registrar("trace", "trace recorder cost and a Chrome trace of echo round trips", trace_bench);
+}
@@ -0,0 +1,187 @@
+#include "bench.hpp"
+#include "loopback.hpp"
+#include "firelink/platform/windows/win_socket.hpp"
+
+/*
+ * The completion dispatch path, stage by stage. Operations are completed through DispatchTestHook, the
+ * completion the IO threadpool runs, on made-up IOData instead of by the kernel, so no socket IO is in the
+ * numbers. The IOCore is an initialized one with HandlerDispatch::RunLoop, so posted handlers wait in its run
+ * loop queue until poll() runs them on this thread:
+ *
+ *   iodata_create_destroy    allocating and filling the IOData of a start_recv, and freeing it
+ *   dispatch_no_handler      completing an operation without a handler: bookkeeping, std::visit and release
+ *   dispatch_post            completing an operation with a handler, up to its work being queued
+ *   handler_invoke_teardown  poll() running the queued work: the handler call, the IOData release and the closure
+ *
+ * dispatch_threadpool then uses a real IOCore: the cost of post_user_work itself, and complete_io through
+ * the user threadpool to the handler.
+ */
+
+namespace
+{
+  constexpr std::uint32_t OPERATIONS = 1'000'000;
+
+  // IOData is large, operations are prepared a batch at a time outside the timed part
+  constexpr std::uint32_t BATCH = 10'000;
+
+  // The IOData start_recv would submit
+  firelink::platform::IOData* make_recv(std::shared_ptr<firelink::Socket> socket, firelink::ReadHandler handler)
+  {
+    auto* io_data = new firelink::platform::IOData{};
+    io_data->socket_ = std::move(socket);
+    io_data->user_handler_ = std::move(handler);
+    io_data->operation_ = firelink::Operation::Recv;
+    return io_data;
+  }
+
+  void prepare(std::vector<firelink::platform::IOData*>& batch, const std::shared_ptr<firelink::Socket>& socket,
+               const firelink::ReadHandler& handler)
+  {
+    batch.clear();
+    for (std::uint32_t i = 0; i < BATCH; ++i)
+      batch.push_back(make_recv(socket, handler));
+  }
+
+  void complete_batch(const std::vector<firelink::platform::IOData*>& batch)
+  {
+    for (firelink::platform::IOData* io_data : batch)
+      firelink::platform::DispatchTestHook::complete_io(io_data, 0, 64);
+  }
+
+  void dispatch_bench(firelink_bench::Report& report)
+  {
+    firelink::IOCoreConfig config{1, 1, 1, 1};
+    config.handler_dispatch_ = firelink::HandlerDispatch::RunLoop;
+    auto created = firelink::IOCore::create(config);
+    if (!created.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(created.error()) << std::endl;
+      return;
+    }
+
+    std::shared_ptr<firelink::IOCore> io_core = std::move(created.value());
+    auto socket = firelink::Socket::create(io_core);
+    if (!socket.has_value())
+    {
+      std::cerr << "dispatch: socket error " << static_cast<int>(socket.error()) << std::endl;
+      io_core->release();
+      return;
+    }
+
+    std::uint64_t handled = 0;
+    firelink::ReadHandler handler = [&handled](std::shared_ptr<firelink::Socket>, firelink::ErrorCode,
+                                               std::int32_t bytes_transferred, firelink::ReadTag)
+    {
+      handled += static_cast<std::uint64_t>(bytes_transferred);
+    };
+
+    std::uint64_t start = firelink_bench::now_ns();
+    for (std::uint32_t i = 0; i < OPERATIONS; ++i)
+    {
+      firelink::platform::IOData* io_data = make_recv(socket.value(), handler);
+      firelink_bench::do_not_optimize(io_data);
+      delete io_data;
+    }
+    report.add("iodata_create_destroy", static_cast<double>(firelink_bench::now_ns() - start) / OPERATIONS, "ns/op");
+
+    std::vector<firelink::platform::IOData*> batch{};
+    batch.reserve(BATCH);
+
+    std::uint64_t dispatch_ns = 0;
+    for (std::uint32_t done = 0; done < OPERATIONS; done += BATCH)
+    {
+      prepare(batch, socket.value(), firelink::ReadHandler{});
+      start = firelink_bench::now_ns();
+      complete_batch(batch);
+      dispatch_ns += firelink_bench::now_ns() - start;
+    }
+    report.add("dispatch_no_handler", static_cast<double>(dispatch_ns) / OPERATIONS, "ns/op");
+
+    dispatch_ns = 0;
+    std::uint64_t handler_ns = 0;
+    for (std::uint32_t done = 0; done < OPERATIONS; done += BATCH)
+    {
+      prepare(batch, socket.value(), handler);
+      start = firelink_bench::now_ns();
+      complete_batch(batch);
+      dispatch_ns += firelink_bench::now_ns() - start;
+
+      start = firelink_bench::now_ns();
+      io_core->poll();
+      handler_ns += firelink_bench::now_ns() - start;
+    }
+    report.add("dispatch_post", static_cast<double>(dispatch_ns) / OPERATIONS, "ns/op");
+    report.add("handler_invoke_teardown", static_cast<double>(handler_ns) / OPERATIONS, "ns/op");
+
+    if (handled != static_cast<std::uint64_t>(OPERATIONS) * 64)
+      std::cerr << "dispatch: " << handled / 64 << " of " << OPERATIONS << " handlers ran" << std::endl;
+
+    io_core->release();
+  }
+
+  void dispatch_threadpool_bench(firelink_bench::Report& report)
+  {
+    auto io_core = firelink_bench::make_io_core(2, 2);
+    if (!io_core.has_value())
+    {
+      std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core.error()) << std::endl;
+      return;
+    }
+
+    std::atomic<std::uint64_t> ran{0};
+    std::uint64_t start = firelink_bench::now_ns();
+    for (std::uint32_t i = 0; i < OPERATIONS; ++i)
+    {
+      if (io_core.value()->post_user_work([&ran]() { ran.fetch_add(1, std::memory_order_relaxed); }) != firelink::ErrorCode::Success)
+        ran.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::uint64_t posted = firelink_bench::now_ns();
+    if (!firelink_bench::wait_until([&]() { return ran.load() == OPERATIONS; }))
+      std::cerr << "dispatch_threadpool: posted work timed out" << std::endl;
+
+    report.add("post_user_work_submit", static_cast<double>(posted - start) / OPERATIONS, "ns/op");
+    report.add("post_user_work_drain", static_cast<double>(firelink_bench::now_ns() - start) / OPERATIONS, "ns/op");
+
+    auto socket = firelink::Socket::create(io_core.value());
+    if (!socket.has_value())
+    {
+      std::cerr << "dispatch_threadpool: socket error " << static_cast<int>(socket.error()) << std::endl;
+      io_core.value()->release();
+      return;
+    }
+
+    std::atomic<std::uint64_t> handled{0};
+    firelink::ReadHandler handler = [&handled](std::shared_ptr<firelink::Socket>, firelink::ErrorCode, std::int32_t,
+                                               firelink::ReadTag)
+    {
+      handled.fetch_add(1, std::memory_order_relaxed);
+    };
+
+    std::vector<firelink::platform::IOData*> batch{};
+    batch.reserve(BATCH);
+
+    // Preparing the batches is kept out, the clock only runs while completing and while waiting for the handlers
+    std::uint64_t elapsed = 0;
+    for (std::uint32_t done = 0; done < OPERATIONS; done += BATCH)
+    {
+      prepare(batch, socket.value(), handler);
+      start = firelink_bench::now_ns();
+      complete_batch(batch);
+      if (!firelink_bench::wait_until([&]() { return handled.load() == done + BATCH; }))
+      {
+        std::cerr << "dispatch_threadpool: handlers timed out" << std::endl;
+        break;
+      }
+      elapsed += firelink_bench::now_ns() - start;
+    }
+    report.add("complete_to_handler", static_cast<double>(elapsed) / OPERATIONS, "ns/op");
+
+    io_core.value()->release();
+  }
+
+  firelink_bench::Registrar dispatch_registrar("dispatch", "completion dispatch stages into a run loop IOCore",
+                                               dispatch_bench);
+  firelink_bench::Registrar dispatch_threadpool_registrar("dispatch_threadpool",
+                                                          "post_user_work and completion to handler through the user threadpool",
+                                                          dispatch_threadpool_bench);
+}
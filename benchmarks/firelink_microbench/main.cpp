@@ -0,0 +1,11 @@
+#include "runner.hpp"
+
+/*
+ * Usage: firelink_microbench.exe [--list] [--json file] [filter...]
+ * Microbenchmarks of firelink's own per-operation overhead, without the kernel in the measurement. Runs
+ * every registered benchmark whose name contains one of the filters, or all of them if no filter is given.
+ */
+int main(int argc, char** argv)
+{
+  return firelink_bench::run(argc, argv, "firelink_microbench.exe");
+}
@@ -0,0 +1,302 @@
+#include "firelink/io_core.hpp"
+#include "firelink/resolver.hpp"
+#include "firelink/socket.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Checks the Resolver against a scripted stub DNS server on loopback. The first label of a name selects how
+ * the server answers it:
+ *   ok        127.0.0.1 with a TTL of 300 s
+ *   nx        NXDOMAIN
+ *   servfail  SERVFAIL
+ *   slow      drops the first query, answers the retry and then sends a late reply (127.0.0.9) to the
+ *             dropped query's source port
+ *   spoof     first a reply with a wrong ID (127.0.0.9), then the real one
+ * Prints one line per check and exits with 1 if any failed.
+ */
+
+namespace
+{
+  constexpr std::uint16_t PORT = 80;
+  constexpr std::size_t HEADER_SIZE = 12;
+  constexpr std::uint32_t TIMEOUT_MS = 200;
+
+  struct ReceivedQuery
+  {
+    std::vector<std::byte> datagram_;
+    firelink::Endpoint source_;
+  };
+
+  class StubServer
+  {
+    public:
+    explicit StubServer(std::shared_ptr<firelink::Socket> socket) : socket_(std::move(socket)) {}
+
+    void run()
+    {
+      std::vector<std::byte> buffer(1232);
+      for (;;)
+      {
+        firelink::Endpoint source{};
+        std::int32_t bytes = socket_->recv_from(buffer, source);
+        if (bytes < static_cast<std::int32_t>(HEADER_SIZE))
+          return;
+
+        ReceivedQuery query{std::vector<std::byte>(buffer.begin(), buffer.begin() + bytes), source};
+        std::string name = query_name(query.datagram_);
+        std::string label = name.substr(0, name.find('.'));
+
+        std::size_t seen = 0;
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          seen = queries_[name]++;
+        }
+
+        if (label == "ok")
+        {
+          reply(query, 0, 1, 0);
+        }
+        else if (label == "nx")
+        {
+          reply(query, 3, 0, 0);
+        }
+        else if (label == "servfail")
+        {
+          reply(query, 2, 0, 0);
+        }
+        else if (label == "slow")
+        {
+          if (seen == 0)
+          {
+            dropped_ = query;
+            continue;
+          }
+
+          reply(query, 0, 1, 0);
+          reply(dropped_, 0, 9, 0);
+        }
+        else if (label == "spoof")
+        {
+          reply(query, 0, 9, 1);
+          reply(query, 0, 1, 0);
+        }
+      }
+    }
+
+    std::size_t queries(const std::string& name)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return queries_[name];
+    }
+
+    private:
+    static std::size_t question_end(const std::vector<std::byte>& datagram)
+    {
+      std::size_t offset = HEADER_SIZE;
+      while (offset < datagram.size() && datagram[offset] != std::byte{0})
+        offset += 1 + static_cast<std::size_t>(datagram[offset]);
+
+      // Root label, QTYPE and QCLASS
+      return offset + 5;
+    }
+
+    static std::string query_name(const std::vector<std::byte>& datagram)
+    {
+      std::string name{};
+      std::size_t offset = HEADER_SIZE;
+      while (offset < datagram.size() && datagram[offset] != std::byte{0})
+      {
+        std::size_t length = static_cast<std::size_t>(datagram[offset]);
+        if (!name.empty())
+          name += '.';
+        for (std::size_t i = 1; i <= length && offset + i < datagram.size(); ++i)
+          name += static_cast<char>(datagram[offset + i]);
+        offset += 1 + length;
+      }
+
+      return name;
+    }
+
+    // Answers with the rcode and, for NOERROR, an A record of 127.0.0.<last_octet>. id_xor corrupts the ID.
+    void reply(const ReceivedQuery& query, std::uint8_t rcode, std::uint8_t last_octet, std::uint8_t id_xor)
+    {
+      std::size_t end = question_end(query.datagram_);
+      if (end > query.datagram_.size())
+        return;
+
+      std::vector<std::byte> datagram(query.datagram_.begin(), query.datagram_.begin() + static_cast<std::ptrdiff_t>(end));
+      datagram[1] ^= static_cast<std::byte>(id_xor);
+      datagram[2] = std::byte{0x81};
+      datagram[3] = static_cast<std::byte>(0x80 | rcode);
+      datagram[7] = std::byte{rcode == 0 ? std::uint8_t{1} : std::uint8_t{0}};  // ANCOUNT
+      datagram[9] = std::byte{0};                                               // NSCOUNT
+      datagram[11] = std::byte{0};                                              // ARCOUNT, the OPT record is dropped
+
+      if (rcode == 0)
+      {
+        // Answer pointing back at the question name, type A, class IN, TTL 300
+        const std::uint8_t answer[] = {0xC0, 0x0C, 0, 1, 0, 1, 0, 0, 0x01, 0x2C, 0, 4, 127, 0, 0, last_octet};
+        for (std::uint8_t b : answer)
+          datagram.push_back(static_cast<std::byte>(b));
+      }
+
+      socket_->send_to(datagram, query.source_);
+    }
+
+    std::shared_ptr<firelink::Socket> socket_;
+    std::mutex mutex_;
+    std::map<std::string, std::size_t> queries_;
+    ReceivedQuery dropped_;
+  };
+
+  struct Result
+  {
+    firelink::ErrorCode error_ = firelink::ErrorCode::TimedOut;
+    std::vector<firelink::Endpoint> endpoints_;
+  };
+
+  Result resolve(firelink::Resolver& resolver, const std::string& name)
+  {
+    auto promise = std::make_shared<std::promise<Result>>();
+    std::future<Result> future = promise->get_future();
+
+    firelink::ErrorCode err = resolver.async_resolve(name, PORT, firelink::AddressFamily::IPv4,
+      [promise](const std::vector<firelink::Endpoint>& endpoints, firelink::ErrorCode error, firelink::ResolveTag)
+    {
+      promise->set_value(Result{error, endpoints});
+    });
+
+    if (err != firelink::ErrorCode::Success)
+      return Result{err, {}};
+
+    if (future.wait_for(std::chrono::seconds(5)) != std::future_status::ready)
+      return Result{};
+
+    return future.get();
+  }
+
+  bool only_loopback(const Result& result, std::uint8_t last_octet)
+  {
+    firelink::IPv4Address expected = firelink::IPv4Address::loopback(PORT);
+    expected.bytes[3] = last_octet;
+    return result.error_ == firelink::ErrorCode::Success && result.endpoints_.size() == 1 &&
+           result.endpoints_.front() == firelink::Endpoint(expected);
+  }
+
+  int failures = 0;
+
+  void check(const char* what, bool passed)
+  {
+    std::cout << (passed ? "PASS " : "FAIL ") << what << std::endl;
+    if (!passed)
+      failures++;
+  }
+}
+
+int main()
+{
+  auto io_core_pending = firelink::IOCore::create({2, 2, 2, 2});
+  if (!io_core_pending.has_value())
+  {
+    std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core_pending.error()) << std::endl;
+    return 1;
+  }
+
+  std::shared_ptr<firelink::IOCore> io_core = std::move(io_core_pending.value());
+
+  auto server_socket = firelink::Socket::create(io_core);
+  firelink::Endpoint server_ep{};
+  firelink::ErrorCode err = server_socket.has_value() ? server_socket.value()->socket(firelink::AddressFamily::IPv4,
+                                                                                      firelink::SocketType::Datagram,
+                                                                                      firelink::Protocol::Udp)
+                                                      : server_socket.error();
+  if (err == firelink::ErrorCode::Success)
+    err = server_socket.value()->bind(firelink::IPv4Address::loopback(0));
+  if (err == firelink::ErrorCode::Success)
+    err = server_socket.value()->get_sock_name(server_ep);
+
+  if (err != firelink::ErrorCode::Success)
+  {
+    std::cerr << "stub server setup error " << static_cast<int>(err) << std::endl;
+    io_core->release();
+    return 1;
+  }
+
+  StubServer server(server_socket.value());
+  std::thread server_thread([&server]() { server.run(); });
+
+  firelink::ResolverConfig config{};
+  config.nameservers_ = {server_ep};
+  config.timeout_ms_ = TIMEOUT_MS;
+  config.attempts_ = 2;
+
+  auto resolver = firelink::Resolver::create(io_core, config);
+  if (resolver.has_value())
+  {
+    firelink::Resolver& r = *resolver.value();
+
+    check("answer", only_loopback(resolve(r, "ok.firelink.test"), 1));
+
+    std::uint64_t sent = r.stats().queries_sent_;
+    check("cached answer", only_loopback(resolve(r, "ok.firelink.test"), 1) && r.stats().queries_sent_ == sent);
+
+    check("NXDOMAIN is HostNotFound", resolve(r, "nx.firelink.test").error_ == firelink::ErrorCode::HostNotFound);
+
+    check("SERVFAIL is retried, then TryAgain",
+          resolve(r, "servfail.firelink.test").error_ == firelink::ErrorCode::TryAgain &&
+          server.queries("servfail.firelink.test") == config.attempts_);
+
+    check("lost query is retried after the timeout", only_loopback(resolve(r, "slow.firelink.test"), 1) &&
+          server.queries("slow.firelink.test") == 2 && r.stats().timeouts_ == 1);
+
+    // The late reply to the dropped query must not reach the cached answer
+    std::this_thread::sleep_for(std::chrono::milliseconds(TIMEOUT_MS));
+    check("late reply to an abandoned attempt is ignored", only_loopback(resolve(r, "slow.firelink.test"), 1));
+
+    check("reply with a wrong ID is ignored", only_loopback(resolve(r, "spoof.firelink.test"), 1));
+
+    // Concurrent lookups of one name share one query
+    std::vector<std::future<Result>> burst{};
+    for (int i = 0; i < 8; ++i)
+      burst.push_back(std::async(std::launch::async, [&r]() { return resolve(r, "ok.burst.firelink.test"); }));
+
+    bool burst_ok = true;
+    for (std::future<Result>& result : burst)
+      burst_ok = only_loopback(result.get(), 1) && burst_ok;
+    check("concurrent lookups are coalesced", burst_ok && server.queries("ok.burst.firelink.test") == 1);
+
+    r.cancel();
+  }
+  else
+  {
+    std::cerr << "firelink::Resolver::create error " << static_cast<int>(resolver.error()) << std::endl;
+    failures++;
+  }
+
+  // A datagram shorter than a DNS header stops the server
+  auto stopper = firelink::Socket::create(io_core);
+  if (stopper.has_value() &&
+      stopper.value()->socket(firelink::AddressFamily::IPv4, firelink::SocketType::Datagram, firelink::Protocol::Udp) ==
+      firelink::ErrorCode::Success)
+  {
+    std::byte stop{0};
+    stopper.value()->send_to(std::span<std::byte>(&stop, 1), server_ep);
+    stopper.value()->close();
+  }
+
+  server_thread.join();
+  server_socket.value()->close();
+  io_core->release();
+
+  std::cout << (failures == 0 ? "all checks passed" : "checks failed") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
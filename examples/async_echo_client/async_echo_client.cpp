@@ -217,7 +217,7 @@ int main()
 
   firelink::Endpoint target_ep = firelink::Endpoint(firelink::IPv4Address({127,0,0,1}, 63000));
     
-  std::cout << "connecting to " << firelink::inet_ntop(firelink::AddressFamily::IPv4, target_ep) << std::endl;
+  std::cout << "connecting to " << firelink::inet_ntop(target_ep) << std::endl;
   
   if(sock->start_connect(target_ep, on_connect_complete) != firelink::ErrorCode::Success)
   {
@@ -180,7 +180,7 @@ int main()
     return -1;
   }
 
-  std::cout << "listener bound to " << firelink::inet_ntop(firelink::AddressFamily::IPv4, listener_ep) << std::endl;
+  std::cout << "listener bound to " << firelink::inet_ntop(listener_ep) << std::endl;
 
   if(sock->listen(5) != firelink::ErrorCode::Success)
   {
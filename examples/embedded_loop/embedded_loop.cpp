@@ -0,0 +1,231 @@
+#include "firelink/socket.hpp"
+#include <Windows.h>
+#include <iostream>
+#include <array>
+#include <cstring>
+#include <string>
+#include <thread>
+
+/*
+ * A host that owns its event loop (here a bare message loop with a frame timer, as a GUI or game would have)
+ * and drives firelink from it. The IOCore runs handlers with HandlerDispatch::RunLoop, so they run on this
+ * thread inside poll(). The host waits on the IOCore's wait handle together with its own handles and the
+ * thread's message queue.
+ *
+ * A client connects to a listener in the same process over loopback and has the server echo MESSAGES
+ * messages back, one at a time.
+ */
+
+static constexpr int MESSAGES = 5;
+static constexpr LONG FRAME_MS = 250;
+
+static std::thread::id host_thread_id{};
+static bool done = false;
+
+static std::array<std::byte, 64>& get_client_buffer()
+{
+  static std::array<std::byte, 64> buffer{};
+  return buffer;
+}
+
+static std::array<std::byte, 64>& get_server_buffer()
+{
+  static std::array<std::byte, 64> buffer{};
+  return buffer;
+}
+
+static void finish(std::shared_ptr<firelink::Socket> socket, const char* what, firelink::ErrorCode error)
+{
+  if(error != firelink::ErrorCode::Success)
+    std::cerr << what << " error " << static_cast<int>(error) << std::endl;
+
+  socket->close();
+  done = true;
+}
+
+static void send_ping(std::shared_ptr<firelink::Socket> client, int n);
+
+static void on_server_recv(std::shared_ptr<firelink::Socket> caller, firelink::ErrorCode error,
+                           std::int32_t bytes_transferred, firelink::ReadTag)
+{
+  if(error != firelink::ErrorCode::Success || bytes_transferred <= 0)
+  {
+    caller->close();
+    return;
+  }
+
+  std::span<std::byte> data(get_server_buffer().data(), static_cast<std::size_t>(bytes_transferred));
+  caller->start_send(data, [](std::shared_ptr<firelink::Socket> caller, firelink::ErrorCode error, std::int32_t, firelink::WriteTag)
+  {
+    if(error != firelink::ErrorCode::Success)
+    {
+      caller->close();
+      return;
+    }
+
+    caller->start_recv(get_server_buffer(), on_server_recv);
+  });
+}
+
+static void on_client_recv(std::shared_ptr<firelink::Socket> caller, firelink::ErrorCode error,
+                           std::int32_t bytes_transferred, int n)
+{
+  if(error != firelink::ErrorCode::Success || bytes_transferred <= 0)
+  {
+    finish(caller, "recv", error);
+    return;
+  }
+
+  std::string str(reinterpret_cast<const char*>(get_client_buffer().data()), static_cast<std::size_t>(bytes_transferred));
+  std::cout
+    << "echo \"" << str << "\" handled on the "
+    << (std::this_thread::get_id() == host_thread_id ? "host thread" : "another thread")
+    << std::endl;
+
+  if(n + 1 == MESSAGES)
+  {
+    finish(caller, "recv", firelink::ErrorCode::Success);
+    return;
+  }
+
+  send_ping(std::move(caller), n + 1);
+}
+
+static void send_ping(std::shared_ptr<firelink::Socket> client, int n)
+{
+  std::string message = "ping " + std::to_string(n);
+  std::memcpy(get_client_buffer().data(), message.data(), message.size());
+
+  std::span<std::byte> data(get_client_buffer().data(), message.size());
+  firelink::ErrorCode err = client->start_send(data, [n](std::shared_ptr<firelink::Socket> caller, firelink::ErrorCode error,
+                                                         std::int32_t, firelink::WriteTag)
+  {
+    if(error != firelink::ErrorCode::Success)
+    {
+      finish(caller, "send", error);
+      return;
+    }
+
+    caller->start_recv(get_client_buffer(), [n](std::shared_ptr<firelink::Socket> caller, firelink::ErrorCode error,
+                                                 std::int32_t bytes_transferred, firelink::ReadTag)
+    {
+      on_client_recv(std::move(caller), error, bytes_transferred, n);
+    });
+  });
+
+  if(err != firelink::ErrorCode::Success)
+    finish(client, "start_send", err);
+}
+
+static std::shared_ptr<firelink::Socket> make_tcp_socket(std::shared_ptr<firelink::IOCore> io_core)
+{
+  auto sock = firelink::Socket::create(io_core);
+  if(!sock.has_value())
+    return nullptr;
+
+  if(sock.value()->socket(firelink::AddressFamily::IPv4, firelink::SocketType::Stream, firelink::Protocol::Tcp) != firelink::ErrorCode::Success)
+    return nullptr;
+
+  return sock.value();
+}
+
+int main()
+{
+  host_thread_id = std::this_thread::get_id();
+
+  // One IO thread completes the operations, every handler runs on this thread
+  firelink::IOCoreConfig config{1, 1, 0, 0};
+  config.handler_dispatch_ = firelink::HandlerDispatch::RunLoop;
+
+  auto io_core_pending = firelink::IOCore::create(config);
+  if(!io_core_pending.has_value())
+  {
+    std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core_pending.error()) << std::endl;
+    return -1;
+  }
+
+  std::shared_ptr<firelink::IOCore> io_core = std::move(io_core_pending.value());
+
+  auto listener = make_tcp_socket(io_core);
+  auto server = make_tcp_socket(io_core);
+  auto client = make_tcp_socket(io_core);
+  firelink::Endpoint listener_ep{};
+  if(!listener || !server || !client ||
+     listener->bind(firelink::IPv4Address::loopback(0)) != firelink::ErrorCode::Success ||
+     listener->listen(1) != firelink::ErrorCode::Success ||
+     listener->get_sock_name(listener_ep) != firelink::ErrorCode::Success)
+  {
+    std::cerr << "listener setup error!" << std::endl;
+    io_core->release();
+    return -1;
+  }
+
+  listener->start_accept(server, [](std::shared_ptr<firelink::Socket>, std::shared_ptr<firelink::Socket> accepted_socket,
+                                    const firelink::Endpoint&, const firelink::Endpoint&, firelink::ErrorCode error, firelink::AcceptTag)
+  {
+    if(error == firelink::ErrorCode::Success)
+      accepted_socket->start_recv(get_server_buffer(), on_server_recv);
+  });
+
+  client->start_connect(listener_ep, [](std::shared_ptr<firelink::Socket> caller, firelink::ErrorCode error, firelink::ConnectTag)
+  {
+    if(error != firelink::ErrorCode::Success)
+    {
+      finish(caller, "connect", error);
+      return;
+    }
+
+    send_ping(std::move(caller), 0);
+  });
+
+  // The host's own work: a frame every FRAME_MS
+  HANDLE frame_timer = CreateWaitableTimerW(nullptr, FALSE, nullptr);
+  LARGE_INTEGER due_time{};
+  due_time.QuadPart = -static_cast<LONGLONG>(FRAME_MS) * 10000;
+  SetWaitableTimer(frame_timer, &due_time, FRAME_MS, nullptr, nullptr, FALSE);
+
+  HANDLE handles[2] = {io_core->native_wait_handle(), frame_timer};
+  int frame = 0;
+
+  while(!done)
+  {
+    DWORD res = MsgWaitForMultipleObjectsEx(2, handles, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+    if(res == WAIT_OBJECT_0)
+    {
+      std::size_t handlers_run = io_core->poll();
+      std::cout << "ran " << handlers_run << " handler(s)" << std::endl;
+    }
+    else if(res == WAIT_OBJECT_0 + 1)
+    {
+      std::cout << "frame " << frame++ << std::endl;
+    }
+    else if(res == WAIT_OBJECT_0 + 2)
+    {
+      MSG msg{};
+      while(PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE))
+      {
+        TranslateMessage(&msg);
+        DispatchMessageW(&msg);
+      }
+    }
+    else
+    {
+      std::cerr << "MsgWaitForMultipleObjectsEx error " << GetLastError() << std::endl;
+      break;
+    }
+  }
+
+  CloseHandle(frame_timer);
+  listener->close();
+  server->close();
+
+  // Handlers of the closed sockets, then the IOCore
+  io_core->poll();
+  if(io_core->release() != firelink::ErrorCode::Success)
+  {
+    std::cerr << "firelink::IOCore::release() error!" << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,107 @@
+#ifndef FIRELINK_ACCEPTOR_H
+#define FIRELINK_ACCEPTOR_H
+
+#include "firelink/export.hpp"
+#include "firelink/types.hpp"
+#include "firelink/error_codes.hpp"
+#include "firelink/endpoint.hpp"
+#include "firelink/io_core.hpp"
+#include "firelink/socket.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Delay before an accept is re-posted after the system ran out of resources, doubled up to the maximum while it lasts
+static constexpr std::uint32_t FIRELINK_ACCEPT_RETRY_MIN_MS = 10;
+static constexpr std::uint32_t FIRELINK_ACCEPT_RETRY_MAX_MS = 1000;
+
+namespace firelink
+{
+  struct ConnectionTag {};
+
+  // Called for every accepted connection. socket is null if error is not ErrorCode::Success.
+  using ConnectionHandler = std::function<void(std::shared_ptr<firelink::Socket> socket,
+                                               const Endpoint& peer_endpoint,
+                                               ErrorCode error, ConnectionTag tag)>;
+
+  struct AcceptorConfig
+  {
+    std::uint32_t pending_accepts_ = 16;  // accepts kept posted on the listener at all times
+    std::int32_t backlog_ = 512;          // listen backlog
+  };
+
+  struct AcceptorStats
+  {
+    std::uint64_t accepted_ = 0;
+    std::uint64_t accept_errors_ = 0;
+    std::uint32_t pending_ = 0;
+  };
+
+  /*
+   * Listens on an endpoint and keeps AcceptorConfig::pending_accepts_ accepts posted. Every completed accept
+   * is re-armed before the connection is handed to the handler, so there is no window in which the listener
+   * has nothing posted.
+   * Accepted sockets are created round-robin on the given IOCores, spreading their IO over the threadpools.
+   * The listener itself runs on the first IOCore.
+   *
+   * A failed accept is reported to the handler with a null socket. If the connection failed (the peer reset
+   * it, ...) the accept is re-armed right away. If the system is out of resources it is re-armed after a
+   * growing delay. Any other error leaves the accept unposted, once all of them failed the acceptor is idle.
+   */
+  class FIRELINK_CLASS_API Acceptor : public std::enable_shared_from_this<Acceptor>
+  {
+    public:
+    ~Acceptor();
+
+    Acceptor(const Acceptor&) = delete;
+    Acceptor& operator=(const Acceptor&) = delete;
+
+    static std::expected<std::shared_ptr<Acceptor>, ErrorCode>
+    create(std::shared_ptr<IOCore> io_core, const AcceptorConfig& config = {});
+
+    static std::expected<std::shared_ptr<Acceptor>, ErrorCode>
+    create(std::vector<std::shared_ptr<IOCore>> io_cores, const AcceptorConfig& config = {});
+
+    // Creates the listening socket, binds it to local_endpoint and starts listening
+    ErrorCode open(AddressFamily addr_family, const Endpoint& local_endpoint);
+
+    // Posts the accepts. The handler is called from the user threadpool.
+    ErrorCode start(ConnectionHandler handler);
+
+    // Cancels the posted accepts and closes the listener
+    void stop();
+
+    ErrorCode get_local_endpoint(Endpoint& ep) const;
+    AcceptorStats stats() const;
+
+    private:
+    Acceptor(std::vector<std::shared_ptr<IOCore>> io_cores, const AcceptorConfig& config);
+
+    ErrorCode post_accept();
+    void on_accept(std::shared_ptr<Socket> accepted_socket, const Endpoint& peer_endpoint, ErrorCode error);
+    void rearm();
+    void rearm_later();
+
+    std::vector<std::weak_ptr<IOCore>> io_cores_;
+    AcceptorConfig conf_;
+    std::shared_ptr<Socket> listener_;
+    ConnectionHandler handler_;
+
+    // Serializes posting accepts against stop, so no accept is posted on a closed listener
+    std::mutex mutex_;
+    bool stopping_;
+
+    std::atomic<std::uint32_t> next_core_;
+    std::atomic<std::uint32_t> retry_delay_ms_;
+    std::atomic<std::uint64_t> accepted_;
+    std::atomic<std::uint64_t> accept_errors_;
+    std::atomic<std::uint32_t> pending_;
+  };
+}
+
+#endif /* FIRELINK_ACCEPTOR_H */
@@ -0,0 +1,190 @@
+#ifndef FIRELINK_BASIC_SOCKET_H
+#define FIRELINK_BASIC_SOCKET_H
+
+#include "firelink/socket.hpp"
+
+#ifdef _WIN32
+  #include "firelink/platform/windows/win_socket.hpp"
+#elif defined(__linux__)
+  #include "firelink/platform/linux/lin_socket.hpp"
+#endif
+
+#include <concepts>
+#include <expected>
+#include <memory>
+#include <type_traits>
+
+namespace firelink
+{
+  /*
+   * Statically dispatched socket. Holds the platform backend by its concrete type and forwards every
+   * operation with a qualified call, so nothing goes through the Socket vtable. Only the few members the
+   * backend defines in its header (is_valid, the accessors) are inlined. The operations themselves are
+   * defined in the library and stay ordinary out-of-line calls into it, so the saving per operation is one
+   * indirect call, next to a system call or a completion. Backend must be the final platform socket that
+   * Socket::create builds, see NativeSocket.
+   *
+   * The backend is still a Socket: handlers receive it as std::shared_ptr<Socket> and as_socket() hands it to
+   * code written against the polymorphic interface (Acceptor, ConnectionPool, ...). Both views share one
+   * object, so the two can be mixed on the same connection.
+   */
+  template<typename Backend>
+  class BasicSocket
+  {
+    static_assert(std::derived_from<Backend, Socket>, "BasicSocket backend must implement firelink::Socket");
+    static_assert(std::is_final_v<Backend>, "BasicSocket backend must be final for its calls to be devirtualized");
+
+    public:
+    using backend_type = Backend;
+
+    BasicSocket() = default;
+
+    explicit BasicSocket(std::shared_ptr<Backend> backend) :
+      backend_(std::move(backend))
+    {
+
+    }
+
+    static std::expected<BasicSocket, ErrorCode> create(std::shared_ptr<IOCore> io_core)
+    {
+      auto sock = Socket::create(std::move(io_core));
+      if (!sock.has_value())
+        return std::unexpected(sock.error());
+
+      return BasicSocket(std::static_pointer_cast<Backend>(std::move(sock.value())));
+    }
+
+    inline Backend& backend() const { return *backend_; }
+    inline std::shared_ptr<Socket> as_socket() const { return backend_; }
+    inline explicit operator bool() const { return backend_ != nullptr; }
+
+    // Synchronous API
+    inline ErrorCode socket(AddressFamily addr_family, SocketType sock_type, Protocol protocol)
+    {
+      return backend_->Backend::socket(addr_family, sock_type, protocol);
+    }
+
+    inline ErrorCode bind(const Endpoint& endpoint) { return backend_->Backend::bind(endpoint); }
+    inline ErrorCode listen(std::int32_t backlog) { return backend_->Backend::listen(backlog); }
+    inline ErrorCode shutdown(ShutdownHow how) { return backend_->Backend::shutdown(how); }
+    inline ErrorCode close() { return backend_->Backend::close(); }
+
+    inline ErrorCode set_socket_option(SocketOptionLevel level, SocketOption option, std::span<const std::byte> value)
+    {
+      return backend_->Backend::set_socket_option(level, option, value);
+    }
+
+    inline ErrorCode get_socket_option(SocketOptionLevel level, SocketOption option, std::span<std::byte> value,
+                                       std::size_t& value_size_out)
+    {
+      return backend_->Backend::get_socket_option(level, option, value, value_size_out);
+    }
+
+    inline ErrorCode get_sock_name(Endpoint& ep) { return backend_->Backend::get_sock_name(ep); }
+    inline ErrorCode get_peer_name(Endpoint& ep) { return backend_->Backend::get_peer_name(ep); }
+
+    inline bool is_valid() const { return backend_->Backend::is_valid(); }
+
+    inline NativeHandle get_native_handle() const { return backend_->get_native_handle(); }
+    inline AddressFamily get_addr_family() const { return backend_->get_addr_family(); }
+    inline SocketType get_sock_type() const { return backend_->get_sock_type(); }
+    inline Protocol get_protocol() const { return backend_->get_protocol(); }
+    inline bool is_bound() const { return backend_->is_bound(); }
+
+    inline ErrorCode accept(const BasicSocket& accept_socket) { return backend_->Backend::accept(accept_socket.backend_); }
+    inline ErrorCode connect(const Endpoint& dst) { return backend_->Backend::connect(dst); }
+    inline std::int32_t recv(std::span<std::byte> buffer) { return backend_->Backend::recv(buffer); }
+    inline std::int32_t recv_from(std::span<std::byte> buffer, Endpoint& dst) { return backend_->Backend::recv_from(buffer, dst); }
+    inline std::int32_t send(std::span<std::byte> data) { return backend_->Backend::send(data); }
+    inline std::int32_t send_to(std::span<std::byte> data, const Endpoint& dst) { return backend_->Backend::send_to(data, dst); }
+    inline ErrorCode disconnect(int timeout_ms) { return backend_->Backend::disconnect(timeout_ms); }
+    inline ErrorCode check_connection() { return backend_->Backend::check_connection(); }
+
+    // Asynchronous API
+    inline ErrorCode start_accept(const BasicSocket& accept_socket, AcceptHandler handler = AcceptHandler{})
+    {
+      return backend_->Backend::start_accept(accept_socket.backend_, std::move(handler));
+    }
+
+    inline ErrorCode start_connect(const Endpoint& dst, ConnectHandler handler = ConnectHandler{})
+    {
+      return backend_->Backend::start_connect(dst, std::move(handler));
+    }
+
+    inline ErrorCode start_recv(std::span<std::byte> buffer, ReadHandler handler = ReadHandler{})
+    {
+      return backend_->Backend::start_recv(buffer, std::move(handler));
+    }
+
+    inline ErrorCode start_recv(MirroredRingBuffer& buffer, ReadHandler handler = ReadHandler{})
+    {
+      return backend_->Socket::start_recv(buffer, std::move(handler));
+    }
+
+    inline ErrorCode start_recv_from(std::span<std::byte> buffer, ReadHandler handler = ReadHandler{})
+    {
+      return backend_->Backend::start_recv_from(buffer, std::move(handler));
+    }
+
+    inline ErrorCode start_recv_datagram(std::span<std::byte> buffer, DatagramHandler handler)
+    {
+      return backend_->Backend::start_recv_datagram(buffer, std::move(handler));
+    }
+
+    inline ErrorCode start_send(std::span<std::byte> data, WriteHandler handler = WriteHandler{})
+    {
+      return backend_->Backend::start_send(data, std::move(handler));
+    }
+
+    inline ErrorCode start_send_to(std::span<std::byte> data, const Endpoint& dst, WriteHandler handler = WriteHandler{})
+    {
+      return backend_->Backend::start_send_to(data, dst, std::move(handler));
+    }
+
+    inline ErrorCode start_disconnect(bool reuse_socket, DisconnectHandler handler = DisconnectHandler{})
+    {
+      return backend_->Backend::start_disconnect(reuse_socket, std::move(handler));
+    }
+
+    inline ErrorCode start_graceful_disconnect(std::uint32_t timeout_ms, DisconnectHandler handler = DisconnectHandler{})
+    {
+      return backend_->Backend::start_graceful_disconnect(timeout_ms, std::move(handler));
+    }
+
+    inline ErrorCode post_send(std::span<std::byte> data, WriteHandler handler = WriteHandler{})
+    {
+      return backend_->Backend::post_send(data, std::move(handler));
+    }
+
+    inline ErrorCode cancel() { return backend_->Backend::cancel(); }
+
+    inline ErrorCode start_close(CloseHandler handler = CloseHandler{})
+    {
+      return backend_->Backend::start_close(std::move(handler));
+    }
+
+    // Send-side backpressure
+    inline void set_send_limits(const SendLimits& limits, DrainHandler handler = DrainHandler{})
+    {
+      backend_->set_send_limits(limits, std::move(handler));
+    }
+
+    inline const SendLimits& get_send_limits() const { return backend_->get_send_limits(); }
+    inline std::size_t get_queued_send_bytes() const { return backend_->get_queued_send_bytes(); }
+    inline bool is_send_congested() const { return backend_->is_send_congested(); }
+
+    // Busy polling, see IOCoreConfig::busy_poll_us_
+    inline void set_busy_poll(std::uint32_t busy_poll_us) { backend_->set_busy_poll(busy_poll_us); }
+    inline std::uint32_t get_busy_poll() const { return backend_->get_busy_poll(); }
+
+    private:
+    std::shared_ptr<Backend> backend_;
+  };
+
+#ifdef _WIN32
+  using NativeSocket = BasicSocket<platform::WinSocket>;
+#elif defined(__linux__)
+  using NativeSocket = BasicSocket<platform::LinSocket>;
+#endif
+}
+#endif /* FIRELINK_BASIC_SOCKET_H */
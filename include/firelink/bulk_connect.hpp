@@ -0,0 +1,50 @@
+#ifndef FIRELINK_BULK_CONNECT_H
+#define FIRELINK_BULK_CONNECT_H
+
+#include "firelink/export.hpp"
+#include "firelink/types.hpp"
+#include "firelink/error_codes.hpp"
+#include "firelink/endpoint.hpp"
+#include "firelink/io_core.hpp"
+#include "firelink/socket.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace firelink
+{
+  struct BulkConnectTag {};
+
+  struct ConnectResult
+  {
+    Endpoint endpoint_;
+    std::shared_ptr<Socket> socket_;  // connected socket, null if error_ is not ErrorCode::Success
+    ErrorCode error_ = ErrorCode::Success;
+  };
+
+  // results[i] belongs to destinations[i]. The connected sockets are owned by the handler from here on.
+  using BulkConnectHandler = std::function<void(std::vector<ConnectResult>& results, BulkConnectTag tag)>;
+
+  struct BulkConnectConfig
+  {
+    std::uint32_t max_in_flight_ = 256;  // connects outstanding at the same time
+    bool reuse_unicast_port_ = true;     // let connections to different destinations share ephemeral ports
+  };
+
+  /*
+   * Opens a TCP connection to every destination, keeping at most max_in_flight_ connects outstanding. A new
+   * connect starts as soon as one completes. The handler is called once, from the user threadpool, after all
+   * of them have completed. The socket objects of failed connects are reused for the destinations after them.
+   * With reuse_unicast_port_ the local port is not reserved at bind time but picked when connecting, and the
+   * same port is reused for other destinations (SO_REUSE_UNICASTPORT on Windows, the counterpart of
+   * IP_BIND_ADDRESS_NO_PORT on Linux). Fan-out to many servers then no longer runs out of ephemeral ports.
+   * The option is set before the socket is first bound. Handles recycled from disconnected sockets are already
+   * bound and keep their local address.
+   */
+  FIRELINK_API ErrorCode connect_bulk(std::shared_ptr<IOCore> io_core, std::vector<Endpoint> destinations,
+                                      BulkConnectHandler handler, const BulkConnectConfig& config = {});
+}
+
+#endif /* FIRELINK_BULK_CONNECT_H */
@@ -0,0 +1,44 @@
+#ifndef FIRELINK_CONNECT_ANY_H
+#define FIRELINK_CONNECT_ANY_H
+
+#include "firelink/export.hpp"
+#include "firelink/types.hpp"
+#include "firelink/error_codes.hpp"
+#include "firelink/endpoint.hpp"
+#include "firelink/io_core.hpp"
+#include "firelink/socket.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace firelink
+{
+  struct ConnectAnyTag {};
+
+  // socket is the connected socket and endpoint the address it connected to. If error is not
+  // ErrorCode::Success, socket is null and error is the error of the last attempt that failed.
+  using ConnectAnyHandler = std::function<void(std::shared_ptr<firelink::Socket> socket,
+                                               const Endpoint& endpoint,
+                                               ErrorCode error, ConnectAnyTag tag)>;
+
+  struct ConnectAnyConfig
+  {
+    std::uint32_t attempt_delay_ms_ = 250;  // head start of every attempt before the next one is started
+    bool interleave_families_ = true;       // alternate IPv6 and IPv4 addresses, starting with the family of the first one
+  };
+
+  /*
+   * Connects a TCP socket to the first of the endpoints that accepts, as described in RFC 8305 (Happy Eyeballs).
+   * Attempts are started in order, each one attempt_delay_ms_ after the previous one or as soon as the previous
+   * one fails, and run concurrently. The first attempt to succeed wins, the others are cancelled and closed.
+   * A path that drops packets therefore costs one attempt delay instead of a full connect timeout.
+   * Endpoints from Resolver::async_resolve with AddressFamily::Unspecified are already in the preferred order.
+   * The handler is called exactly once, from the user threadpool.
+   */
+  FIRELINK_API ErrorCode connect_any(std::shared_ptr<IOCore> io_core, std::vector<Endpoint> endpoints,
+                                     ConnectAnyHandler handler, const ConnectAnyConfig& config = {});
+}
+
+#endif /* FIRELINK_CONNECT_ANY_H */
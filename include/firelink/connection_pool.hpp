@@ -0,0 +1,110 @@
+#ifndef FIRELINK_CONNECTION_POOL_H
+#define FIRELINK_CONNECTION_POOL_H
+
+#include "firelink/export.hpp"
+#include "firelink/types.hpp"
+#include "firelink/error_codes.hpp"
+#include "firelink/endpoint.hpp"
+#include "firelink/endpoint_map.hpp"
+#include "firelink/io_core.hpp"
+#include "firelink/socket.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace firelink
+{
+  struct AcquireTag {};
+
+  // socket is null if error is not ErrorCode::Success
+  using AcquireHandler = std::function<void(std::shared_ptr<firelink::Socket> socket,
+                                            ErrorCode error, AcquireTag tag)>;
+
+  struct ConnectionPoolConfig
+  {
+    std::uint32_t max_per_host_ = 16;         // open connections per destination, idle, in use and connecting
+    std::uint32_t max_idle_per_host_ = 8;     // idle connections kept per destination
+    std::uint32_t max_idle_time_ms_ = 60000;  // idle connections older than this are closed within twice the time, 0 keeps them forever
+    bool check_health_on_acquire_ = true;     // verify that an idle connection is still alive before handing it out
+  };
+
+  struct ConnectionPoolStats
+  {
+    std::uint64_t connects_ = 0;
+    std::uint64_t connect_failures_ = 0;
+    std::uint64_t reuses_ = 0;
+    std::uint64_t health_check_failures_ = 0;
+    std::uint64_t expired_ = 0;
+    std::uint32_t idle_ = 0;
+    std::uint32_t in_use_ = 0;
+    std::uint32_t waiting_ = 0;
+  };
+
+  /*
+   * Keeps warm TCP connections per destination Endpoint. async_acquire hands out an idle connection if a healthy
+   * one exists, connects a new one if the destination is below max_per_host_, or queues the request until a
+   * connection is released. Every acquired socket must be given back with release.
+   */
+  class FIRELINK_CLASS_API ConnectionPool : public std::enable_shared_from_this<ConnectionPool>
+  {
+    public:
+    ~ConnectionPool();
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    static std::expected<std::shared_ptr<ConnectionPool>, ErrorCode>
+    create(std::shared_ptr<IOCore> io_core, const ConnectionPoolConfig& config = {});
+
+    ErrorCode async_acquire(const Endpoint& dst, AcquireHandler handler);
+
+    // Gives an acquired socket back to the pool. Sockets that are not reusable (for example after a protocol
+    // error) are closed instead of being kept idle.
+    void release(std::shared_ptr<Socket> socket, bool reusable = true);
+
+    // Closes all idle connections
+    void clear();
+
+    ConnectionPoolStats stats() const;
+
+    private:
+    struct IdleConnection
+    {
+      std::shared_ptr<Socket> socket_;
+      std::chrono::steady_clock::time_point idle_since_;
+    };
+
+    struct HostState
+    {
+      std::deque<IdleConnection> idle_;
+      std::deque<AcquireHandler> waiters_;
+      std::uint32_t open_ = 0;
+    };
+
+    ConnectionPool(std::shared_ptr<IOCore> io_core, const ConnectionPoolConfig& config);
+
+    ErrorCode connect_new(const Endpoint& dst, AcquireHandler handler);
+    void on_connection_closed(const Endpoint& dst);
+    void deliver(std::shared_ptr<Socket> socket, AcquireHandler handler, ErrorCode error = ErrorCode::Success);
+    void evict_expired(HostState& host, std::vector<std::shared_ptr<Socket>>& to_close);
+    void prune_host(const Endpoint& dst, const HostState& host);
+    void schedule_sweep();
+    void sweep();
+
+    std::weak_ptr<IOCore> io_core_;
+    ConnectionPoolConfig conf_;
+
+    mutable std::mutex mutex_;
+    EndpointMap<HostState> hosts_;
+    std::unordered_map<const Socket*, Endpoint> in_use_;
+    ConnectionPoolStats stats_;
+  };
+}
+
+#endif /* FIRELINK_CONNECTION_POOL_H */
@@ -5,8 +5,22 @@
 #include "firelink/types.hpp"
 #include "firelink/error_codes.hpp"
 
+#include <algorithm>
 #include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <version>
+
+#ifdef __cpp_lib_format
+#include <format>
+#endif
 
 namespace firelink
 {
@@ -60,29 +74,164 @@ namespace firelink
   class FIRELINK_CLASS_API Endpoint
   {
     public:
-    Endpoint(){}
-    Endpoint(IPv4Address addr) : ipv4_(addr) {}
-    Endpoint(IPv6Address addr) : ipv6_(addr) {}
+    constexpr Endpoint() : ipv6_(), family_(AddressFamily::Unspecified) {}
+    constexpr Endpoint(IPv4Address addr) : ipv4_(addr), family_(AddressFamily::IPv4) {}
+    constexpr Endpoint(IPv6Address addr) : ipv6_(addr), family_(AddressFamily::IPv6) {}
 
     inline const IPv4Address& ipv4()    const { return ipv4_; }
     inline const IPv6Address& ipv6()    const { return ipv6_; }
+    inline AddressFamily family()       const { return family_; }
+    inline std::uint16_t port()         const { return family_ == AddressFamily::IPv6 ? ipv6_.port : ipv4_.port; }
+
+    // Endpoints of different families are never equal. Unspecified endpoints are all equal.
+    friend inline bool operator==(const Endpoint& lhs, const Endpoint& rhs)
+    {
+      if (lhs.family_ != rhs.family_)
+        return false;
+      if (lhs.family_ == AddressFamily::IPv4)
+        return lhs.ipv4_.bytes == rhs.ipv4_.bytes && lhs.ipv4_.port == rhs.ipv4_.port;
+      if (lhs.family_ == AddressFamily::IPv6)
+        return lhs.ipv6_.bytes == rhs.ipv6_.bytes && lhs.ipv6_.port == rhs.ipv6_.port;
+
+      return true;
+    }
+
+    // 64-bit hash of family, address and port with full avalanche, so low and high bits are equally usable
+    inline std::uint64_t hash() const
+    {
+      std::uint64_t h = static_cast<std::uint64_t>(static_cast<std::uint32_t>(family_)) << 16;
+      if (family_ == AddressFamily::IPv4)
+      {
+        std::uint32_t addr = 0;
+        std::memcpy(&addr, ipv4_.bytes.data(), 4);
+        h = mix(h ^ (static_cast<std::uint64_t>(addr) << 32) ^ ipv4_.port);
+      }
+      else if (family_ == AddressFamily::IPv6)
+      {
+        std::uint64_t hi = 0;
+        std::uint64_t lo = 0;
+        std::memcpy(&hi, ipv6_.bytes.data(), 8);
+        std::memcpy(&lo, ipv6_.bytes.data() + 8, 8);
+        h = mix(mix(h ^ hi ^ ipv6_.port) ^ lo);
+      }
+
+      return h;
+    }
 
     private:
+    // murmur3 64-bit finalizer
+    static inline std::uint64_t mix(std::uint64_t x)
+    {
+      x ^= x >> 33;
+      x *= 0xff51afd7ed558ccdull;
+      x ^= x >> 33;
+      x *= 0xc4ceb9fe1a85ec53ull;
+      x ^= x >> 33;
+      return x;
+    }
+
     union
     {
       IPv4Address ipv4_;
       IPv6Address ipv6_;
     };
+
+    AddressFamily family_;
   };
 
   // Utility functions
   FIRELINK_API std::string inet_ntop(const IPv4Address& addr);
   FIRELINK_API std::string inet_ntop(const IPv6Address& addr);
   FIRELINK_API std::string inet_ntop(AddressFamily family, const Endpoint& endpoint);
+  FIRELINK_API std::string inet_ntop(const Endpoint& endpoint);
 
   FIRELINK_API ErrorCode inet_pton(std::string_view str, IPv4Address& out);
   FIRELINK_API ErrorCode inet_pton(std::string_view str, IPv6Address& out);
   FIRELINK_API ErrorCode inet_pton(AddressFamily family, std::string_view str, Endpoint& out);
+  FIRELINK_API ErrorCode inet_pton(std::string_view str, Endpoint& out);
+
+  // Longest text forms written by to_chars: "255.255.255.255:65535" and
+  // "[ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255]:65535"
+  inline constexpr std::size_t IPV4_ENDPOINT_MAX_CHARS = 21;
+  inline constexpr std::size_t IPV6_ENDPOINT_MAX_CHARS = 53;
+
+  /*
+   * Allocation-free formatting and parsing in the style of std::to_chars/std::from_chars.
+   * to_chars writes "a.b.c.d:port" or "[v6]:port" (RFC 5952 canonical form) and fails with
+   * std::errc::value_too_large if the range is too small. Nothing is null terminated.
+   * from_chars parses an address with an optional port ("a.b.c.d", "a.b.c.d:port", "v6", "[v6]" or
+   * "[v6]:port"), the port is 0 if there is none. ptr points past the parsed characters, trailing characters
+   * are left for the caller. Errors are std::errc::invalid_argument, or std::errc::result_out_of_range for
+   * a port above 65535.
+   */
+  FIRELINK_API std::to_chars_result to_chars(char* first, char* last, const IPv4Address& addr);
+  FIRELINK_API std::to_chars_result to_chars(char* first, char* last, const IPv6Address& addr);
+  FIRELINK_API std::to_chars_result to_chars(char* first, char* last, AddressFamily family, const Endpoint& endpoint);
+  FIRELINK_API std::to_chars_result to_chars(char* first, char* last, const Endpoint& endpoint);
+
+  FIRELINK_API std::from_chars_result from_chars(const char* first, const char* last, IPv4Address& out);
+  FIRELINK_API std::from_chars_result from_chars(const char* first, const char* last, IPv6Address& out);
+  FIRELINK_API std::from_chars_result from_chars(const char* first, const char* last, AddressFamily family, Endpoint& out);
+
+  // Detects the family: text starting with '[' or with a ':' before any '.' is parsed as IPv6
+  FIRELINK_API std::from_chars_result from_chars(const char* first, const char* last, Endpoint& out);
+
+  // Parses input[i] into out[i], each string must be consumed completely. errors[i] is std::errc{} on success.
+  // out and errors must be at least as long as input. Returns the number of strings that failed to parse.
+  FIRELINK_API std::size_t from_chars_batch(std::span<const std::string_view> input, std::span<IPv4Address> out,
+                                            std::span<std::errc> errors);
+  FIRELINK_API std::size_t from_chars_batch(std::span<const std::string_view> input, std::span<IPv6Address> out,
+                                            std::span<std::errc> errors);
 } // namespace firelink
 
+template<>
+struct std::hash<firelink::Endpoint>
+{
+  std::size_t operator()(const firelink::Endpoint& endpoint) const noexcept
+  {
+    return static_cast<std::size_t>(endpoint.hash());
+  }
+};
+
+#ifdef __cpp_lib_format
+template<>
+struct std::formatter<firelink::IPv4Address, char>
+{
+  constexpr auto parse(std::format_parse_context& ctx) { return ctx.begin(); }
+
+  auto format(const firelink::IPv4Address& addr, std::format_context& ctx) const
+  {
+    std::array<char, firelink::IPV4_ENDPOINT_MAX_CHARS> buf{};
+    std::to_chars_result res = firelink::to_chars(buf.data(), buf.data() + buf.size(), addr);
+    return std::copy(buf.data(), res.ptr, ctx.out());
+  }
+};
+
+template<>
+struct std::formatter<firelink::IPv6Address, char>
+{
+  constexpr auto parse(std::format_parse_context& ctx) { return ctx.begin(); }
+
+  auto format(const firelink::IPv6Address& addr, std::format_context& ctx) const
+  {
+    std::array<char, firelink::IPV6_ENDPOINT_MAX_CHARS> buf{};
+    std::to_chars_result res = firelink::to_chars(buf.data(), buf.data() + buf.size(), addr);
+    return std::copy(buf.data(), res.ptr, ctx.out());
+  }
+};
+
+template<>
+struct std::formatter<firelink::Endpoint, char>
+{
+  constexpr auto parse(std::format_parse_context& ctx) { return ctx.begin(); }
+
+  auto format(const firelink::Endpoint& endpoint, std::format_context& ctx) const
+  {
+    std::array<char, firelink::IPV6_ENDPOINT_MAX_CHARS> buf{};
+    std::to_chars_result res = firelink::to_chars(buf.data(), buf.data() + buf.size(), endpoint);
+    return std::copy(buf.data(), res.ptr, ctx.out());
+  }
+};
+#endif
+
 #endif /* ENDPOINT_H */
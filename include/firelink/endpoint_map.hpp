@@ -0,0 +1,293 @@
+#ifndef FIRELINK_ENDPOINT_MAP_H
+#define FIRELINK_ENDPOINT_MAP_H
+
+#include "firelink/endpoint.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace firelink
+{
+  /*
+   * An open-addressing hash map from Endpoint to T for large per-peer tables (UDP sessions, connection state).
+   * Slots are probed linearly. A one byte control array holds 7 bits of every key's hash, so most probes that
+   * do not match are rejected without touching the keys, and keys are stored apart from the values so a
+   * lookup reads the values only for the slot that matched.
+   *
+   * Pointers returned by find and try_emplace stay valid until the next insertion that grows or rehashes the
+   * table, or until the entry is erased. The map is not thread-safe.
+   */
+  template<typename T>
+  class EndpointMap
+  {
+    public:
+    EndpointMap() = default;
+
+    explicit EndpointMap(std::size_t expected_size)
+    {
+      reserve(expected_size);
+    }
+
+    ~EndpointMap()
+    {
+      destroy_all();
+    }
+
+    EndpointMap(const EndpointMap&) = delete;
+    EndpointMap& operator=(const EndpointMap&) = delete;
+
+    EndpointMap(EndpointMap&& other) noexcept :
+      ctrl_(std::move(other.ctrl_)),
+      keys_(std::move(other.keys_)),
+      values_(std::exchange(other.values_, nullptr)),
+      capacity_(std::exchange(other.capacity_, 0)),
+      size_(std::exchange(other.size_, 0)),
+      tombstones_(std::exchange(other.tombstones_, 0))
+    {
+
+    }
+
+    EndpointMap& operator=(EndpointMap&& other) noexcept
+    {
+      if (this != &other)
+      {
+        destroy_all();
+        ctrl_ = std::move(other.ctrl_);
+        keys_ = std::move(other.keys_);
+        values_ = std::exchange(other.values_, nullptr);
+        capacity_ = std::exchange(other.capacity_, 0);
+        size_ = std::exchange(other.size_, 0);
+        tombstones_ = std::exchange(other.tombstones_, 0);
+      }
+
+      return *this;
+    }
+
+    inline std::size_t size() const { return size_; }
+    inline bool empty() const { return size_ == 0; }
+    inline std::size_t capacity() const { return capacity_; }
+
+    inline T* find(const Endpoint& key)
+    {
+      std::size_t index = find_index(key);
+      return index == NPOS ? nullptr : &values_[index];
+    }
+
+    inline const T* find(const Endpoint& key) const
+    {
+      std::size_t index = find_index(key);
+      return index == NPOS ? nullptr : &values_[index];
+    }
+
+    inline bool contains(const Endpoint& key) const
+    {
+      return find_index(key) != NPOS;
+    }
+
+    // Inserts T(args...) if key is not in the map. Returns the value for key and whether it was inserted.
+    template<typename... Args>
+    std::pair<T*, bool> try_emplace(const Endpoint& key, Args&&... args)
+    {
+      std::uint64_t h = key.hash();
+      std::size_t index = find_index(key, h);
+      if (index != NPOS)
+        return {&values_[index], false};
+
+      if ((size_ + tombstones_ + 1) * 4 > capacity_ * 3)
+      {
+        // Grows when at least half full, otherwise the slots are mostly tombstones and are reclaimed in place
+        rehash(capacity_ == 0 ? MIN_CAPACITY : (size_ + 1) * 2 > capacity_ ? capacity_ * 2 : capacity_);
+      }
+
+      index = free_slot(h);
+      ::new (static_cast<void*>(&values_[index])) T(std::forward<Args>(args)...);
+
+      if (ctrl_[index] == TOMBSTONE)
+        tombstones_--;
+
+      ctrl_[index] = fragment(h);
+      keys_[index] = key;
+      size_++;
+      return {&values_[index], true};
+    }
+
+    inline T& operator[](const Endpoint& key)
+    {
+      return *try_emplace(key).first;
+    }
+
+    // Returns true if key was in the map
+    bool erase(const Endpoint& key)
+    {
+      std::size_t index = find_index(key);
+      if (index == NPOS)
+        return false;
+
+      values_[index].~T();
+      size_--;
+
+      // A slot followed by an empty one ends every probe sequence through it, so it can be emptied outright
+      if (ctrl_[(index + 1) & (capacity_ - 1)] == EMPTY)
+      {
+        ctrl_[index] = EMPTY;
+      }
+      else
+      {
+        ctrl_[index] = TOMBSTONE;
+        tombstones_++;
+      }
+
+      return true;
+    }
+
+    void clear()
+    {
+      for (std::size_t i = 0; i < capacity_; ++i)
+      {
+        if (is_full(ctrl_[i]))
+          values_[i].~T();
+      }
+
+      if (capacity_ != 0)
+        std::memset(ctrl_.get(), EMPTY, capacity_);
+
+      size_ = 0;
+      tombstones_ = 0;
+    }
+
+    // Makes room for count entries without further rehashing
+    void reserve(std::size_t count)
+    {
+      if (count * 4 <= capacity_ * 3)
+        return;
+
+      std::size_t new_capacity = MIN_CAPACITY;
+      while (new_capacity * 3 < count * 4)
+        new_capacity *= 2;
+
+      rehash(new_capacity);
+    }
+
+    // Calls func(const Endpoint&, T&) for every entry, in no particular order. func must not modify the map.
+    template<typename Func>
+    void for_each(Func&& func)
+    {
+      for (std::size_t i = 0; i < capacity_; ++i)
+      {
+        if (is_full(ctrl_[i]))
+          func(static_cast<const Endpoint&>(keys_[i]), values_[i]);
+      }
+    }
+
+    template<typename Func>
+    void for_each(Func&& func) const
+    {
+      for (std::size_t i = 0; i < capacity_; ++i)
+      {
+        if (is_full(ctrl_[i]))
+          func(static_cast<const Endpoint&>(keys_[i]), static_cast<const T&>(values_[i]));
+      }
+    }
+
+    private:
+    static constexpr std::size_t NPOS = static_cast<std::size_t>(-1);
+    static constexpr std::size_t MIN_CAPACITY = 16;
+
+    // Control bytes: full slots have the top bit set and the top 7 bits of the hash below it
+    static constexpr std::uint8_t EMPTY = 0x00;
+    static constexpr std::uint8_t TOMBSTONE = 0x01;
+
+    static inline bool is_full(std::uint8_t ctrl) { return (ctrl & 0x80) != 0; }
+    static inline std::uint8_t fragment(std::uint64_t h) { return static_cast<std::uint8_t>(0x80 | (h >> 57)); }
+
+    inline std::size_t find_index(const Endpoint& key) const
+    {
+      return find_index(key, key.hash());
+    }
+
+    std::size_t find_index(const Endpoint& key, std::uint64_t h) const
+    {
+      if (size_ == 0)
+        return NPOS;
+
+      std::size_t mask = capacity_ - 1;
+      std::uint8_t frag = fragment(h);
+      for (std::size_t i = static_cast<std::size_t>(h) & mask;; i = (i + 1) & mask)
+      {
+        std::uint8_t ctrl = ctrl_[i];
+        if (ctrl == EMPTY)
+          return NPOS;
+
+        if (ctrl == frag && keys_[i] == key)
+          return i;
+      }
+    }
+
+    // First empty or deleted slot in the probe sequence of h. The table always has at least one empty slot.
+    std::size_t free_slot(std::uint64_t h) const
+    {
+      std::size_t mask = capacity_ - 1;
+      std::size_t i = static_cast<std::size_t>(h) & mask;
+      while (is_full(ctrl_[i]))
+        i = (i + 1) & mask;
+
+      return i;
+    }
+
+    // Moves all entries into a new table of new_capacity slots, a power of two, dropping all tombstones
+    void rehash(std::size_t new_capacity)
+    {
+      std::unique_ptr<std::uint8_t[]> old_ctrl = std::move(ctrl_);
+      std::unique_ptr<Endpoint[]> old_keys = std::move(keys_);
+      T* old_values = values_;
+      std::size_t old_capacity = capacity_;
+
+      ctrl_ = std::make_unique<std::uint8_t[]>(new_capacity);
+      keys_ = std::make_unique<Endpoint[]>(new_capacity);
+      values_ = std::allocator<T>().allocate(new_capacity);
+      capacity_ = new_capacity;
+      tombstones_ = 0;
+
+      for (std::size_t i = 0; i < old_capacity; ++i)
+      {
+        if (!is_full(old_ctrl[i]))
+          continue;
+
+        std::uint64_t h = old_keys[i].hash();
+        std::size_t index = free_slot(h);
+        ::new (static_cast<void*>(&values_[index])) T(std::move(old_values[i]));
+        old_values[i].~T();
+
+        ctrl_[index] = fragment(h);
+        keys_[index] = old_keys[i];
+      }
+
+      if (old_values != nullptr)
+        std::allocator<T>().deallocate(old_values, old_capacity);
+    }
+
+    void destroy_all()
+    {
+      if (values_ == nullptr)
+        return;
+
+      clear();
+      std::allocator<T>().deallocate(values_, capacity_);
+      values_ = nullptr;
+      capacity_ = 0;
+    }
+
+    std::unique_ptr<std::uint8_t[]> ctrl_;
+    std::unique_ptr<Endpoint[]> keys_;
+    T* values_ = nullptr;
+    std::size_t capacity_ = 0;
+    std::size_t size_ = 0;
+    std::size_t tombstones_ = 0;
+  };
+}
+
+#endif /* FIRELINK_ENDPOINT_MAP_H */
@@ -57,7 +57,13 @@ namespace firelink
     HostDown                   = WSAEHOSTDOWN,
     HostUnreachable            = WSAEHOSTUNREACH,
 
-    InvalidArgument            = WSAEINVAL
+    TryAgain                   = WSATRY_AGAIN,
+    NoRecovery                 = WSANO_RECOVERY,
+    NoData                     = WSANO_DATA,
+
+    InvalidArgument            = WSAEINVAL,
+
+    OperationAborted           = WSA_OPERATION_ABORTED
     
 #elif defined(__linux__)
     // Linux specific
@@ -3,21 +3,67 @@
 
 #include "firelink/export.hpp"
 #include "firelink/error_codes.hpp"
+#include "firelink/metrics.hpp"
+#include "firelink/numa.hpp"
 #include "types.hpp"
 
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <functional>
 #include <expected>
 
 namespace firelink
 {
+  // Where completion handlers and posted user work run
+  enum class HandlerDispatch : int
+  {
+    UserThreadpool,   // the IOCore's user threadpool
+    RunLoop           // the threads calling run, run_one, poll or run_for. No user threadpool is created.
+  };
+
   struct IOCoreConfig
   {
     std::uint32_t io_threadpool_min_threads_;
     std::uint32_t io_threadpool_max_threads_;
     std::uint32_t user_threadpool_min_threads_;
     std::uint32_t user_threadpool_max_threads_;
+
+    // Number of released Socket objects and reusable native socket handles kept for new sockets, 0 disables recycling
+    std::uint32_t socket_pool_capacity_ = 256;
+
+    // Processors the threads of each pool are pinned to. The default mask of 0 leaves them unpinned.
+    CpuSet io_cpu_set_{};
+    CpuSet user_cpu_set_{};
+
+    /*
+     * One IO and one user threadpool per NUMA node, with the thread counts above for each, and their threads
+     * pinned to the node's processors (intersected with the CPU sets above if they are in the same group).
+     * A socket is served by the IO threadpool of the node it was created on, and once connected its handlers
+     * run in the user threadpool of the node its NIC queue delivers to (RSS). See numa_stats().
+     */
+    bool numa_aware_ = false;
+
+    /*
+     * Busy polling for latency-critical sockets. Starting a receive spins on the socket for up to this many
+     * microseconds, on the calling thread, before the receive is left to the IO threadpool. Data arriving
+     * within the budget is received right away and its handler posted without waiting for an IO thread to
+     * wake. 0 disables it. Sockets can override it with Socket::set_busy_poll.
+     */
+    std::uint32_t busy_poll_us_ = 0;
+
+    HandlerDispatch handler_dispatch_ = HandlerDispatch::UserThreadpool;
+  };
+
+  struct SocketPoolStats
+  {
+    std::uint64_t objects_created_ = 0;   // Socket objects allocated from the heap
+    std::uint64_t objects_reused_ = 0;    // Socket objects built in recycled memory
+    std::uint64_t handles_created_ = 0;   // native sockets created and associated with the IO threadpool
+    std::uint64_t handles_reused_ = 0;    // native sockets reused after a disconnect with reuse_socket
+    std::uint32_t idle_objects_ = 0;
+    std::uint32_t idle_handles_ = 0;
   };
   
   class FIRELINK_CLASS_API IOCore
@@ -37,9 +83,44 @@ namespace firelink
     virtual ErrorCode post_io_work(std::move_only_function<void()>&& func) = 0;
     virtual ErrorCode post_user_work(std::move_only_function<void()>&& func) = 0;
 
-    virtual void run() = 0;
+    // Runs func on the user threadpool once delay_ms milliseconds have passed. Work that is still waiting
+    // when the IOCore is released is dropped without running.
+    virtual ErrorCode post_user_work_after(std::uint32_t delay_ms, std::move_only_function<void()>&& func) = 0;
+
+    /*
+     * The event loop. With HandlerDispatch::RunLoop these run handlers and posted user work on the calling
+     * thread and return how many ran, otherwise there is never anything to run and they only wait.
+     * run blocks until stop() is called, run_one until one handler ran or stop() is called, poll runs what was
+     * queued when it was called without blocking and run_for runs handlers until the timeout has passed or
+     * stop() is called.
+     * Once stopped they return right away until the IOCore is initialized again.
+     */
+    virtual std::size_t run() = 0;
+    virtual std::size_t run_one() = 0;
+    virtual std::size_t poll() = 0;
+    virtual std::size_t run_for(std::chrono::milliseconds timeout) = 0;
     virtual void stop() = 0;
 
+    /*
+     * For hosts that own the event loop (a GUI, a game engine, another reactor) and use HandlerDispatch::RunLoop.
+     * The handle is signaled when handlers are queued while none were, and by stop(). The host waits on it
+     * together with its own handles and calls poll() once it is signaled. poll() runs what was queued when it
+     * was called, the handle is signaled again if work is left when it returns or queued afterwards. Owned by
+     * the IOCore, valid until release().
+     */
+    virtual NativeWaitHandle native_wait_handle() const = 0;
+
+    virtual SocketPoolStats get_socket_pool_stats() const = 0;
+
+    // Operation, byte, error and user queue counters summed over all threads, see MetricsRegistry
+    virtual IOCoreStats stats() const = 0;
+
+    // Per operation histograms of the time to completion, to the handler and in the handler, merged over all threads
+    virtual LatencyStats latency_stats() const = 0;
+
+    // Completions and handlers per NUMA node and relative to each connection's NIC node
+    virtual NumaStats numa_stats() const = 0;
+
     protected:
     IOCore() = default;
   };
@@ -0,0 +1,158 @@
+#ifndef FIRELINK_LATENCY_HISTOGRAM_H
+#define FIRELINK_LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace firelink
+{
+  // Bucket layout of LatencyHistogram
+  static constexpr std::uint32_t LATENCY_SUB_BUCKET_BITS = 5;
+  static constexpr std::uint32_t LATENCY_SUB_BUCKETS = 1u << LATENCY_SUB_BUCKET_BITS;
+  static constexpr std::uint32_t LATENCY_MAX_VALUE_BITS = 40;
+  static constexpr std::size_t LATENCY_BUCKET_COUNT =
+    (LATENCY_MAX_VALUE_BITS - LATENCY_SUB_BUCKET_BITS) * (LATENCY_SUB_BUCKETS / 2) + LATENCY_SUB_BUCKETS;
+
+  /*
+   * A log-linear (HDR-style) histogram of nanosecond values. Every power of two is split into
+   * LATENCY_SUB_BUCKETS / 2 linear buckets, so a value is kept to within 1/16 of itself (about 3% on average)
+   * over the whole range, in a fixed number of buckets. Values of 2^LATENCY_MAX_VALUE_BITS ns (about 18
+   * minutes) and more land in the last bucket.
+   *
+   * Buckets are only allocated once the first value is recorded. The histogram is not thread-safe, the
+   * IOCore records into per-thread counters and merges them into one of these on demand.
+   */
+  class LatencyHistogram
+  {
+    public:
+    static constexpr std::size_t bucket_index(std::uint64_t value_ns)
+    {
+      if (value_ns < LATENCY_SUB_BUCKETS)
+        return static_cast<std::size_t>(value_ns);
+
+      std::uint32_t shift = static_cast<std::uint32_t>(std::bit_width(value_ns)) - LATENCY_SUB_BUCKET_BITS;
+      if (shift > LATENCY_MAX_VALUE_BITS - LATENCY_SUB_BUCKET_BITS)
+        return LATENCY_BUCKET_COUNT - 1;
+
+      // value_ns >> shift is in [LATENCY_SUB_BUCKETS / 2, LATENCY_SUB_BUCKETS)
+      return shift * (LATENCY_SUB_BUCKETS / 2) + static_cast<std::size_t>(value_ns >> shift);
+    }
+
+    // Smallest value that falls into the bucket
+    static constexpr std::uint64_t bucket_lowest(std::size_t index)
+    {
+      if (index < LATENCY_SUB_BUCKETS)
+        return index;
+
+      std::uint32_t shift = static_cast<std::uint32_t>(index / (LATENCY_SUB_BUCKETS / 2)) - 1;
+      std::uint64_t sub_bucket = index % (LATENCY_SUB_BUCKETS / 2) + LATENCY_SUB_BUCKETS / 2;
+      return sub_bucket << shift;
+    }
+
+    // Largest value that falls into the bucket
+    static constexpr std::uint64_t bucket_highest(std::size_t index)
+    {
+      if (index + 1 == LATENCY_BUCKET_COUNT)
+        return std::numeric_limits<std::uint64_t>::max();
+
+      return bucket_lowest(index + 1) - 1;
+    }
+
+    void record(std::uint64_t value_ns, std::uint64_t count = 1)
+    {
+      if (count == 0)
+        return;
+
+      if (counts_.empty())
+        counts_.resize(LATENCY_BUCKET_COUNT);
+
+      counts_[bucket_index(value_ns)] += count;
+      total_ += count;
+      sum_ += value_ns * count;
+      min_ = std::min(min_, value_ns);
+      max_ = std::max(max_, value_ns);
+    }
+
+    // For merging counters kept elsewhere: add_bucket adds to a bucket only, add_summary the sum, min and max
+    // of the values behind those counts.
+    void add_bucket(std::size_t index, std::uint64_t count)
+    {
+      if (count == 0)
+        return;
+
+      if (counts_.empty())
+        counts_.resize(LATENCY_BUCKET_COUNT);
+
+      counts_[index] += count;
+      total_ += count;
+    }
+
+    void add_summary(std::uint64_t sum_ns, std::uint64_t min_ns, std::uint64_t max_ns)
+    {
+      sum_ += sum_ns;
+      min_ = std::min(min_, min_ns);
+      max_ = std::max(max_, max_ns);
+    }
+
+    void merge(const LatencyHistogram& other)
+    {
+      for (std::size_t i = 0; i < other.counts_.size(); ++i)
+        add_bucket(i, other.counts_[i]);
+
+      if (other.total_ != 0)
+        add_summary(other.sum_, other.min_, other.max_);
+    }
+
+    void reset()
+    {
+      counts_.clear();
+      total_ = 0;
+      sum_ = 0;
+      min_ = std::numeric_limits<std::uint64_t>::max();
+      max_ = 0;
+    }
+
+    /*
+     * Value below which the given percentage (0 to 100) of the recorded values fall. Like HdrHistogram this
+     * reports the highest value of the bucket the percentile lands in, capped at the largest recorded value.
+     */
+    std::uint64_t percentile(double percent) const
+    {
+      if (total_ == 0)
+        return 0;
+
+      percent = std::clamp(percent, 0.0, 100.0);
+      std::uint64_t rank = static_cast<std::uint64_t>(percent / 100.0 * static_cast<double>(total_) + 0.5);
+      rank = std::clamp<std::uint64_t>(rank, 1, total_);
+
+      std::uint64_t seen = 0;
+      for (std::size_t i = 0; i < counts_.size(); ++i)
+      {
+        seen += counts_[i];
+        if (seen >= rank)
+          return std::min(bucket_highest(i), max_);
+      }
+
+      return max_;
+    }
+
+    inline std::uint64_t count() const { return total_; }
+    inline std::uint64_t min() const { return total_ != 0 ? min_ : 0; }
+    inline std::uint64_t max() const { return max_; }
+    inline double mean() const { return total_ != 0 ? static_cast<double>(sum_) / static_cast<double>(total_) : 0.0; }
+    inline const std::vector<std::uint64_t>& buckets() const { return counts_; }
+
+    private:
+    std::vector<std::uint64_t> counts_;
+    std::uint64_t total_ = 0;
+    std::uint64_t sum_ = 0;
+    std::uint64_t min_ = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t max_ = 0;
+  };
+}
+
+#endif /* FIRELINK_LATENCY_HISTOGRAM_H */
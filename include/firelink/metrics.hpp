@@ -0,0 +1,252 @@
+#ifndef FIRELINK_METRICS_H
+#define FIRELINK_METRICS_H
+
+#include "firelink/export.hpp"
+#include "firelink/error_codes.hpp"
+#include "firelink/types.hpp"
+#include "firelink/latency_histogram.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Metrics are cheap enough to stay on in production. Define as 0 to compile the recording out entirely.
+#ifndef FIRELINK_ENABLE_METRICS
+#define FIRELINK_ENABLE_METRICS 1
+#endif
+
+static constexpr std::size_t FIRELINK_CACHE_LINE_SIZE = 64;
+
+// Distinct error codes each thread keeps a count for, further ones are only counted in other_errors_
+static constexpr std::size_t FIRELINK_METRICS_ERROR_SLOTS = 16;
+
+namespace firelink
+{
+  static constexpr std::size_t OPERATION_COUNT = static_cast<std::size_t>(Operation::Disconnect) + 1;
+
+  // Stages of an asynchronous operation, each timed into its own histogram
+  enum class LatencyStage : int
+  {
+    Completion,   // start_* to the IO thread picking up the completion: the kernel and the IO threadpool
+    Dispatch,     // IO thread completion to the handler starting: the post_user_work hop into the user threadpool
+    Handler       // handler start to handler end
+  };
+
+  static constexpr std::size_t LATENCY_STAGE_COUNT = static_cast<std::size_t>(LatencyStage::Handler) + 1;
+
+  struct OperationStats
+  {
+    std::uint64_t started_ = 0;
+    std::uint64_t completed_ = 0;   // including the failed ones
+    std::uint64_t failed_ = 0;
+  };
+
+  struct ErrorCount
+  {
+    ErrorCode error_ = ErrorCode::Success;
+    std::uint64_t count_ = 0;
+  };
+
+  struct IOCoreStats
+  {
+    std::array<OperationStats, OPERATION_COUNT> operations_{};  // indexed by Operation
+    std::uint64_t outstanding_operations_ = 0;                  // started but not yet completed
+
+    std::uint64_t bytes_sent_ = 0;
+    std::uint64_t bytes_received_ = 0;
+
+    std::vector<ErrorCount> errors_;   // failed operations by error, most frequent first
+    std::uint64_t other_errors_ = 0;   // failed operations whose error did not fit a thread's error table
+
+    std::uint64_t user_work_posted_ = 0;
+    std::uint64_t user_work_started_ = 0;
+    std::uint64_t user_queue_depth_ = 0;   // posted to the user threadpool and not yet picked up by one of its threads
+
+    inline const OperationStats& operation(Operation op) const { return operations_[static_cast<std::size_t>(op)]; }
+  };
+
+  // Empty unless firelink was built with FIRELINK_ENABLE_LATENCY_HISTOGRAMS, see metrics.cpp
+  struct LatencyStats
+  {
+    std::array<std::array<LatencyHistogram, LATENCY_STAGE_COUNT>, OPERATION_COUNT> histograms_{};
+
+    inline const LatencyHistogram& get(Operation op, LatencyStage stage) const
+    {
+      return histograms_[static_cast<std::size_t>(op)][static_cast<std::size_t>(stage)];
+    }
+  };
+
+  /*
+   * Counters of one IOCore. Every thread that records gets its own cache line aligned slot, registered on its
+   * first use, so recording is a plain load and store of thread-owned memory: no locked instructions and no
+   * cache line shared between threads. snapshot() sums the slots and may run concurrently with recording.
+   */
+  class FIRELINK_CLASS_API MetricsRegistry
+  {
+    public:
+    MetricsRegistry();
+    ~MetricsRegistry() = default;
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    inline void operation_started(Operation op)
+    {
+#if FIRELINK_ENABLE_METRICS
+      bump(local().operations_[static_cast<std::size_t>(op)].started_, 1);
+#else
+      static_cast<void>(op);
+#endif
+    }
+
+    inline void operation_completed(Operation op, ErrorCode error, std::int32_t bytes_transferred)
+    {
+#if FIRELINK_ENABLE_METRICS
+      ThreadMetrics& m = local();
+      bump(m.operations_[static_cast<std::size_t>(op)].completed_, 1);
+
+      if (error != ErrorCode::Success)
+      {
+        bump(m.operations_[static_cast<std::size_t>(op)].failed_, 1);
+        count_error(m, error);
+      }
+      else if (bytes_transferred > 0)
+      {
+        if (op == Operation::Send || op == Operation::SendTo)
+          bump(m.bytes_sent_, static_cast<std::uint64_t>(bytes_transferred));
+        else if (op == Operation::Recv || op == Operation::RecvFrom)
+          bump(m.bytes_received_, static_cast<std::uint64_t>(bytes_transferred));
+      }
+#else
+      static_cast<void>(op);
+      static_cast<void>(error);
+      static_cast<void>(bytes_transferred);
+#endif
+    }
+
+    inline void user_work_posted()
+    {
+#if FIRELINK_ENABLE_METRICS
+      bump(local().user_work_posted_, 1);
+#endif
+    }
+
+    inline void user_work_started()
+    {
+#if FIRELINK_ENABLE_METRICS
+      bump(local().user_work_started_, 1);
+#endif
+    }
+
+    /*
+     * Latency histograms are switched on when the library is built (FIRELINK_ENABLE_LATENCY_HISTOGRAMS in
+     * metrics.cpp), not by the code including this header, so the class looks the same to the library and
+     * its users. Switched off, recording costs one predictable branch and no memory.
+     */
+    inline bool latency_enabled() const { return latency_enabled_; }
+
+    // Timestamp for record_latency, 0 when latency histograms are off
+    inline std::uint64_t latency_clock() const
+    {
+      if (!latency_enabled_)
+        return 0;
+
+      return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    inline void record_latency(Operation op, LatencyStage stage, std::uint64_t from_ns, std::uint64_t to_ns)
+    {
+      if (!latency_enabled_)
+        return;
+
+      std::uint64_t ns = to_ns > from_ns ? to_ns - from_ns : 0;
+      HistogramCounters& h = local().latencies_->counters_[static_cast<std::size_t>(op)][static_cast<std::size_t>(stage)];
+      bump(h.buckets_[LatencyHistogram::bucket_index(ns)], 1);
+      bump(h.sum_, ns);
+
+      if (ns < h.min_.load(std::memory_order_relaxed))
+        h.min_.store(ns, std::memory_order_relaxed);
+      if (ns > h.max_.load(std::memory_order_relaxed))
+        h.max_.store(ns, std::memory_order_relaxed);
+    }
+
+    IOCoreStats snapshot() const;
+    LatencyStats latency_snapshot() const;
+
+    private:
+    using Counter = std::atomic<std::uint64_t>;
+
+    struct OperationCounters
+    {
+      Counter started_{0};
+      Counter completed_{0};
+      Counter failed_{0};
+    };
+
+    struct ErrorSlot
+    {
+      std::atomic<int> error_{0};
+      Counter count_{0};
+    };
+
+    struct HistogramCounters
+    {
+      std::array<Counter, LATENCY_BUCKET_COUNT> buckets_{};
+      Counter sum_{0};
+      Counter min_{UINT64_MAX};
+      Counter max_{0};
+    };
+
+    // About 110 KB, only allocated for the slots of a registry with latency histograms on
+    struct alignas(FIRELINK_CACHE_LINE_SIZE) LatencyCounters
+    {
+      std::array<std::array<HistogramCounters, LATENCY_STAGE_COUNT>, OPERATION_COUNT> counters_{};
+    };
+
+    struct alignas(FIRELINK_CACHE_LINE_SIZE) ThreadMetrics
+    {
+      // Thread the slot belongs to. Only compared by register_thread under mutex_.
+      std::thread::id owner_{};
+
+      std::array<OperationCounters, OPERATION_COUNT> operations_{};
+      Counter bytes_sent_{0};
+      Counter bytes_received_{0};
+      Counter user_work_posted_{0};
+      Counter user_work_started_{0};
+
+      // Filled in order by the owning thread, error_slots_used_ publishes the new entries to snapshot()
+      std::array<ErrorSlot, FIRELINK_METRICS_ERROR_SLOTS> error_slots_{};
+      std::atomic<std::size_t> error_slots_used_{0};
+      Counter other_errors_{0};
+
+      std::unique_ptr<LatencyCounters> latencies_;
+    };
+
+    // Only the owning thread writes a counter, so it needs no read-modify-write. The atomic is there for
+    // snapshot() reading it concurrently, relaxed loads and stores compile to plain moves.
+    static inline void bump(Counter& counter, std::uint64_t n)
+    {
+      counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    ThreadMetrics& local();
+    ThreadMetrics& register_thread();
+    static void count_error(ThreadMetrics& m, ErrorCode error);
+
+    // Unique per registry and never reused, so threads can cache their slot by it
+    std::uint64_t id_;
+    bool latency_enabled_;
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadMetrics>> slots_;
+  };
+}
+
+#endif /* FIRELINK_METRICS_H */
@@ -0,0 +1,87 @@
+#ifndef FIRELINK_NUMA_H
+#define FIRELINK_NUMA_H
+
+#include "firelink/export.hpp"
+#include "firelink/error_codes.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace firelink
+{
+  // Processors of one processor group, bit n is processor n of the group. A mask of 0 means no pinning.
+  struct CpuSet
+  {
+    std::uint16_t group_ = 0;
+    std::uint64_t mask_ = 0;
+  };
+
+  struct NumaNodeStats
+  {
+    std::uint64_t completions_ = 0;   // IO completions picked up by threads running on the node
+    std::uint64_t handlers_ = 0;      // handlers run by threads running on the node
+  };
+
+  /*
+   * Where completions and handlers ran, relative to the node of the NIC queue (RSS) that delivers each
+   * connection's traffic. Only counted on machines with more than one NUMA node.
+   */
+  struct NumaStats
+  {
+    std::vector<NumaNodeStats> nodes_;             // indexed by NUMA node number
+    std::uint64_t nic_local_handlers_ = 0;         // handlers that ran on their connection's NIC node
+    std::uint64_t nic_remote_handlers_ = 0;        // handlers that ran on another node
+    std::uint64_t cross_node_hops_avoided_ = 0;    // completions picked up on another node whose handler was steered to the NIC node
+  };
+
+  // The NUMA node of the processor the calling thread runs on
+  FIRELINK_API std::uint32_t current_numa_node();
+
+  // Highest NUMA node number plus one, 1 on machines without NUMA
+  FIRELINK_API std::uint32_t numa_node_count();
+
+  /*
+   * Page-granular memory committed on one NUMA node, for receive buffers and per-connection state that the
+   * threads of that node touch. Inside a handler of a NUMA-aware IOCore, current_numa_node() is the node
+   * the connection is served from.
+   */
+  class FIRELINK_CLASS_API NodeBuffer
+  {
+    public:
+    NodeBuffer() = default;
+    ~NodeBuffer();
+
+    NodeBuffer(const NodeBuffer&) = delete;
+    NodeBuffer& operator=(const NodeBuffer&) = delete;
+
+    NodeBuffer(NodeBuffer&& other) noexcept :
+      data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      node_(other.node_)
+    {
+
+    }
+
+    NodeBuffer& operator=(NodeBuffer&& other) noexcept;
+
+    static std::expected<NodeBuffer, ErrorCode> allocate(std::size_t size, std::uint32_t node);
+
+    inline std::span<std::byte> span() const { return std::span<std::byte>(data_, size_); }
+    inline std::byte* data() const { return data_; }
+    inline std::size_t size() const { return size_; }
+    inline std::uint32_t node() const { return node_; }
+
+    private:
+    void release();
+
+    std::byte* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::uint32_t node_ = 0;
+  };
+}
+
+#endif /* FIRELINK_NUMA_H */
@@ -44,7 +44,8 @@ namespace firelink
     NoDelay              = TCP_NODELAY,
     DontLinger           = SO_DONTLINGER,
     UpdateAcceptContext  = SO_UPDATE_ACCEPT_CONTEXT,
-    UpdateConnectContext = SO_UPDATE_CONNECT_CONTEXT
+    UpdateConnectContext = SO_UPDATE_CONNECT_CONTEXT,
+    ReuseUnicastPort     = SO_REUSE_UNICASTPORT  // ephemeral port picked at connect time and shared between different destinations
 #elif defined(__linux__)
     // Linux specific
     // add here...
@@ -0,0 +1,19 @@
+#ifndef WIN_DNS_CONFIG_H
+#define WIN_DNS_CONFIG_H
+
+#include "firelink/error_codes.hpp"
+#include "firelink/endpoint.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace firelink
+{
+  namespace platform
+  {
+    // Appends the DNS servers configured for the local computer, with the given port, to nameservers
+    ErrorCode get_system_nameservers(std::uint16_t port, std::vector<Endpoint>& nameservers);
+  }
+}
+
+#endif /* WIN_DNS_CONFIG_H */
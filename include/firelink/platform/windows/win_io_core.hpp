@@ -2,8 +2,14 @@
 #define WIN_IO_CORE_H
 
 #include "firelink/io_core.hpp"
+#include "firelink/platform/windows/win_numa.hpp"
+#include "firelink/platform/windows/win_socket_recycler.hpp"
 
 #include <WinSock2.h>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <vector>
 
 // version of winsock that firelink supports. winsock is initialized to this version
 static constexpr DWORD FIRELINK_SUPPORTED_WINSOCK_MINOR_VERSION = 2;
@@ -12,10 +18,19 @@ static constexpr DWORD FIRELINK_SUPPORTED_WINSOCK_MAJOR_VERSION = 2;
 static constexpr DWORD FIRELINK_IO_THREADPOOL_CLEANUP_TIMEOUT_MS = 5000;
 static constexpr DWORD FIRELINK_USER_THREADPOOL_CLEANUP_TIMEOUT_MS = 5000;
 
+// Size of the scratch buffers graceful disconnects discard incoming data into
+static constexpr std::size_t FIRELINK_DRAIN_BUFFER_SIZE = 16 * 1024;
+
+// Completion keys of the run queue packets
+static constexpr ULONG_PTR FIRELINK_RUN_QUEUE_WAKE = 0;
+static constexpr ULONG_PTR FIRELINK_RUN_QUEUE_WORK = 1;
+
 namespace firelink
 {
   namespace platform
   {
+    struct IOTimer;
+
     enum ThreadpoolRollback
     {
       None,
@@ -23,7 +38,42 @@ namespace firelink
       CreateThreadpool,
       CreateCleanupGroup
     };
+
+    // Outcome of one wait on the run queue
+    enum class RunQueueWait
+    {
+      Ran,
+      Idle,
+      Stopped
+    };
     
+    // Work handed to a threadpool callback. metrics_ is set for user work, which is counted once a thread picks it up.
+    struct PostedWork
+    {
+      std::move_only_function<void()> func_;
+      MetricsRegistry* metrics_ = nullptr;
+      const ThreadPlacement* placement_ = nullptr;
+    };
+
+    using DrainBuffer = std::array<std::byte, FIRELINK_DRAIN_BUFFER_SIZE>;
+
+    // One threadpool with its callback environment and the placement its threads pin themselves to
+    struct Threadpool
+    {
+      TP_CALLBACK_ENVIRON environ_{};
+      PTP_CLEANUP_GROUP cleanup_group_ = nullptr;
+      PTP_POOL pool_ = nullptr;
+      ThreadpoolRollback rollback_ = ThreadpoolRollback::None;
+      ThreadPlacement placement_{};
+    };
+
+    // The IO and user threadpools of one NUMA node, or of the whole machine without numa_aware_
+    struct NodeThreadpools
+    {
+      Threadpool io_;
+      Threadpool user_;
+    };
+
     class WinIOCore : public IOCore
     {
       public:
@@ -35,35 +85,86 @@ namespace firelink
 
       ErrorCode post_io_work(std::move_only_function<void()>&& func) override;
       ErrorCode post_user_work(std::move_only_function<void()>&& func) override;
+      ErrorCode post_user_work_after(std::uint32_t delay_ms, std::move_only_function<void()>&& func) override;
 
-      void run() override;
+      std::size_t run() override;
+      std::size_t run_one() override;
+      std::size_t poll() override;
+      std::size_t run_for(std::chrono::milliseconds timeout) override;
       void stop() override;
+      NativeWaitHandle native_wait_handle() const override;
+
+      SocketPoolStats get_socket_pool_stats() const override;
+      IOCoreStats stats() const override;
+      LatencyStats latency_stats() const override;
+      NumaStats numa_stats() const override;
+
+      // Runs func in the user threadpool of the given NUMA node, or of the nearest one that has threadpools
+      ErrorCode post_user_work_on(std::uint32_t node, std::move_only_function<void()>&& func);
+
+      // Runs func in the IO threadpool once delay_ms milliseconds have passed, dropped if the IOCore is released
+      // first. The timer must be passed to cancel_timer once, whether it fired or not.
+      ErrorCode start_io_timer(std::uint32_t delay_ms, std::move_only_function<void()>&& func, IOTimer& timer);
+
+      // Disarms a timer of start_io_timer, waits for a callback that already started and frees the timer.
+      // Must not be called from the timer's own callback.
+      static void cancel_timer(IOTimer& timer);
+
+      // Scratch buffers for draining sockets. A buffer is only held while an IO callback drains, so the pool
+      // grows to about the number of IO threads no matter how many sockets are draining.
+      std::unique_ptr<DrainBuffer> take_drain_buffer();
+      void give_drain_buffer(std::unique_ptr<DrainBuffer> buffer);
 
-      PTP_IO associate_handle(NativeHandle handle, PTP_WIN32_IO_CALLBACK io_routine);
+      PTP_IO associate_handle(NativeHandle handle, PTP_WIN32_IO_CALLBACK io_routine, std::uint32_t node);
+      const ThreadPlacement* io_placement(std::uint32_t node);
+
+      // The node new sockets are served from: the calling thread's node when NUMA-aware, otherwise 0
+      std::uint32_t node_for_current_thread() const;
+
+      inline bool is_numa_aware() const { return conf_.numa_aware_; }
+      inline std::uint32_t get_busy_poll_us() const { return conf_.busy_poll_us_; }
+      inline const std::shared_ptr<SocketRecycler>& get_socket_recycler() const { return socket_recycler_; }
+      inline const std::shared_ptr<MetricsRegistry>& get_metrics() const { return metrics_; }
+      inline const std::shared_ptr<NumaCounters>& get_numa_counters() const { return numa_counters_; }
 
       private:
-      static ErrorCode initialize_threadpool(DWORD threads_min, DWORD threads_max, ThreadpoolRollback* rollback, 
-                                             PTP_CALLBACK_ENVIRON environment, PTP_CLEANUP_GROUP* cleanup_group, PTP_POOL* threadpool);
+      static ErrorCode initialize_threadpool(DWORD threads_min, DWORD threads_max, Threadpool& threadpool);
+      static ErrorCode release_threadpool(DWORD close_cleanup_members_timeout_ms, Threadpool& threadpool);
+      static CpuSet node_cpu_set(const GROUP_AFFINITY& node_affinity, const CpuSet& configured);
+
+      NodeThreadpools& pools(std::uint32_t node);
+
+      static ErrorCode set_timer(Threadpool& threadpool, std::uint32_t delay_ms, std::move_only_function<void()>&& func);
+      static void arm_timer(PTP_TIMER timer, std::uint32_t delay_ms);
 
-      static ErrorCode release_threadpool(DWORD close_cleanup_members_timeout_ms, ThreadpoolRollback* rollback,
-                                          PTP_CALLBACK_ENVIRON environment, PTP_CLEANUP_GROUP cleanup_group, PTP_POOL threadpool);
+      ErrorCode queue_user_work(std::move_only_function<void()>&& func);
+      RunQueueWait run_queued(DWORD timeout_ms);
+      void close_run_queue();
 
       static ErrorCode get_extended_socket_functions();
+      static void CALLBACK cancel_pending_work(PVOID object_context, PVOID cleanup_context);
 
       IOCoreConfig conf_;
-      SRWLOCK srw_run_;
-      CONDITION_VARIABLE cv_run_;
       LONG volatile stop_requested_;
 
-      TP_CALLBACK_ENVIRON io_threadpool_environ_;
-      PTP_CLEANUP_GROUP io_cleanup_group_;
-      PTP_POOL io_threadpool_;
-      ThreadpoolRollback io_rollback_;
+      // Completion port the event loop waits on. Carries PostedWork with HandlerDispatch::RunLoop, and the
+      // wake-ups of stop() in either mode.
+      HANDLE run_queue_;
+
+      // Work packets on the run queue. The auto-reset wake event is set when it goes up from 0.
+      LONG volatile run_queue_depth_;
+      HANDLE wake_event_;
+
+      // Indexed by NUMA node number, nodes without processors have none. A single entry without numa_aware_.
+      std::vector<std::unique_ptr<NodeThreadpools>> nodes_;
+      std::uint32_t default_node_;
+
+      std::shared_ptr<SocketRecycler> socket_recycler_;
+      std::shared_ptr<MetricsRegistry> metrics_;
+      std::shared_ptr<NumaCounters> numa_counters_;
 
-      TP_CALLBACK_ENVIRON user_threadpool_environ_;
-      PTP_CLEANUP_GROUP user_cleanup_group_;
-      PTP_POOL user_threadpool_;
-      ThreadpoolRollback user_rollback_;  
+      SRWLOCK drain_lock_;
+      std::vector<std::unique_ptr<DrainBuffer>> drain_buffers_;
     };
   }
 }
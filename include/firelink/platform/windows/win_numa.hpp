@@ -0,0 +1,74 @@
+#ifndef WIN_NUMA_H
+#define WIN_NUMA_H
+
+#include "firelink/export.hpp"
+#include "firelink/numa.hpp"
+#include "firelink/metrics.hpp"
+
+#include <WinSock2.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// NUMA nodes counted separately in NumaStats, further ones are counted with the last
+static constexpr std::uint32_t FIRELINK_MAX_NUMA_NODES = 64;
+
+namespace firelink
+{
+  namespace platform
+  {
+    // Where the threads of one threadpool run. Every thread pins itself on its first callback.
+    struct ThreadPlacement
+    {
+      CpuSet cpu_set_{};
+      std::uint32_t node_ = 0;
+    };
+
+    // Pins the calling threadpool thread to placement, once per thread. Called at the top of every callback.
+    FIRELINK_API void enter_threadpool_callback(const ThreadPlacement* placement);
+
+    /*
+     * Counts where completions and handlers of an IOCore ran, per NUMA node. Shared with the sockets of the
+     * IOCore like the MetricsRegistry. Counting, and the RSS query of the NIC node it needs, are skipped
+     * unless the IOCore is NUMA-aware on a machine with more than one node.
+     */
+    class FIRELINK_CLASS_API NumaCounters
+    {
+      public:
+      NumaCounters(bool numa_aware);
+
+      NumaCounters(const NumaCounters&) = delete;
+      NumaCounters& operator=(const NumaCounters&) = delete;
+
+      inline bool enabled() const { return enabled_; }
+
+      // An operation of a socket whose NIC node is nic_node (-1 if unknown) completed on the calling thread
+      void record_completion(std::int32_t nic_node);
+
+      // A handler of such a socket starts on the calling thread
+      void record_handler(std::int32_t nic_node);
+
+      NumaStats snapshot() const;
+
+      private:
+      using Counter = std::atomic<std::uint64_t>;
+
+      struct alignas(FIRELINK_CACHE_LINE_SIZE) NodeCounters
+      {
+        Counter completions_{0};
+        Counter handlers_{0};
+        Counter nic_local_handlers_{0};
+        Counter nic_remote_handlers_{0};
+        Counter hops_avoided_{0};
+      };
+
+      NodeCounters& here(std::uint32_t& node);
+
+      bool enabled_;
+      std::uint32_t node_count_;
+      std::unique_ptr<NodeCounters[]> nodes_;
+    };
+  }
+}
+
+#endif /* WIN_NUMA_H */
@@ -2,45 +2,132 @@
 #define WIN_SOCKET_H
 
 #include "firelink/socket.hpp"
+#include "firelink/metrics.hpp"
+#include "firelink/platform/windows/win_numa.hpp"
 #include <WS2tcpip.h>
 #include <MSWSock.h>
 #include <WinSock2.h>
 #include <string>
 #include <array> 
+#include <atomic>
+#include <memory>
 #include <variant>
+#include <vector>
 
 static constexpr DWORD ACCEPTEX_BUF_LEN = 512;
 
+// Maximum number of queued sends that are gathered into a single WSASend
+static constexpr DWORD FIRELINK_MAX_COALESCED_SENDS = 64;
+
+// Set in WinSocket::io_state_ once start_close was called, the lower bits count the pending operations
+static constexpr std::uint32_t FIRELINK_SOCKET_CLOSING = 0x80000000u;
+
 namespace firelink
 {
   namespace platform
   { 
-    struct IOData
+    // A send queued with post_send. Linked into the socket send queue through next_.
+    struct SendRequest
     {
-      OVERLAPPED overlapped_{};
+      std::span<std::byte> data_;
+      WriteHandler handler_;
+      std::int32_t bytes_transferred_ = 0;
+      SendRequest* next_ = nullptr;
+    };
 
-      std::span<std::byte> user_buffer_;
-      std::array<std::byte, ACCEPTEX_BUF_LEN> accept_address_buffer_{};
+    // Queued sends gathered into one vectored write
+    struct SendBatch
+    {
+      std::vector<std::unique_ptr<SendRequest>> requests_;
+      std::vector<WSABUF> wsa_bufs_;
+    };
 
+    // Only accepts need the AcceptEx address buffer and the socket being accepted into, so they live apart from IOData
+    struct AcceptData
+    {
+      std::array<std::byte, ACCEPTEX_BUF_LEN> accept_address_buffer_{};
       SOCKADDR_STORAGE local_win_addr_{};
       SOCKADDR_STORAGE peer_win_addr_{};
+      std::shared_ptr<Socket> accept_socket_;
+    };
+
+    struct PostedWork;
+
+    // A timer of WinIOCore::start_io_timer. Firing does not free it, WinIOCore::cancel_timer does.
+    struct IOTimer
+    {
+      PTP_TIMER timer_ = nullptr;
+      PostedWork* work_ = nullptr;
+    };
+
+    enum class DrainPhase
+    {
+      Draining,
+      TimedOut,
+      Finished
+    };
+
+    // A graceful disconnect in progress, shared by its IOData and the deadline timer. lock_ orders the timer's
+    // cancel against posting the next receive, overlapped_ is only valid while the phase is Draining. The
+    // timer is cancelled as soon as the drain finishes.
+    struct DrainState
+    {
+      DisconnectHandler handler_;
+      SRWLOCK lock_ = SRWLOCK_INIT;
+      DrainPhase phase_ = DrainPhase::Draining;
+      SOCKET socket_ = INVALID_SOCKET;
+      OVERLAPPED* overlapped_ = nullptr;
+      IOTimer timer_{};
+    };
+
+    struct IOData
+    {
+      OVERLAPPED overlapped_{};
 
+      std::span<std::byte> user_buffer_;
       std::shared_ptr<Socket> socket_;
-      std::shared_ptr<Socket> accept_socket_;
 
       std::variant<
         AcceptHandler,
         ConnectHandler,
         ReadHandler,
+        DatagramHandler,
         WriteHandler,
-        DisconnectHandler
+        DisconnectHandler,
+        SendBatch,
+        std::shared_ptr<DrainState>
         > user_handler_;
 
+      // Set for accepts only
+      std::unique_ptr<AcceptData> accept_;
+
+      // Destination of connects and sendtos, source of recvfroms. The length must outlive a pending WSARecvFrom.
+      SOCKADDR_STORAGE peer_win_addr_{};
+      INT peer_win_addr_len_ = sizeof(SOCKADDR_STORAGE);
+
       ErrorCode error_code_ = ErrorCode::Success;
       std::int32_t bytes_transferred_ = 0;
+      bool reuse_socket_ = false;
+      Operation operation_ = Operation::Unknown;
+
+      // Latency timestamps, only taken with FIRELINK_ENABLE_LATENCY_HISTOGRAMS
+      std::uint64_t submitted_ns_ = 0;
+      std::uint64_t completed_ns_ = 0;
+
+      // Pairs the trace events of the operation, 0 with tracing compiled out
+      std::uint64_t trace_id_ = 0;
+    };
+
+    /*
+     * Lets the dispatch microbenchmarks complete made-up operations the way the IO threadpool completes real
+     * ones, without the kernel. Not part of the API.
+     */
+    struct FIRELINK_CLASS_API DispatchTestHook
+    {
+      static void complete_io(IOData* io_data, ULONG io_result, ULONG_PTR n_bytes_transferred);
     };
 
-    class WinSocket : public Socket, public std::enable_shared_from_this<WinSocket>
+    class FIRELINK_CLASS_API WinSocket final : public Socket, public std::enable_shared_from_this<WinSocket>
     {
       public:
       WinSocket(std::shared_ptr<firelink::IOCore> io_core);
@@ -72,6 +159,7 @@ namespace firelink
       std::int32_t send(std::span<std::byte> data) override;
       std::int32_t send_to(std::span<std::byte> data, const Endpoint& dst) override;
       ErrorCode disconnect(int timeout_ms) override;
+      ErrorCode check_connection() override;
 
       private:
       static ErrorCode sockaddr_to_endpoint(SOCKADDR_STORAGE& addr, Endpoint& endpoint);
@@ -86,13 +174,19 @@ namespace firelink
 
       public:
       // Asynchronous API
+      using Socket::start_recv;
       ErrorCode start_accept(std::shared_ptr<firelink::Socket> accept_socket, AcceptHandler handler = AcceptHandler{}) override;
       ErrorCode start_connect(const Endpoint& dst, ConnectHandler handler = ConnectHandler{}) override;
       ErrorCode start_recv(std::span<std::byte> buffer, ReadHandler handler = ReadHandler{}) override;
       ErrorCode start_recv_from(std::span<std::byte> buffer, ReadHandler handler = ReadHandler{}) override;
+      ErrorCode start_recv_datagram(std::span<std::byte> buffer, DatagramHandler handler) override;
       ErrorCode start_send(std::span<std::byte> data, WriteHandler handler = WriteHandler{}) override;
       ErrorCode start_send_to(std::span<std::byte> data, const Endpoint& dst, WriteHandler handler = WriteHandler{}) override;
       ErrorCode start_disconnect(bool reuse_socket, DisconnectHandler handler = DisconnectHandler{}) override;
+      ErrorCode start_graceful_disconnect(std::uint32_t timeout_ms, DisconnectHandler handler = DisconnectHandler{}) override;
+      ErrorCode post_send(std::span<std::byte> data, WriteHandler handler = WriteHandler{}) override;
+      ErrorCode cancel() override;
+      ErrorCode start_close(CloseHandler handler = CloseHandler{}) override;
 
       static LPFN_ACCEPTEX lpfn_accept_ex_;
       static LPFN_GETACCEPTEXSOCKADDRS lpfn_get_accept_ex_sockaddrs_;
@@ -108,10 +202,70 @@ namespace firelink
       static VOID CALLBACK socket_io_routine(PTP_CALLBACK_INSTANCE, PVOID context, PVOID overlapped,
                                              ULONG io_result, ULONG_PTR n_bytes_transferred, PTP_IO io);
 
+      // What the IO threadpool runs once the kernel reports an operation done. Takes ownership of io_data.
+      static void complete_io(IOData* io_data, ULONG io_result, ULONG_PTR n_bytes_transferred);
+      friend struct DispatchTestHook;
+
       static VOID CALLBACK user_callback(PTP_CALLBACK_INSTANCE instance, PVOID context);
 
+      static std::uint64_t handler_started(IOData* io_data);
+      static void handler_finished(IOData* io_data, std::uint64_t started_ns);
+
+      ErrorCode submit_recv_from(IOData* io_data);
+      bool busy_poll_recv(IOData* io_data, WSABUF& wsa_buf);
+
+      ErrorCode reserve_send(std::size_t n);
+      void release_send(std::size_t n);
+
+      bool recycle_handle();
+
+      ErrorCode post_drain_recv(IOData* io_data);
+      ErrorCode drain_available(bool& fin_received);
+      bool continue_drain(IOData* io_data, ULONG& io_result);
+
+      void start_io();
+      void cancel_io();
+      bool io_finished();
+      void finish_close();
+
+      std::int32_t query_nic_node() const;
+      ErrorCode post_handler(IOCore* io_core, std::int32_t nic_node, std::move_only_function<void()>&& work);
+
+      void flush_send_queue();
+      static void complete_send_batch(IOData* io_data);
+      static void run_send_batch_handlers(IOData* io_data);
+      static void release_io_data(IOData* io_data);
+
       static PTP_WIN32_IO_CALLBACK io_routine_;
       PTP_IO socket_io_handle_;
+
+      // Owned by the IOCore, shared so the counters stay valid for as long as the socket
+      std::shared_ptr<MetricsRegistry> metrics_;
+      std::shared_ptr<NumaCounters> numa_;
+
+      // The node whose IO threadpool the handle is bound to, and the node of the NIC queue (RSS) that
+      // delivers the connection's traffic, -1 until connected or when the IOCore is not NUMA-aware
+      std::uint32_t node_;
+      std::int32_t nic_node_;
+      const ThreadPlacement* io_placement_;
+
+      // Producers push onto send_queue_head_ (newest first). Whoever owns send_in_flight_ moves the pushed
+      // requests into the FIFO pending list and writes them out.
+      std::atomic<SendRequest*> send_queue_head_;
+      std::atomic<bool> send_in_flight_;
+      SendRequest* send_pending_head_;
+      SendRequest* send_pending_tail_;
+
+      // Set when a disconnect with reuse_socket completed. Close or destruction then recycles the handle.
+      bool handle_reusable_;
+
+      // Operations submitted to the IO threadpool whose handler has not run yet, plus FIRELINK_SOCKET_CLOSING.
+      // Whoever brings it down to just the flag finishes the close.
+      std::atomic<std::uint32_t> io_state_;
+      std::atomic<bool> close_started_;
+      CloseHandler close_handler_;
+      std::shared_ptr<Socket> close_self_;
+      ErrorCode close_error_;
     };
   }
 }
@@ -0,0 +1,93 @@
+#ifndef WIN_SOCKET_RECYCLER_H
+#define WIN_SOCKET_RECYCLER_H
+
+#include "firelink/io_core.hpp"
+#include "firelink/types.hpp"
+
+#include <WinSock2.h>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace firelink
+{
+  namespace platform
+  {
+    /*
+     * Keeps released socket state around for new sockets of the same IOCore:
+     * - memory blocks of destroyed WinSocket objects (shared_ptr control block included)
+     * - native socket handles that were disconnected with TF_REUSE_SOCKET, together with their threadpool IO
+     *   objects. A socket handle can be associated with the IO threadpool only once, so the two stay paired.
+     */
+    class SocketRecycler
+    {
+      public:
+      explicit SocketRecycler(std::uint32_t capacity);
+      ~SocketRecycler();
+
+      SocketRecycler(const SocketRecycler&) = delete;
+      SocketRecycler& operator=(const SocketRecycler&) = delete;
+
+      void* allocate(std::size_t size);
+      void deallocate(void* block, std::size_t size);
+
+      // Returns false if no idle handle matches, the caller creates a new one. node is the NUMA node whose IO
+      // threadpool the handle is bound to.
+      bool take_handle(AddressFamily addr_family, SocketType sock_type, Protocol protocol, std::uint32_t node,
+                       SOCKET& socket, PTP_IO& socket_io_handle);
+
+      // Returns false if the handle was not taken, the caller closes it
+      bool give_handle(AddressFamily addr_family, SocketType sock_type, Protocol protocol, std::uint32_t node,
+                       SOCKET socket, PTP_IO socket_io_handle);
+
+      void count_new_handle();
+
+      // Closes all idle handles and stops taking new ones. Called before the IO threadpool is released.
+      void shutdown();
+
+      SocketPoolStats get_stats() const;
+
+      private:
+      struct IdleHandle
+      {
+        AddressFamily addr_family_;
+        SocketType sock_type_;
+        Protocol protocol_;
+        std::uint32_t node_;
+        SOCKET socket_;
+        PTP_IO socket_io_handle_;
+      };
+
+      std::uint32_t capacity_;
+      mutable SRWLOCK lock_;
+      bool shut_down_;
+
+      std::size_t block_size_;
+      std::vector<void*> idle_blocks_;
+      std::vector<IdleHandle> idle_handles_;
+      SocketPoolStats stats_;
+    };
+
+    // Allocator for std::allocate_shared that takes its memory from a SocketRecycler
+    template<typename T>
+    struct RecyclingAllocator
+    {
+      using value_type = T;
+
+      explicit RecyclingAllocator(std::shared_ptr<SocketRecycler> recycler) : recycler_(std::move(recycler)) {}
+
+      template<typename U>
+      RecyclingAllocator(const RecyclingAllocator<U>& other) : recycler_(other.recycler_) {}
+
+      T* allocate(std::size_t n) { return static_cast<T*>(recycler_->allocate(n * sizeof(T))); }
+      void deallocate(T* p, std::size_t n) { recycler_->deallocate(p, n * sizeof(T)); }
+
+      template<typename U>
+      bool operator==(const RecyclingAllocator<U>& other) const { return recycler_ == other.recycler_; }
+
+      std::shared_ptr<SocketRecycler> recycler_;
+    };
+  }
+}
+
+#endif /* WIN_SOCKET_RECYCLER_H */
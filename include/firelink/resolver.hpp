@@ -0,0 +1,175 @@
+#ifndef FIRELINK_RESOLVER_H
+#define FIRELINK_RESOLVER_H
+
+#include "firelink/export.hpp"
+#include "firelink/types.hpp"
+#include "firelink/error_codes.hpp"
+#include "firelink/endpoint.hpp"
+#include "firelink/io_core.hpp"
+#include "firelink/socket.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace firelink
+{
+  struct ResolveTag {};
+
+  // endpoints is empty if error is not ErrorCode::Success. Errors are ErrorCode::HostNotFound (the name does
+  // not exist), ErrorCode::NoData (no addresses of the requested family), ErrorCode::TimedOut (no nameserver
+  // answered), ErrorCode::TryAgain (the nameservers failed) or ErrorCode::NoRecovery (they refused the query).
+  using ResolveHandler = std::function<void(const std::vector<Endpoint>& endpoints,
+                                            ErrorCode error, ResolveTag tag)>;
+
+  struct ResolverConfig
+  {
+    std::vector<Endpoint> nameservers_{};     // tried in order, empty uses the DNS servers of the system
+    std::uint32_t timeout_ms_ = 1000;         // time to wait for an answer before trying the next nameserver
+    std::uint32_t attempts_ = 2;              // times the list of nameservers is gone through
+    std::uint32_t max_cache_entries_ = 4096;  // cached answers (per name and family), 0 disables caching
+    std::uint32_t min_ttl_s_ = 0;             // record TTLs are clamped to [min_ttl_s_, max_ttl_s_]
+    std::uint32_t max_ttl_s_ = 3600;
+    std::uint32_t negative_ttl_s_ = 30;       // cache time of negative answers that have no SOA record
+  };
+
+  struct ResolverStats
+  {
+    std::uint64_t queries_sent_ = 0;   // datagrams sent, retries included
+    std::uint64_t cache_hits_ = 0;     // lookups answered from the cache, negative answers included
+    std::uint64_t negative_hits_ = 0;
+    std::uint64_t coalesced_ = 0;      // lookups that joined a query already in flight
+    std::uint64_t timeouts_ = 0;
+    std::uint64_t failures_ = 0;       // lookups that ended with an error other than HostNotFound or NoData
+    std::uint32_t cache_entries_ = 0;
+    std::uint32_t in_flight_ = 0;
+  };
+
+  /*
+   * Asynchronous stub resolver. Names are resolved with A and AAAA queries sent over UDP to the configured
+   * nameservers with firelink sockets, so no IO thread ever blocks on name resolution.
+   * Answers are cached for their TTL. Names that do not exist, or have no addresses of a family, are cached
+   * for the negative TTL of their zone (RFC 2308). Lookups of a name that is already being queried wait for
+   * that query instead of sending another one.
+   * Handlers are called from the user threadpool. IP address literals and "localhost" are answered without
+   * sending queries, the hosts file and DNS search suffixes are not used.
+   */
+  class FIRELINK_CLASS_API Resolver : public std::enable_shared_from_this<Resolver>
+  {
+    public:
+    ~Resolver();
+
+    Resolver(const Resolver&) = delete;
+    Resolver& operator=(const Resolver&) = delete;
+
+    static std::expected<std::shared_ptr<Resolver>, ErrorCode>
+    create(std::shared_ptr<IOCore> io_core, const ResolverConfig& config = {});
+
+    // Resolves host to endpoints with the given port. AddressFamily::Unspecified queries both families,
+    // IPv6 endpoints come first.
+    ErrorCode async_resolve(std::string_view host, std::uint16_t port, AddressFamily family, ResolveHandler handler);
+
+    // Fails all lookups in flight with ErrorCode::OperationAborted
+    void cancel();
+
+    void clear_cache();
+    ResolverStats stats() const;
+
+    private:
+    enum class RecordType : std::uint16_t
+    {
+      A = 1,
+      AAAA = 28
+    };
+
+    struct Question
+    {
+      std::string name_;
+      RecordType type_;
+
+      bool operator==(const Question&) const = default;
+    };
+
+    struct QuestionHash
+    {
+      std::size_t operator()(const Question& question) const noexcept
+      {
+        return std::hash<std::string>{}(question.name_) ^ static_cast<std::size_t>(question.type_);
+      }
+    };
+
+    // Addresses have port 0, the port of a lookup is filled in when it is delivered
+    using QueryCallback = std::function<void(const std::vector<Endpoint>& addresses, ErrorCode error)>;
+
+    struct CacheEntry
+    {
+      std::vector<Endpoint> addresses_;
+      ErrorCode error_;
+      std::chrono::steady_clock::time_point expires_;
+    };
+
+    // One send to one nameserver. Owns its buffers, so the receive of an abandoned attempt can still complete
+    // into them while the next attempt is under way.
+    struct Attempt
+    {
+      std::uint32_t number_ = 0;
+      std::shared_ptr<Socket> socket_;
+      std::vector<std::uint8_t> request_;
+      std::array<std::byte, 1232> response_;
+    };
+
+    struct Query
+    {
+      Question question_;
+      std::vector<QueryCallback> callbacks_;
+      std::shared_ptr<Attempt> current_;
+      std::vector<std::uint8_t> request_;
+      std::uint32_t attempt_ = 0;
+      std::uint16_t id_ = 0;
+      ErrorCode last_error_ = ErrorCode::TimedOut;
+      bool finished_ = false;
+    };
+
+    struct Answer
+    {
+      std::vector<Endpoint> addresses_;
+      ErrorCode error_ = ErrorCode::Success;
+      std::uint32_t ttl_s_ = 0;
+      bool cacheable_ = false;
+    };
+
+    Resolver(std::shared_ptr<IOCore> io_core, const ResolverConfig& config);
+
+    void lookup(Question question, QueryCallback callback);
+    void send_attempt(std::shared_ptr<Query> query);
+    void on_response(std::shared_ptr<Query> query, std::shared_ptr<Attempt> attempt, ErrorCode error, std::int32_t bytes);
+    ErrorCode start_recv(std::shared_ptr<Query> query, std::shared_ptr<Attempt> attempt);
+    void on_timeout(std::shared_ptr<Query> query, std::uint32_t attempt);
+    void retry_or_finish(std::shared_ptr<Query> query, std::uint32_t attempt, ErrorCode error);
+    void finish(std::shared_ptr<Query> query, const Answer& answer);
+    void store(const Question& question, const Answer& answer);
+
+    Answer parse_response(const Query& query, const Attempt& attempt, std::int32_t bytes) const;
+    std::uint16_t next_query_id();
+    void deliver(std::vector<Endpoint> endpoints, ErrorCode error, ResolveHandler handler);
+
+    std::weak_ptr<IOCore> io_core_;
+    ResolverConfig conf_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<Question, CacheEntry, QuestionHash> cache_;
+    std::unordered_map<Question, std::shared_ptr<Query>, QuestionHash> in_flight_;
+    ResolverStats stats_;
+    std::uint64_t id_state_;
+  };
+}
+
+#endif /* FIRELINK_RESOLVER_H */
@@ -0,0 +1,107 @@
+#ifndef FIRELINK_RING_BUFFER_H
+#define FIRELINK_RING_BUFFER_H
+
+#include "firelink/export.hpp"
+#include "firelink/error_codes.hpp"
+
+#include <cstddef>
+#include <expected>
+#include <span>
+
+namespace firelink
+{
+  /*
+   * A circular byte buffer whose storage is mapped twice, back to back, in virtual memory. Because the
+   * second mapping mirrors the first, both the readable and the writable regions are always a single
+   * contiguous span, even when they wrap around the end of the buffer. Frames can therefore be parsed in
+   * place and the writable span can be handed directly to Socket::start_recv.
+   *
+   * The buffer is not thread-safe. One reader and one writer may use it as long as they do not run
+   * concurrently (for example a ReadHandler that commits received data and then parses it).
+   */
+  class FIRELINK_CLASS_API MirroredRingBuffer
+  {
+    public:
+    MirroredRingBuffer() = default;
+    ~MirroredRingBuffer();
+
+    MirroredRingBuffer(const MirroredRingBuffer&) = delete;
+    MirroredRingBuffer& operator=(const MirroredRingBuffer&) = delete;
+
+    MirroredRingBuffer(MirroredRingBuffer&& other) noexcept;
+    MirroredRingBuffer& operator=(MirroredRingBuffer&& other) noexcept;
+
+    // Capacity is rounded up to the platform mapping granularity (64KiB on Windows, page size on Linux)
+    static std::expected<MirroredRingBuffer, ErrorCode> create(std::size_t min_capacity);
+
+    inline std::size_t capacity() const { return capacity_; }
+    inline std::size_t size() const { return size_; }
+    inline std::size_t space() const { return capacity_ - size_; }
+    inline bool empty() const { return size_ == 0; }
+    inline bool full() const { return size_ == capacity_; }
+
+    // All bytes that have been committed but not yet consumed
+    inline std::span<std::byte> readable_span() const
+    {
+      return std::span<std::byte>(base_ + read_offset_, size_);
+    }
+
+    // All free space after the last committed byte
+    inline std::span<std::byte> writable_span() const
+    {
+      return std::span<std::byte>(base_ + write_offset(), capacity_ - size_);
+    }
+
+    // Marks n bytes at the start of writable_span() as readable. More than space() is rejected with
+    // InvalidArgument and the buffer is left as it was.
+    inline ErrorCode commit(std::size_t n)
+    {
+      if (n > capacity_ - size_)
+        return ErrorCode::InvalidArgument;
+
+      size_ += n;
+      return ErrorCode::Success;
+    }
+
+    // Releases n bytes from the start of readable_span(). More than size() is rejected with InvalidArgument
+    // and the buffer is left as it was.
+    inline ErrorCode consume(std::size_t n)
+    {
+      if (n > size_)
+        return ErrorCode::InvalidArgument;
+
+      read_offset_ += n;
+      if (read_offset_ >= capacity_)
+        read_offset_ -= capacity_;
+
+      size_ -= n;
+      return ErrorCode::Success;
+    }
+
+    inline void clear()
+    {
+      read_offset_ = 0;
+      size_ = 0;
+    }
+
+    private:
+    MirroredRingBuffer(std::byte* base, std::size_t capacity) : base_(base), capacity_(capacity) {}
+
+    inline std::size_t write_offset() const
+    {
+      std::size_t offset = read_offset_ + size_;
+      return offset >= capacity_ ? offset - capacity_ : offset;
+    }
+
+    static ErrorCode map_mirrored(std::size_t capacity, std::byte** base_out);
+    static void unmap_mirrored(std::byte* base, std::size_t capacity);
+    static std::size_t mapping_granularity();
+
+    std::byte* base_ = nullptr;
+    std::size_t capacity_ = 0;
+    std::size_t read_offset_ = 0;
+    std::size_t size_ = 0;
+  };
+}
+
+#endif /* FIRELINK_RING_BUFFER_H */
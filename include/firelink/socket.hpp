@@ -7,8 +7,10 @@
 #include "firelink/options.hpp"
 #include "firelink/endpoint.hpp"
 #include "firelink/io_core.hpp"
+#include "firelink/ring_buffer.hpp"
 
 
+#include <atomic>
 #include <memory>
 #include <string_view>
 #include <span>
@@ -24,6 +26,8 @@ namespace firelink
   struct ReadTag {};
   struct WriteTag {};
   struct DisconnectTag {};
+  struct DrainTag {};
+  struct CloseTag {};
   
   using AcceptHandler = std::function<void(std::shared_ptr<firelink::Socket> caller,
                                            std::shared_ptr<firelink::Socket> accepted_socket,
@@ -37,11 +41,40 @@ namespace firelink
   using ReadHandler = std::function<void(std::shared_ptr<firelink::Socket> caller,
                                          ErrorCode error, std::int32_t bytes_transferred, ReadTag tag)>;
   
+  // A received datagram together with the address it came from
+  using DatagramHandler = std::function<void(std::shared_ptr<firelink::Socket> caller,
+                                             ErrorCode error, std::int32_t bytes_transferred,
+                                             const Endpoint& peer_endpoint, ReadTag tag)>;
+  
   using WriteHandler = std::function<void(std::shared_ptr<firelink::Socket> caller,
                                           ErrorCode error, std::int32_t bytes_transferred, WriteTag tag)>;
   
   using DisconnectHandler = std::function<void(std::shared_ptr<firelink::Socket> caller,
                                                ErrorCode error, DisconnectTag tag)>;
+
+  // Called once a socket closed with start_close is fully released
+  using CloseHandler = std::function<void(std::shared_ptr<firelink::Socket> caller,
+                                          ErrorCode error, CloseTag tag)>;
+
+  // Called once the bytes queued for sending drop to the low watermark after having reached the high watermark
+  using DrainHandler = std::function<void(std::shared_ptr<firelink::Socket> caller,
+                                          std::size_t queued_bytes, DrainTag tag)>;
+
+  // What happens to a send that would take the queued bytes above SendLimits::hard_cap_
+  enum class SendOverflowPolicy : int
+  {
+    FailFast,   // the send is rejected with ErrorCode::NoBufferSpace
+    Disconnect  // outstanding operations are cancelled, the connection is shut down and the send fails with ErrorCode::ConnectionAborted
+  };
+
+  // Limits on the bytes handed to start_send, start_send_to and post_send that have not completed yet. 0 disables a limit.
+  struct SendLimits
+  {
+    std::size_t low_watermark_ = 0;
+    std::size_t high_watermark_ = 0;
+    std::size_t hard_cap_ = 0;
+    SendOverflowPolicy overflow_policy_ = SendOverflowPolicy::FailFast;
+  };
   
   class FIRELINK_CLASS_API Socket
   {
@@ -88,15 +121,56 @@ namespace firelink
     virtual std::int32_t send_to(std::span<std::byte> data, const Endpoint& dst) = 0;
     virtual ErrorCode disconnect(int timeout_ms) = 0;
 
+    // Non-blocking liveness probe of a connected stream socket. Returns ErrorCode::Success if the connection
+    // is still usable, otherwise the reason it is not (the peer closed it, reset it, ...). Pending data is not consumed.
+    virtual ErrorCode check_connection() = 0;
+
     // Asynchronous API
     virtual ErrorCode start_accept(std::shared_ptr<firelink::Socket> accept_socket, AcceptHandler handler = AcceptHandler{}) = 0;
     virtual ErrorCode start_connect(const Endpoint& dst, ConnectHandler handler = ConnectHandler{}) = 0;
     virtual ErrorCode start_recv(std::span<std::byte> buffer, ReadHandler handler = ReadHandler{}) = 0;
     virtual ErrorCode start_recv_from(std::span<std::byte> buffer, ReadHandler handler = ReadHandler{}) = 0;
+    // Like start_recv_from, but the handler is also given the address the datagram came from
+    virtual ErrorCode start_recv_datagram(std::span<std::byte> buffer, DatagramHandler handler) = 0;
     virtual ErrorCode start_send(std::span<std::byte> data, WriteHandler handler = WriteHandler{}) = 0;
     virtual ErrorCode start_send_to(std::span<std::byte> data, const Endpoint& dst, WriteHandler handler = WriteHandler{}) = 0;
     virtual ErrorCode start_disconnect(bool reuse_socket, DisconnectHandler handler = DisconnectHandler{}) = 0;
 
+    // Graceful shutdown of a connected stream socket without blocking a thread, the asynchronous disconnect(timeout_ms).
+    // Shuts down the send side, then discards incoming data until the peer's FIN. The handler is called with
+    // ErrorCode::Success once the FIN arrived, ErrorCode::TimedOut if timeout_ms passed first (0 waits without
+    // a deadline), or the error. The socket stays open, close it from the handler.
+    virtual ErrorCode start_graceful_disconnect(std::uint32_t timeout_ms, DisconnectHandler handler = DisconnectHandler{}) = 0;
+
+    // Queues data for sending on a connected stream socket. Can be called concurrently from any number of
+    // threads without locking. The socket keeps at most one write in flight, and everything queued while it
+    // is in flight is gathered into the next vectored write. Data is sent in the order it was queued.
+    // The data must stay valid until the handler has been called. Do not mix with start_send on the same socket.
+    virtual ErrorCode post_send(std::span<std::byte> data, WriteHandler handler = WriteHandler{}) = 0;
+
+    // Cancels all outstanding asynchronous operations. Their handlers are called with ErrorCode::OperationAborted.
+    virtual ErrorCode cancel() = 0;
+
+    // Closes the socket without blocking. Outstanding operations are aborted and their handlers called with
+    // ErrorCode::OperationAborted. The handler is called after all of them, once the socket is released.
+    // Unlike close(), safe to call from any handler or threadpool thread.
+    virtual ErrorCode start_close(CloseHandler handler = CloseHandler{}) = 0;
+
+    // Send-side backpressure. Set the limits before starting any sends on the socket.
+    void set_send_limits(const SendLimits& limits, DrainHandler handler = DrainHandler{});
+    inline const SendLimits& get_send_limits() const { return send_limits_; }
+    inline std::size_t get_queued_send_bytes() const { return queued_send_bytes_.load(std::memory_order_relaxed); }
+    inline bool is_send_congested() const { return send_congested_.load(std::memory_order_relaxed); }
+
+    // Receives into the writable region of the ring buffer and commits the received bytes before the
+    // handler runs. The buffer must stay alive until the handler has been called.
+    ErrorCode start_recv(MirroredRingBuffer& buffer, ReadHandler handler = ReadHandler{});
+
+    // Overrides IOCoreConfig::busy_poll_us_ for this socket, 0 disables busy polling. Busy polling assumes
+    // at most one receive outstanding on the socket at a time.
+    inline void set_busy_poll(std::uint32_t busy_poll_us) { busy_poll_us_ = busy_poll_us; }
+    inline std::uint32_t get_busy_poll() const { return busy_poll_us_; }
+
   protected:
     Socket(std::shared_ptr<IOCore> io_core);
     std::weak_ptr<IOCore> io_core_;
@@ -105,6 +179,17 @@ namespace firelink
     SocketType sock_type_;
     Protocol protocol_;
     bool is_bound_;
+
+    // Adds n bytes to the queued send bytes. Fails with ErrorCode::NoBufferSpace if the hard cap would be exceeded.
+    ErrorCode acquire_send_bytes(std::size_t n);
+    // Removes n bytes from the queued send bytes. Returns true if the drain handler should be called.
+    bool release_send_bytes(std::size_t n);
+
+    SendLimits send_limits_;
+    DrainHandler drain_handler_;
+    std::atomic<std::size_t> queued_send_bytes_;
+    std::atomic<bool> send_congested_;
+    std::uint32_t busy_poll_us_;
   };
 }
 #endif /* FIRELINK_SOCKET_H */
@@ -0,0 +1,141 @@
+#ifndef FIRELINK_TCP_STREAM_H
+#define FIRELINK_TCP_STREAM_H
+
+#include "firelink/basic_socket.hpp"
+
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <span>
+
+namespace firelink
+{
+  /*
+   * A TCP connection. Exposes only what makes sense on a connected stream, statically dispatched through
+   * NativeSocket, and holds nothing but the socket pointer. The socket type and protocol are fixed, only the
+   * address family is picked when the stream is opened.
+   *
+   * Connecting streams are opened with open(). Streams that are accepted into are made with create() and
+   * handed to the listener through as_socket().
+   */
+  class TcpStream
+  {
+    public:
+    TcpStream() = default;
+
+    // Adopts a socket that already is a TCP stream, e.g. one filled by an accept
+    explicit TcpStream(NativeSocket socket) :
+      socket_(std::move(socket))
+    {
+
+    }
+
+    // An unopened stream to accept into
+    static std::expected<TcpStream, ErrorCode> create(std::shared_ptr<IOCore> io_core)
+    {
+      auto sock = NativeSocket::create(std::move(io_core));
+      if (!sock.has_value())
+        return std::unexpected(sock.error());
+
+      return TcpStream(std::move(sock.value()));
+    }
+
+    // An opened stream, ready to connect
+    static std::expected<TcpStream, ErrorCode> open(std::shared_ptr<IOCore> io_core, AddressFamily family = AddressFamily::IPv4)
+    {
+      auto stream = create(std::move(io_core));
+      if (!stream.has_value())
+        return stream;
+
+      ErrorCode err = stream.value().socket_.socket(family, SocketType::Stream, Protocol::Tcp);
+      if (err != ErrorCode::Success)
+        return std::unexpected(err);
+
+      return stream;
+    }
+
+    inline NativeSocket& native() { return socket_; }
+    inline std::shared_ptr<Socket> as_socket() const { return socket_.as_socket(); }
+    inline explicit operator bool() const { return bool(socket_); }
+    inline bool is_valid() const { return socket_.is_valid(); }
+    inline NativeHandle get_native_handle() const { return socket_.get_native_handle(); }
+    inline AddressFamily get_addr_family() const { return socket_.get_addr_family(); }
+
+    inline ErrorCode bind(const Endpoint& endpoint) { return socket_.bind(endpoint); }
+    inline ErrorCode get_sock_name(Endpoint& ep) { return socket_.get_sock_name(ep); }
+    inline ErrorCode get_peer_name(Endpoint& ep) { return socket_.get_peer_name(ep); }
+
+    // Disables Nagle's algorithm, small writes go out without waiting for earlier ones to be acknowledged
+    inline ErrorCode set_no_delay(bool enable)
+    {
+      std::uint32_t value = enable ? 1 : 0;
+      return socket_.set_socket_option(SocketOptionLevel::Tcp, SocketOption::NoDelay,
+                                       std::as_bytes(std::span<std::uint32_t>(&value, 1)));
+    }
+
+    // Synchronous API
+    inline ErrorCode connect(const Endpoint& dst) { return socket_.connect(dst); }
+    inline std::int32_t recv(std::span<std::byte> buffer) { return socket_.recv(buffer); }
+    inline std::int32_t send(std::span<std::byte> data) { return socket_.send(data); }
+    inline ErrorCode shutdown(ShutdownHow how) { return socket_.shutdown(how); }
+    inline ErrorCode disconnect(int timeout_ms) { return socket_.disconnect(timeout_ms); }
+    inline ErrorCode check_connection() { return socket_.check_connection(); }
+    inline ErrorCode close() { return socket_.close(); }
+
+    // Asynchronous API
+    inline ErrorCode start_connect(const Endpoint& dst, ConnectHandler handler = ConnectHandler{})
+    {
+      return socket_.start_connect(dst, std::move(handler));
+    }
+
+    inline ErrorCode start_recv(std::span<std::byte> buffer, ReadHandler handler = ReadHandler{})
+    {
+      return socket_.start_recv(buffer, std::move(handler));
+    }
+
+    inline ErrorCode start_recv(MirroredRingBuffer& buffer, ReadHandler handler = ReadHandler{})
+    {
+      return socket_.start_recv(buffer, std::move(handler));
+    }
+
+    inline ErrorCode start_send(std::span<std::byte> data, WriteHandler handler = WriteHandler{})
+    {
+      return socket_.start_send(data, std::move(handler));
+    }
+
+    inline ErrorCode post_send(std::span<std::byte> data, WriteHandler handler = WriteHandler{})
+    {
+      return socket_.post_send(data, std::move(handler));
+    }
+
+    inline ErrorCode start_disconnect(bool reuse_socket, DisconnectHandler handler = DisconnectHandler{})
+    {
+      return socket_.start_disconnect(reuse_socket, std::move(handler));
+    }
+
+    inline ErrorCode start_graceful_disconnect(std::uint32_t timeout_ms, DisconnectHandler handler = DisconnectHandler{})
+    {
+      return socket_.start_graceful_disconnect(timeout_ms, std::move(handler));
+    }
+
+    inline ErrorCode cancel() { return socket_.cancel(); }
+    inline ErrorCode start_close(CloseHandler handler = CloseHandler{}) { return socket_.start_close(std::move(handler)); }
+
+    // Send-side backpressure
+    inline void set_send_limits(const SendLimits& limits, DrainHandler handler = DrainHandler{})
+    {
+      socket_.set_send_limits(limits, std::move(handler));
+    }
+
+    inline std::size_t get_queued_send_bytes() const { return socket_.get_queued_send_bytes(); }
+    inline bool is_send_congested() const { return socket_.is_send_congested(); }
+
+    // Busy polling, see IOCoreConfig::busy_poll_us_
+    inline void set_busy_poll(std::uint32_t busy_poll_us) { socket_.set_busy_poll(busy_poll_us); }
+    inline std::uint32_t get_busy_poll() const { return socket_.get_busy_poll(); }
+
+    private:
+    NativeSocket socket_;
+  };
+}
+#endif /* FIRELINK_TCP_STREAM_H */
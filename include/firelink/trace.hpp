@@ -0,0 +1,121 @@
+#ifndef FIRELINK_TRACE_H
+#define FIRELINK_TRACE_H
+
+#include "firelink/export.hpp"
+#include "firelink/error_codes.hpp"
+#include "firelink/types.hpp"
+
+#include <chrono>
+#include <cstdint>
+
+// Define as 1 to build firelink with tracing hooks on the IO path. Off, the hooks compile to nothing.
+#ifndef FIRELINK_ENABLE_TRACING
+#define FIRELINK_ENABLE_TRACING 0
+#endif
+
+namespace firelink
+{
+  enum class TraceEvent : std::uint8_t
+  {
+    OperationSubmitted,   // start_* handed the operation to the kernel
+    OperationCompleted,   // an IO thread picked up the completion
+    HandlerDispatched,    // a user thread is about to call the handler
+    HandlerFinished,      // the handler returned
+    SocketCreated,
+    SocketClosed
+  };
+
+  struct TraceRecord
+  {
+    std::uint64_t timestamp_ns_ = 0;       // steady clock
+    std::uint64_t operation_id_ = 0;       // pairs the events of one operation, never reused; 0 for socket events
+    const void* socket_ = nullptr;
+    std::uint32_t thread_id_ = 0;          // small per-process thread number, see trace_thread_id
+    std::int32_t bytes_transferred_ = 0;
+    ErrorCode error_ = ErrorCode::Success;
+    Operation operation_ = Operation::Unknown;
+    TraceEvent event_ = TraceEvent::OperationSubmitted;
+  };
+
+  /*
+   * Receives the trace events of every IOCore once installed with set_trace_sink. record is called from IO,
+   * user and application threads concurrently and should not block.
+   */
+  class FIRELINK_CLASS_API TraceSink
+  {
+    public:
+    virtual ~TraceSink() = default;
+    virtual void record(const TraceRecord& record) noexcept = 0;
+  };
+
+  // Installs the sink, nullptr removes it. The sink must outlive the IOCores tracing into it.
+  FIRELINK_API void set_trace_sink(TraceSink* sink);
+  FIRELINK_API TraceSink* get_trace_sink();
+
+  // Numbers the threads of the process in the order they first trace, starting from 1
+  FIRELINK_API std::uint32_t trace_thread_id();
+
+  // Numbers the operations of the process in the order they are submitted, starting from 1
+  FIRELINK_API std::uint64_t next_trace_operation_id();
+
+  // Tracing compiled out, every hook is an empty inline function
+  struct NullTracePolicy
+  {
+    static constexpr bool enabled = false;
+
+    static inline void record(TraceEvent, const void*, std::uint64_t, Operation, ErrorCode, std::int32_t) {}
+  };
+
+  // Forwards to the installed sink, if any
+  struct SinkTracePolicy
+  {
+    static constexpr bool enabled = true;
+
+    static inline void record(TraceEvent event, const void* socket, std::uint64_t operation_id, Operation op,
+                              ErrorCode error, std::int32_t bytes_transferred)
+    {
+      TraceSink* sink = get_trace_sink();
+      if (sink == nullptr)
+        return;
+
+      TraceRecord record{};
+      record.timestamp_ns_ = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+      record.operation_id_ = operation_id;
+      record.socket_ = socket;
+      record.thread_id_ = trace_thread_id();
+      record.bytes_transferred_ = bytes_transferred;
+      record.error_ = error;
+      record.operation_ = op;
+      record.event_ = event;
+      sink->record(record);
+    }
+  };
+
+#if FIRELINK_ENABLE_TRACING
+  using TracePolicy = SinkTracePolicy;
+#else
+  using TracePolicy = NullTracePolicy;
+#endif
+
+  // The hook firelink calls on the IO path. Policy picks the implementation at compile time.
+  template<typename Policy = TracePolicy>
+  inline void trace(TraceEvent event, const void* socket, std::uint64_t operation_id = 0, Operation op = Operation::Unknown,
+                    ErrorCode error = ErrorCode::Success, std::int32_t bytes_transferred = 0)
+  {
+    if constexpr (Policy::enabled)
+      Policy::record(event, socket, operation_id, op, error, bytes_transferred);
+  }
+
+  // Id for the events of a new operation. Tracing compiled out, it is 0 and costs nothing.
+  template<typename Policy = TracePolicy>
+  inline std::uint64_t trace_operation_id()
+  {
+    if constexpr (Policy::enabled)
+      return next_trace_operation_id();
+    else
+      return 0;
+  }
+}
+
+#endif /* FIRELINK_TRACE_H */
@@ -0,0 +1,70 @@
+#ifndef FIRELINK_TRACE_RECORDER_H
+#define FIRELINK_TRACE_RECORDER_H
+
+#include "firelink/export.hpp"
+#include "firelink/trace.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace firelink
+{
+  struct TraceRecorderConfig
+  {
+    std::uint32_t capacity_ = 1u << 16;   // records kept, rounded up to a power of two; the oldest are overwritten
+  };
+
+  /*
+   * A TraceSink that keeps the most recent records in a ring buffer. Writers claim a slot with a single
+   * fetch_add, so they only wait on each other when one laps the ring onto a slot that is still being filled.
+   * Call stop() before reading the records back, it waits for writers that are still copying a record.
+   */
+  class FIRELINK_CLASS_API TraceRecorder : public TraceSink
+  {
+    public:
+    explicit TraceRecorder(const TraceRecorderConfig& config = {});
+    ~TraceRecorder() override;
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    void record(const TraceRecord& record) noexcept override;
+
+    void start();
+    void stop();
+
+    // Drops all records. Only while stopped.
+    void clear();
+
+    // Records kept, and records written in total including the overwritten ones. Exact only while stopped.
+    std::size_t size() const;
+    std::uint64_t total_recorded() const;
+
+    /*
+     * The kept records as Chrome trace-event JSON, for chrome://tracing or Perfetto. Only while stopped.
+     * Operations become async spans from submission to completion, handlers duration events on the user
+     * thread that ran them, and threads are named by what they were seen doing (io, user or app).
+     */
+    std::string export_chrome_json() const;
+
+    private:
+    // busy_ keeps a writer that lapped the ring from overwriting a slot another writer is still filling
+    struct Slot
+    {
+      std::atomic<bool> busy_{false};
+      TraceRecord record_;
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    std::uint64_t mask_;
+
+    std::atomic<std::uint64_t> head_;
+    std::atomic<std::uint32_t> writers_;
+    std::atomic<bool> recording_;
+  };
+}
+
+#endif /* FIRELINK_TRACE_RECORDER_H */
@@ -12,9 +12,11 @@ namespace firelink
 #ifdef _WIN32
   // Windows specific
   using NativeHandle = SOCKET;
+  using NativeWaitHandle = HANDLE;
 #elif defined(__linux__)
   // Linux specific
   using NativeHandle = int;
+  using NativeWaitHandle = int;
 #endif
   
   enum class Operation : int
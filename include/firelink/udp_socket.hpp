@@ -0,0 +1,173 @@
+#ifndef FIRELINK_UDP_SOCKET_H
+#define FIRELINK_UDP_SOCKET_H
+
+#include "firelink/basic_socket.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <span>
+
+namespace firelink
+{
+  // One datagram of a batch: the payload and where it goes to or came from
+  struct Datagram
+  {
+    std::span<std::byte> data_;
+    Endpoint peer_;
+  };
+
+  /*
+   * A UDP socket. Exposes only datagram operations, statically dispatched through NativeSocket, and holds
+   * nothing but the socket pointer. Received datagrams come with their source address (DatagramHandler).
+   *
+   * The batch calls keep several datagrams in flight with one call. A server that posts a batch of receives
+   * does not drop datagrams that arrive while a handler runs. Winsock has no counterpart of sendmmsg or
+   * recvmmsg, so every datagram is still its own overlapped operation. What a batch saves over a loop of
+   * single calls is the handler: it is moved once into shared storage and each operation only holds a
+   * pointer to it, instead of a copy of the handler and whatever it captures.
+   */
+  class UdpSocket
+  {
+    public:
+    UdpSocket() = default;
+
+    explicit UdpSocket(NativeSocket socket) :
+      socket_(std::move(socket))
+    {
+
+    }
+
+    static std::expected<UdpSocket, ErrorCode> open(std::shared_ptr<IOCore> io_core, AddressFamily family = AddressFamily::IPv4)
+    {
+      auto sock = NativeSocket::create(std::move(io_core));
+      if (!sock.has_value())
+        return std::unexpected(sock.error());
+
+      ErrorCode err = sock.value().socket(family, SocketType::Datagram, Protocol::Udp);
+      if (err != ErrorCode::Success)
+        return std::unexpected(err);
+
+      return UdpSocket(std::move(sock.value()));
+    }
+
+    inline NativeSocket& native() { return socket_; }
+    inline std::shared_ptr<Socket> as_socket() const { return socket_.as_socket(); }
+    inline explicit operator bool() const { return bool(socket_); }
+    inline bool is_valid() const { return socket_.is_valid(); }
+    inline NativeHandle get_native_handle() const { return socket_.get_native_handle(); }
+    inline AddressFamily get_addr_family() const { return socket_.get_addr_family(); }
+
+    inline ErrorCode bind(const Endpoint& endpoint) { return socket_.bind(endpoint); }
+    inline ErrorCode get_sock_name(Endpoint& ep) { return socket_.get_sock_name(ep); }
+    inline ErrorCode close() { return socket_.close(); }
+
+    inline ErrorCode set_broadcast(bool enable)
+    {
+      std::uint32_t value = enable ? 1 : 0;
+      return socket_.set_socket_option(SocketOptionLevel::Socket, SocketOption::Broadcast,
+                                       std::as_bytes(std::span<std::uint32_t>(&value, 1)));
+    }
+
+    // Synchronous API
+    inline std::int32_t send_to(std::span<std::byte> data, const Endpoint& dst) { return socket_.send_to(data, dst); }
+    inline std::int32_t recv_from(std::span<std::byte> buffer, Endpoint& peer) { return socket_.recv_from(buffer, peer); }
+
+    // Sends the datagrams in order and stops at the first that fails. Returns how many were sent.
+    inline std::size_t send_batch(std::span<const Datagram> datagrams)
+    {
+      std::size_t sent = 0;
+      for (const Datagram& datagram : datagrams)
+      {
+        if (socket_.send_to(datagram.data_, datagram.peer_) < 0)
+          break;
+
+        ++sent;
+      }
+
+      return sent;
+    }
+
+    // Asynchronous API
+    inline ErrorCode start_send_to(std::span<std::byte> data, const Endpoint& dst, WriteHandler handler = WriteHandler{})
+    {
+      return socket_.start_send_to(data, dst, std::move(handler));
+    }
+
+    inline ErrorCode start_recv_from(std::span<std::byte> buffer, DatagramHandler handler)
+    {
+      return socket_.start_recv_datagram(buffer, std::move(handler));
+    }
+
+    /*
+     * Posts one send per datagram, each completing on its own through handler. Stops at the first that can
+     * not be posted and returns its error, posted is set to the number that were.
+     */
+    inline ErrorCode start_send_batch(std::span<const Datagram> datagrams, std::size_t& posted, WriteHandler handler = WriteHandler{})
+    {
+      WriteHandler each{};
+      if (bool(handler))
+      {
+        each = [shared = std::make_shared<WriteHandler>(std::move(handler))](std::shared_ptr<Socket> caller, ErrorCode error,
+                                                                            std::int32_t bytes_transferred, WriteTag tag)
+        {
+          (*shared)(std::move(caller), error, bytes_transferred, tag);
+        };
+      }
+
+      posted = 0;
+      for (const Datagram& datagram : datagrams)
+      {
+        ErrorCode err = socket_.start_send_to(datagram.data_, datagram.peer_, each);
+        if (err != ErrorCode::Success)
+          return err;
+
+        ++posted;
+      }
+
+      return ErrorCode::Success;
+    }
+
+    /*
+     * Posts one receive per buffer, each completing on its own through handler. Stops at the first that can
+     * not be posted and returns its error, posted is set to the number that were.
+     */
+    inline ErrorCode start_recv_batch(std::span<const std::span<std::byte>> buffers, std::size_t& posted, DatagramHandler handler)
+    {
+      DatagramHandler each{};
+      if (bool(handler))
+      {
+        each = [shared = std::make_shared<DatagramHandler>(std::move(handler))](std::shared_ptr<Socket> caller, ErrorCode error,
+                                                                               std::int32_t bytes_transferred,
+                                                                               const Endpoint& peer_endpoint, ReadTag tag)
+        {
+          (*shared)(std::move(caller), error, bytes_transferred, peer_endpoint, tag);
+        };
+      }
+
+      posted = 0;
+      for (std::span<std::byte> buffer : buffers)
+      {
+        ErrorCode err = socket_.start_recv_datagram(buffer, each);
+        if (err != ErrorCode::Success)
+          return err;
+
+        ++posted;
+      }
+
+      return ErrorCode::Success;
+    }
+
+    inline ErrorCode cancel() { return socket_.cancel(); }
+    inline ErrorCode start_close(CloseHandler handler = CloseHandler{}) { return socket_.start_close(std::move(handler)); }
+
+    // Busy polling, see IOCoreConfig::busy_poll_us_
+    inline void set_busy_poll(std::uint32_t busy_poll_us) { socket_.set_busy_poll(busy_poll_us); }
+    inline std::uint32_t get_busy_poll() const { return socket_.get_busy_poll(); }
+
+    private:
+    NativeSocket socket_;
+  };
+}
+#endif /* FIRELINK_UDP_SOCKET_H */
@@ -0,0 +1,283 @@
+#include "firelink/acceptor.hpp"
+
+#include <algorithm>
+
+namespace
+{
+  enum class AcceptFailure
+  {
+    Connection,   // only this connection is lost, accept the next one
+    Resources,    // the system is out of buffers or handles, try again later
+    Fatal         // the listener itself is unusable
+  };
+
+  AcceptFailure classify_accept_error(firelink::ErrorCode error)
+  {
+    switch (error)
+    {
+      case firelink::ErrorCode::ConnectionReset:
+      case firelink::ErrorCode::ConnectionAborted:
+      case firelink::ErrorCode::NetworkReset:
+      case firelink::ErrorCode::TimedOut:
+        return AcceptFailure::Connection;
+
+      case firelink::ErrorCode::NoBufferSpace:
+      case firelink::ErrorCode::ProcLimitReached:
+      case firelink::ErrorCode::SystemError:
+        return AcceptFailure::Resources;
+
+      default:
+        return AcceptFailure::Fatal;
+    }
+  }
+}
+
+firelink::Acceptor::Acceptor(std::vector<std::shared_ptr<IOCore>> io_cores, const AcceptorConfig& config) :
+  conf_(config),
+  stopping_(false),
+  next_core_(0),
+  retry_delay_ms_(FIRELINK_ACCEPT_RETRY_MIN_MS),
+  accepted_(0),
+  accept_errors_(0),
+  pending_(0)
+{
+  for (std::shared_ptr<IOCore>& io_core : io_cores)
+    io_cores_.push_back(io_core);
+}
+
+firelink::Acceptor::~Acceptor()
+{
+  stop();
+}
+
+std::expected<std::shared_ptr<firelink::Acceptor>, firelink::ErrorCode>
+firelink::Acceptor::create(std::shared_ptr<IOCore> io_core, const AcceptorConfig& config)
+{
+  return create(std::vector<std::shared_ptr<IOCore>>{std::move(io_core)}, config);
+}
+
+std::expected<std::shared_ptr<firelink::Acceptor>, firelink::ErrorCode>
+firelink::Acceptor::create(std::vector<std::shared_ptr<IOCore>> io_cores, const AcceptorConfig& config)
+{
+  if (io_cores.empty() || config.pending_accepts_ == 0)
+    return std::unexpected(ErrorCode::InvalidArgument);
+
+  for (const std::shared_ptr<IOCore>& io_core : io_cores)
+  {
+    if (!io_core)
+      return std::unexpected(ErrorCode::InvalidArgument);
+  }
+
+  return std::shared_ptr<Acceptor>(new Acceptor(std::move(io_cores), config));
+}
+
+firelink::ErrorCode firelink::Acceptor::open(AddressFamily addr_family, const Endpoint& local_endpoint)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (listener_ || stopping_)
+    return ErrorCode::InvalidArgument;
+
+  std::shared_ptr<IOCore> io_core = io_cores_.front().lock();
+  if (!io_core)
+    return ErrorCode::SystemError;
+
+  auto listener = Socket::create(io_core);
+  if (!listener.has_value())
+    return listener.error();
+
+  ErrorCode err = listener.value()->socket(addr_family, SocketType::Stream, Protocol::Tcp);
+  if (err != ErrorCode::Success)
+    return err;
+
+  err = listener.value()->bind(local_endpoint);
+  if (err == ErrorCode::Success)
+    err = listener.value()->listen(conf_.backlog_);
+
+  if (err != ErrorCode::Success)
+  {
+    listener.value()->close();
+    return err;
+  }
+
+  listener_ = std::move(listener.value());
+  return ErrorCode::Success;
+}
+
+firelink::ErrorCode firelink::Acceptor::start(ConnectionHandler handler)
+{
+  if (!bool(handler))
+    return ErrorCode::InvalidArgument;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!listener_)
+      return ErrorCode::NotASocket;
+    if (bool(handler_))
+      return ErrorCode::AlreadyInProgress;
+
+    handler_ = std::move(handler);
+  }
+
+  ErrorCode first_err = ErrorCode::Success;
+  for (std::uint32_t i = 0; i < conf_.pending_accepts_; ++i)
+  {
+    ErrorCode err = post_accept();
+    if (err != ErrorCode::Success && first_err == ErrorCode::Success)
+      first_err = err;
+  }
+
+  // Running with fewer accepts than configured still works, fail only if none could be posted
+  if (pending_.load() == 0)
+    return first_err;
+
+  return ErrorCode::Success;
+}
+
+void firelink::Acceptor::stop()
+{
+  std::shared_ptr<Socket> listener{};
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_)
+      return;
+
+    stopping_ = true;
+    listener = listener_;
+    if (listener)
+      listener->cancel();
+  }
+
+  // Waits for the cancelled accepts to complete
+  if (listener)
+    listener->close();
+}
+
+firelink::ErrorCode firelink::Acceptor::get_local_endpoint(Endpoint& ep) const
+{
+  if (!listener_)
+    return ErrorCode::NotASocket;
+
+  return listener_->get_sock_name(ep);
+}
+
+firelink::AcceptorStats firelink::Acceptor::stats() const
+{
+  AcceptorStats result{};
+  result.accepted_ = accepted_.load(std::memory_order_relaxed);
+  result.accept_errors_ = accept_errors_.load(std::memory_order_relaxed);
+  result.pending_ = pending_.load(std::memory_order_relaxed);
+  return result;
+}
+
+/*
+ * Posts one accept. The accept socket is created on the next IOCore in round-robin order.
+ */
+firelink::ErrorCode firelink::Acceptor::post_accept()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (stopping_)
+    return ErrorCode::OperationAborted;
+
+  std::uint32_t index = next_core_.fetch_add(1, std::memory_order_relaxed) % static_cast<std::uint32_t>(io_cores_.size());
+  std::shared_ptr<IOCore> io_core = io_cores_[index].lock();
+  if (!io_core)
+    return ErrorCode::SystemError;
+
+  auto accept_socket = Socket::create(io_core);
+  if (!accept_socket.has_value())
+    return accept_socket.error();
+
+  // Counted before posting, the accept may complete before start_accept returns
+  pending_.fetch_add(1);
+
+  std::weak_ptr<Acceptor> weak_self = weak_from_this();
+  ErrorCode err = listener_->start_accept(accept_socket.value(), [weak_self](std::shared_ptr<Socket>,
+                                                                             std::shared_ptr<Socket> accepted_socket,
+                                                                             const Endpoint&,
+                                                                             const Endpoint& peer_endpoint,
+                                                                             ErrorCode error, AcceptTag)
+  {
+    if (std::shared_ptr<Acceptor> self = weak_self.lock())
+      self->on_accept(std::move(accepted_socket), peer_endpoint, error);
+    else if (accepted_socket)
+      accepted_socket->close();
+  });
+
+  if (err != ErrorCode::Success)
+  {
+    pending_.fetch_sub(1);
+    accept_errors_.fetch_add(1, std::memory_order_relaxed);
+    accept_socket.value()->close();
+  }
+
+  return err;
+}
+
+void firelink::Acceptor::on_accept(std::shared_ptr<Socket> accepted_socket, const Endpoint& peer_endpoint, ErrorCode error)
+{
+  pending_.fetch_sub(1);
+
+  // The listener is going away
+  if (error == ErrorCode::OperationAborted)
+  {
+    if (accepted_socket)
+      accepted_socket->close();
+    return;
+  }
+
+  if (error != ErrorCode::Success)
+  {
+    AcceptFailure failure = classify_accept_error(error);
+    if (failure == AcceptFailure::Connection)
+      rearm();
+    else if (failure == AcceptFailure::Resources)
+      rearm_later();
+
+    accept_errors_.fetch_add(1, std::memory_order_relaxed);
+    if (accepted_socket)
+      accepted_socket->close();
+
+    handler_(nullptr, peer_endpoint, error, ConnectionTag{});
+    return;
+  }
+
+  // Re-arm first, the handler may take a while
+  retry_delay_ms_.store(FIRELINK_ACCEPT_RETRY_MIN_MS, std::memory_order_relaxed);
+  rearm();
+
+  accepted_.fetch_add(1, std::memory_order_relaxed);
+  handler_(std::move(accepted_socket), peer_endpoint, error, ConnectionTag{});
+}
+
+/*
+ * Posts a replacement for a completed accept. If that fails for lack of resources it is retried later,
+ * otherwise the acceptor continues with one accept less.
+ */
+void firelink::Acceptor::rearm()
+{
+  ErrorCode err = post_accept();
+  if (err != ErrorCode::Success && err != ErrorCode::OperationAborted &&
+      classify_accept_error(err) == AcceptFailure::Resources)
+  {
+    rearm_later();
+  }
+}
+
+// Re-arms after the current retry delay and doubles it for the next failure
+void firelink::Acceptor::rearm_later()
+{
+  std::uint32_t delay_ms = retry_delay_ms_.load(std::memory_order_relaxed);
+  retry_delay_ms_.store(std::min(delay_ms * 2, FIRELINK_ACCEPT_RETRY_MAX_MS), std::memory_order_relaxed);
+
+  std::shared_ptr<IOCore> io_core = io_cores_.front().lock();
+  if (!io_core)
+    return;
+
+  std::weak_ptr<Acceptor> weak_self = weak_from_this();
+  io_core->post_user_work_after(delay_ms, [weak_self]()
+  {
+    if (std::shared_ptr<Acceptor> self = weak_self.lock())
+      self->rearm();
+  });
+}
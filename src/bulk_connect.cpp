@@ -0,0 +1,197 @@
+#include "firelink/bulk_connect.hpp"
+
+#include <atomic>
+#include <mutex>
+
+namespace
+{
+  /*
+   * State of one connect_bulk call. Connects claim destinations through next_, so each result slot is
+   * written by exactly one of them, and the completion that brings completed_ to the total delivers.
+   * Sockets whose connect failed are closed and kept in spare_, the next destinations reuse their objects
+   * instead of allocating new ones.
+   */
+  class BulkConnect : public std::enable_shared_from_this<BulkConnect>
+  {
+    public:
+    BulkConnect(std::shared_ptr<firelink::IOCore> io_core, std::vector<firelink::Endpoint> destinations,
+                firelink::BulkConnectHandler handler, const firelink::BulkConnectConfig& config) :
+      io_core_(io_core),
+      handler_(std::move(handler)),
+      conf_(config),
+      next_(0),
+      completed_(0)
+    {
+      results_.resize(destinations.size());
+      for (std::size_t i = 0; i < destinations.size(); ++i)
+        results_[i].endpoint_ = destinations[i];
+
+      spare_.reserve(std::min<std::size_t>(conf_.max_in_flight_, results_.size()));
+    }
+
+    inline std::size_t size() const { return results_.size(); }
+
+    // Starts connects until one is outstanding or no destinations are left
+    void launch()
+    {
+      for (;;)
+      {
+        std::size_t index = next_.fetch_add(1, std::memory_order_relaxed);
+        if (index >= results_.size())
+          return;
+
+        firelink::ErrorCode err = start_connect(index);
+        if (err == firelink::ErrorCode::Success)
+          return;
+
+        results_[index].error_ = err;
+        if (complete_one())
+          return;
+      }
+    }
+
+    private:
+    firelink::ErrorCode start_connect(std::size_t index)
+    {
+      std::shared_ptr<firelink::IOCore> io_core = io_core_.lock();
+      if (!io_core)
+        return firelink::ErrorCode::SystemError;
+
+      std::shared_ptr<firelink::Socket> sock = take_spare();
+      if (!sock)
+      {
+        auto created = firelink::Socket::create(io_core);
+        if (!created.has_value())
+          return created.error();
+
+        sock = std::move(created.value());
+      }
+
+      const firelink::Endpoint& dst = results_[index].endpoint_;
+      firelink::ErrorCode err = sock->socket(dst.family(), firelink::SocketType::Stream, firelink::Protocol::Tcp);
+      if (err != firelink::ErrorCode::Success)
+      {
+        give_spare(std::move(sock));
+        return err;
+      }
+
+      // The option only applies to the bind start_connect does. A recycled handle is still bound to the local
+      // address of its previous connection and keeps it. Best effort, older systems do not know the option
+      // and fall back to reserving a port per socket.
+      if (conf_.reuse_unicast_port_ && !sock->is_bound())
+      {
+        std::uint32_t enable = 1;
+        sock->set_socket_option(firelink::SocketOptionLevel::Socket, firelink::SocketOption::ReuseUnicastPort,
+                                std::as_bytes(std::span<std::uint32_t>(&enable, 1)));
+      }
+
+      std::shared_ptr<BulkConnect> self = shared_from_this();
+      err = sock->start_connect(dst, [self, index](std::shared_ptr<firelink::Socket> caller,
+                                                   firelink::ErrorCode error, firelink::ConnectTag)
+      {
+        self->on_connect(index, std::move(caller), error);
+      });
+
+      if (err != firelink::ErrorCode::Success)
+        give_spare(std::move(sock));
+
+      return err;
+    }
+
+    std::shared_ptr<firelink::Socket> take_spare()
+    {
+      std::lock_guard<std::mutex> lock(spare_lock_);
+      if (spare_.empty())
+        return nullptr;
+
+      std::shared_ptr<firelink::Socket> sock = std::move(spare_.back());
+      spare_.pop_back();
+      return sock;
+    }
+
+    // Closes the socket and keeps the object for a later destination
+    void give_spare(std::shared_ptr<firelink::Socket> sock)
+    {
+      sock->close();
+
+      std::lock_guard<std::mutex> lock(spare_lock_);
+      spare_.push_back(std::move(sock));
+    }
+
+    void on_connect(std::size_t index, std::shared_ptr<firelink::Socket> socket, firelink::ErrorCode error)
+    {
+      if (error == firelink::ErrorCode::Success)
+      {
+        results_[index].socket_ = std::move(socket);
+      }
+      else
+      {
+        give_spare(std::move(socket));
+        results_[index].error_ = error;
+      }
+
+      if (!complete_one())
+        launch();
+    }
+
+    // Returns true if this was the last outstanding destination. The handler has been taken care of then.
+    bool complete_one()
+    {
+      if (completed_.fetch_add(1, std::memory_order_acq_rel) + 1 != results_.size())
+        return false;
+
+      {
+        std::lock_guard<std::mutex> lock(spare_lock_);
+        spare_.clear();
+      }
+
+      // The last completion may come from a synchronous failure on the calling thread
+      std::shared_ptr<BulkConnect> self = shared_from_this();
+      auto call_handler = [self]()
+      {
+        self->handler_(self->results_, firelink::BulkConnectTag{});
+      };
+
+      std::shared_ptr<firelink::IOCore> io_core = io_core_.lock();
+      if (!io_core || io_core->post_user_work(call_handler) != firelink::ErrorCode::Success)
+      {
+        // Failed to post user work. Call handler manually.
+        call_handler();
+      }
+
+      return true;
+    }
+
+    std::weak_ptr<firelink::IOCore> io_core_;
+    firelink::BulkConnectHandler handler_;
+    firelink::BulkConnectConfig conf_;
+    std::vector<firelink::ConnectResult> results_;
+
+    std::atomic<std::size_t> next_;
+    std::atomic<std::size_t> completed_;
+
+    std::mutex spare_lock_;
+    std::vector<std::shared_ptr<firelink::Socket>> spare_;
+  };
+}
+
+firelink::ErrorCode firelink::connect_bulk(std::shared_ptr<IOCore> io_core, std::vector<Endpoint> destinations,
+                                           BulkConnectHandler handler, const BulkConnectConfig& config)
+{
+  if (!io_core || destinations.empty() || !bool(handler) || config.max_in_flight_ == 0)
+    return ErrorCode::InvalidArgument;
+
+  for (const Endpoint& destination : destinations)
+  {
+    if (destination.family() == AddressFamily::Unspecified)
+      return ErrorCode::InvalidArgument;
+  }
+
+  auto bulk = std::make_shared<BulkConnect>(io_core, std::move(destinations), std::move(handler), config);
+
+  std::size_t initial = std::min<std::size_t>(config.max_in_flight_, bulk->size());
+  for (std::size_t i = 0; i < initial; ++i)
+    bulk->launch();
+
+  return ErrorCode::Success;
+}
@@ -0,0 +1,277 @@
+#include "firelink/connect_any.hpp"
+
+#include <mutex>
+
+namespace
+{
+  // RFC 8305 section 4: alternate between the families, keeping the relative order within each family
+  std::vector<firelink::Endpoint> interleave_families(const std::vector<firelink::Endpoint>& endpoints)
+  {
+    std::vector<firelink::Endpoint> first{};
+    std::vector<firelink::Endpoint> second{};
+    for (const firelink::Endpoint& endpoint : endpoints)
+    {
+      if (endpoint.family() == endpoints.front().family())
+        first.push_back(endpoint);
+      else
+        second.push_back(endpoint);
+    }
+
+    std::vector<firelink::Endpoint> result{};
+    result.reserve(endpoints.size());
+    for (std::size_t i = 0; i < first.size() || i < second.size(); ++i)
+    {
+      if (i < first.size())
+        result.push_back(first[i]);
+      if (i < second.size())
+        result.push_back(second[i]);
+    }
+
+    return result;
+  }
+
+  /*
+   * State of one connect_any call. Attempts keep it alive through their handlers and timers.
+   */
+  class ConnectRace : public std::enable_shared_from_this<ConnectRace>
+  {
+    public:
+    ConnectRace(std::shared_ptr<firelink::IOCore> io_core, std::vector<firelink::Endpoint> endpoints,
+                firelink::ConnectAnyHandler handler, const firelink::ConnectAnyConfig& config) :
+      io_core_(io_core),
+      endpoints_(std::move(endpoints)),
+      handler_(std::move(handler)),
+      conf_(config),
+      attempts_(endpoints_.size()),
+      next_(0),
+      failed_(0),
+      done_(false),
+      last_error_(firelink::ErrorCode::HostUnreachable)
+    {
+
+    }
+
+    // Starts the next attempt. Attempts that fail synchronously are skipped over right away.
+    void start_next()
+    {
+      for (;;)
+      {
+        std::size_t index = 0;
+
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          if (done_ || next_ == endpoints_.size())
+            return;
+
+          index = next_++;
+        }
+
+        firelink::ErrorCode err = start_attempt(index);
+        if (err == firelink::ErrorCode::Success)
+          return;
+
+        if (attempt_failed(err))
+          return;
+      }
+    }
+
+    private:
+    firelink::ErrorCode start_attempt(std::size_t index)
+    {
+      std::shared_ptr<firelink::IOCore> io_core = io_core_.lock();
+      if (!io_core)
+        return firelink::ErrorCode::SystemError;
+
+      auto sock = firelink::Socket::create(io_core);
+      if (!sock.has_value())
+        return sock.error();
+
+      const firelink::Endpoint& dst = endpoints_[index];
+      firelink::ErrorCode err = sock.value()->socket(dst.family(), firelink::SocketType::Stream, firelink::Protocol::Tcp);
+      if (err != firelink::ErrorCode::Success)
+      {
+        sock.value()->close();
+        return err;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (done_)
+        {
+          sock.value()->close();
+          return firelink::ErrorCode::Success;
+        }
+
+        attempts_[index] = sock.value();
+      }
+
+      std::shared_ptr<ConnectRace> self = shared_from_this();
+      err = sock.value()->start_connect(dst, [self, index](std::shared_ptr<firelink::Socket> caller,
+                                                           firelink::ErrorCode error, firelink::ConnectTag)
+      {
+        self->on_connect(index, std::move(caller), error);
+      });
+
+      if (err != firelink::ErrorCode::Success)
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          attempts_[index].reset();
+        }
+
+        sock.value()->close();
+        return err;
+      }
+
+      // The next attempt gets going after the delay unless this one fails first
+      err = io_core->post_user_work_after(conf_.attempt_delay_ms_, [self, index]()
+      {
+        self->on_attempt_delay(index);
+      });
+
+      if (err != firelink::ErrorCode::Success)
+        start_next();
+
+      return firelink::ErrorCode::Success;
+    }
+
+    void on_attempt_delay(std::size_t index)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (done_ || next_ != index + 1)
+          return;
+      }
+
+      start_next();
+    }
+
+    void on_connect(std::size_t index, std::shared_ptr<firelink::Socket> socket, firelink::ErrorCode error)
+    {
+      if (error != firelink::ErrorCode::Success)
+      {
+        bool start_another = false;
+
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          attempts_[index].reset();
+
+          // A failed attempt does not wait for the delay, the next one starts now
+          start_another = !done_ && next_ == index + 1;
+        }
+
+        socket->close();
+
+        if (attempt_failed(error) || !start_another)
+          return;
+
+        start_next();
+        return;
+      }
+
+      std::vector<std::shared_ptr<firelink::Socket>> losers{};
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        attempts_[index].reset();
+
+        // Lost the race against an attempt that completed at the same time
+        if (done_)
+        {
+          losers.push_back(std::move(socket));
+        }
+        else
+        {
+          done_ = true;
+          for (std::shared_ptr<firelink::Socket>& attempt : attempts_)
+          {
+            if (attempt)
+              losers.push_back(std::move(attempt));
+          }
+        }
+      }
+
+      for (std::shared_ptr<firelink::Socket>& loser : losers)
+      {
+        loser->cancel();
+        loser->close();
+      }
+
+      if (socket)
+        handler_(std::move(socket), endpoints_[index], firelink::ErrorCode::Success, firelink::ConnectAnyTag{});
+    }
+
+    // Counts a failed attempt. Returns true if it was the last one and the handler has been called.
+    bool attempt_failed(firelink::ErrorCode error)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // Cancelled because another attempt won
+        if (done_)
+          return true;
+
+        if (error != firelink::ErrorCode::OperationAborted)
+          last_error_ = error;
+
+        if (++failed_ != endpoints_.size())
+          return false;
+
+        done_ = true;
+      }
+
+      deliver_failure();
+      return true;
+    }
+
+    void deliver_failure()
+    {
+      std::shared_ptr<ConnectRace> self = shared_from_this();
+      auto call_handler = [self]()
+      {
+        self->handler_(nullptr, firelink::Endpoint{}, self->last_error_, firelink::ConnectAnyTag{});
+      };
+
+      if (std::shared_ptr<firelink::IOCore> io_core = io_core_.lock())
+      {
+        if (io_core->post_user_work(call_handler) == firelink::ErrorCode::Success)
+          return;
+      }
+
+      // Failed to post user work. Call handler manually.
+      call_handler();
+    }
+
+    std::weak_ptr<firelink::IOCore> io_core_;
+    std::vector<firelink::Endpoint> endpoints_;
+    firelink::ConnectAnyHandler handler_;
+    firelink::ConnectAnyConfig conf_;
+
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<firelink::Socket>> attempts_;
+    std::size_t next_;
+    std::size_t failed_;
+    bool done_;
+    firelink::ErrorCode last_error_;
+  };
+}
+
+firelink::ErrorCode firelink::connect_any(std::shared_ptr<IOCore> io_core, std::vector<Endpoint> endpoints,
+                                          ConnectAnyHandler handler, const ConnectAnyConfig& config)
+{
+  if (!io_core || endpoints.empty() || !bool(handler))
+    return ErrorCode::InvalidArgument;
+
+  for (const Endpoint& endpoint : endpoints)
+  {
+    if (endpoint.family() == AddressFamily::Unspecified)
+      return ErrorCode::InvalidArgument;
+  }
+
+  if (config.interleave_families_)
+    endpoints = interleave_families(endpoints);
+
+  auto race = std::make_shared<ConnectRace>(io_core, std::move(endpoints), std::move(handler), config);
+  race->start_next();
+  return ErrorCode::Success;
+}
@@ -0,0 +1,383 @@
+#include "firelink/connection_pool.hpp"
+
+#include <vector>
+
+firelink::ConnectionPool::ConnectionPool(std::shared_ptr<IOCore> io_core, const ConnectionPoolConfig& config) :
+  io_core_(io_core),
+  conf_(config)
+{
+
+}
+
+firelink::ConnectionPool::~ConnectionPool()
+{
+  clear();
+}
+
+std::expected<std::shared_ptr<firelink::ConnectionPool>, firelink::ErrorCode>
+firelink::ConnectionPool::create(std::shared_ptr<IOCore> io_core, const ConnectionPoolConfig& config)
+{
+  if (!io_core || config.max_per_host_ == 0)
+    return std::unexpected(ErrorCode::InvalidArgument);
+
+  std::shared_ptr<ConnectionPool> pool(new ConnectionPool(io_core, config));
+  pool->schedule_sweep();
+  return pool;
+}
+
+/*
+ * Hands a connected socket for dst to the handler. The handler is always called from the user threadpool.
+ */
+firelink::ErrorCode firelink::ConnectionPool::async_acquire(const Endpoint& dst, AcquireHandler handler)
+{
+  if (!bool(handler) || dst.family() == AddressFamily::Unspecified)
+    return ErrorCode::InvalidArgument;
+
+  for (;;)
+  {
+    std::shared_ptr<Socket> candidate{};
+    std::vector<std::shared_ptr<Socket>> to_close{};
+    bool must_connect = false;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      HostState& host = hosts_[dst];
+      evict_expired(host, to_close);
+
+      if (!host.idle_.empty())
+      {
+        // Most recently used first, it is the least likely to have been closed by the peer
+        candidate = std::move(host.idle_.back().socket_);
+        host.idle_.pop_back();
+        in_use_[candidate.get()] = dst;
+      }
+      else if (host.open_ < conf_.max_per_host_)
+      {
+        host.open_++;
+        must_connect = true;
+      }
+      else
+      {
+        host.waiters_.push_back(std::move(handler));
+        stats_.waiting_++;
+      }
+    }
+
+    for (std::shared_ptr<Socket>& sock : to_close)
+      sock->close();
+
+    if (must_connect)
+    {
+      ErrorCode err = connect_new(dst, std::move(handler));
+      if (err != ErrorCode::Success)
+        on_connection_closed(dst);
+
+      return err;
+    }
+
+    // Queued until a connection to dst is released
+    if (!candidate)
+      return ErrorCode::Success;
+
+    if (!conf_.check_health_on_acquire_ || candidate->check_connection() == ErrorCode::Success)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.reuses_++;
+      }
+
+      deliver(std::move(candidate), std::move(handler));
+      return ErrorCode::Success;
+    }
+
+    // The peer has closed the idle connection, drop it and try again
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      in_use_.erase(candidate.get());
+      HostState& host = hosts_[dst];
+      host.open_--;
+      prune_host(dst, host);
+      stats_.health_check_failures_++;
+    }
+
+    candidate->close();
+  }
+}
+
+void firelink::ConnectionPool::release(std::shared_ptr<Socket> socket, bool reusable)
+{
+  if (!socket)
+    return;
+
+  Endpoint dst{};
+  AcquireHandler waiter{};
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = in_use_.find(socket.get());
+    if (it == in_use_.end())
+      return;
+
+    dst = it->second;
+    in_use_.erase(it);
+
+    HostState& host = hosts_[dst];
+    if (reusable && socket->is_valid())
+    {
+      if (!host.waiters_.empty())
+      {
+        // Hand the connection straight to the next waiter
+        waiter = std::move(host.waiters_.front());
+        host.waiters_.pop_front();
+        stats_.waiting_--;
+        stats_.reuses_++;
+        in_use_[socket.get()] = dst;
+      }
+      else if (host.idle_.size() < conf_.max_idle_per_host_)
+      {
+        host.idle_.push_back(IdleConnection{std::move(socket), std::chrono::steady_clock::now()});
+        return;
+      }
+    }
+  }
+
+  if (bool(waiter))
+  {
+    deliver(std::move(socket), std::move(waiter));
+    return;
+  }
+
+  socket->close();
+  on_connection_closed(dst);
+}
+
+void firelink::ConnectionPool::clear()
+{
+  std::vector<std::shared_ptr<Socket>> to_close{};
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Endpoint> unused{};
+    hosts_.for_each([&to_close, &unused](const Endpoint& dst, HostState& host)
+    {
+      for (IdleConnection& idle : host.idle_)
+        to_close.push_back(std::move(idle.socket_));
+
+      host.open_ -= static_cast<std::uint32_t>(host.idle_.size());
+      host.idle_.clear();
+
+      if (host.open_ == 0 && host.waiters_.empty())
+        unused.push_back(dst);
+    });
+
+    for (const Endpoint& dst : unused)
+      hosts_.erase(dst);
+  }
+
+  for (std::shared_ptr<Socket>& sock : to_close)
+    sock->close();
+}
+
+firelink::ConnectionPoolStats firelink::ConnectionPool::stats() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  ConnectionPoolStats result = stats_;
+  result.idle_ = 0;
+  hosts_.for_each([&result](const Endpoint&, const HostState& host)
+  {
+    result.idle_ += static_cast<std::uint32_t>(host.idle_.size());
+  });
+
+  result.in_use_ = static_cast<std::uint32_t>(in_use_.size());
+  return result;
+}
+
+/*
+ * Opens a new connection. The caller has already counted it in HostState::open_. If this fails right away the
+ * handler is not called and the caller gives the slot back with on_connection_closed.
+ */
+firelink::ErrorCode firelink::ConnectionPool::connect_new(const Endpoint& dst, AcquireHandler handler)
+{
+  std::shared_ptr<IOCore> io_core = io_core_.lock();
+  if (!io_core)
+    return ErrorCode::SystemError;
+
+  auto sock = Socket::create(io_core);
+  if (!sock.has_value())
+    return sock.error();
+
+  ErrorCode err = sock.value()->socket(dst.family(), SocketType::Stream, Protocol::Tcp);
+  if (err != ErrorCode::Success)
+    return err;
+
+  std::weak_ptr<ConnectionPool> weak_self = weak_from_this();
+  err = sock.value()->start_connect(dst, [weak_self, dst, handler](std::shared_ptr<Socket> caller,
+                                                                   ErrorCode error, ConnectTag)
+  {
+    std::shared_ptr<ConnectionPool> self = weak_self.lock();
+    if (!self)
+    {
+      caller->close();
+      handler(nullptr, ErrorCode::SystemError, AcquireTag{});
+      return;
+    }
+
+    if (error != ErrorCode::Success)
+    {
+      {
+        std::lock_guard<std::mutex> lock(self->mutex_);
+        self->stats_.connect_failures_++;
+      }
+
+      caller->close();
+      self->on_connection_closed(dst);
+      handler(nullptr, error, AcquireTag{});
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(self->mutex_);
+      self->stats_.connects_++;
+      self->in_use_[caller.get()] = dst;
+    }
+
+    handler(std::move(caller), ErrorCode::Success, AcquireTag{});
+  });
+
+  if (err != ErrorCode::Success)
+    sock.value()->close();
+
+  return err;
+}
+
+/*
+ * A connection to dst is gone. If requests are waiting for the host, its slot is used to connect for the first one.
+ * A connect that fails right away fails that waiter and the slot goes to the next, without nesting a call per
+ * waiter.
+ */
+void firelink::ConnectionPool::on_connection_closed(const Endpoint& dst)
+{
+  for (;;)
+  {
+    AcquireHandler waiter{};
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      HostState& host = hosts_[dst];
+      host.open_--;
+
+      if (host.waiters_.empty())
+      {
+        prune_host(dst, host);
+        return;
+      }
+
+      waiter = std::move(host.waiters_.front());
+      host.waiters_.pop_front();
+      stats_.waiting_--;
+      host.open_++;
+    }
+
+    AcquireHandler waiter_copy = waiter;
+    ErrorCode err = connect_new(dst, std::move(waiter));
+    if (err == ErrorCode::Success)
+      return;
+
+    deliver(nullptr, std::move(waiter_copy), err);
+  }
+}
+
+void firelink::ConnectionPool::deliver(std::shared_ptr<Socket> socket, AcquireHandler handler, ErrorCode error)
+{
+  if (std::shared_ptr<IOCore> io_core = io_core_.lock())
+  {
+    ErrorCode err = io_core->post_user_work([socket, handler, error]()
+    {
+      handler(socket, error, AcquireTag{});
+    });
+
+    if (err == ErrorCode::Success)
+      return;
+  }
+
+  // Failed to post user work. Call handler manually.
+  handler(std::move(socket), error, AcquireTag{});
+}
+
+/*
+ * Drops the state of a destination that has no connections and no waiters left, so contacting many hosts over
+ * time does not grow the map. Called with mutex_ held, host must not be used afterwards.
+ */
+void firelink::ConnectionPool::prune_host(const Endpoint& dst, const HostState& host)
+{
+  if (host.open_ == 0 && host.idle_.empty() && host.waiters_.empty())
+    hosts_.erase(dst);
+}
+
+/*
+ * Moves idle connections that have been idle for longer than max_idle_time_ms_ into to_close. Called with mutex_ held.
+ */
+void firelink::ConnectionPool::evict_expired(HostState& host, std::vector<std::shared_ptr<Socket>>& to_close)
+{
+  if (conf_.max_idle_time_ms_ == 0)
+    return;
+
+  auto deadline = std::chrono::steady_clock::now() - std::chrono::milliseconds(conf_.max_idle_time_ms_);
+
+  // Oldest connections are at the front
+  while (!host.idle_.empty() && host.idle_.front().idle_since_ < deadline)
+  {
+    to_close.push_back(std::move(host.idle_.front().socket_));
+    host.idle_.pop_front();
+    host.open_--;
+    stats_.expired_++;
+  }
+}
+
+/*
+ * Sweeps the pool every max_idle_time_ms_ for as long as it exists, so idle connections to destinations that
+ * are not acquired again are closed too.
+ */
+void firelink::ConnectionPool::schedule_sweep()
+{
+  if (conf_.max_idle_time_ms_ == 0)
+    return;
+
+  std::shared_ptr<IOCore> io_core = io_core_.lock();
+  if (!io_core)
+    return;
+
+  std::weak_ptr<ConnectionPool> weak_self = weak_from_this();
+  io_core->post_user_work_after(conf_.max_idle_time_ms_, [weak_self]()
+  {
+    if (std::shared_ptr<ConnectionPool> self = weak_self.lock())
+      self->sweep();
+  });
+}
+
+// Closes the expired idle connections of every destination and drops the destinations left unused
+void firelink::ConnectionPool::sweep()
+{
+  std::vector<std::shared_ptr<Socket>> to_close{};
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Endpoint> unused{};
+    hosts_.for_each([this, &to_close, &unused](const Endpoint& dst, HostState& host)
+    {
+      evict_expired(host, to_close);
+
+      if (host.open_ == 0 && host.idle_.empty() && host.waiters_.empty())
+        unused.push_back(dst);
+    });
+
+    for (const Endpoint& dst : unused)
+      hosts_.erase(dst);
+  }
+
+  for (std::shared_ptr<Socket>& sock : to_close)
+    sock->close();
+
+  schedule_sweep();
+}
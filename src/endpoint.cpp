@@ -1,35 +1,506 @@
 #include "firelink/endpoint.hpp"
-#include <in6addr.h>
-#include <ws2ipdef.h>
 
-#ifdef _WIN32
-#include <WinSock2.h>
-#include <WS2tcpip.h>
-#elif defined(__linux__)
-#include <arpa/inet.h>
-#endif
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+  // Hex digit value of every character, -1 for non-hex characters
+  constexpr std::array<std::int8_t, 256> make_hex_table()
+  {
+    std::array<std::int8_t, 256> table{};
+    for (std::size_t i = 0; i < table.size(); ++i)
+      table[i] = -1;
+
+    for (int i = 0; i < 10; ++i)
+      table[static_cast<std::size_t>('0' + i)] = static_cast<std::int8_t>(i);
+
+    for (int i = 0; i < 6; ++i)
+    {
+      table[static_cast<std::size_t>('a' + i)] = static_cast<std::int8_t>(10 + i);
+      table[static_cast<std::size_t>('A' + i)] = static_cast<std::int8_t>(10 + i);
+    }
+
+    return table;
+  }
+
+  constexpr std::array<std::int8_t, 256> HEX_VALUE = make_hex_table();
+  constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+  inline int hex_value(char c)
+  {
+    return HEX_VALUE[static_cast<unsigned char>(c)];
+  }
+
+  inline bool is_digit(char c)
+  {
+    return static_cast<unsigned char>(c - '0') < 10;
+  }
+
+  // Writes 0-65535 in decimal without leading zeros
+  inline char* write_decimal(char* out, std::uint32_t value)
+  {
+    char digits[5];
+    int n = 0;
+    do
+    {
+      digits[n++] = static_cast<char>('0' + value % 10);
+      value /= 10;
+    } while (value != 0);
+
+    while (n > 0)
+      *out++ = digits[--n];
+
+    return out;
+  }
+
+  inline char* write_dotted(char* out, const std::uint8_t* bytes)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      if (i != 0)
+        *out++ = '.';
+      out = write_decimal(out, bytes[i]);
+    }
+
+    return out;
+  }
+
+  // Writes a 16 bit group in lowercase hex without leading zeros
+  inline char* write_hex_group(char* out, std::uint32_t group)
+  {
+    bool started = false;
+    for (int shift = 12; shift >= 0; shift -= 4)
+    {
+      std::uint32_t nibble = (group >> shift) & 0xF;
+      if (nibble != 0 || started || shift == 0)
+      {
+        *out++ = HEX_DIGITS[nibble];
+        started = true;
+      }
+    }
+
+    return out;
+  }
+
+  // RFC 5952: the longest run of two or more zero groups is shortened to "::", the first one on a tie.
+  // IPv4-mapped addresses keep their IPv4 part in dotted form.
+  char* write_ipv6(char* out, const std::array<std::uint8_t, 16>& bytes)
+  {
+    static constexpr std::uint8_t MAPPED_PREFIX[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF};
+    if (std::memcmp(bytes.data(), MAPPED_PREFIX, sizeof(MAPPED_PREFIX)) == 0)
+    {
+      std::memcpy(out, "::ffff:", 7);
+      return write_dotted(out + 7, bytes.data() + 12);
+    }
+
+    std::uint32_t groups[8];
+    for (int i = 0; i < 8; ++i)
+      groups[i] = (static_cast<std::uint32_t>(bytes[2 * i]) << 8) | bytes[2 * i + 1];
+
+    int best_start = -1;
+    int best_len = 1;
+    for (int i = 0; i < 8;)
+    {
+      if (groups[i] != 0)
+      {
+        ++i;
+        continue;
+      }
+
+      int run_start = i;
+      while (i < 8 && groups[i] == 0)
+        ++i;
+
+      if (i - run_start > best_len)
+      {
+        best_start = run_start;
+        best_len = i - run_start;
+      }
+    }
+
+    for (int i = 0; i < 8; ++i)
+    {
+      if (i == best_start)
+      {
+        *out++ = ':';
+        *out++ = ':';
+        i += best_len - 1;
+        continue;
+      }
+
+      if (i != 0 && i != best_start + best_len)
+        *out++ = ':';
+
+      out = write_hex_group(out, groups[i]);
+    }
+
+    return out;
+  }
+
+  inline std::to_chars_result copy_out(char* first, char* last, const char* buf, const char* buf_end)
+  {
+    std::size_t len = static_cast<std::size_t>(buf_end - buf);
+    if (static_cast<std::size_t>(last - first) < len)
+      return {last, std::errc::value_too_large};
+
+    std::memcpy(first, buf, len);
+    return {first + len, std::errc{}};
+  }
+
+  // Parses a dotted quad into 4 bytes. Octets have 1-3 digits, no leading zeros and a value up to 255.
+  const char* parse_dotted(const char* p, const char* last, std::uint8_t* out)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      if (i != 0)
+      {
+        if (p == last || *p != '.')
+          return nullptr;
+        ++p;
+      }
+
+      if (p == last || !is_digit(*p))
+        return nullptr;
+
+      std::uint32_t value = static_cast<std::uint32_t>(*p++ - '0');
+      if (value != 0)
+      {
+        for (int d = 0; d < 2 && p != last && is_digit(*p); ++d)
+          value = value * 10 + static_cast<std::uint32_t>(*p++ - '0');
+      }
+
+      if (value > 255 || (p != last && is_digit(*p)))
+        return nullptr;
+
+      out[i] = static_cast<std::uint8_t>(value);
+    }
+
+    return p;
+  }
+
+  // Parses an IPv6 address without brackets into 16 bytes
+  const char* parse_ipv6(const char* p, const char* last, std::array<std::uint8_t, 16>& out)
+  {
+    std::uint32_t groups[8]{};
+    int n = 0;
+    int compress_at = -1;
+    bool need_group = false;
+
+    if (last - p >= 2 && p[0] == ':' && p[1] == ':')
+    {
+      compress_at = 0;
+      p += 2;
+    }
+    else if (p != last && *p == ':')
+    {
+      return nullptr;
+    }
+
+    while (n < 8)
+    {
+      const char* group_start = p;
+      std::uint32_t value = 0;
+      int digits = 0;
+      while (p != last && digits < 4 && hex_value(*p) >= 0)
+      {
+        value = (value << 4) | static_cast<std::uint32_t>(hex_value(*p++));
+        ++digits;
+      }
+
+      if (digits == 0)
+      {
+        if (need_group)
+          return nullptr;
+        break;
+      }
+
+      // Trailing IPv4 part, it takes the last two groups
+      if (p != last && *p == '.')
+      {
+        if (n > 6)
+          return nullptr;
+
+        std::uint8_t v4[4];
+        p = parse_dotted(group_start, last, v4);
+        if (p == nullptr)
+          return nullptr;
+
+        groups[n++] = (static_cast<std::uint32_t>(v4[0]) << 8) | v4[1];
+        groups[n++] = (static_cast<std::uint32_t>(v4[2]) << 8) | v4[3];
+        need_group = false;
+        break;
+      }
+
+      if (p != last && hex_value(*p) >= 0)
+        return nullptr;
+
+      groups[n++] = value;
+      need_group = false;
+
+      if (p == last || *p != ':' || n == 8)
+        break;
+
+      if (last - p >= 2 && p[1] == ':')
+      {
+        if (compress_at >= 0)
+          return nullptr;
+
+        compress_at = n;
+        p += 2;
+      }
+      else
+      {
+        ++p;
+        need_group = true;
+      }
+    }
+
+    if (need_group)
+      return nullptr;
+
+    if (compress_at < 0)
+    {
+      if (n != 8)
+        return nullptr;
+    }
+    else
+    {
+      // "::" stands for at least one zero group
+      if (n == 8)
+        return nullptr;
+
+      int tail = n - compress_at;
+      for (int i = 0; i < tail; ++i)
+        groups[7 - i] = groups[n - 1 - i];
+      for (int i = compress_at; i < 8 - tail; ++i)
+        groups[i] = 0;
+    }
+
+    for (int i = 0; i < 8; ++i)
+    {
+      out[2 * i] = static_cast<std::uint8_t>(groups[i] >> 8);
+      out[2 * i + 1] = static_cast<std::uint8_t>(groups[i] & 0xFF);
+    }
+
+    return p;
+  }
+
+  // Parses ":port" if present
+  std::from_chars_result parse_port(const char* p, const char* last, std::uint16_t& port)
+  {
+    port = 0;
+    if (p == last || *p != ':')
+      return {p, std::errc{}};
+
+    ++p;
+    if (p == last || !is_digit(*p))
+      return {p, std::errc::invalid_argument};
+
+    std::uint32_t value = 0;
+    int digits = 0;
+    while (p != last && is_digit(*p))
+    {
+      if (++digits > 5)
+        return {p, std::errc::result_out_of_range};
+
+      value = value * 10 + static_cast<std::uint32_t>(*p++ - '0');
+    }
+
+    if (value > 0xFFFF)
+      return {p, std::errc::result_out_of_range};
+
+    port = static_cast<std::uint16_t>(value);
+    return {p, std::errc{}};
+  }
+
+  template<typename Address>
+  std::size_t parse_batch(std::span<const std::string_view> input, std::span<Address> out, std::span<std::errc> errors)
+  {
+    if (out.size() < input.size() || errors.size() < input.size())
+      return input.size();
+
+    std::size_t failed = 0;
+    for (std::size_t i = 0; i < input.size(); ++i)
+    {
+      const char* first = input[i].data();
+      const char* last = first + input[i].size();
+
+      std::from_chars_result res = firelink::from_chars(first, last, out[i]);
+      if (res.ec == std::errc{} && res.ptr != last)
+        res.ec = std::errc::invalid_argument;
+
+      errors[i] = res.ec;
+      if (res.ec != std::errc{})
+        ++failed;
+    }
+
+    return failed;
+  }
+
+  inline firelink::ErrorCode to_error_code(std::errc ec)
+  {
+    return ec == std::errc{} ? firelink::ErrorCode::Success : firelink::ErrorCode::InvalidArgument;
+  }
+}
+
+std::to_chars_result firelink::to_chars(char* first, char* last, const IPv4Address& addr)
+{
+  char buf[IPV4_ENDPOINT_MAX_CHARS];
+  char* out = write_dotted(buf, addr.bytes.data());
+  *out++ = ':';
+  out = write_decimal(out, addr.port);
+
+  return copy_out(first, last, buf, out);
+}
+
+std::to_chars_result firelink::to_chars(char* first, char* last, const IPv6Address& addr)
+{
+  char buf[IPV6_ENDPOINT_MAX_CHARS];
+  char* out = buf;
+  *out++ = '[';
+  out = write_ipv6(out, addr.bytes);
+  *out++ = ']';
+  *out++ = ':';
+  out = write_decimal(out, addr.port);
+
+  return copy_out(first, last, buf, out);
+}
+
+std::to_chars_result firelink::to_chars(char* first, char* last, AddressFamily family, const Endpoint& endpoint)
+{
+  if (family == AddressFamily::IPv4)
+    return to_chars(first, last, endpoint.ipv4());
+  else if (family == AddressFamily::IPv6)
+    return to_chars(first, last, endpoint.ipv6());
+
+  return {first, std::errc::invalid_argument};
+}
+
+std::to_chars_result firelink::to_chars(char* first, char* last, const Endpoint& endpoint)
+{
+  return to_chars(first, last, endpoint.family(), endpoint);
+}
+
+std::from_chars_result firelink::from_chars(const char* first, const char* last, IPv4Address& out)
+{
+  IPv4Address result{};
+  const char* p = parse_dotted(first, last, result.bytes.data());
+  if (p == nullptr)
+    return {first, std::errc::invalid_argument};
+
+  std::from_chars_result port_res = parse_port(p, last, result.port);
+  if (port_res.ec != std::errc{})
+    return {first, port_res.ec};
+
+  out = result;
+  return port_res;
+}
+
+std::from_chars_result firelink::from_chars(const char* first, const char* last, IPv6Address& out)
+{
+  IPv6Address result{};
+  const char* p = first;
+
+  bool bracketed = p != last && *p == '[';
+  if (bracketed)
+    ++p;
+
+  p = parse_ipv6(p, last, result.bytes);
+  if (p == nullptr)
+    return {first, std::errc::invalid_argument};
+
+  // A port is only allowed after a bracketed address, "1::2:80" would be ambiguous
+  if (bracketed)
+  {
+    if (p == last || *p != ']')
+      return {first, std::errc::invalid_argument};
+
+    std::from_chars_result port_res = parse_port(p + 1, last, result.port);
+    if (port_res.ec != std::errc{})
+      return {first, port_res.ec};
+
+    p = port_res.ptr;
+  }
+
+  out = result;
+  return {p, std::errc{}};
+}
+
+std::from_chars_result firelink::from_chars(const char* first, const char* last, AddressFamily family, Endpoint& out)
+{
+  if (family == AddressFamily::IPv4)
+  {
+    IPv4Address addr{};
+    std::from_chars_result res = from_chars(first, last, addr);
+    if (res.ec == std::errc{})
+      out = Endpoint(addr);
+
+    return res;
+  }
+  else if (family == AddressFamily::IPv6)
+  {
+    IPv6Address addr{};
+    std::from_chars_result res = from_chars(first, last, addr);
+    if (res.ec == std::errc{})
+      out = Endpoint(addr);
+
+    return res;
+  }
+
+  return {first, std::errc::invalid_argument};
+}
+
+std::from_chars_result firelink::from_chars(const char* first, const char* last, Endpoint& out)
+{
+  AddressFamily family = AddressFamily::IPv4;
+  if (first != last && *first == '[')
+  {
+    family = AddressFamily::IPv6;
+  }
+  else
+  {
+    for (const char* p = first; p != last && *p != '.'; ++p)
+    {
+      if (*p == ':')
+      {
+        family = AddressFamily::IPv6;
+        break;
+      }
+    }
+  }
+
+  return from_chars(first, last, family, out);
+}
+
+std::size_t firelink::from_chars_batch(std::span<const std::string_view> input, std::span<IPv4Address> out,
+                                       std::span<std::errc> errors)
+{
+  return parse_batch(input, out, errors);
+}
+
+std::size_t firelink::from_chars_batch(std::span<const std::string_view> input, std::span<IPv6Address> out,
+                                       std::span<std::errc> errors)
+{
+  return parse_batch(input, out, errors);
+}
 
-                                                   
 std::string firelink::inet_ntop(const IPv4Address& addr)
 {
-  // Convert into a string
-  char buf[INET_ADDRSTRLEN]{};
-  
-  if(::inet_ntop(AF_INET, addr.bytes.data(), buf, INET_ADDRSTRLEN) == nullptr)
-    return {};
-  
-  return std::string(buf) + ":" + std::to_string(addr.port);
+  char buf[IPV4_ENDPOINT_MAX_CHARS];
+  std::to_chars_result res = to_chars(buf, buf + sizeof(buf), addr);
+
+  return std::string(buf, res.ptr);
 }
-  
+
 std::string firelink::inet_ntop(const IPv6Address& addr)
-{ 
-  char buf[INET6_ADDRSTRLEN]{};
-  if (::inet_ntop(AF_INET6, addr.bytes.data(), buf, INET6_ADDRSTRLEN) == nullptr)
-    return {};
-    
-  return "[" + std::string(buf) + "]" + ":" + std::to_string(addr.port);
+{
+  char buf[IPV6_ENDPOINT_MAX_CHARS];
+  std::to_chars_result res = to_chars(buf, buf + sizeof(buf), addr);
+
+  return std::string(buf, res.ptr);
 }
-  
+
 std::string firelink::inet_ntop(AddressFamily family, const Endpoint& endpoint)
 {
   if(family == AddressFamily::IPv4)
@@ -40,69 +511,40 @@ std::string firelink::inet_ntop(AddressFamily family, const Endpoint& endpoint)
     return {};
 }
 
+std::string firelink::inet_ntop(const Endpoint& endpoint)
+{
+  return firelink::inet_ntop(endpoint.family(), endpoint);
+}
+
+/*
+ * The whole string must be an address, optionally with a port.
+ */
 firelink::ErrorCode firelink::inet_pton(std::string_view str, IPv4Address& out)
 {
-  std::string trimmed_addr{};
-  std::string trimmed_port{};
-  
-  size_t pos = str.rfind(':');
-  if (pos != std::string_view::npos && pos > str.find_last_of('.'))
-  {    
-    trimmed_addr = std::string(str.substr(0, pos));
-    trimmed_port = std::string(str.substr(pos + 1));
-    
-    out.port = static_cast<std::uint16_t>(std::stoi(trimmed_port, &pos));
-    // TODO check stoi errors?
-  }
-  else
-  { 
-    trimmed_addr = std::string(str);
-  }
+  IPv4Address addr{};
+  std::from_chars_result res = from_chars(str.data(), str.data() + str.size(), addr);
+  if (res.ec == std::errc{} && res.ptr != str.data() + str.size())
+    res.ec = std::errc::invalid_argument;
 
-  int res = ::inet_pton(AF_INET, trimmed_addr.data(), out.bytes.data());
-  if(res != 1)
-  {
-    return ErrorCode::SystemError;
-  }
+  if (res.ec == std::errc{})
+    out = addr;
 
-  return ErrorCode::Success;
+  return to_error_code(res.ec);
 }
-  
+
 firelink::ErrorCode firelink::inet_pton(std::string_view str, IPv6Address& out)
 {
-  std::string trimmed_addr{};
-  std::string trimmed_port{};
-  
-  size_t pos = str.rfind(':');
-  if (pos != std::string_view::npos && pos > str.rfind(']'))
-  {    
-    // trim port from string
-    trimmed_addr = std::string(str.substr(0, pos));
-    trimmed_port = std::string(str.substr(pos + 1));
-
-    // trim brackets from around addr ("[addr]")
-    trimmed_addr.erase(0, 1);
-    trimmed_addr.pop_back();
-    
-    out.port = static_cast<std::uint16_t>(std::stoi(trimmed_port, &pos));
-    // TODO check stoi errors?
-  }
-  else
-  { 
-    trimmed_addr = std::string(str);
-  }
-  
-  sockaddr_in6 addr{};
-  int res = ::inet_pton(AF_INET6, trimmed_addr.data(), &addr.sin6_addr);
-  if(res != 1)
-  {
-    return ErrorCode::SystemError;
-  }
+  IPv6Address addr{};
+  std::from_chars_result res = from_chars(str.data(), str.data() + str.size(), addr);
+  if (res.ec == std::errc{} && res.ptr != str.data() + str.size())
+    res.ec = std::errc::invalid_argument;
+
+  if (res.ec == std::errc{})
+    out = addr;
 
-  std::memcpy(out.bytes.data(), &addr.sin6_addr, 16);
-  return ErrorCode::Success;    
+  return to_error_code(res.ec);
 }
-  
+
 firelink::ErrorCode firelink::inet_pton(AddressFamily family, std::string_view str, Endpoint& out)
 {
   ErrorCode result = ErrorCode::Success;
@@ -115,7 +557,7 @@ firelink::ErrorCode firelink::inet_pton(AddressFamily family, std::string_view s
 
     return result;
   }
-    
+
   else if(family == AddressFamily::IPv6)
   {
     firelink::IPv6Address addr{};
@@ -128,3 +570,16 @@ firelink::ErrorCode firelink::inet_pton(AddressFamily family, std::string_view s
 
   return ErrorCode::AddressFamilyNotSupported;
 }
+
+firelink::ErrorCode firelink::inet_pton(std::string_view str, Endpoint& out)
+{
+  Endpoint endpoint{};
+  std::from_chars_result res = from_chars(str.data(), str.data() + str.size(), endpoint);
+  if (res.ec == std::errc{} && res.ptr != str.data() + str.size())
+    res.ec = std::errc::invalid_argument;
+
+  if (res.ec == std::errc{})
+    out = endpoint;
+
+  return to_error_code(res.ec);
+}
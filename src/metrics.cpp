@@ -0,0 +1,219 @@
+#include "firelink/metrics.hpp"
+
+#include <algorithm>
+
+// Latency histograms cost three clock reads per operation and about 110 KB per recording thread. Define as 1
+// when building firelink to record them. Code using the library does not need to agree on it.
+#ifndef FIRELINK_ENABLE_LATENCY_HISTOGRAMS
+#define FIRELINK_ENABLE_LATENCY_HISTOGRAMS 0
+#endif
+
+// Registries a thread keeps its slot cached for. Slots of older registries are looked up again on their next use.
+static constexpr std::size_t FIRELINK_METRICS_CACHED_REGISTRIES = 16;
+
+namespace
+{
+  std::atomic<std::uint64_t> next_registry_id{1};
+
+  struct CachedSlot
+  {
+    std::uint64_t registry_id_;
+    void* slot_;
+  };
+
+  // The slot of the registry this thread recorded into last, and the ones before it
+  thread_local CachedSlot last_slot{0, nullptr};
+  thread_local std::vector<CachedSlot> cached_slots{};
+}
+
+firelink::MetricsRegistry::MetricsRegistry() :
+  id_(next_registry_id.fetch_add(1, std::memory_order_relaxed)),
+  latency_enabled_(FIRELINK_ENABLE_LATENCY_HISTOGRAMS != 0)
+{
+
+}
+
+firelink::MetricsRegistry::ThreadMetrics& firelink::MetricsRegistry::local()
+{
+  if (last_slot.registry_id_ == id_)
+    return *static_cast<ThreadMetrics*>(last_slot.slot_);
+
+  return register_thread();
+}
+
+/*
+ * Slow path of local(): finds the slot of this thread in its cache, then among the registry's slots, and
+ * allocates a new one only if the thread has none yet. Each thread has at most one slot per registry, however
+ * many registries it records into.
+ */
+firelink::MetricsRegistry::ThreadMetrics& firelink::MetricsRegistry::register_thread()
+{
+  auto it = std::find_if(cached_slots.begin(), cached_slots.end(), [this](const CachedSlot& cached)
+  {
+    return cached.registry_id_ == id_;
+  });
+
+  if (it != cached_slots.end())
+  {
+    last_slot = *it;
+    return *static_cast<ThreadMetrics*>(last_slot.slot_);
+  }
+
+  ThreadMetrics* slot = nullptr;
+  std::thread::id self = std::this_thread::get_id();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // A thread that outgrew its cache comes back to a registry it was evicted from
+    auto owned = std::find_if(slots_.begin(), slots_.end(), [self](const std::unique_ptr<ThreadMetrics>& existing)
+    {
+      return existing->owner_ == self;
+    });
+
+    if (owned != slots_.end())
+    {
+      slot = owned->get();
+    }
+    else
+    {
+      slots_.push_back(std::make_unique<ThreadMetrics>());
+      slot = slots_.back().get();
+      slot->owner_ = self;
+      if (latency_enabled_)
+        slot->latencies_ = std::make_unique<LatencyCounters>();
+    }
+  }
+
+  if (cached_slots.size() == FIRELINK_METRICS_CACHED_REGISTRIES)
+    cached_slots.erase(cached_slots.begin());
+
+  last_slot = CachedSlot{id_, slot};
+  cached_slots.push_back(last_slot);
+  return *slot;
+}
+
+void firelink::MetricsRegistry::count_error(ThreadMetrics& m, ErrorCode error)
+{
+  std::size_t used = m.error_slots_used_.load(std::memory_order_relaxed);
+  for (std::size_t i = 0; i < used; ++i)
+  {
+    if (m.error_slots_[i].error_.load(std::memory_order_relaxed) == static_cast<int>(error))
+    {
+      bump(m.error_slots_[i].count_, 1);
+      return;
+    }
+  }
+
+  if (used == m.error_slots_.size())
+  {
+    bump(m.other_errors_, 1);
+    return;
+  }
+
+  m.error_slots_[used].error_.store(static_cast<int>(error), std::memory_order_relaxed);
+  m.error_slots_[used].count_.store(1, std::memory_order_relaxed);
+  m.error_slots_used_.store(used + 1, std::memory_order_release);
+}
+
+/*
+ * Sums the slots of all threads. Counters are read one at a time while threads keep recording, so the
+ * snapshot is not a single point in time; derived values are clamped instead of going negative.
+ */
+firelink::IOCoreStats firelink::MetricsRegistry::snapshot() const
+{
+  IOCoreStats stats{};
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const std::unique_ptr<ThreadMetrics>& slot : slots_)
+  {
+    for (std::size_t op = 0; op < OPERATION_COUNT; ++op)
+    {
+      stats.operations_[op].started_ += slot->operations_[op].started_.load(std::memory_order_relaxed);
+      stats.operations_[op].completed_ += slot->operations_[op].completed_.load(std::memory_order_relaxed);
+      stats.operations_[op].failed_ += slot->operations_[op].failed_.load(std::memory_order_relaxed);
+    }
+
+    stats.bytes_sent_ += slot->bytes_sent_.load(std::memory_order_relaxed);
+    stats.bytes_received_ += slot->bytes_received_.load(std::memory_order_relaxed);
+    stats.user_work_posted_ += slot->user_work_posted_.load(std::memory_order_relaxed);
+    stats.user_work_started_ += slot->user_work_started_.load(std::memory_order_relaxed);
+    stats.other_errors_ += slot->other_errors_.load(std::memory_order_relaxed);
+
+    std::size_t used = slot->error_slots_used_.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < used; ++i)
+    {
+      ErrorCode error = static_cast<ErrorCode>(slot->error_slots_[i].error_.load(std::memory_order_relaxed));
+      std::uint64_t count = slot->error_slots_[i].count_.load(std::memory_order_relaxed);
+
+      auto it = std::find_if(stats.errors_.begin(), stats.errors_.end(), [error](const ErrorCount& entry)
+      {
+        return entry.error_ == error;
+      });
+
+      if (it != stats.errors_.end())
+        it->count_ += count;
+      else
+        stats.errors_.push_back(ErrorCount{error, count});
+    }
+  }
+
+  std::uint64_t started = 0;
+  std::uint64_t completed = 0;
+  for (const OperationStats& op : stats.operations_)
+  {
+    started += op.started_;
+    completed += op.completed_;
+  }
+
+  stats.outstanding_operations_ = started > completed ? started - completed : 0;
+  stats.user_queue_depth_ = stats.user_work_posted_ > stats.user_work_started_
+                            ? stats.user_work_posted_ - stats.user_work_started_ : 0;
+
+  std::sort(stats.errors_.begin(), stats.errors_.end(), [](const ErrorCount& a, const ErrorCount& b)
+  {
+    return a.count_ > b.count_;
+  });
+
+  return stats;
+}
+
+/*
+ * Merges the latency counters of all threads. Like snapshot() this reads while threads keep recording.
+ */
+firelink::LatencyStats firelink::MetricsRegistry::latency_snapshot() const
+{
+  LatencyStats stats{};
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const std::unique_ptr<ThreadMetrics>& slot : slots_)
+  {
+    if (!slot->latencies_)
+      continue;
+
+    for (std::size_t op = 0; op < OPERATION_COUNT; ++op)
+    {
+      for (std::size_t stage = 0; stage < LATENCY_STAGE_COUNT; ++stage)
+      {
+        const HistogramCounters& counters = slot->latencies_->counters_[op][stage];
+        LatencyHistogram& histogram = stats.histograms_[op][stage];
+
+        std::uint64_t count = 0;
+        for (std::size_t i = 0; i < LATENCY_BUCKET_COUNT; ++i)
+        {
+          std::uint64_t n = counters.buckets_[i].load(std::memory_order_relaxed);
+          histogram.add_bucket(i, n);
+          count += n;
+        }
+
+        if (count != 0)
+        {
+          histogram.add_summary(counters.sum_.load(std::memory_order_relaxed), counters.min_.load(std::memory_order_relaxed),
+                                counters.max_.load(std::memory_order_relaxed));
+        }
+      }
+    }
+  }
+
+  return stats;
+}
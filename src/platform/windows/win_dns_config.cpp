@@ -0,0 +1,44 @@
+#include "firelink/platform/windows/win_dns_config.hpp"
+
+#include <WinSock2.h>
+#include <iphlpapi.h>
+#include <cstring>
+#include <memory>
+
+/*
+ * Reads the DNS server list with GetNetworkParams. The list only has IPv4 servers, servers that do not parse
+ * are skipped.
+ */
+firelink::ErrorCode firelink::platform::get_system_nameservers(std::uint16_t port, std::vector<Endpoint>& nameservers)
+{
+  ULONG buffer_size = sizeof(FIXED_INFO);
+  std::unique_ptr<std::byte[]> buffer{};
+
+  // The size of the server list is not known up front, the first call reports it
+  DWORD res = ERROR_BUFFER_OVERFLOW;
+  while (res == ERROR_BUFFER_OVERFLOW)
+  {
+    buffer = std::make_unique<std::byte[]>(buffer_size);
+    res = GetNetworkParams(reinterpret_cast<FIXED_INFO*>(buffer.get()), &buffer_size);
+  }
+
+  if (res != ERROR_SUCCESS)
+    return static_cast<ErrorCode>(res);
+
+  const FIXED_INFO* info = reinterpret_cast<const FIXED_INFO*>(buffer.get());
+  for (const IP_ADDR_STRING* server = &info->DnsServerList; server != nullptr; server = server->Next)
+  {
+    IPv4Address addr{};
+    std::size_t len = strnlen(server->IpAddress.String, sizeof(server->IpAddress.String));
+    if (firelink::inet_pton(std::string_view(server->IpAddress.String, len), addr) != ErrorCode::Success)
+      continue;
+
+    addr.port = port;
+    nameservers.push_back(addr);
+  }
+
+  if (nameservers.empty())
+    return ErrorCode::NoData;
+
+  return ErrorCode::Success;
+}
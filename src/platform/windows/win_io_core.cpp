@@ -1,12 +1,19 @@
 #include "firelink/platform/windows/win_io_core.hpp"
 #include "firelink/platform/windows/win_socket.hpp"
+#include <algorithm>
 #include <iostream>
 
 firelink::platform::WinIOCore::WinIOCore(const IOCoreConfig& config) :
   conf_(config),
-  srw_run_(SRWLOCK_INIT),
-  cv_run_(CONDITION_VARIABLE_INIT),
-  stop_requested_(0)
+  stop_requested_(0),
+  run_queue_(nullptr),
+  run_queue_depth_(0),
+  wake_event_(nullptr),
+  default_node_(0),
+  socket_recycler_(std::make_shared<SocketRecycler>(config.socket_pool_capacity_)),
+  metrics_(std::make_shared<MetricsRegistry>()),
+  numa_counters_(std::make_shared<NumaCounters>(config.numa_aware_)),
+  drain_lock_(SRWLOCK_INIT)
 {
   
 }
@@ -44,17 +51,62 @@ firelink::ErrorCode firelink::platform::WinIOCore::initialize()
     return err;
   }
 
-  err = initialize_threadpool(conf_.io_threadpool_min_threads_, conf_.io_threadpool_max_threads_,
-                              &io_rollback_, &io_threadpool_environ_, &io_cleanup_group_, &io_threadpool_);
-  
-  if (err != ErrorCode::Success)
-    return err;
+  if (run_queue_ == nullptr)
+  {
+    run_queue_ = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 0);
+    if (run_queue_ == nullptr)
+      return static_cast<ErrorCode>(static_cast<int>(GetLastError()));
+  }
 
-  err = initialize_threadpool(conf_.user_threadpool_min_threads_, conf_.user_threadpool_max_threads_,
-                              &user_rollback_, &user_threadpool_environ_, &user_cleanup_group_, &user_threadpool_);
-  
-  if (err != ErrorCode::Success)
-    return err;
+  if (wake_event_ == nullptr)
+  {
+    wake_event_ = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    if (wake_event_ == nullptr)
+      return static_cast<ErrorCode>(static_cast<int>(GetLastError()));
+  }
+
+  // Without NUMA awareness one pair of threadpools serves the machine, pinned to the configured CPU sets
+  std::uint32_t node_count = conf_.numa_aware_ ? std::min(numa_node_count(), FIRELINK_MAX_NUMA_NODES) : 1;
+  nodes_.clear();
+  nodes_.resize(node_count);
+  default_node_ = node_count;
+
+  for (std::uint32_t node = 0; node < node_count; ++node)
+  {
+    ThreadPlacement io_placement{conf_.io_cpu_set_, node};
+    ThreadPlacement user_placement{conf_.user_cpu_set_, node};
+
+    if (conf_.numa_aware_)
+    {
+      // Nodes with memory but no processors get no threadpools
+      GROUP_AFFINITY node_affinity{};
+      if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &node_affinity) || node_affinity.Mask == 0)
+        continue;
+
+      io_placement.cpu_set_ = node_cpu_set(node_affinity, conf_.io_cpu_set_);
+      user_placement.cpu_set_ = node_cpu_set(node_affinity, conf_.user_cpu_set_);
+    }
+
+    nodes_[node] = std::make_unique<NodeThreadpools>();
+    nodes_[node]->io_.placement_ = io_placement;
+    nodes_[node]->user_.placement_ = user_placement;
+    default_node_ = std::min(default_node_, node);
+
+    err = initialize_threadpool(conf_.io_threadpool_min_threads_, conf_.io_threadpool_max_threads_, nodes_[node]->io_);
+    if (err != ErrorCode::Success)
+      return err;
+
+    // Handlers run on the threads driving the event loop instead
+    if (conf_.handler_dispatch_ == HandlerDispatch::RunLoop)
+      continue;
+
+    err = initialize_threadpool(conf_.user_threadpool_min_threads_, conf_.user_threadpool_max_threads_, nodes_[node]->user_);
+    if (err != ErrorCode::Success)
+      return err;
+  }
+
+  if (default_node_ == node_count)
+    return ErrorCode::SystemError;
 
   InterlockedExchange(const_cast<LONG*>(&stop_requested_), 0);
   return ErrorCode::Success;
@@ -62,17 +114,32 @@ firelink::ErrorCode firelink::platform::WinIOCore::initialize()
 
 firelink::ErrorCode firelink::platform::WinIOCore::release()
 {
-  ErrorCode result = release_threadpool(FIRELINK_USER_THREADPOOL_CLEANUP_TIMEOUT_MS, &user_rollback_,
-                                        &user_threadpool_environ_, user_cleanup_group_, user_threadpool_);
- 
-  if (result != ErrorCode::Success)
-    return result;
+  // Idle handles hold threadpool IO objects, close them before the IO threadpool goes away
+  socket_recycler_->shutdown();
 
-  result = release_threadpool(FIRELINK_IO_THREADPOOL_CLEANUP_TIMEOUT_MS, &io_rollback_,
-                              &io_threadpool_environ_, io_cleanup_group_, io_threadpool_);
-  
-  if (result != ErrorCode::Success)
-    return result;
+  // All user threadpools go first, their handlers may still start operations on any node
+  for (std::unique_ptr<NodeThreadpools>& node : nodes_)
+  {
+    if (!node)
+      continue;
+
+    ErrorCode result = release_threadpool(FIRELINK_USER_THREADPOOL_CLEANUP_TIMEOUT_MS, node->user_);
+    if (result != ErrorCode::Success)
+      return result;
+  }
+
+  for (std::unique_ptr<NodeThreadpools>& node : nodes_)
+  {
+    if (!node)
+      continue;
+
+    ErrorCode result = release_threadpool(FIRELINK_IO_THREADPOOL_CLEANUP_TIMEOUT_MS, node->io_);
+    if (result != ErrorCode::Success)
+      return result;
+  }
+
+  // Nothing posts to the run queue anymore, drop the handlers no run call picked up
+  close_run_queue();
 
   if (WSACleanup() == SOCKET_ERROR)
     return static_cast<ErrorCode>(WSAGetLastError());
@@ -82,23 +149,25 @@ firelink::ErrorCode firelink::platform::WinIOCore::release()
 
 firelink::ErrorCode firelink::platform::WinIOCore::post_io_work(std::move_only_function<void()>&& func)
 {
-  auto* heap_func = new std::move_only_function<void()>(std::move(func));
+  Threadpool& threadpool = pools(node_for_current_thread()).io_;
+  auto* work = new PostedWork{std::move(func), nullptr, &threadpool.placement_};
 
   BOOL success = TrySubmitThreadpoolCallback(
     [](PTP_CALLBACK_INSTANCE instance, PVOID context) noexcept
     {
       UNREFERENCED_PARAMETER(instance);
-      auto* f = static_cast<std::move_only_function<void()>*>(context);
-      std::invoke(*f);
-      delete f;
+      auto* w = static_cast<PostedWork*>(context);
+      enter_threadpool_callback(w->placement_);
+      std::invoke(w->func_);
+      delete w;
       
-    }, heap_func, &io_threadpool_environ_
+    }, work, &threadpool.environ_
     );
 
   if (!success)
   {
     // Very important: clean up on failure!
-    delete heap_func;
+    delete work;
     return static_cast<ErrorCode>(GetLastError());
   }
 
@@ -107,39 +176,209 @@ firelink::ErrorCode firelink::platform::WinIOCore::post_io_work(std::move_only_f
 
 firelink::ErrorCode firelink::platform::WinIOCore::post_user_work(std::move_only_function<void()>&& func)
 {
-  auto* heap_func = new std::move_only_function<void()>(std::move(func));
+  return post_user_work_on(node_for_current_thread(), std::move(func));
+}
+
+firelink::ErrorCode firelink::platform::WinIOCore::post_user_work_on(std::uint32_t node, std::move_only_function<void()>&& func)
+{
+  if (conf_.handler_dispatch_ == HandlerDispatch::RunLoop)
+    return queue_user_work(std::move(func));
+
+  Threadpool& threadpool = pools(node).user_;
+  auto* work = new PostedWork{std::move(func), metrics_.get(), &threadpool.placement_};
 
   BOOL success = TrySubmitThreadpoolCallback(
     [](PTP_CALLBACK_INSTANCE instance, PVOID context) noexcept
     {
       UNREFERENCED_PARAMETER(instance);
-      auto* f = static_cast<std::move_only_function<void()>*>(context);
-      std::invoke(*f);
-      delete f;
+      auto* w = static_cast<PostedWork*>(context);
+      enter_threadpool_callback(w->placement_);
+      w->metrics_->user_work_started();
+      std::invoke(w->func_);
+      delete w;
       
-    }, heap_func, &user_threadpool_environ_
+    }, work, &threadpool.environ_
     );
 
   if (!success)
   {
     // Very important: clean up on failure!
-    delete heap_func;
+    delete work;
     return static_cast<ErrorCode>(GetLastError());
   }
 
+  // A user thread may already have picked the work up, snapshots clamp the queue depth for that
+  metrics_->user_work_posted();
   return ErrorCode::Success;
 }
 
-void firelink::platform::WinIOCore::run()
+firelink::ErrorCode firelink::platform::WinIOCore::post_user_work_after(std::uint32_t delay_ms,
+                                                                       std::move_only_function<void()>&& func)
 {
-  AcquireSRWLockExclusive(&srw_run_);
-  while (InterlockedCompareExchange(const_cast<LONG*>(&stop_requested_), 0, 0) == 0)
+  // Without a user threadpool the timer fires on an IO thread and only queues func for the event loop
+  if (conf_.handler_dispatch_ == HandlerDispatch::RunLoop)
   {
-    // Wait indefinitely until stop() wakes us
-    SleepConditionVariableSRW(&cv_run_, &srw_run_, INFINITE, 0);
+    func = [this, func = std::move(func)]() mutable
+    {
+      queue_user_work(std::move(func));
+    };
   }
 
-  ReleaseSRWLockExclusive(&srw_run_);
+  NodeThreadpools& node_pools = pools(node_for_current_thread());
+  return set_timer(conf_.handler_dispatch_ == HandlerDispatch::RunLoop ? node_pools.io_ : node_pools.user_, delay_ms,
+                   std::move(func));
+}
+
+// Unlike set_timer the callback leaves the timer and its work alone, so they stay valid for cancel_timer
+firelink::ErrorCode firelink::platform::WinIOCore::start_io_timer(std::uint32_t delay_ms, std::move_only_function<void()>&& func,
+                                                                  IOTimer& timer)
+{
+  Threadpool& threadpool = pools(node_for_current_thread()).io_;
+  auto* work = new PostedWork{std::move(func), nullptr, &threadpool.placement_};
+
+  PTP_TIMER tp_timer = CreateThreadpoolTimer(
+    [](PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer) noexcept
+    {
+      UNREFERENCED_PARAMETER(instance);
+      UNREFERENCED_PARAMETER(timer);
+      auto* w = static_cast<PostedWork*>(context);
+      enter_threadpool_callback(w->placement_);
+      std::invoke(w->func_);
+
+    }, work, &threadpool.environ_
+    );
+
+  if (tp_timer == nullptr)
+  {
+    delete work;
+    return static_cast<ErrorCode>(GetLastError());
+  }
+
+  arm_timer(tp_timer, delay_ms);
+  timer.timer_ = tp_timer;
+  timer.work_ = work;
+  return ErrorCode::Success;
+}
+
+void firelink::platform::WinIOCore::cancel_timer(IOTimer& timer)
+{
+  if (timer.timer_ == nullptr)
+    return;
+
+  SetThreadpoolTimer(timer.timer_, nullptr, 0, 0);
+  WaitForThreadpoolTimerCallbacks(timer.timer_, TRUE);
+  CloseThreadpoolTimer(timer.timer_);
+  delete timer.work_;
+  timer = IOTimer{};
+}
+
+// One-shot timer in the threadpool. It belongs to the threadpool's cleanup group, so release drops it if still waiting.
+firelink::ErrorCode firelink::platform::WinIOCore::set_timer(Threadpool& threadpool, std::uint32_t delay_ms,
+                                                            std::move_only_function<void()>&& func)
+{
+  auto* work = new PostedWork{std::move(func), nullptr, &threadpool.placement_};
+
+  PTP_TIMER timer = CreateThreadpoolTimer(
+    [](PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer) noexcept
+    {
+      UNREFERENCED_PARAMETER(instance);
+      auto* w = static_cast<PostedWork*>(context);
+      enter_threadpool_callback(w->placement_);
+      std::invoke(w->func_);
+      delete w;
+
+      // One-shot timer, it is freed once this callback returns
+      CloseThreadpoolTimer(timer);
+
+    }, work, &threadpool.environ_
+    );
+
+  if (timer == nullptr)
+  {
+    delete work;
+    return static_cast<ErrorCode>(GetLastError());
+  }
+
+  arm_timer(timer, delay_ms);
+  return ErrorCode::Success;
+}
+
+void firelink::platform::WinIOCore::arm_timer(PTP_TIMER timer, std::uint32_t delay_ms)
+{
+  // A negative due time is relative to now, in 100 nanosecond units
+  ULARGE_INTEGER due_time{};
+  due_time.QuadPart = static_cast<ULONGLONG>(-static_cast<LONGLONG>(delay_ms) * 10000);
+
+  FILETIME ft_due_time{};
+  ft_due_time.dwLowDateTime = due_time.LowPart;
+  ft_due_time.dwHighDateTime = due_time.HighPart;
+  SetThreadpoolTimer(timer, &ft_due_time, 0, 0);
+}
+
+std::size_t firelink::platform::WinIOCore::run()
+{
+  std::size_t handlers_run = 0;
+  for (RunQueueWait wait = run_queued(INFINITE); wait != RunQueueWait::Stopped; wait = run_queued(INFINITE))
+  {
+    if (wait == RunQueueWait::Ran)
+      handlers_run++;
+  }
+
+  return handlers_run;
+}
+
+std::size_t firelink::platform::WinIOCore::run_one()
+{
+  for (;;)
+  {
+    // Idle here is a stale wake-up of an earlier stop(), keep waiting
+    RunQueueWait wait = run_queued(INFINITE);
+    if (wait == RunQueueWait::Ran)
+      return 1;
+    if (wait == RunQueueWait::Stopped)
+      return 0;
+  }
+}
+
+/*
+ * Runs at most what was queued on entry, so handlers that keep posting work can not hold the caller. Whatever
+ * is left signals the wake event again, the host calls poll once more.
+ */
+std::size_t firelink::platform::WinIOCore::poll()
+{
+  LONG queued = InterlockedCompareExchange(const_cast<LONG*>(&run_queue_depth_), 0, 0);
+
+  std::size_t handlers_run = 0;
+  while (handlers_run < static_cast<std::size_t>(queued) && run_queued(0) == RunQueueWait::Ran)
+    handlers_run++;
+
+  if (wake_event_ != nullptr && InterlockedCompareExchange(const_cast<LONG*>(&run_queue_depth_), 0, 0) > 0)
+    SetEvent(wake_event_);
+
+  return handlers_run;
+}
+
+std::size_t firelink::platform::WinIOCore::run_for(std::chrono::milliseconds timeout)
+{
+  std::size_t handlers_run = 0;
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  for (;;)
+  {
+    auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    DWORD timeout_ms = remaining.count() > 0 ? static_cast<DWORD>(remaining.count()) : 0;
+
+    RunQueueWait wait = run_queued(timeout_ms);
+    if (wait == RunQueueWait::Ran)
+      handlers_run++;
+    else if (wait == RunQueueWait::Stopped)
+      break;
+
+    // Work that keeps arriving must not hold the caller past the deadline
+    if (std::chrono::steady_clock::now() >= deadline)
+      break;
+  }
+
+  return handlers_run;
 }
 
 void firelink::platform::WinIOCore::stop()
@@ -147,38 +386,203 @@ void firelink::platform::WinIOCore::stop()
   // Atomically set the flag to 1 (stopping)
   InterlockedExchange(const_cast<LONG*>(&stop_requested_), 1);
 
-  // Wake up all threads waiting in run()
-  AcquireSRWLockExclusive(&srw_run_);
-  WakeAllConditionVariable(&cv_run_);
-  ReleaseSRWLockExclusive(&srw_run_);
+  // Wake up a thread waiting on the run queue, it passes the wake-up on to the next one
+  if (run_queue_ != nullptr)
+    PostQueuedCompletionStatus(run_queue_, 0, FIRELINK_RUN_QUEUE_WAKE, nullptr);
+
+  if (wake_event_ != nullptr)
+    SetEvent(wake_event_);
+}
+
+firelink::NativeWaitHandle firelink::platform::WinIOCore::native_wait_handle() const
+{
+  return wake_event_;
+}
+
+firelink::SocketPoolStats firelink::platform::WinIOCore::get_socket_pool_stats() const
+{
+  return socket_recycler_->get_stats();
+}
+
+firelink::IOCoreStats firelink::platform::WinIOCore::stats() const
+{
+  return metrics_->snapshot();
+}
+
+firelink::LatencyStats firelink::platform::WinIOCore::latency_stats() const
+{
+  return metrics_->latency_snapshot();
+}
+
+firelink::NumaStats firelink::platform::WinIOCore::numa_stats() const
+{
+  return numa_counters_->snapshot();
+}
+
+std::unique_ptr<firelink::platform::DrainBuffer> firelink::platform::WinIOCore::take_drain_buffer()
+{
+  AcquireSRWLockExclusive(&drain_lock_);
+  if (!drain_buffers_.empty())
+  {
+    std::unique_ptr<DrainBuffer> buffer = std::move(drain_buffers_.back());
+    drain_buffers_.pop_back();
+    ReleaseSRWLockExclusive(&drain_lock_);
+    return buffer;
+  }
+
+  ReleaseSRWLockExclusive(&drain_lock_);
+  return std::make_unique<DrainBuffer>();
+}
+
+void firelink::platform::WinIOCore::give_drain_buffer(std::unique_ptr<DrainBuffer> buffer)
+{
+  AcquireSRWLockExclusive(&drain_lock_);
+  drain_buffers_.push_back(std::move(buffer));
+  ReleaseSRWLockExclusive(&drain_lock_);
+}
+
+/*
+ * Queues user work for the threads in run, run_one, poll or run_for
+ */
+firelink::ErrorCode firelink::platform::WinIOCore::queue_user_work(std::move_only_function<void()>&& func)
+{
+  if (run_queue_ == nullptr)
+    return ErrorCode::SystemError;
+
+  auto* work = new PostedWork{std::move(func), metrics_.get()};
+  if (!PostQueuedCompletionStatus(run_queue_, 0, FIRELINK_RUN_QUEUE_WORK, reinterpret_cast<LPOVERLAPPED>(work)))
+  {
+    delete work;
+    return static_cast<ErrorCode>(static_cast<int>(GetLastError()));
+  }
+
+  // Counted once the packet is queued, so a host woken by the event always finds it
+  if (InterlockedIncrement(&run_queue_depth_) == 1)
+    SetEvent(wake_event_);
+
+  // The event loop may already have picked the work up, snapshots clamp the queue depth for that
+  metrics_->user_work_posted();
+  return ErrorCode::Success;
 }
 
-PTP_IO firelink::platform::WinIOCore::associate_handle(NativeHandle handle, PTP_WIN32_IO_CALLBACK io_routine)
+/*
+ * Waits up to timeout_ms for one packet on the run queue and runs it if it is user work. A thread woken by
+ * stop() wakes the next waiting one before it returns, so every thread in the event loop sees the stop.
+ */
+firelink::platform::RunQueueWait firelink::platform::WinIOCore::run_queued(DWORD timeout_ms)
 {
-  return CreateThreadpoolIo(reinterpret_cast<HANDLE>(handle), io_routine, nullptr, &io_threadpool_environ_);
+  if (run_queue_ == nullptr || InterlockedCompareExchange(const_cast<LONG*>(&stop_requested_), 0, 0) != 0)
+    return RunQueueWait::Stopped;
+
+  DWORD bytes_transferred = 0;
+  ULONG_PTR key = 0;
+  LPOVERLAPPED overlapped = nullptr;
+  if (!GetQueuedCompletionStatus(run_queue_, &bytes_transferred, &key, &overlapped, timeout_ms))
+    return GetLastError() == WAIT_TIMEOUT ? RunQueueWait::Idle : RunQueueWait::Stopped;
+
+  if (key == FIRELINK_RUN_QUEUE_WAKE)
+  {
+    if (InterlockedCompareExchange(const_cast<LONG*>(&stop_requested_), 0, 0) == 0)
+      return RunQueueWait::Idle;
+
+    PostQueuedCompletionStatus(run_queue_, 0, FIRELINK_RUN_QUEUE_WAKE, nullptr);
+    return RunQueueWait::Stopped;
+  }
+
+  InterlockedDecrement(&run_queue_depth_);
+
+  auto* work = reinterpret_cast<PostedWork*>(overlapped);
+  work->metrics_->user_work_started();
+  std::invoke(work->func_);
+  delete work;
+  return RunQueueWait::Ran;
 }
 
-firelink::ErrorCode firelink::platform::WinIOCore::initialize_threadpool(DWORD threads_min, DWORD threads_max, ThreadpoolRollback* rollback, 
-                                                                         PTP_CALLBACK_ENVIRON environment, PTP_CLEANUP_GROUP* cleanup_group, PTP_POOL* threadpool)
+void firelink::platform::WinIOCore::close_run_queue()
 {
-  InitializeThreadpoolEnvironment(environment);
-  *rollback = ThreadpoolRollback::InitEnviron;
-  *threadpool = ::CreateThreadpool(nullptr);
-  if (*threadpool != nullptr)
+  if (run_queue_ == nullptr)
+    return;
+
+  DWORD bytes_transferred = 0;
+  ULONG_PTR key = 0;
+  LPOVERLAPPED overlapped = nullptr;
+  while (GetQueuedCompletionStatus(run_queue_, &bytes_transferred, &key, &overlapped, 0))
   {
-    *rollback = ThreadpoolRollback::CreateThreadpool;
-    SetThreadpoolThreadMaximum(*threadpool, threads_max);
+    if (key != FIRELINK_RUN_QUEUE_WORK)
+      continue;
+
+    // Dropped user work leaves the queue all the same
+    auto* work = reinterpret_cast<PostedWork*>(overlapped);
+    work->metrics_->user_work_started();
+    delete work;
+  }
+
+  CloseHandle(run_queue_);
+  run_queue_ = nullptr;
+  InterlockedExchange(&run_queue_depth_, 0);
 
-    BOOL res = SetThreadpoolThreadMinimum(*threadpool, threads_min);
+  if (wake_event_ != nullptr)
+    CloseHandle(wake_event_);
+  wake_event_ = nullptr;
+}
+
+/*
+ * Binds the handle to the IO threadpool of node. Its completions are picked up by that node's IO threads
+ * for as long as the handle lives, a handle can not be moved to another threadpool.
+ */
+PTP_IO firelink::platform::WinIOCore::associate_handle(NativeHandle handle, PTP_WIN32_IO_CALLBACK io_routine, std::uint32_t node)
+{
+  return CreateThreadpoolIo(reinterpret_cast<HANDLE>(handle), io_routine, nullptr, &pools(node).io_.environ_);
+}
+
+const firelink::platform::ThreadPlacement* firelink::platform::WinIOCore::io_placement(std::uint32_t node)
+{
+  return &pools(node).io_.placement_;
+}
+
+std::uint32_t firelink::platform::WinIOCore::node_for_current_thread() const
+{
+  return conf_.numa_aware_ ? current_numa_node() : 0;
+}
+
+firelink::platform::NodeThreadpools& firelink::platform::WinIOCore::pools(std::uint32_t node)
+{
+  if (node < nodes_.size() && nodes_[node])
+    return *nodes_[node];
+
+  return *nodes_[default_node_];
+}
+
+// The node's processors, narrowed to the configured CPU set if that names some of them
+firelink::CpuSet firelink::platform::WinIOCore::node_cpu_set(const GROUP_AFFINITY& node_affinity, const CpuSet& configured)
+{
+  CpuSet cpu_set{node_affinity.Group, static_cast<std::uint64_t>(node_affinity.Mask)};
+  if (configured.mask_ != 0 && configured.group_ == node_affinity.Group && (configured.mask_ & cpu_set.mask_) != 0)
+    cpu_set.mask_ &= configured.mask_;
+
+  return cpu_set;
+}
+
+firelink::ErrorCode firelink::platform::WinIOCore::initialize_threadpool(DWORD threads_min, DWORD threads_max, Threadpool& threadpool)
+{
+  InitializeThreadpoolEnvironment(&threadpool.environ_);
+  threadpool.rollback_ = ThreadpoolRollback::InitEnviron;
+  threadpool.pool_ = ::CreateThreadpool(nullptr);
+  if (threadpool.pool_ != nullptr)
+  {
+    threadpool.rollback_ = ThreadpoolRollback::CreateThreadpool;
+    SetThreadpoolThreadMaximum(threadpool.pool_, threads_max);
+
+    BOOL res = SetThreadpoolThreadMinimum(threadpool.pool_, threads_min);
 
     if (res != FALSE)
     {
-      *cleanup_group = CreateThreadpoolCleanupGroup();
-      if (*cleanup_group != nullptr)
+      threadpool.cleanup_group_ = CreateThreadpoolCleanupGroup();
+      if (threadpool.cleanup_group_ != nullptr)
       {
-        *rollback = ThreadpoolRollback::CreateCleanupGroup;
-        SetThreadpoolCallbackPool(environment, *threadpool);
-        SetThreadpoolCallbackCleanupGroup(environment, *cleanup_group, nullptr);
+        threadpool.rollback_ = ThreadpoolRollback::CreateCleanupGroup;
+        SetThreadpoolCallbackPool(&threadpool.environ_, threadpool.pool_);
+        SetThreadpoolCallbackCleanupGroup(&threadpool.environ_, threadpool.cleanup_group_, cancel_pending_work);
       }
       else
       {
@@ -198,15 +602,30 @@ firelink::ErrorCode firelink::platform::WinIOCore::initialize_threadpool(DWORD t
   return ErrorCode::Success;
 }
 
-firelink::ErrorCode firelink::platform::WinIOCore::release_threadpool(DWORD close_cleanup_members_timeout_ms, ThreadpoolRollback* rollback,
-                                                                      PTP_CALLBACK_ENVIRON environment, PTP_CLEANUP_GROUP cleanup_group, PTP_POOL threadpool)
+/*
+ * Called by CloseThreadpoolCleanupGroupMembers for every callback that is cancelled before it started.
+ * Posted work and timers carry a PostedWork as the object context, IO objects have no context.
+ */
+void CALLBACK firelink::platform::WinIOCore::cancel_pending_work(PVOID object_context, PVOID cleanup_context)
+{
+  UNREFERENCED_PARAMETER(cleanup_context);
+
+  // Dropped user work leaves the queue all the same
+  auto* work = static_cast<PostedWork*>(object_context);
+  if (work != nullptr && work->metrics_ != nullptr)
+    work->metrics_->user_work_started();
+
+  delete work;
+}
+
+firelink::ErrorCode firelink::platform::WinIOCore::release_threadpool(DWORD close_cleanup_members_timeout_ms, Threadpool& threadpool)
 {
   ErrorCode return_val = ErrorCode::Success;
 
   // Ignore missing default case warning, not needed
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wswitch-default"
-  switch (*rollback)
+  switch (threadpool.rollback_)
   {
     case ThreadpoolRollback::CreateCleanupGroup:
     {
@@ -223,7 +642,7 @@ firelink::ErrorCode firelink::platform::WinIOCore::release_threadpool(DWORD clos
                                              CloseThreadpoolCleanupGroupMembers(grp, TRUE, nullptr);
                                              return 0;
 
-                                           }, cleanup_group, 0, nullptr);
+                                           }, threadpool.cleanup_group_, 0, nullptr);
 
       if (cleanup_thread != nullptr)
       {
@@ -253,24 +672,24 @@ firelink::ErrorCode firelink::platform::WinIOCore::release_threadpool(DWORD clos
         return_val = static_cast<ErrorCode>(static_cast<int>(GetLastError()));
       }
 
-      CloseThreadpoolCleanupGroup(cleanup_group);
-      cleanup_group = nullptr;
-      *rollback = ThreadpoolRollback::CreateThreadpool;
+      CloseThreadpoolCleanupGroup(threadpool.cleanup_group_);
+      threadpool.cleanup_group_ = nullptr;
+      threadpool.rollback_ = ThreadpoolRollback::CreateThreadpool;
 
       [[fallthrough]];
     }
     case ThreadpoolRollback::CreateThreadpool:
     {
-      CloseThreadpool(threadpool);
-      threadpool = nullptr;
-      *rollback = ThreadpoolRollback::InitEnviron;
+      CloseThreadpool(threadpool.pool_);
+      threadpool.pool_ = nullptr;
+      threadpool.rollback_ = ThreadpoolRollback::InitEnviron;
 
       [[fallthrough]];
     }
     case ThreadpoolRollback::InitEnviron:
     {
-      DestroyThreadpoolEnvironment(environment);
-      *rollback = ThreadpoolRollback::None;
+      DestroyThreadpoolEnvironment(&threadpool.environ_);
+      threadpool.rollback_ = ThreadpoolRollback::None;
 
       [[fallthrough]];
     }
@@ -281,7 +700,7 @@ firelink::ErrorCode firelink::platform::WinIOCore::release_threadpool(DWORD clos
   }
 #pragma clang diagnostic pop
   
-  *rollback = ThreadpoolRollback::None;
+  threadpool.rollback_ = ThreadpoolRollback::None;
   return return_val;
 }
 
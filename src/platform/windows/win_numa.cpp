@@ -0,0 +1,163 @@
+#include "firelink/platform/windows/win_numa.hpp"
+
+#include <Windows.h>
+#include <algorithm>
+
+namespace
+{
+  // The placement the calling threadpool thread is pinned to. Threads of a private pool serve only that pool.
+  thread_local const firelink::platform::ThreadPlacement* pinned_placement = nullptr;
+}
+
+std::uint32_t firelink::current_numa_node()
+{
+  PROCESSOR_NUMBER processor{};
+  GetCurrentProcessorNumberEx(&processor);
+
+  USHORT node = 0;
+  if (!GetNumaProcessorNodeEx(&processor, &node) || node == MAXUSHORT)
+    return 0;
+
+  return node;
+}
+
+std::uint32_t firelink::numa_node_count()
+{
+  ULONG highest = 0;
+  if (!GetNumaHighestNodeNumber(&highest))
+    return 1;
+
+  return static_cast<std::uint32_t>(highest) + 1;
+}
+
+firelink::NodeBuffer::~NodeBuffer()
+{
+  release();
+}
+
+firelink::NodeBuffer& firelink::NodeBuffer::operator=(NodeBuffer&& other) noexcept
+{
+  if (this != &other)
+  {
+    release();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    node_ = other.node_;
+  }
+
+  return *this;
+}
+
+/*
+ * Commits size bytes, rounded up to whole pages, with node as the preferred node. The pages are placed
+ * there when first touched, or on another node if this one has no free memory.
+ */
+std::expected<firelink::NodeBuffer, firelink::ErrorCode> firelink::NodeBuffer::allocate(std::size_t size, std::uint32_t node)
+{
+  if (size == 0)
+    return std::unexpected(ErrorCode::InvalidArgument);
+
+  void* data = VirtualAllocExNuma(GetCurrentProcess(), nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE,
+                                  static_cast<DWORD>(node));
+  if (data == nullptr)
+    return std::unexpected(static_cast<ErrorCode>(static_cast<int>(GetLastError())));
+
+  NodeBuffer buffer{};
+  buffer.data_ = static_cast<std::byte*>(data);
+  buffer.size_ = size;
+  buffer.node_ = node;
+  return buffer;
+}
+
+void firelink::NodeBuffer::release()
+{
+  if (data_ != nullptr)
+    VirtualFree(data_, 0, MEM_RELEASE);
+
+  data_ = nullptr;
+  size_ = 0;
+}
+
+void firelink::platform::enter_threadpool_callback(const ThreadPlacement* placement)
+{
+  if (placement == nullptr || pinned_placement == placement)
+    return;
+
+  pinned_placement = placement;
+  if (placement->cpu_set_.mask_ == 0)
+    return;
+
+  GROUP_AFFINITY affinity{};
+  affinity.Group = placement->cpu_set_.group_;
+  affinity.Mask = static_cast<KAFFINITY>(placement->cpu_set_.mask_);
+
+  // Best effort, a thread that can not be pinned keeps running where the system puts it
+  SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr);
+}
+
+firelink::platform::NumaCounters::NumaCounters(bool numa_aware) :
+  enabled_(false),
+  node_count_(numa_aware ? std::min(numa_node_count(), FIRELINK_MAX_NUMA_NODES) : 1),
+  nodes_(std::make_unique<NodeCounters[]>(node_count_))
+{
+  enabled_ = node_count_ > 1;
+}
+
+firelink::platform::NumaCounters::NodeCounters& firelink::platform::NumaCounters::here(std::uint32_t& node)
+{
+  node = std::min(current_numa_node(), node_count_ - 1);
+  return nodes_[node];
+}
+
+/*
+ * The handler goes to the user threadpool of the NIC node, so a completion picked up on another node is a
+ * hop the handler and the connection's buffers did not make.
+ */
+void firelink::platform::NumaCounters::record_completion(std::int32_t nic_node)
+{
+  if (!enabled_)
+    return;
+
+  std::uint32_t node = 0;
+  NodeCounters& counters = here(node);
+  counters.completions_.fetch_add(1, std::memory_order_relaxed);
+
+  if (nic_node >= 0 && static_cast<std::uint32_t>(nic_node) != node)
+    counters.hops_avoided_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void firelink::platform::NumaCounters::record_handler(std::int32_t nic_node)
+{
+  if (!enabled_)
+    return;
+
+  std::uint32_t node = 0;
+  NodeCounters& counters = here(node);
+  counters.handlers_.fetch_add(1, std::memory_order_relaxed);
+
+  if (nic_node < 0)
+    return;
+
+  if (static_cast<std::uint32_t>(nic_node) == node)
+    counters.nic_local_handlers_.fetch_add(1, std::memory_order_relaxed);
+  else
+    counters.nic_remote_handlers_.fetch_add(1, std::memory_order_relaxed);
+}
+
+firelink::NumaStats firelink::platform::NumaCounters::snapshot() const
+{
+  NumaStats stats{};
+  stats.nodes_.resize(node_count_);
+
+  for (std::uint32_t i = 0; i < node_count_; ++i)
+  {
+    const NodeCounters& counters = nodes_[i];
+    stats.nodes_[i].completions_ = counters.completions_.load(std::memory_order_relaxed);
+    stats.nodes_[i].handlers_ = counters.handlers_.load(std::memory_order_relaxed);
+    stats.nic_local_handlers_ += counters.nic_local_handlers_.load(std::memory_order_relaxed);
+    stats.nic_remote_handlers_ += counters.nic_remote_handlers_.load(std::memory_order_relaxed);
+    stats.cross_node_hops_avoided_ += counters.hops_avoided_.load(std::memory_order_relaxed);
+  }
+
+  return stats;
+}
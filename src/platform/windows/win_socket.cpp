@@ -1,14 +1,19 @@
 #include "firelink/platform/windows/win_socket.hpp"
 #include "firelink/platform/windows/win_io_core.hpp"
+#include "firelink/platform/windows/win_socket_recycler.hpp"
+#include "firelink/trace.hpp"
 #include <WinSock2.h>
 #include <guiddef.h>
 #include <memory>
 #include <minwinbase.h>
 #include <mstcpip.h>
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include <array>
+#include <chrono>
 #include <system_error>
+#include <utility>
 #include <winnt.h>
 #include <ws2ipdef.h>
 
@@ -20,9 +25,23 @@ LPFN_DISCONNECTEX firelink::platform::WinSocket::lpfn_disconnect_ex_ = nullptr;
 
 firelink::platform::WinSocket::WinSocket(std::shared_ptr<firelink::IOCore> io_core) :
   firelink::Socket(io_core),
-  socket_io_handle_(nullptr)
+  socket_io_handle_(nullptr),
+  metrics_(static_cast<WinIOCore*>(io_core.get())->get_metrics()),
+  numa_(static_cast<WinIOCore*>(io_core.get())->get_numa_counters()),
+  node_(0),
+  nic_node_(-1),
+  io_placement_(nullptr),
+  send_queue_head_(nullptr),
+  send_in_flight_(false),
+  send_pending_head_(nullptr),
+  send_pending_tail_(nullptr),
+  handle_reusable_(false),
+  io_state_(0),
+  close_started_(false),
+  close_error_(ErrorCode::Success)
 {
   socket_ = INVALID_SOCKET;
+  busy_poll_us_ = static_cast<WinIOCore*>(io_core.get())->get_busy_poll_us();
   addr_family_= AddressFamily::NotSupported;
   sock_type_ = SocketType::NotSupported;
   protocol_ = Protocol::NotSupported;
@@ -31,11 +50,22 @@ firelink::platform::WinSocket::WinSocket(std::shared_ptr<firelink::IOCore> io_co
 
 firelink::platform::WinSocket::~WinSocket()
 {
+  // Every pending operation holds a reference, none is left. The IO object is freed once a callback that
+  // may still be returning is done, so there is nothing to wait for, even on an IO thread.
   if (socket_io_handle_ != nullptr)
   {
-    WaitForThreadpoolIoCallbacks(socket_io_handle_, FALSE);
-    CloseThreadpoolIo(socket_io_handle_);
+    if (!recycle_handle())
+      CloseThreadpoolIo(socket_io_handle_);
   }
+
+  // Release sends that were queued but never written
+  SendRequest* request = send_queue_head_.exchange(nullptr);
+  while (request != nullptr)
+    delete std::exchange(request, request->next_);
+
+  request = send_pending_head_;
+  while (request != nullptr)
+    delete std::exchange(request, request->next_);
 }
 
 /*
@@ -43,36 +73,55 @@ firelink::platform::WinSocket::~WinSocket()
  */
 firelink::ErrorCode firelink::platform::WinSocket::socket(AddressFamily addr_family, SocketType sock_type, Protocol protocol)
 {
+  std::shared_ptr<IOCore> c = io_core_.lock();
+  if (!c)
+    return ErrorCode::SystemError;
+
+  // Served by the IO threadpool of the node the socket is created on
+  WinIOCore* win_core = static_cast<WinIOCore*>(c.get());
+  node_ = win_core->node_for_current_thread();
+  nic_node_ = -1;
+  io_placement_ = win_core->io_placement(node_);
+
+  // Prefer a handle released by a socket that was disconnected for reuse. It is already associated with the IO threadpool.
+  if (win_core->get_socket_recycler()->take_handle(addr_family, sock_type, protocol, node_, socket_, socket_io_handle_))
+  {
+    this->addr_family_ = addr_family;
+    this->sock_type_ = sock_type;
+    this->protocol_ = protocol;
+
+    // A handle that was connected keeps its local address across the reuse, an accepted one may not have it
+    SOCKADDR_STORAGE local_win_addr{};
+    int addr_len = sizeof(local_win_addr);
+    this->is_bound_ = getsockname(socket_, reinterpret_cast<PSOCKADDR>(&local_win_addr), &addr_len) == 0;
+
+    trace(TraceEvent::SocketCreated, this);
+    return ErrorCode::Success;
+  }
+
   socket_ = WSASocketW(static_cast<int>(addr_family), static_cast<int>(sock_type),
                          static_cast<int>(protocol), nullptr, 0, WSA_FLAG_OVERLAPPED);
   
   if (socket_ == INVALID_SOCKET)
     return static_cast<ErrorCode>(WSAGetLastError());
 
-  if (std::shared_ptr<IOCore> c = io_core_.lock())
-  {
-    WinIOCore* win_core = static_cast<WinIOCore*>(c.get());
-    socket_io_handle_ = win_core->associate_handle(socket_, io_routine_);
-    if (socket_io_handle_ == nullptr)
-    {
-      int err = static_cast<int>(GetLastError());
-      closesocket(socket_);
-      socket_ = INVALID_SOCKET;
-   
-      return static_cast<ErrorCode>(err);
-    }
-  }
-  else
+  socket_io_handle_ = win_core->associate_handle(socket_, io_routine_, node_);
+  if (socket_io_handle_ == nullptr)
   {
+    int err = static_cast<int>(GetLastError());
     closesocket(socket_);
     socket_ = INVALID_SOCKET;
-    return ErrorCode::SystemError;
+ 
+    return static_cast<ErrorCode>(err);
   }
 
+  win_core->get_socket_recycler()->count_new_handle();
+
   this->addr_family_ = addr_family;
   this->sock_type_ = sock_type;
   this->protocol_ = protocol;
   
+  trace(TraceEvent::SocketCreated, this);
   return ErrorCode::Success;
 }
 
@@ -120,15 +169,25 @@ firelink::ErrorCode firelink::platform::WinSocket::shutdown(ShutdownHow how)
 
 /*
  * Waits for all unfinished async socket operations to complete, closes the threadpool IO, 
- * and closes the socket.
+ * and closes the socket. A socket that was disconnected for reuse hands its handle to the IOCore instead.
  */
 firelink::ErrorCode firelink::platform::WinSocket::close()
 {
+  if (socket_ != INVALID_SOCKET)
+    trace(TraceEvent::SocketClosed, this);
+
   ErrorCode err = ErrorCode::Success;
   if (socket_io_handle_ != nullptr)
   {
-    WaitForThreadpoolIoCallbacks(socket_io_handle_, FALSE);
-    CloseThreadpoolIo(socket_io_handle_);
+    // Blocks until the callbacks of pending operations are done, must not be called from an IO thread then
+    if ((io_state_.load(std::memory_order_acquire) & ~FIRELINK_SOCKET_CLOSING) != 0)
+      WaitForThreadpoolIoCallbacks(socket_io_handle_, FALSE);
+
+    if (recycle_handle())
+      socket_ = INVALID_SOCKET;
+    else
+      CloseThreadpoolIo(socket_io_handle_);
+
     socket_io_handle_ = nullptr;
   }
 
@@ -178,18 +237,25 @@ firelink::ErrorCode firelink::platform::WinSocket::accept(std::shared_ptr<fireli
   accept_win_socket->sock_type_ = static_cast<SocketType>(info.iSocketType);
   accept_win_socket->protocol_ = static_cast<Protocol>(info.iProtocol);
   accept_win_socket->socket_ = s;
+  accept_win_socket->nic_node_ = accept_win_socket->query_nic_node();
 
-  // associate the accept socket with the socket IO threadpool
+  // associate the accept socket with the socket IO threadpool, of the NIC node when it is known
   if (std::shared_ptr<IOCore> c = io_core_.lock())
   {
     WinIOCore* win_core = static_cast<WinIOCore*>(c.get());
-    accept_win_socket->socket_io_handle_ = win_core->associate_handle(accept_win_socket->socket_, io_routine_);
+    std::int32_t nic_node = accept_win_socket->nic_node_;
+    accept_win_socket->node_ = nic_node >= 0 ? static_cast<std::uint32_t>(nic_node) : win_core->node_for_current_thread();
+    accept_win_socket->io_placement_ = win_core->io_placement(accept_win_socket->node_);
+    accept_win_socket->socket_io_handle_ = win_core->associate_handle(accept_win_socket->socket_, io_routine_,
+                                                                      accept_win_socket->node_);
     if (accept_win_socket->socket_io_handle_ == nullptr)
     {
       err = static_cast<ErrorCode>(static_cast<int>(GetLastError()));
       accept_win_socket->close();
       return err;
     }
+
+    win_core->get_socket_recycler()->count_new_handle();
   }
   else
   {
@@ -198,6 +264,7 @@ firelink::ErrorCode firelink::platform::WinSocket::accept(std::shared_ptr<fireli
   }
 
   accept_win_socket->is_bound_ = true;
+  accept_win_socket->handle_reusable_ = false;
   return err;
 }
 
@@ -217,7 +284,9 @@ firelink::ErrorCode firelink::platform::WinSocket::connect(const Endpoint& dst)
     return err;
   }
 
+  nic_node_ = query_nic_node();
   is_bound_ = true;
+  handle_reusable_ = false;
   return ErrorCode::Success;
 }
 
@@ -329,7 +398,8 @@ firelink::ErrorCode firelink::platform::WinSocket::disconnect(int timeout_ms)
     FD_SET(socket_, &fd_select_set);
     #pragma clang diagnostic pop
     
-    int res = select(1, &fd_select_set, nullptr, nullptr, timeout_ms == 0 ? nullptr : &time_val);
+    // nfds is ignored by Winsock, the set says which socket to wait on
+    int res = select(0, &fd_select_set, nullptr, nullptr, timeout_ms == 0 ? nullptr : &time_val);
 
     // there is data to be read
     if (res > 0)
@@ -355,6 +425,40 @@ firelink::ErrorCode firelink::platform::WinSocket::disconnect(int timeout_ms)
   // Unreachable
 }
 
+/*
+ * Polls the socket without waiting. A readable socket is peeked at: zero bytes means the peer has closed
+ * the connection, anything else is data the peer sent that is left in place.
+ */
+firelink::ErrorCode firelink::platform::WinSocket::check_connection()
+{
+  if (socket_ == INVALID_SOCKET)
+    return ErrorCode::NotASocket;
+
+  WSAPOLLFD poll_fd{};
+  poll_fd.fd = socket_;
+  poll_fd.events = POLLRDNORM;
+
+  int res = WSAPoll(&poll_fd, 1, 0);
+  if (res == SOCKET_ERROR)
+    return static_cast<ErrorCode>(WSAGetLastError());
+
+  // Nothing to read, the connection is idle
+  if (res == 0)
+    return ErrorCode::Success;
+
+  if (poll_fd.revents & (POLLERR | POLLHUP | POLLNVAL))
+    return ErrorCode::ConnectionReset;
+
+  char peek_byte = 0;
+  int n_bytes = ::recv(socket_, &peek_byte, 1, MSG_PEEK);
+  if (n_bytes == SOCKET_ERROR)
+    return static_cast<ErrorCode>(WSAGetLastError());
+  else if (n_bytes == 0)
+    return ErrorCode::NotConnected;
+
+  return ErrorCode::Success;
+}
+
 /*
  * Begins an asynchronous accept operation. accept_socket is filled with the new connection.
  */
@@ -368,25 +472,35 @@ firelink::ErrorCode firelink::platform::WinSocket::start_accept(std::shared_ptr<
       return res;
   }
 
+  static_cast<WinSocket*>(accept_socket.get())->handle_reusable_ = false;
+
   IOData* io_data = new IOData{};
   io_data->socket_ = shared_from_this();
-  io_data->accept_socket_ = std::shared_ptr<Socket>(std::move(accept_socket));
+  io_data->accept_ = std::make_unique<AcceptData>();
+  io_data->accept_->accept_socket_ = std::shared_ptr<Socket>(std::move(accept_socket));
   io_data->user_handler_ = std::move(handler);
+  io_data->operation_ = Operation::Accept;
   
-  StartThreadpoolIo(socket_io_handle_);
+  metrics_->operation_started(Operation::Accept);
+  io_data->trace_id_ = trace_operation_id();
+  trace(TraceEvent::OperationSubmitted, this, io_data->trace_id_, Operation::Accept);
+  io_data->submitted_ns_ = metrics_->latency_clock();
+  start_io();
 
-  SOCKET accept_sock_handle = static_cast<WinSocket*>(io_data->accept_socket_.get())->socket_;
+  SOCKET accept_sock_handle = static_cast<WinSocket*>(io_data->accept_->accept_socket_.get())->socket_;
   DWORD addr_len = sizeof(SOCKADDR_STORAGE) + 16;
   DWORD bytes_received = ULONG_MAX;
   
-  if (lpfn_accept_ex_(socket_, accept_sock_handle, static_cast<PVOID>(io_data->accept_address_buffer_.data()), 0, 
+  if (lpfn_accept_ex_(socket_, accept_sock_handle, static_cast<PVOID>(io_data->accept_->accept_address_buffer_.data()), 0, 
                       addr_len, addr_len, &bytes_received, &io_data->overlapped_) != TRUE)
   {
     int error = WSAGetLastError();
     if (error != ERROR_IO_PENDING)
     {
+      trace(TraceEvent::OperationCompleted, this, io_data->trace_id_, Operation::Accept, static_cast<ErrorCode>(error));
       delete io_data;
-      CancelThreadpoolIo(socket_io_handle_);
+      cancel_io();
+      metrics_->operation_completed(Operation::Accept, static_cast<ErrorCode>(error), 0);
       return static_cast<ErrorCode>(error);
     }
   }
@@ -408,32 +522,40 @@ firelink::ErrorCode firelink::platform::WinSocket::start_connect(const Endpoint&
   IOData* io_data = new IOData{};
   io_data->socket_ = shared_from_this();
   io_data->user_handler_ = std::move(handler);
+  io_data->operation_ = Operation::Connect;
   
   ErrorCode err = endpoint_to_sockaddr(addr_family_, dst, io_data->peer_win_addr_);
   if(err != ErrorCode::Success)
+  {
+    delete io_data;
     return err;
+  }
 	
   // ConnectEx requires a bound socket. Check if socket is bound and if not, then bind it.
   if (io_data->peer_win_addr_.ss_family == AF_INET)
   {
     if(is_bound_ == false)
-    {
       err = this->bind(IPv4Address::any());
-      if(err != ErrorCode::Success)
-        return err;
-    }
   }
   else if (io_data->peer_win_addr_.ss_family == AF_INET6)
   {
     if(is_bound_ == false)
-    {
       err = this->bind(IPv6Address::any());
-      if(err != ErrorCode::Success)
-        return err;
-    }
   }
+
+  if(err != ErrorCode::Success)
+  {
+    delete io_data;
+    return err;
+  }
+
+  handle_reusable_ = false;
   
-  StartThreadpoolIo(socket_io_handle_);
+  metrics_->operation_started(Operation::Connect);
+  io_data->trace_id_ = trace_operation_id();
+  trace(TraceEvent::OperationSubmitted, this, io_data->trace_id_, Operation::Connect);
+  io_data->submitted_ns_ = metrics_->latency_clock();
+  start_io();
   
   DWORD n_bytes_sent = 0;
   if (lpfn_connect_ex_(socket_, reinterpret_cast<PSOCKADDR>(&io_data->peer_win_addr_), sizeof(io_data->peer_win_addr_), nullptr, 0,
@@ -442,8 +564,10 @@ firelink::ErrorCode firelink::platform::WinSocket::start_connect(const Endpoint&
     int error = WSAGetLastError();
     if (error != ERROR_IO_PENDING)
     {
+      trace(TraceEvent::OperationCompleted, this, io_data->trace_id_, Operation::Connect, static_cast<ErrorCode>(error));
       delete io_data;
-      CancelThreadpoolIo(socket_io_handle_);
+      cancel_io();
+      metrics_->operation_completed(Operation::Connect, static_cast<ErrorCode>(error), 0);
       return static_cast<ErrorCode>(error);
     }
   }
@@ -465,13 +589,21 @@ firelink::ErrorCode firelink::platform::WinSocket::start_recv(std::span<std::byt
   IOData* io_data = new IOData{};
   io_data->socket_ = shared_from_this();
   io_data->user_handler_ = std::move(handler);
+  io_data->operation_ = Operation::Recv;
   io_data->user_buffer_ = buffer;
 
   WSABUF wsa_buf{};
   wsa_buf.buf = reinterpret_cast<char*>(buffer.data());
   wsa_buf.len = static_cast<ULONG>(buffer.size());
   
-  StartThreadpoolIo(socket_io_handle_);
+  metrics_->operation_started(Operation::Recv);
+  io_data->trace_id_ = trace_operation_id();
+  trace(TraceEvent::OperationSubmitted, this, io_data->trace_id_, Operation::Recv);
+  io_data->submitted_ns_ = metrics_->latency_clock();
+  if (busy_poll_recv(io_data, wsa_buf))
+    return ErrorCode::Success;
+
+  start_io();
 
   DWORD flags = 0;
   int result = WSARecv(socket_, &wsa_buf, 1, nullptr, &flags, &io_data->overlapped_, nullptr);
@@ -480,8 +612,10 @@ firelink::ErrorCode firelink::platform::WinSocket::start_recv(std::span<std::byt
     result = WSAGetLastError();
     if (result != ERROR_IO_PENDING)
     {
+      trace(TraceEvent::OperationCompleted, this, io_data->trace_id_, Operation::Recv, static_cast<ErrorCode>(result));
       delete io_data;
-      CancelThreadpoolIo(socket_io_handle_);
+      cancel_io();
+      metrics_->operation_completed(Operation::Recv, static_cast<ErrorCode>(result), 0);
       return static_cast<ErrorCode>(result);
     }
   }
@@ -504,26 +638,58 @@ firelink::ErrorCode firelink::platform::WinSocket::start_recv_from(std::span<std
   IOData* io_data = new IOData{};
   io_data->socket_ = shared_from_this();
   io_data->user_handler_ = std::move(handler);
+  io_data->operation_ = Operation::RecvFrom;
+  io_data->user_buffer_ = buffer;
+
+  return submit_recv_from(io_data);
+}
+
+/*
+ * Begins an asynchronous recvfrom operation whose handler is given the source address of the datagram
+ */
+firelink::ErrorCode firelink::platform::WinSocket::start_recv_datagram(std::span<std::byte> buffer, DatagramHandler handler)
+{
+  IOData* io_data = new IOData{};
+  io_data->socket_ = shared_from_this();
+  io_data->user_handler_ = std::move(handler);
+  io_data->operation_ = Operation::RecvFrom;
   io_data->user_buffer_ = buffer;
 
+  return submit_recv_from(io_data);
+}
+
+/*
+ * Issues the WSARecvFrom of a prepared recvfrom operation. Takes ownership of io_data. The source address
+ * and its length are written into io_data when the datagram arrives.
+ */
+firelink::ErrorCode firelink::platform::WinSocket::submit_recv_from(IOData* io_data)
+{
   WSABUF wsa_buf{};
-  wsa_buf.buf = reinterpret_cast<char*>(buffer.data());
-  wsa_buf.len = static_cast<ULONG>(buffer.size());
+  wsa_buf.buf = reinterpret_cast<char*>(io_data->user_buffer_.data());
+  wsa_buf.len = static_cast<ULONG>(io_data->user_buffer_.size());
+
+  metrics_->operation_started(Operation::RecvFrom);
+  io_data->trace_id_ = trace_operation_id();
+  trace(TraceEvent::OperationSubmitted, this, io_data->trace_id_, Operation::RecvFrom);
+  io_data->submitted_ns_ = metrics_->latency_clock();
+  if (busy_poll_recv(io_data, wsa_buf))
+    return ErrorCode::Success;
 
-  StartThreadpoolIo(socket_io_handle_);
+  start_io();
 
   DWORD flags = 0;
-  INT remote_addr_len = sizeof(io_data->peer_win_addr_);
   int res = WSARecvFrom(socket_, &wsa_buf, 1, nullptr, &flags, reinterpret_cast<LPSOCKADDR>(&io_data->peer_win_addr_),
-                        &remote_addr_len, &io_data->overlapped_, nullptr);
+                        &io_data->peer_win_addr_len_, &io_data->overlapped_, nullptr);
 
   if (res == SOCKET_ERROR)
   {
     int error = WSAGetLastError();
     if (error != ERROR_IO_PENDING)
     {
+      trace(TraceEvent::OperationCompleted, this, io_data->trace_id_, Operation::RecvFrom, static_cast<ErrorCode>(error));
       delete io_data;
-      CancelThreadpoolIo(socket_io_handle_);
+      cancel_io();
+      metrics_->operation_completed(Operation::RecvFrom, static_cast<ErrorCode>(error), 0);
       return static_cast<ErrorCode>(error);
     }
   }
@@ -538,21 +704,83 @@ firelink::ErrorCode firelink::platform::WinSocket::start_recv_from(std::span<std
   return ErrorCode::Success;
 }
 
+/*
+ * Spins on the socket for up to busy_poll_us_ until data can be received. If it arrives in time, the receive
+ * is done right away on the calling thread and completed like one reported by the IO threadpool. Returns false
+ * if busy polling is off or nothing arrived, the caller then submits the overlapped receive.
+ */
+bool firelink::platform::WinSocket::busy_poll_recv(IOData* io_data, WSABUF& wsa_buf)
+{
+  if (busy_poll_us_ == 0)
+    return false;
+
+  WSAPOLLFD poll_fd{};
+  poll_fd.fd = socket_;
+  poll_fd.events = POLLRDNORM;
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(busy_poll_us_);
+  for (;;)
+  {
+    poll_fd.revents = 0;
+    int ready = WSAPoll(&poll_fd, 1, 0);
+    if (ready == SOCKET_ERROR)
+      return false;
+
+    // Readable, closed by the peer or failed: the receive does not block in either case
+    if (ready > 0 && poll_fd.revents != 0)
+      break;
+
+    if (std::chrono::steady_clock::now() >= deadline)
+      return false;
+
+    YieldProcessor();
+  }
+
+  DWORD bytes_transferred = 0;
+  DWORD flags = 0;
+  int res = 0;
+  if (io_data->operation_ == Operation::Recv)
+  {
+    res = WSARecv(socket_, &wsa_buf, 1, &bytes_transferred, &flags, nullptr, nullptr);
+  }
+  else
+  {
+    res = WSARecvFrom(socket_, &wsa_buf, 1, &bytes_transferred, &flags, reinterpret_cast<LPSOCKADDR>(&io_data->peer_win_addr_),
+                      &io_data->peer_win_addr_len_, nullptr, nullptr);
+  }
+
+  ULONG io_result = res == SOCKET_ERROR ? static_cast<ULONG>(WSAGetLastError()) : 0;
+
+  // Never submitted with start_io, counted here so complete_io can release it
+  io_state_.fetch_add(1, std::memory_order_acq_rel);
+  complete_io(io_data, io_result, bytes_transferred);
+  return true;
+}
+
 /*
  * Begins an asynchronous send operation.
  */
 firelink::ErrorCode firelink::platform::WinSocket::start_send(std::span<std::byte> data, WriteHandler handler)
 {
+  ErrorCode err = reserve_send(data.size());
+  if (err != ErrorCode::Success)
+    return err;
+
   IOData* io_data = new IOData{};
   io_data->socket_ = shared_from_this();
   io_data->user_handler_ = std::move(handler);
+  io_data->operation_ = Operation::Send;
   io_data->user_buffer_ = data;
   
   WSABUF wsa_buf{};
   wsa_buf.buf = reinterpret_cast<char*>(data.data());
   wsa_buf.len = static_cast<ULONG>(data.size());
   
-  StartThreadpoolIo(socket_io_handle_);
+  metrics_->operation_started(Operation::Send);
+  io_data->trace_id_ = trace_operation_id();
+  trace(TraceEvent::OperationSubmitted, this, io_data->trace_id_, Operation::Send);
+  io_data->submitted_ns_ = metrics_->latency_clock();
+  start_io();
 
   DWORD flags = 0;
   int res = WSASend(socket_, &wsa_buf, 1, nullptr, flags, &io_data->overlapped_, nullptr);
@@ -562,8 +790,11 @@ firelink::ErrorCode firelink::platform::WinSocket::start_send(std::span<std::byt
     int error = WSAGetLastError();
     if (error != ERROR_IO_PENDING)
     {
+      trace(TraceEvent::OperationCompleted, this, io_data->trace_id_, Operation::Send, static_cast<ErrorCode>(error));
       delete io_data;
-      CancelThreadpoolIo(socket_io_handle_);
+      cancel_io();
+      release_send(data.size());
+      metrics_->operation_completed(Operation::Send, static_cast<ErrorCode>(error), 0);
       return static_cast<ErrorCode>(error);
     }
   }
@@ -584,20 +815,33 @@ firelink::ErrorCode firelink::platform::WinSocket::start_send(std::span<std::byt
  */
 firelink::ErrorCode firelink::platform::WinSocket::start_send_to(std::span<std::byte> data, const Endpoint& dst, WriteHandler handler)
 {
+  ErrorCode error = reserve_send(data.size());
+  if (error != ErrorCode::Success)
+    return error;
+
   IOData* io_data = new IOData{};
   io_data->socket_ = shared_from_this();
   io_data->user_handler_ = std::move(handler);
+  io_data->operation_ = Operation::SendTo;
   io_data->user_buffer_ = data;
 
-  ErrorCode error = endpoint_to_sockaddr(addr_family_, dst, io_data->peer_win_addr_);
+  error = endpoint_to_sockaddr(addr_family_, dst, io_data->peer_win_addr_);
   if(error != ErrorCode::Success)
+  {
+    delete io_data;
+    release_send(data.size());
     return error;
+  }
 
   WSABUF wsa_buf{};
   wsa_buf.buf = reinterpret_cast<char*>(data.data());
   wsa_buf.len = static_cast<ULONG>(data.size());
   
-  StartThreadpoolIo(socket_io_handle_);
+  metrics_->operation_started(Operation::SendTo);
+  io_data->trace_id_ = trace_operation_id();
+  trace(TraceEvent::OperationSubmitted, this, io_data->trace_id_, Operation::SendTo);
+  io_data->submitted_ns_ = metrics_->latency_clock();
+  start_io();
 
   DWORD flags = 0;
   int result = WSASendTo(socket_, &wsa_buf, 1, nullptr, flags, reinterpret_cast<PSOCKADDR>(&io_data->peer_win_addr_),
@@ -608,8 +852,11 @@ firelink::ErrorCode firelink::platform::WinSocket::start_send_to(std::span<std::
     result = WSAGetLastError();
     if (result != ERROR_IO_PENDING)
     {
+      trace(TraceEvent::OperationCompleted, this, io_data->trace_id_, Operation::SendTo, static_cast<ErrorCode>(result));
       delete io_data;
-      CancelThreadpoolIo(socket_io_handle_);
+      cancel_io();
+      release_send(data.size());
+      metrics_->operation_completed(Operation::SendTo, static_cast<ErrorCode>(result), 0);
       return static_cast<ErrorCode>(result);
     }
   }
@@ -636,16 +883,24 @@ firelink::ErrorCode firelink::platform::WinSocket::start_disconnect(bool reuse_s
   IOData* io_data = new IOData{};
   io_data->socket_ = shared_from_this();
   io_data->user_handler_ = std::move(handler);
+  io_data->operation_ = Operation::Disconnect;
+  io_data->reuse_socket_ = reuse_socket;
   
-  StartThreadpoolIo(socket_io_handle_);
+  metrics_->operation_started(Operation::Disconnect);
+  io_data->trace_id_ = trace_operation_id();
+  trace(TraceEvent::OperationSubmitted, this, io_data->trace_id_, Operation::Disconnect);
+  io_data->submitted_ns_ = metrics_->latency_clock();
+  start_io();
 
   if (lpfn_disconnect_ex_(socket_, &io_data->overlapped_, flags, 0) != TRUE)
   {
     int error = WSAGetLastError();
     if (error != ERROR_IO_PENDING)
     {
+      trace(TraceEvent::OperationCompleted, this, io_data->trace_id_, Operation::Disconnect, static_cast<ErrorCode>(error));
       delete io_data;
-      CancelThreadpoolIo(socket_io_handle_);
+      cancel_io();
+      metrics_->operation_completed(Operation::Disconnect, static_cast<ErrorCode>(error), 0);
       return static_cast<ErrorCode>(error);
     }
   }
@@ -661,121 +916,738 @@ firelink::ErrorCode firelink::platform::WinSocket::start_disconnect(bool reuse_s
 }
 
 /*
- * Sets a socket option.
+ * Asynchronous disconnect(timeout_ms). After the send side is shut down a zero-byte receive waits for data or
+ * the FIN, so a draining socket holds no buffer. Each completion discards what arrived into a pooled scratch
+ * buffer and posts the next receive, until the FIN arrives or the deadline timer cancels the receive. The
+ * whole drain counts as one pending operation. The send side is only shut down once the timer is set, so
+ * a failure returned from here leaves the socket as it was.
  */
-firelink::ErrorCode firelink::platform::WinSocket::set_socket_option(SocketOptionLevel level, SocketOption option,
-                                      std::span<const std::byte> value)
+firelink::ErrorCode firelink::platform::WinSocket::start_graceful_disconnect(std::uint32_t timeout_ms, DisconnectHandler handler)
 {
-  if (value.empty()) 
-    return ErrorCode::InvalidArgument;
-    
-  int winsock_level = static_cast<int>(level);
-  int winsock_option = static_cast<int>(option);
-  
-  if(winsock_level == -1 || winsock_option == -1)
-    return ErrorCode::InvalidArgument;
+  if (socket_ == INVALID_SOCKET)
+    return ErrorCode::NotASocket;
 
-  const char* opt_val = reinterpret_cast<const char*>(value.data());
-  int opt_len = static_cast<int>(value.size());
-  
-  if (setsockopt(socket_, winsock_level, winsock_option, opt_val, opt_len) != 0)
-    return static_cast<ErrorCode>(WSAGetLastError());
+  std::shared_ptr<IOCore> io_core = io_core_.lock();
+  if (!io_core)
+    return ErrorCode::SystemError;
 
-  return ErrorCode::Success;
-}
+  IOData* io_data = new IOData{};
+  io_data->socket_ = shared_from_this();
+  io_data->operation_ = Operation::Disconnect;
 
-/*
- * Gets a socket option.
- */
-firelink::ErrorCode firelink::platform::WinSocket::get_socket_option(SocketOptionLevel level, SocketOption option,
-                                          std::span<std::byte> value,
-                                          std::size_t& value_size_out)
-{
-  int winsock_level = static_cast<int>(level);
-  int winsock_option = static_cast<int>(option);
-  
-  if(winsock_level == -1 || winsock_option == -1)
-    return static_cast<ErrorCode>(WSAEINVAL);
+  auto drain = std::make_shared<DrainState>();
+  drain->handler_ = std::move(handler);
+  drain->socket_ = socket_;
+  drain->overlapped_ = &io_data->overlapped_;
+  io_data->user_handler_ = drain;
 
-  char* opt_val = reinterpret_cast<char*>(value.data());
-  int opt_len = static_cast<int>(value.size());
-  
-  if (getsockopt(socket_, winsock_level, winsock_option, opt_val, &opt_len) != 0)
-    return static_cast<ErrorCode>(WSAGetLastError());
+  if (timeout_ms != 0)
+  {
+    // May fire while the drain finishes, the phase tells
+    ErrorCode err = static_cast<WinIOCore*>(io_core.get())->start_io_timer(timeout_ms, [drain]()
+    {
+      AcquireSRWLockExclusive(&drain->lock_);
+      if (drain->phase_ == DrainPhase::Draining)
+      {
+        drain->phase_ = DrainPhase::TimedOut;
+        CancelIoEx(reinterpret_cast<HANDLE>(drain->socket_), drain->overlapped_);
+      }
+      ReleaseSRWLockExclusive(&drain->lock_);
+    }, drain->timer_);
 
-  value_size_out = static_cast<std::size_t>(opt_len);
-  
-  return ErrorCode::Success;
-}
+    if (err != ErrorCode::Success)
+    {
+      delete io_data;
+      return err;
+    }
+  }
 
-firelink::ErrorCode firelink::platform::WinSocket::get_sock_name(firelink::Endpoint& ep)
-{
-  SOCKADDR_STORAGE addr{};
-  int name_len = sizeof(addr);
-  int result = ::getsockname(socket_, reinterpret_cast<PSOCKADDR>(&addr), &name_len);
-  if(result == SOCKET_ERROR)
-    return static_cast<ErrorCode>(WSAGetLastError());
-   
-  return sockaddr_to_endpoint(addr, ep);  
-}
+  if (::shutdown(socket_, SD_SEND) != 0)
+  {
+    ErrorCode err = static_cast<ErrorCode>(WSAGetLastError());
+    WinIOCore::cancel_timer(drain->timer_);
+    delete io_data;
+    return err;
+  }
 
-firelink::ErrorCode firelink::platform::WinSocket::get_peer_name(firelink::Endpoint& ep)
-{
-  SOCKADDR_STORAGE addr{};
-  int name_len = sizeof(addr);
-  int result = ::getpeername(socket_, reinterpret_cast<PSOCKADDR>(&addr), &name_len);
-  if(result == SOCKET_ERROR)
-    return static_cast<ErrorCode>(WSAGetLastError());
-   
-  return sockaddr_to_endpoint(addr, ep);  
+  metrics_->operation_started(Operation::Disconnect);
+  io_data->trace_id_ = trace_operation_id();
+  trace(TraceEvent::OperationSubmitted, this, io_data->trace_id_, Operation::Disconnect);
+  io_data->submitted_ns_ = metrics_->latency_clock();
+  io_state_.fetch_add(1, std::memory_order_acq_rel);
+
+  ErrorCode err = post_drain_recv(io_data);
+  if (err != ErrorCode::Success)
+  {
+    AcquireSRWLockExclusive(&drain->lock_);
+    drain->phase_ = DrainPhase::Finished;
+    ReleaseSRWLockExclusive(&drain->lock_);
+    WinIOCore::cancel_timer(drain->timer_);
+
+    trace(TraceEvent::OperationCompleted, this, io_data->trace_id_, Operation::Disconnect, err);
+    delete io_data;
+    if (io_finished())
+      finish_close();
+
+    metrics_->operation_completed(Operation::Disconnect, err, 0);
+    return err;
+  }
+
+  return ErrorCode::Success;
 }
 
-firelink::ErrorCode firelink::platform::WinSocket::get_acceptex_sockaddrs(PVOID buffer, LPSOCKADDR_STORAGE local_addr, LPSOCKADDR_STORAGE remote_addr,
-                                                           DWORD local_addr_len, DWORD remote_addr_len)                                                           
+/*
+ * Posts the zero-byte receive of a draining socket, unless the deadline has passed. The drain is counted as
+ * pending once for its whole run, so the receives only start and cancel the threadpool IO.
+ */
+firelink::ErrorCode firelink::platform::WinSocket::post_drain_recv(IOData* io_data)
 {
-  LPSOCKADDR local_addr_ptr = nullptr;
-  LPSOCKADDR remote_addr_ptr = nullptr;
-  int local_addr_len_out = 0;	// filled by get_accept_ex_sockaddrs
-  int remote_addr_len_out = 0;	// filled by get_accept_ex_sockaddrs
-
-  lpfn_get_accept_ex_sockaddrs_(buffer, 0, local_addr_len, remote_addr_len, &local_addr_ptr,
-                                &local_addr_len_out, &remote_addr_ptr, &remote_addr_len_out);
+  DrainState& drain = *std::get<std::shared_ptr<DrainState>>(io_data->user_handler_);
+  ErrorCode err = ErrorCode::Success;
 
-  if (local_addr_ptr == nullptr || remote_addr_ptr == nullptr)
+  AcquireSRWLockExclusive(&drain.lock_);
+  if (drain.phase_ != DrainPhase::Draining)
   {
-    return ErrorCode::SystemError;
+    err = ErrorCode::TimedOut;
   }
   else
   {
-    CopyMemory(local_addr, local_addr_ptr, local_addr_len_out);
-    CopyMemory(remote_addr, remote_addr_ptr, remote_addr_len_out);
+    io_data->overlapped_ = OVERLAPPED{};
+    StartThreadpoolIo(socket_io_handle_);
+
+    WSABUF wsa_buf{};
+    DWORD flags = 0;
+    if (WSARecv(socket_, &wsa_buf, 1, nullptr, &flags, &io_data->overlapped_, nullptr) == SOCKET_ERROR)
+    {
+      int error = WSAGetLastError();
+      if (error != ERROR_IO_PENDING)
+      {
+        CancelThreadpoolIo(socket_io_handle_);
+        err = static_cast<ErrorCode>(error);
+      }
+    }
   }
+  ReleaseSRWLockExclusive(&drain.lock_);
 
-  return ErrorCode::Success;
+  return err;
 }
 
 /*
- * Updates the properties of the accept_socket to match those of the listen_socket.
- * This function is called after the async Accept operation is completed.
+ * Discards what arrived on a draining socket. Only reads as much as FIONREAD reports, so the receives never
+ * block. Nothing to read although the zero-byte receive completed means the FIN (or an error) is next.
  */
-firelink::ErrorCode firelink::platform::WinSocket::update_accept_socket_context(firelink::platform::WinSocket* listen_socket,
-                                                                                firelink::platform::WinSocket* accept_socket)
+firelink::ErrorCode firelink::platform::WinSocket::drain_available(bool& fin_received)
 {
-  if (setsockopt(accept_socket->socket_, SOL_SOCKET, SO_UPDATE_ACCEPT_CONTEXT,
-                 reinterpret_cast<char*>(&listen_socket->socket_), sizeof(listen_socket->socket_)) == SOCKET_ERROR)
-  {
+  u_long available = 0;
+  if (ioctlsocket(socket_, FIONREAD, &available) == SOCKET_ERROR)
     return static_cast<ErrorCode>(WSAGetLastError());
+
+  std::shared_ptr<IOCore> io_core = io_core_.lock();
+  if (!io_core)
+    return ErrorCode::SystemError;
+
+  WinIOCore* win_core = static_cast<WinIOCore*>(io_core.get());
+  std::unique_ptr<DrainBuffer> buffer = win_core->take_drain_buffer();
+
+  ErrorCode err = ErrorCode::Success;
+  do
+  {
+    u_long len = std::min<u_long>(std::max<u_long>(available, 1), static_cast<u_long>(buffer->size()));
+    int res = ::recv(socket_, reinterpret_cast<char*>(buffer->data()), static_cast<int>(len), 0);
+    if (res == SOCKET_ERROR)
+    {
+      err = static_cast<ErrorCode>(WSAGetLastError());
+      break;
+    }
+
+    if (res == 0)
+    {
+      fin_received = true;
+      break;
+    }
+
+    available -= std::min<u_long>(available, static_cast<u_long>(res));
   }
+  while (available != 0);
 
-  return ErrorCode::Success;
+  win_core->give_drain_buffer(std::move(buffer));
+  return err;
 }
 
 /*
-  
- * Enables the previously set properties and options of the connect_socket
- * This function should be called after the async Connect operation is completed.
+ * Called by the IO routine for every completion. For the receive of a draining socket it drains and posts
+ * the next receive, then returns true while the drain goes on. Once it is done io_result is set to its
+ * outcome and the completion is handed to complete_io like any other.
  */
-firelink::ErrorCode firelink::platform::WinSocket::update_connect_socket_context(firelink::platform::WinSocket* connect_socket)
+bool firelink::platform::WinSocket::continue_drain(IOData* io_data, ULONG& io_result)
+{
+  if (!std::holds_alternative<std::shared_ptr<DrainState>>(io_data->user_handler_))
+    return false;
+
+  DrainState& drain = *std::get<std::shared_ptr<DrainState>>(io_data->user_handler_);
+  ErrorCode err = static_cast<ErrorCode>(static_cast<int>(io_result));
+  bool fin_received = false;
+
+  if (err == ErrorCode::Success && (io_state_.load(std::memory_order_acquire) & FIRELINK_SOCKET_CLOSING) == 0)
+  {
+    err = drain_available(fin_received);
+    if (err == ErrorCode::Success && !fin_received)
+    {
+      err = post_drain_recv(io_data);
+      if (err == ErrorCode::Success)
+        return true;
+    }
+  }
+
+  // Report the deadline or the close rather than the receive they aborted
+  AcquireSRWLockExclusive(&drain.lock_);
+  if (!fin_received)
+  {
+    if (drain.phase_ == DrainPhase::TimedOut)
+      err = ErrorCode::TimedOut;
+    else if ((io_state_.load(std::memory_order_acquire) & FIRELINK_SOCKET_CLOSING) != 0)
+      err = ErrorCode::OperationAborted;
+  }
+  drain.phase_ = DrainPhase::Finished;
+  ReleaseSRWLockExclusive(&drain.lock_);
+
+  // Outside the lock, a timer callback that already started takes it
+  WinIOCore::cancel_timer(drain.timer_);
+
+  io_result = static_cast<ULONG>(static_cast<int>(err));
+  return false;
+}
+
+/*
+ * Queues data for sending. Producers only push onto the lock-free send queue; the thread that finds no write in
+ * flight becomes the owner of the queue and starts the next write.
+ */
+firelink::ErrorCode firelink::platform::WinSocket::post_send(std::span<std::byte> data, WriteHandler handler)
+{
+  if (socket_ == INVALID_SOCKET)
+    return ErrorCode::NotASocket;
+
+  ErrorCode err = reserve_send(data.size());
+  if (err != ErrorCode::Success)
+    return err;
+
+  SendRequest* request = new SendRequest{};
+  request->data_ = data;
+  request->handler_ = std::move(handler);
+
+  SendRequest* head = send_queue_head_.load();
+  do
+  {
+    request->next_ = head;
+  }
+  while (!send_queue_head_.compare_exchange_weak(head, request));
+
+  if (!send_in_flight_.exchange(true))
+  {
+    io_state_.fetch_add(1, std::memory_order_acq_rel);
+    flush_send_queue();
+    if (io_finished())
+      finish_close();
+  }
+
+  return ErrorCode::Success;
+}
+
+/*
+ * Gathers queued sends into a single WSASend. Must only be called by the owner of send_in_flight_. Ownership is
+ * released here when the queue runs empty, otherwise it passes on to the completion of the write. The caller
+ * holds a count in io_state_, so a close can not finish while the queue is flushed.
+ */
+void firelink::platform::WinSocket::flush_send_queue()
+{
+  for (;;)
+  {
+    // Move everything pushed since the last flush to the end of the pending list, restoring FIFO order
+    SendRequest* pushed = send_queue_head_.exchange(nullptr);
+    SendRequest* reversed = nullptr;
+    SendRequest* reversed_tail = pushed;
+    while (pushed != nullptr)
+    {
+      SendRequest* next = pushed->next_;
+      pushed->next_ = reversed;
+      reversed = pushed;
+      pushed = next;
+    }
+
+    if (reversed != nullptr)
+    {
+      if (send_pending_tail_ != nullptr)
+        send_pending_tail_->next_ = reversed;
+      else
+        send_pending_head_ = reversed;
+
+      send_pending_tail_ = reversed_tail;
+    }
+
+    if (send_pending_head_ == nullptr)
+    {
+      send_in_flight_.store(false);
+
+      // A producer may have pushed after our exchange but still seen send_in_flight_ set. If so, take the
+      // ownership back and keep flushing, unless another producer got it first.
+      if (send_queue_head_.load() == nullptr || send_in_flight_.exchange(true))
+        return;
+
+      continue;
+    }
+
+    IOData* io_data = new IOData{};
+    io_data->socket_ = shared_from_this();
+    io_data->user_handler_ = SendBatch{};
+    io_data->operation_ = Operation::Send;
+    SendBatch& batch = std::get<SendBatch>(io_data->user_handler_);
+
+    while (send_pending_head_ != nullptr && batch.requests_.size() < FIRELINK_MAX_COALESCED_SENDS)
+    {
+      SendRequest* request = send_pending_head_;
+      send_pending_head_ = request->next_;
+      request->next_ = nullptr;
+
+      WSABUF wsa_buf{};
+      wsa_buf.buf = reinterpret_cast<char*>(request->data_.data());
+      wsa_buf.len = static_cast<ULONG>(request->data_.size());
+      batch.wsa_bufs_.push_back(wsa_buf);
+      batch.requests_.emplace_back(request);
+    }
+
+    if (send_pending_head_ == nullptr)
+      send_pending_tail_ = nullptr;
+
+    metrics_->operation_started(Operation::Send);
+    io_data->trace_id_ = trace_operation_id();
+    trace(TraceEvent::OperationSubmitted, this, io_data->trace_id_, Operation::Send);
+    io_data->submitted_ns_ = metrics_->latency_clock();
+    start_io();
+
+    DWORD flags = 0;
+    int res = WSASend(socket_, batch.wsa_bufs_.data(), static_cast<DWORD>(batch.wsa_bufs_.size()), nullptr, flags,
+                      &io_data->overlapped_, nullptr);
+
+    if (res == SOCKET_ERROR)
+    {
+      int error = WSAGetLastError();
+      if (error != ERROR_IO_PENDING)
+      {
+        CancelThreadpoolIo(socket_io_handle_);
+
+        // The requests were accepted by post_send, so the error is reported through their handlers.
+        io_data->error_code_ = static_cast<ErrorCode>(error);
+        io_data->completed_ns_ = metrics_->latency_clock();
+        metrics_->operation_completed(Operation::Send, io_data->error_code_, 0);
+        trace(TraceEvent::OperationCompleted, this, io_data->trace_id_, Operation::Send, io_data->error_code_);
+        complete_send_batch(io_data);
+        continue;
+      }
+    }
+
+    // The completion of this write continues flushing
+    return;
+  }
+}
+
+/*
+ * Distributes the bytes written over the requests of a completed batch in queue order and hands the batch
+ * over to the user threadpool. Takes ownership of io_data, see release_io_data.
+ */
+void firelink::platform::WinSocket::complete_send_batch(IOData* io_data)
+{
+  SendBatch& batch = std::get<SendBatch>(io_data->user_handler_);
+  WinSocket* caller = static_cast<WinSocket*>(io_data->socket_.get());
+
+  std::int32_t remaining = io_data->bytes_transferred_;
+  std::size_t batch_size = 0;
+  bool has_handler = false;
+  for (std::unique_ptr<SendRequest>& request : batch.requests_)
+  {
+    std::int32_t size = static_cast<std::int32_t>(request->data_.size());
+    request->bytes_transferred_ = remaining < size ? remaining : size;
+    remaining -= request->bytes_transferred_;
+    batch_size += request->data_.size();
+
+    if (bool(request->handler_))
+      has_handler = true;
+  }
+
+  caller->release_send(batch_size);
+
+  if (!has_handler)
+  {
+    release_io_data(io_data);
+    return;
+  }
+
+  if (std::shared_ptr<IOCore> io_core = caller->io_core_.lock())
+  {
+    ErrorCode err = caller->post_handler(io_core.get(), caller->nic_node_, [io_data]() mutable
+    {
+      std::uint64_t started_ns = handler_started(io_data);
+      run_send_batch_handlers(io_data);
+      handler_finished(io_data, started_ns);
+      release_io_data(io_data);
+    });
+
+    if (err == ErrorCode::Success)
+      return;
+
+    // Failed to post user work. Call handlers manually.
+    // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
+    if (io_data->error_code_ == ErrorCode::Success)
+      io_data->error_code_ = err;
+  }
+
+  run_send_batch_handlers(io_data);
+  release_io_data(io_data);
+}
+
+void firelink::platform::WinSocket::run_send_batch_handlers(IOData* io_data)
+{
+  SendBatch& batch = std::get<SendBatch>(io_data->user_handler_);
+  for (std::unique_ptr<SendRequest>& request : batch.requests_)
+  {
+    if (bool(request->handler_))
+      request->handler_(io_data->socket_, io_data->error_code_, request->bytes_transferred_, WriteTag{});
+  }
+}
+
+/*
+ * Cancels all outstanding asynchronous operations on the socket.
+ */
+firelink::ErrorCode firelink::platform::WinSocket::cancel()
+{
+  if (CancelIoEx(reinterpret_cast<HANDLE>(socket_), nullptr) == FALSE)
+  {
+    DWORD error = GetLastError();
+
+    // Nothing to cancel
+    if (error == ERROR_NOT_FOUND)
+      return ErrorCode::Success;
+
+    return static_cast<ErrorCode>(static_cast<int>(error));
+  }
+
+  return ErrorCode::Success;
+}
+
+/*
+ * Closes the socket without waiting for the callbacks of its pending operations. The handle is closed right
+ * away, which aborts the operations, and the IO object is closed by whoever completes the last of them.
+ * A handle that was disconnected for reuse is kept open for recycling if nothing is pending.
+ */
+firelink::ErrorCode firelink::platform::WinSocket::start_close(CloseHandler handler)
+{
+  if (close_started_.exchange(true, std::memory_order_acq_rel))
+    return ErrorCode::AlreadyInProgress;
+
+  if (socket_ != INVALID_SOCKET)
+    trace(TraceEvent::SocketClosed, this);
+
+  // Published by the fetch_or below, before anyone can finish the close
+  close_handler_ = std::move(handler);
+  close_self_ = shared_from_this();
+  close_error_ = ErrorCode::Success;
+
+  if (!handle_reusable_ || (io_state_.load(std::memory_order_acquire) & ~FIRELINK_SOCKET_CLOSING) != 0)
+  {
+    handle_reusable_ = false;
+    SOCKET s = std::exchange(socket_, INVALID_SOCKET);
+    if (s != INVALID_SOCKET && closesocket(s) == SOCKET_ERROR)
+      close_error_ = static_cast<ErrorCode>(WSAGetLastError());
+  }
+
+  std::uint32_t state = io_state_.fetch_or(FIRELINK_SOCKET_CLOSING, std::memory_order_acq_rel);
+  if ((state & ~FIRELINK_SOCKET_CLOSING) == 0)
+    finish_close();
+
+  return ErrorCode::Success;
+}
+
+// Counts an operation as pending before it is submitted to the IO threadpool
+void firelink::platform::WinSocket::start_io()
+{
+  io_state_.fetch_add(1, std::memory_order_acq_rel);
+  StartThreadpoolIo(socket_io_handle_);
+}
+
+// The submission failed right away, no callback will come for it
+void firelink::platform::WinSocket::cancel_io()
+{
+  CancelThreadpoolIo(socket_io_handle_);
+  if (io_finished())
+    finish_close();
+}
+
+// Returns true if this was the last pending operation of a closing socket, the caller then finishes the close
+bool firelink::platform::WinSocket::io_finished()
+{
+  return io_state_.fetch_sub(1, std::memory_order_acq_rel) == (FIRELINK_SOCKET_CLOSING | 1);
+}
+
+/*
+ * Releases the IO object and the handle of a socket closed with start_close once nothing is pending on it,
+ * then posts the close handler. The socket can be given a new handle with socket() afterwards. Only the
+ * caller that takes io_state_ from the bare closing flag to 0 finishes the close, any other call returns.
+ */
+void firelink::platform::WinSocket::finish_close()
+{
+  std::uint32_t closing = FIRELINK_SOCKET_CLOSING;
+  if (!io_state_.compare_exchange_strong(closing, 0, std::memory_order_acq_rel))
+    return;
+
+  if (socket_io_handle_ != nullptr)
+  {
+    if (recycle_handle())
+      socket_ = INVALID_SOCKET;
+    else
+      CloseThreadpoolIo(socket_io_handle_);
+
+    socket_io_handle_ = nullptr;
+  }
+
+  if (socket_ != INVALID_SOCKET && closesocket(socket_) == SOCKET_ERROR)
+    close_error_ = static_cast<ErrorCode>(WSAGetLastError());
+
+  socket_ = INVALID_SOCKET;
+  addr_family_ = AddressFamily::NotSupported;
+  sock_type_ = SocketType::NotSupported;
+  protocol_ = Protocol::NotSupported;
+  is_bound_ = false;
+
+  std::shared_ptr<Socket> self = std::move(close_self_);
+  CloseHandler handler = std::move(close_handler_);
+  ErrorCode error = close_error_;
+  close_started_.store(false, std::memory_order_release);
+
+  if (!bool(handler))
+    return;
+
+  if (std::shared_ptr<IOCore> io_core = io_core_.lock())
+  {
+    ErrorCode err = post_handler(io_core.get(), nic_node_, [self, handler, error]()
+    {
+      handler(self, error, CloseTag{});
+    });
+
+    if (err == ErrorCode::Success)
+      return;
+  }
+
+  // Failed to post user work. Call handler manually.
+  handler(self, error, CloseTag{});
+}
+
+/*
+ * Gives a handle that was disconnected with TF_REUSE_SOCKET to the IOCore, where a new socket of the same
+ * family, type and protocol picks it up. Returns false if the handle must be closed instead.
+ */
+bool firelink::platform::WinSocket::recycle_handle()
+{
+  if (!handle_reusable_ || socket_ == INVALID_SOCKET || socket_io_handle_ == nullptr)
+    return false;
+
+  handle_reusable_ = false;
+
+  std::shared_ptr<IOCore> c = io_core_.lock();
+  if (!c)
+    return false;
+
+  WinIOCore* win_core = static_cast<WinIOCore*>(c.get());
+  return win_core->get_socket_recycler()->give_handle(addr_family_, sock_type_, protocol_, node_, socket_, socket_io_handle_);
+}
+
+/*
+ * The NUMA node of the NIC queue that receive side scaling assigned to the connection, -1 if it is unknown,
+ * the IOCore is not NUMA-aware or the machine has a single node.
+ */
+std::int32_t firelink::platform::WinSocket::query_nic_node() const
+{
+  if (!numa_->enabled())
+    return -1;
+
+  SOCKET_PROCESSOR_AFFINITY affinity{};
+  DWORD bytes_returned = 0;
+  if (WSAIoctl(socket_, SIO_QUERY_RSS_PROCESSOR_INFO, nullptr, 0, &affinity, sizeof(affinity),
+               &bytes_returned, nullptr, nullptr) == SOCKET_ERROR)
+  {
+    return -1;
+  }
+
+  return affinity.NumaNodeId == MAXUSHORT ? -1 : static_cast<std::int32_t>(affinity.NumaNodeId);
+}
+
+/*
+ * Posts a handler to the user threadpool. A NUMA-aware IOCore runs it on the connection's NIC node, or on the
+ * node the socket is served from while the NIC node is unknown.
+ */
+firelink::ErrorCode firelink::platform::WinSocket::post_handler(IOCore* io_core, std::int32_t nic_node,
+                                                                std::move_only_function<void()>&& work)
+{
+  WinIOCore* win_core = static_cast<WinIOCore*>(io_core);
+  if (!win_core->is_numa_aware())
+    return io_core->post_user_work(std::move(work));
+
+  return win_core->post_user_work_on(nic_node >= 0 ? static_cast<std::uint32_t>(nic_node) : node_, std::move(work));
+}
+
+/*
+ * Accounts n bytes as queued for sending and applies the overflow policy if the hard cap would be exceeded.
+ */
+firelink::ErrorCode firelink::platform::WinSocket::reserve_send(std::size_t n)
+{
+  ErrorCode err = acquire_send_bytes(n);
+  if (err == ErrorCode::NoBufferSpace && send_limits_.overflow_policy_ == SendOverflowPolicy::Disconnect)
+  {
+    cancel();
+    ::shutdown(socket_, SD_BOTH);
+    return ErrorCode::ConnectionAborted;
+  }
+
+  return err;
+}
+
+/*
+ * Releases n bytes of queued send data and posts the drain handler if the queue fell to the low watermark.
+ */
+void firelink::platform::WinSocket::release_send(std::size_t n)
+{
+  if (!release_send_bytes(n) || !bool(drain_handler_))
+    return;
+
+  if (std::shared_ptr<IOCore> io_core = io_core_.lock())
+  {
+    std::shared_ptr<Socket> self = shared_from_this();
+    std::size_t queued = get_queued_send_bytes();
+    ErrorCode err = post_handler(io_core.get(), nic_node_, [self, queued]()
+    {
+      static_cast<WinSocket*>(self.get())->drain_handler_(self, queued, DrainTag{});
+    });
+
+    // Failed to post user work. Call handler manually.
+    if (err != ErrorCode::Success)
+      drain_handler_(self, queued, DrainTag{});
+  }
+}
+
+/*
+ * Sets a socket option.
+ */
+firelink::ErrorCode firelink::platform::WinSocket::set_socket_option(SocketOptionLevel level, SocketOption option,
+                                      std::span<const std::byte> value)
+{
+  if (value.empty()) 
+    return ErrorCode::InvalidArgument;
+    
+  int winsock_level = static_cast<int>(level);
+  int winsock_option = static_cast<int>(option);
+  
+  if(winsock_level == -1 || winsock_option == -1)
+    return ErrorCode::InvalidArgument;
+
+  const char* opt_val = reinterpret_cast<const char*>(value.data());
+  int opt_len = static_cast<int>(value.size());
+  
+  if (setsockopt(socket_, winsock_level, winsock_option, opt_val, opt_len) != 0)
+    return static_cast<ErrorCode>(WSAGetLastError());
+
+  return ErrorCode::Success;
+}
+
+/*
+ * Gets a socket option.
+ */
+firelink::ErrorCode firelink::platform::WinSocket::get_socket_option(SocketOptionLevel level, SocketOption option,
+                                          std::span<std::byte> value,
+                                          std::size_t& value_size_out)
+{
+  int winsock_level = static_cast<int>(level);
+  int winsock_option = static_cast<int>(option);
+  
+  if(winsock_level == -1 || winsock_option == -1)
+    return static_cast<ErrorCode>(WSAEINVAL);
+
+  char* opt_val = reinterpret_cast<char*>(value.data());
+  int opt_len = static_cast<int>(value.size());
+  
+  if (getsockopt(socket_, winsock_level, winsock_option, opt_val, &opt_len) != 0)
+    return static_cast<ErrorCode>(WSAGetLastError());
+
+  value_size_out = static_cast<std::size_t>(opt_len);
+  
+  return ErrorCode::Success;
+}
+
+firelink::ErrorCode firelink::platform::WinSocket::get_sock_name(firelink::Endpoint& ep)
+{
+  SOCKADDR_STORAGE addr{};
+  int name_len = sizeof(addr);
+  int result = ::getsockname(socket_, reinterpret_cast<PSOCKADDR>(&addr), &name_len);
+  if(result == SOCKET_ERROR)
+    return static_cast<ErrorCode>(WSAGetLastError());
+   
+  return sockaddr_to_endpoint(addr, ep);  
+}
+
+firelink::ErrorCode firelink::platform::WinSocket::get_peer_name(firelink::Endpoint& ep)
+{
+  SOCKADDR_STORAGE addr{};
+  int name_len = sizeof(addr);
+  int result = ::getpeername(socket_, reinterpret_cast<PSOCKADDR>(&addr), &name_len);
+  if(result == SOCKET_ERROR)
+    return static_cast<ErrorCode>(WSAGetLastError());
+   
+  return sockaddr_to_endpoint(addr, ep);  
+}
+
+firelink::ErrorCode firelink::platform::WinSocket::get_acceptex_sockaddrs(PVOID buffer, LPSOCKADDR_STORAGE local_addr, LPSOCKADDR_STORAGE remote_addr,
+                                                           DWORD local_addr_len, DWORD remote_addr_len)                                                           
+{
+  LPSOCKADDR local_addr_ptr = nullptr;
+  LPSOCKADDR remote_addr_ptr = nullptr;
+  int local_addr_len_out = 0;	// filled by get_accept_ex_sockaddrs
+  int remote_addr_len_out = 0;	// filled by get_accept_ex_sockaddrs
+
+  lpfn_get_accept_ex_sockaddrs_(buffer, 0, local_addr_len, remote_addr_len, &local_addr_ptr,
+                                &local_addr_len_out, &remote_addr_ptr, &remote_addr_len_out);
+
+  if (local_addr_ptr == nullptr || remote_addr_ptr == nullptr)
+  {
+    return ErrorCode::SystemError;
+  }
+  else
+  {
+    CopyMemory(local_addr, local_addr_ptr, local_addr_len_out);
+    CopyMemory(remote_addr, remote_addr_ptr, remote_addr_len_out);
+  }
+
+  return ErrorCode::Success;
+}
+
+/*
+ * Updates the properties of the accept_socket to match those of the listen_socket.
+ * This function is called after the async Accept operation is completed.
+ */
+firelink::ErrorCode firelink::platform::WinSocket::update_accept_socket_context(firelink::platform::WinSocket* listen_socket,
+                                                                                firelink::platform::WinSocket* accept_socket)
+{
+  if (setsockopt(accept_socket->socket_, SOL_SOCKET, SO_UPDATE_ACCEPT_CONTEXT,
+                 reinterpret_cast<char*>(&listen_socket->socket_), sizeof(listen_socket->socket_)) == SOCKET_ERROR)
+  {
+    return static_cast<ErrorCode>(WSAGetLastError());
+  }
+
+  return ErrorCode::Success;
+}
+
+/*
+  
+ * Enables the previously set properties and options of the connect_socket
+ * This function should be called after the async Connect operation is completed.
+ */
+firelink::ErrorCode firelink::platform::WinSocket::update_connect_socket_context(firelink::platform::WinSocket* connect_socket)
 {
   if (setsockopt(connect_socket->socket_, SOL_SOCKET, SO_UPDATE_CONNECT_CONTEXT, nullptr, 0) == SOCKET_ERROR)
   {
@@ -785,12 +1657,34 @@ firelink::ErrorCode firelink::platform::WinSocket::update_connect_socket_context
   return ErrorCode::Success;
 }
 
+/*
+ * Records how long a completion waited for a user thread and traces the handler dispatch. Returns the handler
+ * start time for handler_finished.
+ */
+std::uint64_t firelink::platform::WinSocket::handler_started(IOData* io_data)
+{
+  trace(TraceEvent::HandlerDispatched, io_data->socket_.get(), io_data->trace_id_, io_data->operation_);
+
+  WinSocket* socket = static_cast<WinSocket*>(io_data->socket_.get());
+  socket->numa_->record_handler(socket->nic_node_);
+
+  std::uint64_t started_ns = socket->metrics_->latency_clock();
+  socket->metrics_->record_latency(io_data->operation_, LatencyStage::Dispatch, io_data->completed_ns_, started_ns);
+  return started_ns;
+}
+
+void firelink::platform::WinSocket::handler_finished(IOData* io_data, std::uint64_t started_ns)
+{
+  MetricsRegistry* metrics = static_cast<WinSocket*>(io_data->socket_.get())->metrics_.get();
+  metrics->record_latency(io_data->operation_, LatencyStage::Handler, started_ns, metrics->latency_clock());
+
+  trace(TraceEvent::HandlerFinished, io_data->socket_.get(), io_data->trace_id_, io_data->operation_);
+}
+
 /*
  * This is the socket IO thread pool work function, that handles the completion of async socket operations
  * such as start_accept, start_send, etc. The completed operations are then forwarded to the callback threadpool
  * that calls the user-defined handlers.
- *
- * IMPORTANT: If changes are made, be sure to double check that io data gets released accordingly!!!
  */
 VOID CALLBACK firelink::platform::WinSocket::socket_io_routine(PTP_CALLBACK_INSTANCE instance, PVOID context, PVOID overlapped,
                                                    ULONG io_result, ULONG_PTR n_bytes_transferred, PTP_IO io)
@@ -803,224 +1697,385 @@ VOID CALLBACK firelink::platform::WinSocket::socket_io_routine(PTP_CALLBACK_INST
   
   if(io_data)
   {
-    WinSocket* caller = static_cast<WinSocket*>(io_data->socket_.get());
-    io_data->bytes_transferred_ = static_cast<std::int32_t>(n_bytes_transferred);
-    io_data->error_code_ = static_cast<ErrorCode>(static_cast<int>(io_result));
+    WinSocket* socket = static_cast<WinSocket*>(io_data->socket_.get());
+    enter_threadpool_callback(socket->io_placement_);
+
+    // A draining socket posted its next receive, the drain is still pending
+    if (socket->continue_drain(io_data, io_result))
+      return;
 
-    // Returning true from the std::visit lambda indicates that user handler work was posted
-    // and that io_data must NOT be released yet. 
-    if (std::visit([&io_data, &caller](auto&& handler)
+    // The operation stays pending until its handler ran, see release_io_data
+    complete_io(io_data, io_result, n_bytes_transferred);
+  }
+}
+
+void firelink::platform::DispatchTestHook::complete_io(IOData* io_data, ULONG io_result, ULONG_PTR n_bytes_transferred)
+{
+  // Counted like a submitted operation, complete_io releases it
+  static_cast<WinSocket*>(io_data->socket_.get())->io_state_.fetch_add(1, std::memory_order_acq_rel);
+  WinSocket::complete_io(io_data, io_result, n_bytes_transferred);
+}
+
+/*
+ * Deletes the IOData of a completed operation after its handler ran. Only then does the operation stop
+ * counting as pending, so the handler of the last operation of a closing socket runs before the close handler
+ * is posted.
+ */
+void firelink::platform::WinSocket::release_io_data(IOData* io_data)
+{
+  std::shared_ptr<Socket> self = std::move(io_data->socket_);
+  delete io_data;
+
+  WinSocket* socket = static_cast<WinSocket*>(self.get());
+  if (socket->io_finished())
+    socket->finish_close();
+}
+
+/*
+ * Completes an operation: records it, dispatches on the handler type and posts the user handler to the
+ * callback threadpool. io_data is released with release_io_data once the handler ran.
+ *
+ * IMPORTANT: If changes are made, be sure to double check that io data gets released accordingly!!!
+ */
+void firelink::platform::WinSocket::complete_io(IOData* io_data, ULONG io_result, ULONG_PTR n_bytes_transferred)
+{
+  WinSocket* caller = static_cast<WinSocket*>(io_data->socket_.get());
+  io_data->bytes_transferred_ = static_cast<std::int32_t>(n_bytes_transferred);
+  io_data->error_code_ = static_cast<ErrorCode>(static_cast<int>(io_result));
+  io_data->completed_ns_ = caller->metrics_->latency_clock();
+  caller->metrics_->operation_completed(io_data->operation_, io_data->error_code_, io_data->bytes_transferred_);
+  caller->metrics_->record_latency(io_data->operation_, LatencyStage::Completion, io_data->submitted_ns_, io_data->completed_ns_);
+  trace(TraceEvent::OperationCompleted, caller, io_data->trace_id_, io_data->operation_,
+        io_data->error_code_, io_data->bytes_transferred_);
+  caller->numa_->record_completion(caller->nic_node_);
+
+  // Returning true from the std::visit lambda indicates that user handler work was posted
+  // and that io_data must NOT be released yet. 
+  if (std::visit([&io_data, &caller](auto&& handler)
+  {
+    using HandlerType = std::decay_t<decltype(handler)>;
+    if constexpr (std::is_same_v<HandlerType, AcceptHandler>)
     {
-      using HandlerType = std::decay_t<decltype(handler)>;
-      if constexpr (std::is_same_v<HandlerType, AcceptHandler>)
+      AcceptData& accept = *io_data->accept_;
+      WinSocket* accept_win_socket = static_cast<WinSocket*>(accept.accept_socket_.get());
+      if(accept_win_socket)
       {
-        WinSocket* accept_win_socket = static_cast<WinSocket*>(io_data->accept_socket_.get());
-        if(accept_win_socket)
+        ErrorCode err = update_accept_socket_context(caller, accept_win_socket);
+        if(err != ErrorCode::Success)
         {
-          ErrorCode err = update_accept_socket_context(caller, accept_win_socket);
-          if(err != ErrorCode::Success)
-          {
-            // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
-            if(io_data->error_code_ == ErrorCode::Success)
-              io_data->error_code_ = err;
-          }
+          // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
+          if(io_data->error_code_ == ErrorCode::Success)
+            io_data->error_code_ = err;
         }
         else
-        { 
+        {
+          accept_win_socket->nic_node_ = accept_win_socket->query_nic_node();
+        }
+      }
+      else
+      { 
+        // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
+        if(io_data->error_code_ == ErrorCode::Success)
+          io_data->error_code_ = ErrorCode::SystemError;
+      }
+
+      // Checks if user has supplied a handler function
+      if(bool(handler))
+      {
+        // Use the windows extended sock function (get_accept_ex_sockaddrs) for a fast retrieval of addresses
+        ErrorCode err = get_acceptex_sockaddrs(accept.accept_address_buffer_.data(), &accept.local_win_addr_, &accept.peer_win_addr_,
+                                               sizeof(SOCKADDR_STORAGE) + 16, sizeof(SOCKADDR_STORAGE) + 16);
+        if(err != ErrorCode::Success)
+        {
           // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
           if(io_data->error_code_ == ErrorCode::Success)
-            io_data->error_code_ = ErrorCode::SystemError;
+            io_data->error_code_ = err; 
+        }
+      
+        Endpoint local_ep{};
+        Endpoint peer_ep{};
+      
+        err = sockaddr_to_endpoint(accept.local_win_addr_, local_ep);
+        if(err != ErrorCode::Success)
+        {
+          if(io_data->error_code_ == ErrorCode::Success)
+            io_data->error_code_ = err;
         }
 
-        // Checks if user has supplied a handler function
-        if(bool(handler))
+        err = sockaddr_to_endpoint(accept.peer_win_addr_, peer_ep);
+        if(err != ErrorCode::Success)
         {
-          // Use the windows extended sock function (get_accept_ex_sockaddrs) for a fast retrieval of addresses
-          ErrorCode err = get_acceptex_sockaddrs(io_data->accept_address_buffer_.data(), &io_data->local_win_addr_, &io_data->peer_win_addr_,
-                                                 sizeof(SOCKADDR_STORAGE) + 16, sizeof(SOCKADDR_STORAGE) + 16);
-          if(err != ErrorCode::Success)
+          if(io_data->error_code_ == ErrorCode::Success)
+            io_data->error_code_ = err;
+        }
+
+        if (std::shared_ptr<IOCore> io_core = caller->io_core_.lock())
+        {
+          // Steered to the node of the accepted connection, the listener has no NIC node of its own
+          std::int32_t nic_node = accept_win_socket ? accept_win_socket->nic_node_ : -1;
+          err = caller->post_handler(io_core.get(), nic_node, [io_data, handler, local_ep, peer_ep]() mutable
           {
-            // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
-            if(io_data->error_code_ == ErrorCode::Success)
-              io_data->error_code_ = err; 
+            std::uint64_t started_ns = handler_started(io_data);
+            handler(io_data->socket_, std::move(io_data->accept_->accept_socket_), local_ep, peer_ep, io_data->error_code_,  AcceptTag{});
+            handler_finished(io_data, started_ns);
+            release_io_data(io_data);
+          });
+
+          if(err == ErrorCode::Success)
+          {
+            return true;
           }
-        
-          Endpoint local_ep{};
-          Endpoint peer_ep{};
-        
-          err = sockaddr_to_endpoint(io_data->local_win_addr_, local_ep);
-          if(err != ErrorCode::Success)
+          // Failed to post user work. Call handler manually.
+          else
           {
+            // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
             if(io_data->error_code_ == ErrorCode::Success)
               io_data->error_code_ = err;
+
+            handler(io_data->socket_, std::move(io_data->accept_->accept_socket_), local_ep, peer_ep, io_data->error_code_,  AcceptTag{});
           }
+        }
+      }
+    }
+    else if constexpr (std::is_same_v<HandlerType, ConnectHandler>)
+    {
+      ErrorCode err = update_connect_socket_context(caller);
+      if(err != ErrorCode::Success)
+      {
+        // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
+        if(io_data->error_code_ == ErrorCode::Success)
+          io_data->error_code_ = err;    
+      }
+      else if(io_data->error_code_ == ErrorCode::Success)
+      {
+        caller->nic_node_ = caller->query_nic_node();
+      }
 
-          err = sockaddr_to_endpoint(io_data->peer_win_addr_, peer_ep);
-          if(err != ErrorCode::Success)
+      // Checks if user has supplied a handler function
+      if(bool(handler))
+      {
+        if (std::shared_ptr<IOCore> io_core = caller->io_core_.lock())
+        {
+          err = caller->post_handler(io_core.get(), caller->nic_node_, [io_data, handler]() mutable
+          {
+            std::uint64_t started_ns = handler_started(io_data);
+            handler(io_data->socket_, io_data->error_code_, ConnectTag{});
+            handler_finished(io_data, started_ns);
+            release_io_data(io_data);
+          });
+
+          if(err == ErrorCode::Success)
           {
+            return true;
+          }
+          // Failed to post user work. Call handler manually.
+          else
+          {
+            // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
             if(io_data->error_code_ == ErrorCode::Success)
               io_data->error_code_ = err;
+
+            handler(io_data->socket_, io_data->error_code_, ConnectTag{});             
           }
+        }
+      }
+    }
+    else if constexpr (std::is_same_v<HandlerType, ReadHandler>)
+    {
+      // Checks if user has supplied a handler function
+      if(bool(handler))
+      {
+        if (std::shared_ptr<IOCore> io_core = caller->io_core_.lock())
+        {
+          ErrorCode err = caller->post_handler(io_core.get(), caller->nic_node_, [io_data, handler]() mutable
+          {
+            std::uint64_t started_ns = handler_started(io_data);
+            handler(io_data->socket_, io_data->error_code_, io_data->bytes_transferred_, ReadTag{});
+            handler_finished(io_data, started_ns);
+            release_io_data(io_data);
+          });
 
-          if (std::shared_ptr<IOCore> io_core = caller->io_core_.lock())
+          if(err == ErrorCode::Success)
           {
-            err = io_core->post_user_work([io_data, handler, local_ep, peer_ep]() mutable
-            {
-              handler(io_data->socket_, std::move(io_data->accept_socket_), local_ep, peer_ep, io_data->error_code_,  AcceptTag{});
-              delete io_data;
-            });
-
-            if(err == ErrorCode::Success)
-            {
-              return true;
-            }
-            // Failed to post user work. Call handler manually.
-            else
-            {
-              // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
-              if(io_data->error_code_ == ErrorCode::Success)
-                io_data->error_code_ = err;
-
-              handler(io_data->socket_, std::move(io_data->accept_socket_), local_ep, peer_ep, io_data->error_code_,  AcceptTag{});
-            }
+            return true;
+          }
+          // Failed to post user work. Call handler manually.
+          else
+          {
+            // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
+            if(io_data->error_code_ == ErrorCode::Success)
+              io_data->error_code_ = err;
+
+            handler(io_data->socket_, io_data->error_code_, io_data->bytes_transferred_, ReadTag{});
           }
         }
       }
-      else if constexpr (std::is_same_v<HandlerType, ConnectHandler>)
+    }
+    else if constexpr (std::is_same_v<HandlerType, DatagramHandler>)
+    {
+      // Checks if user has supplied a handler function
+      if(bool(handler))
       {
-        ErrorCode err = update_connect_socket_context(caller);
-        if(err != ErrorCode::Success)
+        Endpoint peer_ep{};
+        if(io_data->error_code_ == ErrorCode::Success)
         {
-          // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
-          if(io_data->error_code_ == ErrorCode::Success)
-            io_data->error_code_ = err;    
+          ErrorCode err = sockaddr_to_endpoint(io_data->peer_win_addr_, peer_ep);
+          if(err != ErrorCode::Success)
+            io_data->error_code_ = err;
         }
 
-        // Checks if user has supplied a handler function
-        if(bool(handler))
+        if (std::shared_ptr<IOCore> io_core = caller->io_core_.lock())
         {
-          if (std::shared_ptr<IOCore> io_core = caller->io_core_.lock())
+          ErrorCode err = caller->post_handler(io_core.get(), caller->nic_node_, [io_data, handler, peer_ep]() mutable
+          {
+            std::uint64_t started_ns = handler_started(io_data);
+            handler(io_data->socket_, io_data->error_code_, io_data->bytes_transferred_, peer_ep, ReadTag{});
+            handler_finished(io_data, started_ns);
+            release_io_data(io_data);
+          });
+
+          if(err == ErrorCode::Success)
           {
-            err = io_core->post_user_work([io_data, handler]() mutable
-            {
-              handler(io_data->socket_, io_data->error_code_, ConnectTag{});
-              delete io_data;
-            });
-
-            if(err == ErrorCode::Success)
-            {
-              return true;
-            }
-            // Failed to post user work. Call handler manually.
-            else
-            {
-              // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
-              if(io_data->error_code_ == ErrorCode::Success)
-                io_data->error_code_ = err;
-
-              handler(io_data->socket_, io_data->error_code_, ConnectTag{});             
-            }
+            return true;
+          }
+          // Failed to post user work. Call handler manually.
+          else
+          {
+            // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
+            if(io_data->error_code_ == ErrorCode::Success)
+              io_data->error_code_ = err;
+
+            handler(io_data->socket_, io_data->error_code_, io_data->bytes_transferred_, peer_ep, ReadTag{});
           }
         }
       }
-      else if constexpr (std::is_same_v<HandlerType, ReadHandler>)
+    }
+    else if constexpr (std::is_same_v<HandlerType, WriteHandler>)
+    {
+      caller->release_send(io_data->user_buffer_.size());
+
+      // Checks if user has supplied a handler function
+      if(bool(handler))
       {
-        // Checks if user has supplied a handler function
-        if(bool(handler))
+        if (std::shared_ptr<IOCore> io_core = caller->io_core_.lock())
         {
-          if (std::shared_ptr<IOCore> io_core = caller->io_core_.lock())
+          ErrorCode err = caller->post_handler(io_core.get(), caller->nic_node_, [io_data, handler]() mutable
+          {
+            std::uint64_t started_ns = handler_started(io_data);
+            handler(io_data->socket_, io_data->error_code_, io_data->bytes_transferred_, WriteTag{});
+            handler_finished(io_data, started_ns);
+            release_io_data(io_data);
+          });
+
+          if(err == ErrorCode::Success)
           {
-            ErrorCode err = io_core->post_user_work([io_data, handler]() mutable
-            {
-              handler(io_data->socket_, io_data->error_code_, io_data->bytes_transferred_, ReadTag{});
-              delete io_data;
-            });
-
-            if(err == ErrorCode::Success)
-            {
-              return true;
-            }
-            // Failed to post user work. Call handler manually.
-            else
-            {
-              // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
-              if(io_data->error_code_ == ErrorCode::Success)
-                io_data->error_code_ = err;
-
-              handler(io_data->socket_, io_data->error_code_, io_data->bytes_transferred_, ReadTag{});
-            }
+            return true;
+          }
+          // Failed to post user work. Call handler manually.
+          else
+          {
+            // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
+            if(io_data->error_code_ == ErrorCode::Success)
+              io_data->error_code_ = err;
+
+            handler(io_data->socket_, io_data->error_code_, io_data->bytes_transferred_, WriteTag{});
           }
         }
       }
-      else if constexpr (std::is_same_v<HandlerType, WriteHandler>)
+    }
+    else if constexpr (std::is_same_v<HandlerType, SendBatch>)
+    {
+      UNREFERENCED_PARAMETER(handler);
+
+      // Keep the socket alive, io_data may be released by the user threadpool before we flush again. The
+      // count taken here keeps a close from finishing in between.
+      std::shared_ptr<Socket> socket = io_data->socket_;
+      caller->io_state_.fetch_add(1, std::memory_order_acq_rel);
+      complete_send_batch(io_data);
+
+      // This write owned the send queue, continue with whatever was queued meanwhile.
+      caller->flush_send_queue();
+      if (caller->io_finished())
+        caller->finish_close();
+      return true;
+    }
+    else if constexpr (std::is_same_v<HandlerType, std::shared_ptr<DrainState>>)
+    {
+      // Checks if user has supplied a handler function
+      DisconnectHandler& disconnect_handler = handler->handler_;
+      if(bool(disconnect_handler))
       {
-        // Checks if user has supplied a handler function
-        if(bool(handler))
+        if (std::shared_ptr<IOCore> io_core = caller->io_core_.lock())
         {
-          if (std::shared_ptr<IOCore> io_core = caller->io_core_.lock())
+          ErrorCode err = caller->post_handler(io_core.get(), caller->nic_node_, [io_data, disconnect_handler]() mutable
+          {
+            std::uint64_t started_ns = handler_started(io_data);
+            disconnect_handler(io_data->socket_, io_data->error_code_, DisconnectTag{});
+            handler_finished(io_data, started_ns);
+            release_io_data(io_data);
+          });
+
+          if(err == ErrorCode::Success)
           {
-            ErrorCode err = io_core->post_user_work([io_data, handler]() mutable
-            {
-              handler(io_data->socket_, io_data->error_code_, io_data->bytes_transferred_, WriteTag{});
-              delete io_data;
-            });
-
-            if(err == ErrorCode::Success)
-            {
-              return true;
-            }
-            // Failed to post user work. Call handler manually.
-            else
-            {
-              // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
-              if(io_data->error_code_ == ErrorCode::Success)
-                io_data->error_code_ = err;
-
-              handler(io_data->socket_, io_data->error_code_, io_data->bytes_transferred_, WriteTag{});
-            }
+            return true;
+          }
+          // Failed to post user work. Call handler manually.
+          else
+          {
+            // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
+            if(io_data->error_code_ == ErrorCode::Success)
+              io_data->error_code_ = err;
+
+            disconnect_handler(io_data->socket_, io_data->error_code_, DisconnectTag{});
           }
         }
       }
-      else if constexpr (std::is_same_v<HandlerType, DisconnectHandler>)
+    }
+    else if constexpr (std::is_same_v<HandlerType, DisconnectHandler>)
+    {
+      // The handle can be given to a new socket once this one is closed or destroyed
+      if (io_data->reuse_socket_ && io_data->error_code_ == ErrorCode::Success)
+        caller->handle_reusable_ = true;
+
+      // Checks if user has supplied a handler function
+      if(bool(handler))
       {
-        // Checks if user has supplied a handler function
-        if(bool(handler))
+        if (std::shared_ptr<IOCore> io_core = caller->io_core_.lock())
         {
-          if (std::shared_ptr<IOCore> io_core = caller->io_core_.lock())
+          ErrorCode err = caller->post_handler(io_core.get(), caller->nic_node_, [io_data, handler]() mutable
           {
-            ErrorCode err = io_core->post_user_work([io_data, handler]() mutable
-            {
-              handler(io_data->socket_, io_data->error_code_, DisconnectTag{});
-              delete io_data;
-            });
-
-            if(err == ErrorCode::Success)
-            {
-              return true;
-            }
-            // Failed to post user work. Call handler manually.
-            else
-            {
-              // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
-              if(io_data->error_code_ == ErrorCode::Success)
-                io_data->error_code_ = err;
-
-              handler(io_data->socket_, io_data->error_code_, DisconnectTag{});
-            }
+            std::uint64_t started_ns = handler_started(io_data);
+            handler(io_data->socket_, io_data->error_code_, DisconnectTag{});
+            handler_finished(io_data, started_ns);
+            release_io_data(io_data);
+          });
+
+          if(err == ErrorCode::Success)
+          {
+            return true;
+          }
+          // Failed to post user work. Call handler manually.
+          else
+          {
+            // Let's not overwrite if there is an IO/Socket related error as they may be more useful to the user.
+            if(io_data->error_code_ == ErrorCode::Success)
+              io_data->error_code_ = err;
+
+            handler(io_data->socket_, io_data->error_code_, DisconnectTag{});
           }
         }
       }
-
-      return false;
-    }, io_data->user_handler_))
-    // User work has been posted. Must keep io_data alive
-    {
-      return;
     }
 
-    // Something went wrong, or user has not given a handler routine. io_data can be released.
-    delete io_data;
+    return false;
+  }, io_data->user_handler_))
+  // User work has been posted. Must keep io_data alive
+  {
+    return;
   }
+
+  // Something went wrong, or user has not given a handler routine. io_data can be released.
+  release_io_data(io_data);
 }
 
 /*
@@ -0,0 +1,133 @@
+#include "firelink/platform/windows/win_socket_recycler.hpp"
+
+#include <iterator>
+#include <new>
+
+firelink::platform::SocketRecycler::SocketRecycler(std::uint32_t capacity) :
+  capacity_(capacity),
+  lock_(SRWLOCK_INIT),
+  shut_down_(false),
+  block_size_(0)
+{
+  idle_blocks_.reserve(capacity_);
+  idle_handles_.reserve(capacity_);
+}
+
+firelink::platform::SocketRecycler::~SocketRecycler()
+{
+  shutdown();
+
+  for (void* block : idle_blocks_)
+    ::operator delete(block);
+}
+
+/*
+ * Hands out a recycled block if one of the right size is idle. All sockets are allocated through the same
+ * allocate_shared instantiation, so every block has the size of the first request.
+ */
+void* firelink::platform::SocketRecycler::allocate(std::size_t size)
+{
+  AcquireSRWLockExclusive(&lock_);
+  if (block_size_ == 0)
+    block_size_ = size;
+
+  if (size == block_size_ && !idle_blocks_.empty())
+  {
+    void* block = idle_blocks_.back();
+    idle_blocks_.pop_back();
+    stats_.objects_reused_++;
+    ReleaseSRWLockExclusive(&lock_);
+    return block;
+  }
+
+  stats_.objects_created_++;
+  ReleaseSRWLockExclusive(&lock_);
+  return ::operator new(size);
+}
+
+void firelink::platform::SocketRecycler::deallocate(void* block, std::size_t size)
+{
+  AcquireSRWLockExclusive(&lock_);
+  if (size == block_size_ && idle_blocks_.size() < capacity_)
+  {
+    idle_blocks_.push_back(block);
+    ReleaseSRWLockExclusive(&lock_);
+    return;
+  }
+
+  ReleaseSRWLockExclusive(&lock_);
+  ::operator delete(block);
+}
+
+/*
+ * Takes the most recently released handle created with the same family, type and protocol, and bound to the
+ * IO threadpool of the same node.
+ */
+bool firelink::platform::SocketRecycler::take_handle(AddressFamily addr_family, SocketType sock_type, Protocol protocol,
+                                                     std::uint32_t node, SOCKET& socket, PTP_IO& socket_io_handle)
+{
+  AcquireSRWLockExclusive(&lock_);
+  for (auto it = idle_handles_.rbegin(); it != idle_handles_.rend(); ++it)
+  {
+    if (it->addr_family_ == addr_family && it->sock_type_ == sock_type && it->protocol_ == protocol && it->node_ == node)
+    {
+      socket = it->socket_;
+      socket_io_handle = it->socket_io_handle_;
+      idle_handles_.erase(std::next(it).base());
+      stats_.handles_reused_++;
+      ReleaseSRWLockExclusive(&lock_);
+      return true;
+    }
+  }
+
+  ReleaseSRWLockExclusive(&lock_);
+  return false;
+}
+
+bool firelink::platform::SocketRecycler::give_handle(AddressFamily addr_family, SocketType sock_type, Protocol protocol,
+                                                     std::uint32_t node, SOCKET socket, PTP_IO socket_io_handle)
+{
+  AcquireSRWLockExclusive(&lock_);
+  if (shut_down_ || idle_handles_.size() >= capacity_)
+  {
+    ReleaseSRWLockExclusive(&lock_);
+    return false;
+  }
+
+  idle_handles_.push_back(IdleHandle{addr_family, sock_type, protocol, node, socket, socket_io_handle});
+  ReleaseSRWLockExclusive(&lock_);
+  return true;
+}
+
+void firelink::platform::SocketRecycler::count_new_handle()
+{
+  AcquireSRWLockExclusive(&lock_);
+  stats_.handles_created_++;
+  ReleaseSRWLockExclusive(&lock_);
+}
+
+void firelink::platform::SocketRecycler::shutdown()
+{
+  AcquireSRWLockExclusive(&lock_);
+  shut_down_ = true;
+  std::vector<IdleHandle> handles = std::move(idle_handles_);
+  idle_handles_.clear();
+  ReleaseSRWLockExclusive(&lock_);
+
+  for (IdleHandle& handle : handles)
+  {
+    CloseThreadpoolIo(handle.socket_io_handle_);
+    closesocket(handle.socket_);
+  }
+}
+
+firelink::SocketPoolStats firelink::platform::SocketRecycler::get_stats() const
+{
+  AcquireSRWLockShared(&lock_);
+  SocketPoolStats result = stats_;
+  result.idle_objects_ = static_cast<std::uint32_t>(idle_blocks_.size());
+  result.idle_handles_ = static_cast<std::uint32_t>(idle_handles_.size());
+  ReleaseSRWLockShared(&lock_);
+
+  return result;
+}
@@ -0,0 +1,912 @@
+#include "firelink/resolver.hpp"
+
+// Platform-specific implementation headers
+#ifdef _WIN32
+    #include <firelink/platform/windows/win_dns_config.hpp>
+#else
+    #error "Firelink: Unsupported platform"
+#endif
+
+#include <algorithm>
+#include <random>
+
+namespace
+{
+  constexpr std::uint16_t DNS_PORT = 53;
+  constexpr std::size_t HEADER_SIZE = 12;
+  constexpr std::size_t MAX_NAME_LENGTH = 253;
+  constexpr std::size_t MAX_LABEL_LENGTH = 63;
+  constexpr std::uint32_t MAX_CNAME_HOPS = 8;
+
+  constexpr std::uint16_t FLAG_QR = 0x8000;
+  constexpr std::uint16_t FLAG_TC = 0x0200;
+  constexpr std::uint16_t FLAG_RD = 0x0100;
+  constexpr std::uint16_t OPCODE_MASK = 0x7800;
+  constexpr std::uint16_t RCODE_MASK = 0x000F;
+
+  constexpr std::uint16_t RCODE_NO_ERROR = 0;
+  constexpr std::uint16_t RCODE_SERVER_FAILURE = 2;
+  constexpr std::uint16_t RCODE_NAME_ERROR = 3;
+
+  constexpr std::uint16_t TYPE_CNAME = 5;
+  constexpr std::uint16_t TYPE_SOA = 6;
+  constexpr std::uint16_t TYPE_OPT = 41;
+  constexpr std::uint16_t CLASS_IN = 1;
+
+  // EDNS(0) UDP payload size, small enough to avoid IP fragmentation on any path
+  constexpr std::uint16_t EDNS_UDP_PAYLOAD_SIZE = 1232;
+
+  struct ResourceRecord
+  {
+    std::string owner_;
+    std::uint16_t type_;
+    std::uint16_t class_;
+    std::uint32_t ttl_;
+    std::size_t rdata_offset_;
+    std::uint16_t rdata_length_;
+  };
+
+  inline std::uint16_t read_u16(const std::uint8_t* p)
+  {
+    return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+  }
+
+  inline std::uint32_t read_u32(const std::uint8_t* p)
+  {
+    return (static_cast<std::uint32_t>(p[0]) << 24) | (static_cast<std::uint32_t>(p[1]) << 16) |
+           (static_cast<std::uint32_t>(p[2]) << 8) | p[3];
+  }
+
+  inline void write_u16(std::vector<std::uint8_t>& out, std::uint16_t value)
+  {
+    out.push_back(static_cast<std::uint8_t>(value >> 8));
+    out.push_back(static_cast<std::uint8_t>(value & 0xFF));
+  }
+
+  inline char to_lower(char c)
+  {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+  }
+
+  /*
+   * Lowercases host and removes the trailing dot of a fully qualified name. Fails if host is not a valid
+   * host name: labels of 1-63 letters, digits, hyphens or underscores, at most 253 characters in total.
+   */
+  bool normalize_host(std::string_view host, std::string& out)
+  {
+    if (!host.empty() && host.back() == '.')
+      host.remove_suffix(1);
+
+    if (host.empty() || host.size() > MAX_NAME_LENGTH)
+      return false;
+
+    out.clear();
+    out.reserve(host.size());
+
+    std::size_t label_length = 0;
+    for (char c : host)
+    {
+      if (c == '.')
+      {
+        if (label_length == 0)
+          return false;
+
+        label_length = 0;
+        out.push_back(c);
+        continue;
+      }
+
+      bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_';
+      if (!valid || ++label_length > MAX_LABEL_LENGTH)
+        return false;
+
+      out.push_back(to_lower(c));
+    }
+
+    return label_length != 0;
+  }
+
+  // Builds a recursive query for name with an EDNS(0) OPT record. The ID is filled in for every attempt.
+  std::vector<std::uint8_t> build_query(const std::string& name, std::uint16_t type)
+  {
+    std::vector<std::uint8_t> packet{};
+    packet.reserve(HEADER_SIZE + name.size() + 2 + 4 + 11);
+
+    write_u16(packet, 0);       // ID
+    write_u16(packet, FLAG_RD);
+    write_u16(packet, 1);       // QDCOUNT
+    write_u16(packet, 0);       // ANCOUNT
+    write_u16(packet, 0);       // NSCOUNT
+    write_u16(packet, 1);       // ARCOUNT
+
+    std::size_t label_start = 0;
+    while (label_start <= name.size())
+    {
+      std::size_t label_end = name.find('.', label_start);
+      if (label_end == std::string::npos)
+        label_end = name.size();
+
+      packet.push_back(static_cast<std::uint8_t>(label_end - label_start));
+      packet.insert(packet.end(), name.begin() + static_cast<std::ptrdiff_t>(label_start),
+                    name.begin() + static_cast<std::ptrdiff_t>(label_end));
+      label_start = label_end + 1;
+    }
+
+    packet.push_back(0);
+    write_u16(packet, type);
+    write_u16(packet, CLASS_IN);
+
+    // OPT pseudo-record: root owner, the payload size in the class field, no extended flags
+    packet.push_back(0);
+    write_u16(packet, TYPE_OPT);
+    write_u16(packet, EDNS_UDP_PAYLOAD_SIZE);
+    write_u16(packet, 0);
+    write_u16(packet, 0);
+    write_u16(packet, 0);
+
+    return packet;
+  }
+
+  /*
+   * Reads a possibly compressed name at offset into out, lowercased and without the trailing dot. next is
+   * set to the first byte after the name in the record it was read from. Compression pointers may only point
+   * backwards, which rules out loops.
+   */
+  bool read_name(const std::uint8_t* msg, std::size_t size, std::size_t offset, std::string& out, std::size_t& next)
+  {
+    out.clear();
+    bool jumped = false;
+
+    for (;;)
+    {
+      if (offset >= size)
+        return false;
+
+      std::uint8_t length = msg[offset];
+      if ((length & 0xC0) == 0xC0)
+      {
+        if (offset + 1 >= size)
+          return false;
+
+        std::size_t target = (static_cast<std::size_t>(length & 0x3F) << 8) | msg[offset + 1];
+        if (target >= offset)
+          return false;
+
+        if (!jumped)
+          next = offset + 2;
+
+        jumped = true;
+        offset = target;
+        continue;
+      }
+
+      if ((length & 0xC0) != 0)
+        return false;
+
+      if (length == 0)
+      {
+        if (!jumped)
+          next = offset + 1;
+        return true;
+      }
+
+      if (offset + 1 + length > size || out.size() + length + 1 > MAX_NAME_LENGTH + 1)
+        return false;
+
+      if (!out.empty())
+        out.push_back('.');
+
+      for (std::size_t i = 0; i < length; ++i)
+        out.push_back(to_lower(static_cast<char>(msg[offset + 1 + i])));
+
+      offset += 1 + length;
+    }
+  }
+
+  bool read_record(const std::uint8_t* msg, std::size_t size, std::size_t& offset, ResourceRecord& rr)
+  {
+    std::size_t next = 0;
+    if (!read_name(msg, size, offset, rr.owner_, next) || next + 10 > size)
+      return false;
+
+    rr.type_ = read_u16(msg + next);
+    rr.class_ = read_u16(msg + next + 2);
+    rr.ttl_ = read_u32(msg + next + 4);
+    rr.rdata_length_ = read_u16(msg + next + 8);
+    rr.rdata_offset_ = next + 10;
+
+    if (rr.rdata_offset_ + rr.rdata_length_ > size)
+      return false;
+
+    offset = rr.rdata_offset_ + rr.rdata_length_;
+    return true;
+  }
+
+  // Results of the two queries of an AddressFamily::Unspecified lookup
+  struct DualLookup
+  {
+    std::mutex mutex_;
+    std::uint32_t remaining_ = 2;
+    std::vector<firelink::Endpoint> ipv6_;
+    std::vector<firelink::Endpoint> ipv4_;
+    firelink::ErrorCode ipv6_error_ = firelink::ErrorCode::Success;
+    firelink::ErrorCode ipv4_error_ = firelink::ErrorCode::Success;
+  };
+
+  firelink::Endpoint with_port(const firelink::Endpoint& address, std::uint16_t port)
+  {
+    if (address.family() == firelink::AddressFamily::IPv6)
+      return firelink::IPv6Address(address.ipv6().bytes, port);
+
+    return firelink::IPv4Address(address.ipv4().bytes, port);
+  }
+
+  void append_with_port(std::vector<firelink::Endpoint>& out, const std::vector<firelink::Endpoint>& addresses,
+                        std::uint16_t port)
+  {
+    for (const firelink::Endpoint& address : addresses)
+      out.push_back(with_port(address, port));
+  }
+}
+
+firelink::Resolver::Resolver(std::shared_ptr<IOCore> io_core, const ResolverConfig& config) :
+  io_core_(io_core),
+  conf_(config)
+{
+  std::random_device rd{};
+  id_state_ = (static_cast<std::uint64_t>(rd()) << 32) | rd();
+}
+
+firelink::Resolver::~Resolver()
+{
+  cancel();
+}
+
+std::expected<std::shared_ptr<firelink::Resolver>, firelink::ErrorCode>
+firelink::Resolver::create(std::shared_ptr<IOCore> io_core, const ResolverConfig& config)
+{
+  if (!io_core || config.attempts_ == 0 || config.timeout_ms_ == 0 || config.min_ttl_s_ > config.max_ttl_s_)
+    return std::unexpected(ErrorCode::InvalidArgument);
+
+  ResolverConfig conf = config;
+  for (const Endpoint& nameserver : conf.nameservers_)
+  {
+    if (nameserver.family() == AddressFamily::Unspecified)
+      return std::unexpected(ErrorCode::InvalidArgument);
+  }
+
+  if (conf.nameservers_.empty())
+  {
+    ErrorCode err = platform::get_system_nameservers(DNS_PORT, conf.nameservers_);
+    if (err != ErrorCode::Success)
+      return std::unexpected(err);
+  }
+
+  return std::shared_ptr<Resolver>(new Resolver(io_core, conf));
+}
+
+firelink::ErrorCode firelink::Resolver::async_resolve(std::string_view host, std::uint16_t port, AddressFamily family,
+                                                      ResolveHandler handler)
+{
+  if (!bool(handler))
+    return ErrorCode::InvalidArgument;
+
+  if (family != AddressFamily::Unspecified && family != AddressFamily::IPv4 && family != AddressFamily::IPv6)
+    return ErrorCode::AddressFamilyNotSupported;
+
+  // Address literals need no lookup
+  Endpoint literal{};
+  if (firelink::inet_pton(host, literal) == ErrorCode::Success)
+  {
+    if (family != AddressFamily::Unspecified && literal.family() != family)
+      deliver({}, ErrorCode::NoData, std::move(handler));
+    else
+      deliver({with_port(literal, port)}, ErrorCode::Success, std::move(handler));
+
+    return ErrorCode::Success;
+  }
+
+  std::string name{};
+  if (!normalize_host(host, name))
+    return ErrorCode::InvalidArgument;
+
+  // RFC 6761, localhost always means the loopback addresses
+  if (name == "localhost")
+  {
+    std::vector<Endpoint> endpoints{};
+    if (family != AddressFamily::IPv4)
+      endpoints.push_back(IPv6Address::loopback(port));
+    if (family != AddressFamily::IPv6)
+      endpoints.push_back(IPv4Address::loopback(port));
+
+    deliver(std::move(endpoints), ErrorCode::Success, std::move(handler));
+    return ErrorCode::Success;
+  }
+
+  std::weak_ptr<Resolver> weak_self = weak_from_this();
+
+  if (family != AddressFamily::Unspecified)
+  {
+    RecordType type = family == AddressFamily::IPv6 ? RecordType::AAAA : RecordType::A;
+    lookup(Question{std::move(name), type}, [weak_self, port, handler](const std::vector<Endpoint>& addresses,
+                                                                      ErrorCode error)
+    {
+      std::vector<Endpoint> endpoints{};
+      append_with_port(endpoints, addresses, port);
+
+      if (std::shared_ptr<Resolver> self = weak_self.lock())
+        self->deliver(std::move(endpoints), error, handler);
+      else
+        handler(endpoints, error, ResolveTag{});
+    });
+
+    return ErrorCode::Success;
+  }
+
+  auto dual = std::make_shared<DualLookup>();
+  auto on_result = [weak_self, port, handler, dual](RecordType type, const std::vector<Endpoint>& addresses,
+                                                    ErrorCode error)
+  {
+    {
+      std::lock_guard<std::mutex> lock(dual->mutex_);
+      if (type == RecordType::AAAA)
+      {
+        dual->ipv6_ = addresses;
+        dual->ipv6_error_ = error;
+      }
+      else
+      {
+        dual->ipv4_ = addresses;
+        dual->ipv4_error_ = error;
+      }
+
+      if (--dual->remaining_ != 0)
+        return;
+    }
+
+    std::vector<Endpoint> endpoints{};
+    append_with_port(endpoints, dual->ipv6_, port);
+    append_with_port(endpoints, dual->ipv4_, port);
+
+    // One family having addresses is enough. Otherwise a missing name wins over a missing family.
+    ErrorCode result = ErrorCode::Success;
+    if (endpoints.empty())
+    {
+      if (dual->ipv4_error_ == ErrorCode::HostNotFound || dual->ipv6_error_ == ErrorCode::HostNotFound)
+        result = ErrorCode::HostNotFound;
+      else if (dual->ipv4_error_ != ErrorCode::NoData && dual->ipv4_error_ != ErrorCode::Success)
+        result = dual->ipv4_error_;
+      else if (dual->ipv6_error_ != ErrorCode::NoData && dual->ipv6_error_ != ErrorCode::Success)
+        result = dual->ipv6_error_;
+      else
+        result = ErrorCode::NoData;
+    }
+
+    if (std::shared_ptr<Resolver> self = weak_self.lock())
+      self->deliver(std::move(endpoints), result, handler);
+    else
+      handler(endpoints, result, ResolveTag{});
+  };
+
+  lookup(Question{name, RecordType::AAAA}, [on_result](const std::vector<Endpoint>& addresses, ErrorCode error)
+  {
+    on_result(RecordType::AAAA, addresses, error);
+  });
+
+  lookup(Question{std::move(name), RecordType::A}, [on_result](const std::vector<Endpoint>& addresses, ErrorCode error)
+  {
+    on_result(RecordType::A, addresses, error);
+  });
+
+  return ErrorCode::Success;
+}
+
+void firelink::Resolver::cancel()
+{
+  std::vector<std::shared_ptr<Query>> queries{};
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [question, query] : in_flight_)
+      queries.push_back(query);
+  }
+
+  Answer aborted{};
+  aborted.error_ = ErrorCode::OperationAborted;
+  for (std::shared_ptr<Query>& query : queries)
+    finish(query, aborted);
+}
+
+void firelink::Resolver::clear_cache()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  cache_.clear();
+}
+
+firelink::ResolverStats firelink::Resolver::stats() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  ResolverStats result = stats_;
+  result.cache_entries_ = static_cast<std::uint32_t>(cache_.size());
+  result.in_flight_ = static_cast<std::uint32_t>(in_flight_.size());
+  return result;
+}
+
+/*
+ * Answers question from the cache, joins the query in flight for it, or sends a new query.
+ * callback is called with the addresses (port 0) or the error.
+ */
+void firelink::Resolver::lookup(Question question, QueryCallback callback)
+{
+  std::shared_ptr<Query> query{};
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    auto cached = cache_.find(question);
+    if (cached != cache_.end())
+    {
+      if (cached->second.expires_ > std::chrono::steady_clock::now())
+      {
+        std::vector<Endpoint> addresses = cached->second.addresses_;
+        ErrorCode error = cached->second.error_;
+
+        stats_.cache_hits_++;
+        if (error != ErrorCode::Success)
+          stats_.negative_hits_++;
+
+        lock.unlock();
+        callback(addresses, error);
+        return;
+      }
+
+      cache_.erase(cached);
+    }
+
+    auto pending = in_flight_.find(question);
+    if (pending != in_flight_.end())
+    {
+      pending->second->callbacks_.push_back(std::move(callback));
+      stats_.coalesced_++;
+      return;
+    }
+
+    query = std::make_shared<Query>();
+    query->request_ = build_query(question.name_, static_cast<std::uint16_t>(question.type_));
+    query->question_ = std::move(question);
+    query->callbacks_.push_back(std::move(callback));
+    in_flight_[query->question_] = query;
+  }
+
+  send_attempt(std::move(query));
+}
+
+/*
+ * Sends the query to the nameserver of the current attempt over a new connected UDP socket. Every attempt
+ * uses a fresh ID and source port, and the socket only accepts datagrams from the nameserver.
+ */
+void firelink::Resolver::send_attempt(std::shared_ptr<Query> query)
+{
+  std::uint32_t attempt = 0;
+  Endpoint nameserver{};
+  auto state = std::make_shared<Attempt>();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (query->finished_)
+      return;
+
+    attempt = query->attempt_;
+    nameserver = conf_.nameservers_[attempt % conf_.nameservers_.size()];
+
+    query->id_ = next_query_id();
+    state->number_ = attempt;
+    state->request_ = query->request_;
+    state->request_[0] = static_cast<std::uint8_t>(query->id_ >> 8);
+    state->request_[1] = static_cast<std::uint8_t>(query->id_ & 0xFF);
+  }
+
+  std::shared_ptr<IOCore> io_core = io_core_.lock();
+  if (!io_core)
+  {
+    Answer answer{};
+    answer.error_ = ErrorCode::SystemError;
+    finish(query, answer);
+    return;
+  }
+
+  auto sock = Socket::create(io_core);
+  if (!sock.has_value())
+  {
+    retry_or_finish(query, attempt, sock.error());
+    return;
+  }
+
+  ErrorCode err = sock.value()->socket(nameserver.family(), SocketType::Datagram, Protocol::Udp);
+  if (err == ErrorCode::Success)
+    err = sock.value()->connect(nameserver);
+
+  if (err != ErrorCode::Success)
+  {
+    sock.value()->close();
+    retry_or_finish(query, attempt, err);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (query->finished_ || query->attempt_ != attempt)
+    {
+      sock.value()->close();
+      return;
+    }
+
+    state->socket_ = sock.value();
+    query->current_ = state;
+    stats_.queries_sent_++;
+  }
+
+  err = start_recv(query, state);
+
+  // The write handler keeps the request alive until the send is done
+  if (err == ErrorCode::Success)
+  {
+    err = sock.value()->start_send(std::as_writable_bytes(std::span<std::uint8_t>(state->request_)),
+                                   [state](std::shared_ptr<Socket>, ErrorCode, std::int32_t, WriteTag) {});
+  }
+
+  if (err != ErrorCode::Success)
+  {
+    retry_or_finish(query, attempt, err);
+    return;
+  }
+
+  std::weak_ptr<Resolver> weak_self = weak_from_this();
+  err = io_core->post_user_work_after(conf_.timeout_ms_, [weak_self, query, attempt]()
+  {
+    if (std::shared_ptr<Resolver> self = weak_self.lock())
+      self->on_timeout(query, attempt);
+  });
+
+  // Without a timer a lost datagram would leave the query hanging, give up on this attempt right away
+  if (err != ErrorCode::Success)
+    retry_or_finish(query, attempt, err);
+}
+
+// Receives the next datagram of an attempt into its own buffer
+firelink::ErrorCode firelink::Resolver::start_recv(std::shared_ptr<Query> query, std::shared_ptr<Attempt> attempt)
+{
+  std::weak_ptr<Resolver> weak_self = weak_from_this();
+  std::shared_ptr<Socket> sock = attempt->socket_;
+  return sock->start_recv(attempt->response_, [weak_self, query, attempt](std::shared_ptr<Socket>, ErrorCode error,
+                                                                          std::int32_t bytes_transferred, ReadTag)
+  {
+    if (std::shared_ptr<Resolver> self = weak_self.lock())
+      self->on_response(query, attempt, error, bytes_transferred);
+  });
+}
+
+void firelink::Resolver::on_response(std::shared_ptr<Query> query, std::shared_ptr<Attempt> state, ErrorCode error,
+                                     std::int32_t bytes)
+{
+  std::uint32_t attempt = state->number_;
+
+  // Cancelled by a retry or by finish
+  if (error == ErrorCode::OperationAborted)
+    return;
+
+  // ICMP port unreachable shows up as ConnectionReset on a connected UDP socket
+  if (error != ErrorCode::Success || bytes < static_cast<std::int32_t>(HEADER_SIZE))
+  {
+    retry_or_finish(query, attempt, error != ErrorCode::Success ? error : ErrorCode::NoRecovery);
+    return;
+  }
+
+  // A late reply to an attempt that has already been retried, the current attempt has its own buffer
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (query->finished_ || query->attempt_ != attempt)
+      return;
+  }
+
+  Answer answer = parse_response(*query, *state, bytes);
+
+  // Not a reply to this query, keep waiting for the real one
+  if (answer.error_ == ErrorCode::WouldBlock)
+  {
+    ErrorCode err = start_recv(query, state);
+    if (err != ErrorCode::Success)
+      retry_or_finish(query, attempt, err);
+    return;
+  }
+
+  // Another nameserver may do better
+  if (answer.error_ == ErrorCode::TryAgain || answer.error_ == ErrorCode::NoRecovery)
+  {
+    retry_or_finish(query, attempt, answer.error_);
+    return;
+  }
+
+  finish(std::move(query), answer);
+}
+
+void firelink::Resolver::on_timeout(std::shared_ptr<Query> query, std::uint32_t attempt)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (query->finished_ || query->attempt_ != attempt)
+      return;
+
+    stats_.timeouts_++;
+  }
+
+  retry_or_finish(std::move(query), attempt, ErrorCode::TimedOut);
+}
+
+/*
+ * Ends the given attempt and moves on to the next nameserver, or fails the query with error once every
+ * attempt has been used. Does nothing if the attempt has already ended.
+ */
+void firelink::Resolver::retry_or_finish(std::shared_ptr<Query> query, std::uint32_t attempt, ErrorCode error)
+{
+  std::shared_ptr<Attempt> old_attempt{};
+  bool give_up = false;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (query->finished_ || query->attempt_ != attempt)
+      return;
+
+    old_attempt = std::move(query->current_);
+    query->attempt_++;
+    give_up = query->attempt_ >= conf_.attempts_ * conf_.nameservers_.size();
+  }
+
+  if (old_attempt && old_attempt->socket_)
+  {
+    old_attempt->socket_->cancel();
+    old_attempt->socket_->close();
+  }
+
+  if (!give_up)
+  {
+    send_attempt(std::move(query));
+    return;
+  }
+
+  Answer answer{};
+  answer.error_ = error;
+  finish(std::move(query), answer);
+}
+
+void firelink::Resolver::finish(std::shared_ptr<Query> query, const Answer& answer)
+{
+  std::vector<QueryCallback> callbacks{};
+  std::shared_ptr<Attempt> last_attempt{};
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (query->finished_)
+      return;
+
+    query->finished_ = true;
+    callbacks = std::move(query->callbacks_);
+    last_attempt = std::move(query->current_);
+
+    auto it = in_flight_.find(query->question_);
+    if (it != in_flight_.end() && it->second == query)
+      in_flight_.erase(it);
+
+    if (answer.cacheable_)
+      store(query->question_, answer);
+
+    if (answer.error_ != ErrorCode::Success && answer.error_ != ErrorCode::HostNotFound &&
+        answer.error_ != ErrorCode::NoData)
+      stats_.failures_++;
+  }
+
+  if (last_attempt && last_attempt->socket_)
+  {
+    last_attempt->socket_->cancel();
+    last_attempt->socket_->close();
+  }
+
+  for (QueryCallback& callback : callbacks)
+    callback(answer.addresses_, answer.error_);
+}
+
+/*
+ * Caches an answer. When the cache is full, expired entries are dropped first, then the entry closest to
+ * expiring. Called with mutex_ held.
+ */
+void firelink::Resolver::store(const Question& question, const Answer& answer)
+{
+  if (conf_.max_cache_entries_ == 0 || answer.ttl_s_ == 0)
+    return;
+
+  auto now = std::chrono::steady_clock::now();
+  if (cache_.size() >= conf_.max_cache_entries_ && cache_.find(question) == cache_.end())
+  {
+    std::erase_if(cache_, [now](const auto& entry) { return entry.second.expires_ <= now; });
+
+    if (cache_.size() >= conf_.max_cache_entries_)
+    {
+      auto soonest = std::min_element(cache_.begin(), cache_.end(), [](const auto& lhs, const auto& rhs)
+      {
+        return lhs.second.expires_ < rhs.second.expires_;
+      });
+
+      cache_.erase(soonest);
+    }
+  }
+
+  cache_[question] = CacheEntry{answer.addresses_, answer.error_, now + std::chrono::seconds(answer.ttl_s_)};
+}
+
+/*
+ * Checks that the response received by the attempt answers the query and extracts the addresses. The error of
+ * the result is ErrorCode::WouldBlock if the datagram is not a reply to the query at all.
+ */
+firelink::Resolver::Answer firelink::Resolver::parse_response(const Query& query, const Attempt& attempt, std::int32_t bytes) const
+{
+  const std::uint8_t* msg = reinterpret_cast<const std::uint8_t*>(attempt.response_.data());
+  std::size_t size = static_cast<std::size_t>(bytes);
+  std::uint16_t qtype = static_cast<std::uint16_t>(query.question_.type_);
+
+  Answer answer{};
+
+  std::uint16_t flags = read_u16(msg + 2);
+  if (read_u16(msg) != query.id_ || (flags & FLAG_QR) == 0 || (flags & OPCODE_MASK) != 0 || read_u16(msg + 4) != 1)
+  {
+    answer.error_ = ErrorCode::WouldBlock;
+    return answer;
+  }
+
+  std::size_t offset = HEADER_SIZE;
+  std::string name{};
+  std::size_t next = 0;
+  if (!read_name(msg, size, offset, name, next) || next + 4 > size || name != query.question_.name_ ||
+      read_u16(msg + next) != qtype || read_u16(msg + next + 2) != CLASS_IN)
+  {
+    answer.error_ = ErrorCode::WouldBlock;
+    return answer;
+  }
+
+  offset = next + 4;
+
+  std::uint16_t rcode = flags & RCODE_MASK;
+  if (rcode == RCODE_SERVER_FAILURE)
+  {
+    answer.error_ = ErrorCode::TryAgain;
+    return answer;
+  }
+
+  if (rcode != RCODE_NO_ERROR && rcode != RCODE_NAME_ERROR)
+  {
+    answer.error_ = ErrorCode::NoRecovery;
+    return answer;
+  }
+
+  std::uint16_t answer_count = read_u16(msg + 6);
+  std::uint16_t authority_count = read_u16(msg + 8);
+
+  std::vector<ResourceRecord> answers(answer_count);
+  for (ResourceRecord& rr : answers)
+  {
+    if (!read_record(msg, size, offset, rr))
+    {
+      answer.error_ = ErrorCode::NoRecovery;
+      return answer;
+    }
+  }
+
+  // Follow the CNAME chain from the question to the addresses
+  std::string target = query.question_.name_;
+  std::uint32_t ttl = UINT32_MAX;
+  if (rcode == RCODE_NO_ERROR)
+  {
+    for (std::uint32_t hop = 0; hop <= MAX_CNAME_HOPS && answer.addresses_.empty(); ++hop)
+    {
+      const ResourceRecord* cname = nullptr;
+      for (const ResourceRecord& rr : answers)
+      {
+        if (rr.class_ != CLASS_IN || rr.owner_ != target)
+          continue;
+
+        if (rr.type_ == qtype && rr.rdata_length_ == (qtype == static_cast<std::uint16_t>(RecordType::A) ? 4 : 16))
+        {
+          if (rr.rdata_length_ == 4)
+          {
+            IPv4Address addr{};
+            std::copy(msg + rr.rdata_offset_, msg + rr.rdata_offset_ + 4, addr.bytes.begin());
+            answer.addresses_.push_back(addr);
+          }
+          else
+          {
+            IPv6Address addr{};
+            std::copy(msg + rr.rdata_offset_, msg + rr.rdata_offset_ + 16, addr.bytes.begin());
+            answer.addresses_.push_back(addr);
+          }
+
+          ttl = std::min(ttl, rr.ttl_);
+        }
+        else if (rr.type_ == TYPE_CNAME)
+        {
+          cname = &rr;
+        }
+      }
+
+      if (!answer.addresses_.empty() || cname == nullptr)
+        break;
+
+      std::size_t cname_next = 0;
+      if (!read_name(msg, size, cname->rdata_offset_, target, cname_next))
+        break;
+
+      ttl = std::min(ttl, cname->ttl_);
+    }
+  }
+
+  if (!answer.addresses_.empty())
+  {
+    answer.ttl_s_ = std::clamp(ttl, conf_.min_ttl_s_, conf_.max_ttl_s_);
+    answer.cacheable_ = true;
+    return answer;
+  }
+
+  // A truncated reply without addresses needs TCP, which is not supported
+  if ((flags & FLAG_TC) != 0)
+  {
+    answer.error_ = ErrorCode::TryAgain;
+    return answer;
+  }
+
+  answer.error_ = rcode == RCODE_NAME_ERROR ? ErrorCode::HostNotFound : ErrorCode::NoData;
+
+  // RFC 2308: negative answers live for the smaller of the SOA record TTL and its MINIMUM field
+  answer.ttl_s_ = conf_.negative_ttl_s_;
+  for (std::uint16_t i = 0; i < authority_count; ++i)
+  {
+    ResourceRecord rr{};
+    if (!read_record(msg, size, offset, rr))
+      break;
+
+    if (rr.type_ == TYPE_SOA && rr.rdata_length_ >= 4)
+    {
+      std::uint32_t minimum = read_u32(msg + rr.rdata_offset_ + rr.rdata_length_ - 4);
+      answer.ttl_s_ = std::min(rr.ttl_, minimum);
+      break;
+    }
+  }
+
+  answer.ttl_s_ = std::min(answer.ttl_s_, conf_.max_ttl_s_);
+  answer.cacheable_ = true;
+  return answer;
+}
+
+// splitmix64 over a randomly seeded state, query IDs must not be predictable. Called with mutex_ held.
+std::uint16_t firelink::Resolver::next_query_id()
+{
+  std::uint64_t z = (id_state_ += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return static_cast<std::uint16_t>((z ^ (z >> 31)) >> 48);
+}
+
+void firelink::Resolver::deliver(std::vector<Endpoint> endpoints, ErrorCode error, ResolveHandler handler)
+{
+  if (std::shared_ptr<IOCore> io_core = io_core_.lock())
+  {
+    ErrorCode err = io_core->post_user_work([endpoints, error, handler]()
+    {
+      handler(endpoints, error, ResolveTag{});
+    });
+
+    if (err == ErrorCode::Success)
+      return;
+  }
+
+  // Failed to post user work. Call handler manually.
+  handler(endpoints, error, ResolveTag{});
+}
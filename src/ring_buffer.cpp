@@ -0,0 +1,207 @@
+#include "firelink/ring_buffer.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <memoryapi.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+namespace
+{
+  // Placeholder API (Windows 10 1803+). Resolved at runtime so that firelink still loads on older systems.
+  using VirtualAlloc2Fn = PVOID (WINAPI*)(HANDLE process, PVOID base_address, SIZE_T size, ULONG allocation_type,
+                                          ULONG page_protection, MEM_EXTENDED_PARAMETER* extended_parameters,
+                                          ULONG parameter_count);
+
+  using MapViewOfFile3Fn = PVOID (WINAPI*)(HANDLE file_mapping, HANDLE process, PVOID base_address, ULONG64 offset,
+                                           SIZE_T view_size, ULONG allocation_type, ULONG page_protection,
+                                           MEM_EXTENDED_PARAMETER* extended_parameters, ULONG parameter_count);
+
+  VirtualAlloc2Fn get_virtual_alloc2()
+  {
+    static VirtualAlloc2Fn fn = reinterpret_cast<VirtualAlloc2Fn>(
+      reinterpret_cast<void*>(GetProcAddress(GetModuleHandleW(L"kernelbase.dll"), "VirtualAlloc2")));
+    return fn;
+  }
+
+  MapViewOfFile3Fn get_map_view_of_file3()
+  {
+    static MapViewOfFile3Fn fn = reinterpret_cast<MapViewOfFile3Fn>(
+      reinterpret_cast<void*>(GetProcAddress(GetModuleHandleW(L"kernelbase.dll"), "MapViewOfFile3")));
+    return fn;
+  }
+}
+#endif
+
+firelink::MirroredRingBuffer::~MirroredRingBuffer()
+{
+  if (base_ != nullptr)
+    unmap_mirrored(base_, capacity_);
+}
+
+firelink::MirroredRingBuffer::MirroredRingBuffer(MirroredRingBuffer&& other) noexcept :
+  base_(std::exchange(other.base_, nullptr)),
+  capacity_(std::exchange(other.capacity_, 0)),
+  read_offset_(std::exchange(other.read_offset_, 0)),
+  size_(std::exchange(other.size_, 0))
+{
+
+}
+
+firelink::MirroredRingBuffer& firelink::MirroredRingBuffer::operator=(MirroredRingBuffer&& other) noexcept
+{
+  if (this != &other)
+  {
+    if (base_ != nullptr)
+      unmap_mirrored(base_, capacity_);
+
+    base_ = std::exchange(other.base_, nullptr);
+    capacity_ = std::exchange(other.capacity_, 0);
+    read_offset_ = std::exchange(other.read_offset_, 0);
+    size_ = std::exchange(other.size_, 0);
+  }
+
+  return *this;
+}
+
+std::expected<firelink::MirroredRingBuffer, firelink::ErrorCode>
+firelink::MirroredRingBuffer::create(std::size_t min_capacity)
+{
+  if (min_capacity == 0)
+    return std::unexpected(ErrorCode::InvalidArgument);
+
+  std::size_t granularity = mapping_granularity();
+  std::size_t capacity = ((min_capacity + granularity - 1) / granularity) * granularity;
+
+  std::byte* base = nullptr;
+  ErrorCode err = map_mirrored(capacity, &base);
+  if (err != ErrorCode::Success)
+    return std::unexpected(err);
+
+  return MirroredRingBuffer(base, capacity);
+}
+
+std::size_t firelink::MirroredRingBuffer::mapping_granularity()
+{
+#ifdef _WIN32
+  SYSTEM_INFO info{};
+  GetSystemInfo(&info);
+  return static_cast<std::size_t>(info.dwAllocationGranularity);
+#elif defined(__linux__)
+  return static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+/*
+ * Reserves 2 * capacity bytes of address space and maps the same memory section into both halves.
+ */
+firelink::ErrorCode firelink::MirroredRingBuffer::map_mirrored(std::size_t capacity, std::byte** base_out)
+{
+#ifdef _WIN32
+  VirtualAlloc2Fn virtual_alloc2 = get_virtual_alloc2();
+  MapViewOfFile3Fn map_view_of_file3 = get_map_view_of_file3();
+  if (virtual_alloc2 == nullptr || map_view_of_file3 == nullptr)
+    return ErrorCode::PlatformNotSupported;
+
+  // Reserve one placeholder covering both halves and split it in two
+  auto* placeholder = static_cast<std::byte*>(virtual_alloc2(nullptr, nullptr, 2 * capacity,
+                                                             MEM_RESERVE | MEM_RESERVE_PLACEHOLDER,
+                                                             PAGE_NOACCESS, nullptr, 0));
+  if (placeholder == nullptr)
+    return static_cast<ErrorCode>(static_cast<int>(GetLastError()));
+
+  if (VirtualFree(placeholder, capacity, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER) == FALSE)
+  {
+    ErrorCode err = static_cast<ErrorCode>(static_cast<int>(GetLastError()));
+    VirtualFree(placeholder, 0, MEM_RELEASE);
+    return err;
+  }
+
+  HANDLE section = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                      static_cast<DWORD>(static_cast<ULONG64>(capacity) >> 32),
+                                      static_cast<DWORD>(capacity & 0xFFFFFFFF), nullptr);
+  if (section == nullptr)
+  {
+    ErrorCode err = static_cast<ErrorCode>(static_cast<int>(GetLastError()));
+    VirtualFree(placeholder, 0, MEM_RELEASE);
+    VirtualFree(placeholder + capacity, 0, MEM_RELEASE);
+    return err;
+  }
+
+  PVOID view1 = map_view_of_file3(section, nullptr, placeholder, 0, capacity,
+                                  MEM_REPLACE_PLACEHOLDER, PAGE_READWRITE, nullptr, 0);
+  if (view1 == nullptr)
+  {
+    ErrorCode err = static_cast<ErrorCode>(static_cast<int>(GetLastError()));
+    CloseHandle(section);
+    VirtualFree(placeholder, 0, MEM_RELEASE);
+    VirtualFree(placeholder + capacity, 0, MEM_RELEASE);
+    return err;
+  }
+
+  PVOID view2 = map_view_of_file3(section, nullptr, placeholder + capacity, 0, capacity,
+                                  MEM_REPLACE_PLACEHOLDER, PAGE_READWRITE, nullptr, 0);
+  if (view2 == nullptr)
+  {
+    ErrorCode err = static_cast<ErrorCode>(static_cast<int>(GetLastError()));
+    CloseHandle(section);
+    UnmapViewOfFile(view1);
+    VirtualFree(placeholder + capacity, 0, MEM_RELEASE);
+    return err;
+  }
+
+  // The views keep the section alive
+  CloseHandle(section);
+
+  *base_out = placeholder;
+  return ErrorCode::Success;
+
+#elif defined(__linux__)
+  int fd = memfd_create("firelink_ring_buffer", MFD_CLOEXEC);
+  if (fd == -1)
+    return ErrorCode::SystemError;
+
+  if (ftruncate(fd, static_cast<off_t>(capacity)) != 0)
+  {
+    close(fd);
+    return ErrorCode::SystemError;
+  }
+
+  void* reserved = mmap(nullptr, 2 * capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (reserved == MAP_FAILED)
+  {
+    close(fd);
+    return ErrorCode::SystemError;
+  }
+
+  auto* base = static_cast<std::byte*>(reserved);
+  if (mmap(base, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+      mmap(base + capacity, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+  {
+    munmap(reserved, 2 * capacity);
+    close(fd);
+    return ErrorCode::SystemError;
+  }
+
+  // The mappings keep the memory file alive
+  close(fd);
+
+  *base_out = base;
+  return ErrorCode::Success;
+#endif
+}
+
+void firelink::MirroredRingBuffer::unmap_mirrored(std::byte* base, std::size_t capacity)
+{
+#ifdef _WIN32
+  UnmapViewOfFile(base);
+  UnmapViewOfFile(base + capacity);
+#elif defined(__linux__)
+  munmap(base, 2 * capacity);
+#endif
+}
@@ -3,13 +3,18 @@
 // Platform-specific implementation headers
 #ifdef _WIN32
     #include <firelink/platform/windows/win_socket.hpp>
+    #include <firelink/platform/windows/win_io_core.hpp>
 #elif defined(__linux__)
     #include <firelink/platform/linux/lin_socket.hpp>
 #else
     #error "Firelink: Unsupported platform"
 #endif
 
-firelink::Socket::Socket(std::shared_ptr<firelink::IOCore> io_core) : io_core_(io_core)
+firelink::Socket::Socket(std::shared_ptr<firelink::IOCore> io_core) :
+  io_core_(io_core),
+  queued_send_bytes_(0),
+  send_congested_(false),
+  busy_poll_us_(0)
 {
   
 }
@@ -23,7 +28,10 @@ firelink::Socket::create(std::shared_ptr<firelink::IOCore> io_core)
   }
   
 #if defined(_WIN32)
-  auto sock = std::make_shared<platform::WinSocket>(io_core);
+  // Socket objects are built in memory recycled from destroyed sockets of the same IOCore
+  auto* win_core = static_cast<platform::WinIOCore*>(io_core.get());
+  auto sock = std::allocate_shared<platform::WinSocket>(
+    platform::RecyclingAllocator<platform::WinSocket>(win_core->get_socket_recycler()), io_core);
 #elif defined(__linux__)
   auto sock = std::make_shared<platform::LinSocket>(io_core);
 #else
@@ -41,3 +49,53 @@ void firelink::Socket::stop_io_context()
     core->stop();
   }
 }
+
+firelink::ErrorCode firelink::Socket::start_recv(MirroredRingBuffer& buffer, ReadHandler handler)
+{
+  std::span<std::byte> target = buffer.writable_span();
+  if (target.empty())
+    return ErrorCode::NoBufferSpace;
+
+  return start_recv(target, [&buffer, handler = std::move(handler)](std::shared_ptr<Socket> caller, ErrorCode error,
+                                                                     std::int32_t bytes_transferred, ReadTag tag)
+  {
+    if (error == ErrorCode::Success && bytes_transferred > 0)
+      buffer.commit(static_cast<std::size_t>(bytes_transferred));
+
+    if (handler)
+      handler(std::move(caller), error, bytes_transferred, tag);
+  });
+}
+
+void firelink::Socket::set_send_limits(const SendLimits& limits, DrainHandler handler)
+{
+  send_limits_ = limits;
+  drain_handler_ = std::move(handler);
+}
+
+firelink::ErrorCode firelink::Socket::acquire_send_bytes(std::size_t n)
+{
+  std::size_t queued = queued_send_bytes_.fetch_add(n, std::memory_order_relaxed) + n;
+
+  if (send_limits_.hard_cap_ != 0 && queued > send_limits_.hard_cap_)
+  {
+    queued_send_bytes_.fetch_sub(n, std::memory_order_relaxed);
+    return ErrorCode::NoBufferSpace;
+  }
+
+  if (send_limits_.high_watermark_ != 0 && queued >= send_limits_.high_watermark_)
+    send_congested_.store(true, std::memory_order_relaxed);
+
+  return ErrorCode::Success;
+}
+
+bool firelink::Socket::release_send_bytes(std::size_t n)
+{
+  std::size_t queued = queued_send_bytes_.fetch_sub(n, std::memory_order_relaxed) - n;
+
+  // Only the release that clears the congested flag fires the drain handler
+  if (queued <= send_limits_.low_watermark_ && send_congested_.load(std::memory_order_relaxed))
+    return send_congested_.exchange(false, std::memory_order_relaxed);
+
+  return false;
+}
@@ -0,0 +1,31 @@
+#include "firelink/trace.hpp"
+
+#include <atomic>
+
+namespace
+{
+  std::atomic<firelink::TraceSink*> trace_sink{nullptr};
+  std::atomic<std::uint32_t> next_thread_id{1};
+  std::atomic<std::uint64_t> next_operation_id{1};
+}
+
+void firelink::set_trace_sink(TraceSink* sink)
+{
+  trace_sink.store(sink, std::memory_order_release);
+}
+
+firelink::TraceSink* firelink::get_trace_sink()
+{
+  return trace_sink.load(std::memory_order_acquire);
+}
+
+std::uint32_t firelink::trace_thread_id()
+{
+  thread_local std::uint32_t thread_id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+  return thread_id;
+}
+
+std::uint64_t firelink::next_trace_operation_id()
+{
+  return next_operation_id.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,244 @@
+#include "firelink/trace_recorder.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <map>
+#include <thread>
+
+// Smallest ring buffer, keeps a few records per thread even with a tiny configured capacity
+static constexpr std::uint32_t FIRELINK_TRACE_MIN_CAPACITY = 64;
+
+namespace
+{
+  const char* operation_name(firelink::Operation op)
+  {
+    switch (op)
+    {
+      case firelink::Operation::Accept: return "accept";
+      case firelink::Operation::Connect: return "connect";
+      case firelink::Operation::Recv: return "recv";
+      case firelink::Operation::RecvFrom: return "recv_from";
+      case firelink::Operation::Send: return "send";
+      case firelink::Operation::SendTo: return "send_to";
+      case firelink::Operation::Disconnect: return "disconnect";
+      case firelink::Operation::Unknown: break;
+    }
+
+    return "operation";
+  }
+
+  void append_uint(std::string& out, std::uint64_t value)
+  {
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+  }
+
+  void append_int(std::string& out, std::int64_t value)
+  {
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+  }
+
+  void append_hex(std::string& out, std::uint64_t value)
+  {
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, 16);
+    out.append("\"0x");
+    out.append(buffer, result.ptr);
+    out.push_back('"');
+  }
+
+  // Trace event timestamps are microseconds, keep the nanoseconds as three decimals
+  void append_timestamp(std::string& out, std::uint64_t ns)
+  {
+    append_uint(out, ns / 1000);
+    out.push_back('.');
+
+    std::uint64_t fraction = ns % 1000;
+    out.push_back(static_cast<char>('0' + fraction / 100));
+    out.push_back(static_cast<char>('0' + fraction / 10 % 10));
+    out.push_back(static_cast<char>('0' + fraction % 10));
+  }
+
+  // Opens an event object with the fields every event has. The caller closes it.
+  void begin_event(std::string& out, bool& first, const char* name, const char* suffix, const char* phase,
+                   std::uint64_t ts_ns, std::uint32_t thread_id)
+  {
+    out.append(first ? "\n" : ",\n");
+    first = false;
+
+    out.append("{\"name\":\"");
+    out.append(name);
+    out.append(suffix);
+    out.append("\",\"ph\":\"");
+    out.append(phase);
+    out.append("\",\"ts\":");
+    append_timestamp(out, ts_ns);
+    out.append(",\"pid\":1,\"tid\":");
+    append_uint(out, thread_id);
+  }
+}
+
+firelink::TraceRecorder::TraceRecorder(const TraceRecorderConfig& config) :
+  head_(0),
+  writers_(0),
+  recording_(true)
+{
+  std::uint64_t capacity = std::bit_ceil(std::max(config.capacity_, FIRELINK_TRACE_MIN_CAPACITY));
+  slots_ = std::make_unique<Slot[]>(capacity);
+  mask_ = capacity - 1;
+}
+
+firelink::TraceRecorder::~TraceRecorder()
+{
+  stop();
+}
+
+void firelink::TraceRecorder::record(const TraceRecord& record) noexcept
+{
+  // Announce the write before checking recording_, so stop() either sees this writer or the writer sees the stop
+  writers_.fetch_add(1);
+  if (recording_.load())
+  {
+    Slot& slot = slots_[head_.fetch_add(1, std::memory_order_relaxed) & mask_];
+    while (slot.busy_.exchange(true, std::memory_order_acquire))
+      std::this_thread::yield();
+
+    slot.record_ = record;
+    slot.busy_.store(false, std::memory_order_release);
+  }
+
+  writers_.fetch_sub(1, std::memory_order_release);
+}
+
+void firelink::TraceRecorder::start()
+{
+  recording_.store(true);
+}
+
+void firelink::TraceRecorder::stop()
+{
+  recording_.store(false);
+  while (writers_.load() != 0)
+    std::this_thread::yield();
+}
+
+void firelink::TraceRecorder::clear()
+{
+  head_.store(0, std::memory_order_relaxed);
+}
+
+std::size_t firelink::TraceRecorder::size() const
+{
+  return static_cast<std::size_t>(std::min(head_.load(std::memory_order_acquire), mask_ + 1));
+}
+
+std::uint64_t firelink::TraceRecorder::total_recorded() const
+{
+  return head_.load(std::memory_order_acquire);
+}
+
+std::string firelink::TraceRecorder::export_chrome_json() const
+{
+  std::uint64_t head = head_.load(std::memory_order_acquire);
+  std::uint64_t count = std::min(head, mask_ + 1);
+  std::uint64_t first_index = head - count;
+
+  // Timestamps relative to the oldest kept record, writers may have stored slightly out of order
+  std::uint64_t base_ns = UINT64_MAX;
+  for (std::uint64_t i = first_index; i < head; ++i)
+    base_ns = std::min(base_ns, slots_[i & mask_].record_.timestamp_ns_);
+
+  // What each thread was seen doing names it in the timeline
+  std::map<std::uint32_t, const char*> thread_roles{};
+
+  std::string out{};
+  out.reserve(static_cast<std::size_t>(count) * 160 + 64);
+  out.append("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+  bool first = true;
+  for (std::uint64_t i = first_index; i < head; ++i)
+  {
+    const TraceRecord& r = slots_[i & mask_].record_;
+    std::uint64_t ts = r.timestamp_ns_ - base_ns;
+    const char* name = operation_name(r.operation_);
+
+    switch (r.event_)
+    {
+      case TraceEvent::OperationSubmitted:
+      {
+        thread_roles.try_emplace(r.thread_id_, "app");
+        begin_event(out, first, name, "", "b", ts, r.thread_id_);
+        out.append(",\"cat\":\"operation\",\"id\":");
+        append_hex(out, r.operation_id_);
+        out.append(",\"args\":{\"socket\":");
+        append_hex(out, reinterpret_cast<std::uintptr_t>(r.socket_));
+        out.append("}}");
+        break;
+      }
+      case TraceEvent::OperationCompleted:
+      {
+        thread_roles[r.thread_id_] = "io";
+        begin_event(out, first, name, "", "e", ts, r.thread_id_);
+        out.append(",\"cat\":\"operation\",\"id\":");
+        append_hex(out, r.operation_id_);
+        out.append(",\"args\":{\"error\":");
+        append_int(out, static_cast<int>(r.error_));
+        out.append(",\"bytes\":");
+        append_int(out, r.bytes_transferred_);
+        out.append("}}");
+
+        // Also on the IO thread's own track, to see which thread picked the completion up
+        begin_event(out, first, name, " completed", "i", ts, r.thread_id_);
+        out.append(",\"s\":\"t\"}");
+        break;
+      }
+      case TraceEvent::HandlerDispatched:
+      {
+        thread_roles[r.thread_id_] = "user";
+        begin_event(out, first, name, " handler", "B", ts, r.thread_id_);
+        out.append(",\"args\":{\"operation\":");
+        append_hex(out, r.operation_id_);
+        out.append("}}");
+        break;
+      }
+      case TraceEvent::HandlerFinished:
+      {
+        begin_event(out, first, name, " handler", "E", ts, r.thread_id_);
+        out.append("}");
+        break;
+      }
+      case TraceEvent::SocketCreated:
+      case TraceEvent::SocketClosed:
+      {
+        thread_roles.try_emplace(r.thread_id_, "app");
+        begin_event(out, first, r.event_ == TraceEvent::SocketCreated ? "socket created" : "socket closed", "", "i",
+                    ts, r.thread_id_);
+        out.append(",\"s\":\"t\",\"args\":{\"socket\":");
+        append_hex(out, reinterpret_cast<std::uintptr_t>(r.socket_));
+        out.append("}}");
+        break;
+      }
+    }
+  }
+
+  for (const auto& [thread_id, role] : thread_roles)
+  {
+    out.append(first ? "\n" : ",\n");
+    first = false;
+
+    out.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":");
+    append_uint(out, thread_id);
+    out.append(",\"args\":{\"name\":\"");
+    out.append(role);
+    out.push_back(' ');
+    append_uint(out, thread_id);
+    out.append("\"}}");
+  }
+
+  out.append("\n]}\n");
+  return out;
+}
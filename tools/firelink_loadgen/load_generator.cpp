@@ -0,0 +1,446 @@
+#include "loadgen.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+firelink_loadgen::LoadTotals firelink_loadgen::LoadCounters::load() const
+{
+  LoadTotals totals{};
+  totals.connected_ = connected_.load(std::memory_order_relaxed);
+  totals.connect_errors_ = connect_errors_.load(std::memory_order_relaxed);
+  totals.disconnected_ = disconnected_.load(std::memory_order_relaxed);
+  totals.requests_sent_ = requests_sent_.load(std::memory_order_relaxed);
+  totals.send_errors_ = send_errors_.load(std::memory_order_relaxed);
+  totals.responses_ = responses_.load(std::memory_order_relaxed);
+  totals.unanswered_ = unanswered_.load(std::memory_order_relaxed);
+  totals.bytes_sent_ = bytes_sent_.load(std::memory_order_relaxed);
+  totals.bytes_received_ = bytes_received_.load(std::memory_order_relaxed);
+  return totals;
+}
+
+firelink_loadgen::Connection::Connection(LoadGenerator* generator, std::uint32_t id, std::shared_ptr<firelink::Socket> socket,
+                                         bool chatty) :
+  generator_(generator),
+  id_(id),
+  socket_(std::move(socket)),
+  recv_buffer_(chatty ? LOADGEN_CHATTY_RECV_BUFFER : LOADGEN_IDLE_RECV_BUFFER),
+  closed_(false)
+{
+}
+
+void firelink_loadgen::Connection::start_reading()
+{
+  firelink::ErrorCode err = socket_->start_recv(recv_buffer_, [self = shared_from_this()](std::shared_ptr<firelink::Socket>,
+                                                                                          firelink::ErrorCode error,
+                                                                                          std::int32_t bytes_transferred,
+                                                                                          firelink::ReadTag)
+  {
+    self->on_recv(error, bytes_transferred);
+  });
+
+  if (err != firelink::ErrorCode::Success)
+    on_recv(err, 0);
+}
+
+/*
+ * Queues a request behind the unanswered ones. The pending entry goes in before the send, the response
+ * can not arrive earlier than that.
+ */
+void firelink_loadgen::Connection::send_request(std::uint64_t intended_ns, std::span<std::byte> payload)
+{
+  LoadCounters& counters = generator_->counters();
+  counters.requests_sent_.fetch_add(1, std::memory_order_relaxed);
+
+  // The schedule does not skip requests of a closed connection, they count as never answered
+  if (closed_.load(std::memory_order_relaxed))
+  {
+    counters.unanswered_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.push_back(Pending{intended_ns, static_cast<std::uint32_t>(payload.size())});
+  }
+
+  firelink::ErrorCode err = socket_->post_send(payload, [self = shared_from_this()](std::shared_ptr<firelink::Socket>,
+                                                                                    firelink::ErrorCode error,
+                                                                                    std::int32_t bytes_transferred,
+                                                                                    firelink::WriteTag)
+  {
+    LoadCounters& counters = self->generator_->counters();
+    if (error != firelink::ErrorCode::Success)
+    {
+      // The stream is out of step with the pending requests now, the connection is done
+      counters.send_errors_.fetch_add(1, std::memory_order_relaxed);
+      self->close();
+      return;
+    }
+
+    counters.bytes_sent_.fetch_add(static_cast<std::uint64_t>(bytes_transferred), std::memory_order_relaxed);
+  });
+
+  if (err != firelink::ErrorCode::Success)
+  {
+    counters.send_errors_.fetch_add(1, std::memory_order_relaxed);
+    close();
+  }
+}
+
+void firelink_loadgen::Connection::close()
+{
+  if (!closed_.exchange(true))
+    socket_->close();
+}
+
+void firelink_loadgen::Connection::on_recv(firelink::ErrorCode error, std::int32_t bytes_transferred)
+{
+  LoadCounters& counters = generator_->counters();
+  if (error != firelink::ErrorCode::Success || bytes_transferred <= 0)
+  {
+    std::size_t dropped = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      dropped = pending_.size();
+      pending_.clear();
+    }
+
+    counters.unanswered_.fetch_add(dropped, std::memory_order_relaxed);
+    counters.disconnected_.fetch_add(1, std::memory_order_relaxed);
+    close();
+    return;
+  }
+
+  counters.bytes_received_.fetch_add(static_cast<std::uint64_t>(bytes_transferred), std::memory_order_relaxed);
+
+  // Echoed bytes answer the oldest requests first. Bytes nobody asked for are ignored.
+  std::uint64_t now = now_ns();
+  std::uint32_t left = static_cast<std::uint32_t>(bytes_transferred);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (left > 0 && !pending_.empty())
+    {
+      Pending& oldest = pending_.front();
+      std::uint32_t taken = std::min(left, oldest.remaining_);
+      oldest.remaining_ -= taken;
+      left -= taken;
+
+      if (oldest.remaining_ == 0)
+      {
+        generator_->record_latency(id_, now > oldest.intended_ns_ ? now - oldest.intended_ns_ : 0);
+        counters.responses_.fetch_add(1, std::memory_order_relaxed);
+        pending_.pop_front();
+      }
+    }
+  }
+
+  start_reading();
+}
+
+firelink_loadgen::LoadGenerator::LoadGenerator(const LoadConfig& config) :
+  conf_(config),
+  connecting_(0),
+  phase_(LoadPhase::RampUp),
+  done_(false),
+  start_ns_(0)
+{
+  payload_.resize(std::max<std::uint32_t>(conf_.payload_.largest(), 1));
+  for (std::size_t i = 0; i < payload_.size(); ++i)
+    payload_[i] = static_cast<std::byte>(i & 0xFF);
+}
+
+int firelink_loadgen::LoadGenerator::run()
+{
+  if (conf_.targets_.empty())
+  {
+    std::cerr << "firelink_loadgen: no targets" << std::endl;
+    return 1;
+  }
+
+  auto io_core = firelink::IOCore::create({conf_.io_threads_, conf_.io_threads_, conf_.user_threads_, conf_.user_threads_});
+  if (!io_core.has_value())
+  {
+    std::cerr << "firelink::IOCore::create error " << static_cast<int>(io_core.error()) << std::endl;
+    return 1;
+  }
+
+  io_core_ = std::move(io_core.value());
+  start_ns_ = now_ns();
+
+  std::cout << std::setw(7) << "time_s" << std::setw(7) << "phase" << std::setw(10) << "conns" << std::setw(10) << "conn_err"
+            << std::setw(10) << "closed" << std::setw(10) << "req/s" << std::setw(10) << "resp/s" << std::setw(10) << "errors"
+            << std::setw(11) << "out_MiB/s" << std::setw(11) << "in_MiB/s" << std::setw(10) << "p50_us" << std::setw(10) << "p90_us"
+            << std::setw(10) << "p99_us" << std::setw(10) << "p99.9_us" << std::setw(10) << "max_us" << std::endl;
+
+  std::thread reporter([this]() { report_loop(); });
+
+  ramp_up();
+
+  phase_.store(LoadPhase::Load);
+  std::uint64_t load_phase_ns = send_requests();
+
+  phase_.store(LoadPhase::Drain);
+  drain();
+
+  done_.store(true);
+  reporter.join();
+
+  {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    for (std::shared_ptr<Connection>& connection : connections_)
+      connection->close();
+  }
+
+  io_core_->release();
+  report_summary(load_phase_ns);
+  return 0;
+}
+
+void firelink_loadgen::LoadGenerator::record_latency(std::uint32_t connection_id, std::uint64_t latency_ns)
+{
+  HistogramShard& shard = shards_[connection_id % LOADGEN_HISTOGRAM_SHARDS];
+  std::lock_guard<std::mutex> lock(shard.mutex_);
+  shard.histogram_.record(latency_ns);
+}
+
+/*
+ * Opens conf_.connections_ connections, no faster than conf_.ramp_up_rate_ per second (0 for as fast as
+ * possible) and with at most conf_.max_connecting_ outstanding. Returns once every connect has completed.
+ */
+void firelink_loadgen::LoadGenerator::ramp_up()
+{
+  std::uint64_t start = now_ns();
+  std::uint32_t next_id = 0;
+
+  while (next_id < conf_.connections_)
+  {
+    std::uint64_t allowed = conf_.connections_;
+    if (conf_.ramp_up_rate_ != 0)
+      allowed = std::min<std::uint64_t>(allowed, (now_ns() - start) * conf_.ramp_up_rate_ / 1'000'000'000ull + 1);
+
+    while (next_id < allowed && connecting_.load() < conf_.max_connecting_)
+    {
+      connecting_.fetch_add(1);
+      start_connect(next_id++);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  while (connecting_.load() != 0)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+void firelink_loadgen::LoadGenerator::start_connect(std::uint32_t id)
+{
+  const firelink::Endpoint& dst = conf_.targets_[id % conf_.targets_.size()];
+
+  auto sock = firelink::Socket::create(io_core_);
+  if (!sock.has_value())
+  {
+    on_connect(id, nullptr, sock.error());
+    return;
+  }
+
+  firelink::ErrorCode err = sock.value()->socket(dst.family(), firelink::SocketType::Stream, firelink::Protocol::Tcp);
+  if (err != firelink::ErrorCode::Success)
+  {
+    on_connect(id, sock.value(), err);
+    return;
+  }
+
+  // Best effort. With several targets the connections share ephemeral ports instead of running out of them.
+  std::uint32_t enable = 1;
+  sock.value()->set_socket_option(firelink::SocketOptionLevel::Socket, firelink::SocketOption::ReuseUnicastPort,
+                                  std::as_bytes(std::span<std::uint32_t>(&enable, 1)));
+
+  err = sock.value()->start_connect(dst, [this, id](std::shared_ptr<firelink::Socket> caller, firelink::ErrorCode error,
+                                                    firelink::ConnectTag)
+  {
+    on_connect(id, std::move(caller), error);
+  });
+
+  if (err != firelink::ErrorCode::Success)
+    on_connect(id, sock.value(), err);
+}
+
+void firelink_loadgen::LoadGenerator::on_connect(std::uint32_t id, std::shared_ptr<firelink::Socket> socket,
+                                                 firelink::ErrorCode error)
+{
+  if (error != firelink::ErrorCode::Success)
+  {
+    if (socket)
+      socket->close();
+
+    counters_.connect_errors_.fetch_add(1, std::memory_order_relaxed);
+    connecting_.fetch_sub(1);
+    return;
+  }
+
+  bool chatty = is_chatty(id);
+  auto connection = std::make_shared<Connection>(this, id, std::move(socket), chatty);
+  {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    connections_.push_back(connection);
+    if (chatty)
+      chatty_.push_back(connection);
+  }
+
+  counters_.connected_.fetch_add(1, std::memory_order_relaxed);
+  connection->start_reading();
+  connecting_.fetch_sub(1);
+}
+
+// Spreads the chatty connections evenly over the ids, so every target and every ramp-up second gets its share
+bool firelink_loadgen::LoadGenerator::is_chatty(std::uint32_t id) const
+{
+  return std::floor((id + 1) * conf_.chatty_fraction_) > std::floor(id * conf_.chatty_fraction_);
+}
+
+/*
+ * The open-loop schedule. Request n is due at a time fixed up front, requests that are due go out round-robin
+ * over the chatty connections whether or not earlier ones were answered. Sleeping is coarse, due requests
+ * leave in small bursts, but their latency still counts from the scheduled time. Returns the phase length.
+ */
+std::uint64_t firelink_loadgen::LoadGenerator::send_requests()
+{
+  std::uint64_t start = now_ns();
+  std::uint64_t end = start + static_cast<std::uint64_t>(conf_.duration_s_) * 1'000'000'000ull;
+
+  std::vector<std::shared_ptr<Connection>> chatty{};
+  {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    chatty = chatty_;
+  }
+
+  if (chatty.empty() || conf_.request_rate_ <= 0.0)
+  {
+    // Idle connections only, hold them for the duration
+    std::this_thread::sleep_for(std::chrono::seconds(conf_.duration_s_));
+    return now_ns() - start;
+  }
+
+  std::mt19937_64 rng(0x5eed);
+  std::exponential_distribution<double> gaps(conf_.request_rate_);
+  double interval_ns = 1e9 / conf_.request_rate_;
+
+  double next_ns = static_cast<double>(start);
+  std::size_t next_connection = 0;
+  for (;;)
+  {
+    std::uint64_t now = now_ns();
+    if (now >= end)
+      break;
+
+    while (next_ns <= static_cast<double>(now))
+    {
+      std::uint32_t size = conf_.payload_.pick(rng);
+      chatty[next_connection]->send_request(static_cast<std::uint64_t>(next_ns), std::span<std::byte>(payload_.data(), size));
+      next_connection = (next_connection + 1) % chatty.size();
+      next_ns += conf_.poisson_ ? gaps(rng) * 1e9 : interval_ns;
+    }
+
+    double wait_ns = next_ns - static_cast<double>(now_ns());
+    if (wait_ns >= 1'000'000.0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    else if (wait_ns > 0.0)
+      std::this_thread::yield();
+  }
+
+  return now_ns() - start;
+}
+
+// Gives the requests sent near the end their responses, they belong in the percentiles as much as the rest
+void firelink_loadgen::LoadGenerator::drain()
+{
+  std::uint64_t deadline = now_ns() + static_cast<std::uint64_t>(conf_.drain_timeout_ms_) * 1'000'000ull;
+  while (now_ns() < deadline)
+  {
+    LoadTotals totals = counters_.load();
+    if (totals.responses_ + totals.unanswered_ >= totals.requests_sent_)
+      return;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+void firelink_loadgen::LoadGenerator::report_loop()
+{
+  std::uint64_t next_report = start_ns_ + 1'000'000'000ull;
+  while (!done_.load())
+  {
+    std::uint64_t now = now_ns();
+    if (now < next_report)
+    {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(std::min<std::uint64_t>(next_report - now, 50'000'000ull)));
+      continue;
+    }
+
+    report_interval();
+    next_report += 1'000'000'000ull;
+  }
+
+  // The partial last interval
+  report_interval();
+}
+
+void firelink_loadgen::LoadGenerator::report_interval()
+{
+  LoadTotals totals = counters_.load();
+
+  firelink::LatencyHistogram interval{};
+  for (HistogramShard& shard : shards_)
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    interval.merge(shard.histogram_);
+    shard.histogram_.reset();
+  }
+  total_.merge(interval);
+
+  static const char* phase_names[] = {"ramp", "load", "drain"};
+  double elapsed_s = static_cast<double>(now_ns() - start_ns_) / 1e9;
+  double mib = 1024.0 * 1024.0;
+  auto us = [](std::uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+
+  std::cout << std::fixed << std::setprecision(1)
+            << std::setw(7) << elapsed_s << std::setw(7) << phase_names[static_cast<int>(phase_.load())]
+            << std::setw(10) << totals.connected_ - totals.disconnected_
+            << std::setw(10) << totals.connect_errors_ - last_.connect_errors_
+            << std::setw(10) << totals.disconnected_ - last_.disconnected_
+            << std::setw(10) << totals.requests_sent_ - last_.requests_sent_
+            << std::setw(10) << totals.responses_ - last_.responses_
+            << std::setw(10) << totals.send_errors_ - last_.send_errors_ + totals.unanswered_ - last_.unanswered_
+            << std::setprecision(2)
+            << std::setw(11) << static_cast<double>(totals.bytes_sent_ - last_.bytes_sent_) / mib
+            << std::setw(11) << static_cast<double>(totals.bytes_received_ - last_.bytes_received_) / mib
+            << std::setprecision(1)
+            << std::setw(10) << us(interval.percentile(50.0)) << std::setw(10) << us(interval.percentile(90.0))
+            << std::setw(10) << us(interval.percentile(99.0)) << std::setw(10) << us(interval.percentile(99.9))
+            << std::setw(10) << us(interval.max()) << std::endl;
+
+  last_ = totals;
+}
+
+void firelink_loadgen::LoadGenerator::report_summary(std::uint64_t load_phase_ns)
+{
+  LoadTotals totals = counters_.load();
+  double load_s = static_cast<double>(load_phase_ns) / 1e9;
+  auto us = [](std::uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+
+  std::cout << std::endl
+            << "connections:  " << totals.connected_ << " opened, " << totals.connect_errors_ << " failed" << std::endl
+            << "requests:     " << totals.requests_sent_ << " sent, " << totals.responses_ << " answered, "
+            << totals.unanswered_ << " lost to closed connections, "
+            << totals.requests_sent_ - std::min(totals.requests_sent_, totals.responses_ + totals.unanswered_)
+            << " unanswered at the end, " << totals.send_errors_ << " send errors" << std::endl
+            << std::fixed << std::setprecision(1)
+            << "rate:         " << static_cast<double>(totals.requests_sent_) / load_s << " req/s sent, "
+            << conf_.request_rate_ << " req/s target" << std::endl
+            << "latency (us): p50 " << us(total_.percentile(50.0)) << "  p90 " << us(total_.percentile(90.0))
+            << "  p99 " << us(total_.percentile(99.0)) << "  p99.9 " << us(total_.percentile(99.9))
+            << "  p99.99 " << us(total_.percentile(99.99)) << "  max " << us(total_.max())
+            << "  mean " << total_.mean() / 1000.0
+            << std::endl;
+}
@@ -0,0 +1,201 @@
+#ifndef FIRELINK_LOADGEN_H
+#define FIRELINK_LOADGEN_H
+
+#include "firelink/endpoint.hpp"
+#include "firelink/io_core.hpp"
+#include "firelink/latency_histogram.hpp"
+#include "firelink/socket.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Latency is recorded into this many histograms, picked by connection, so responses rarely wait on each other
+static constexpr std::uint32_t LOADGEN_HISTOGRAM_SHARDS = 64;
+
+// Receive buffers of connections that send requests and of idle connections, which only notice the close
+static constexpr std::size_t LOADGEN_CHATTY_RECV_BUFFER = 4096;
+static constexpr std::size_t LOADGEN_IDLE_RECV_BUFFER = 64;
+
+namespace firelink_loadgen
+{
+  struct PayloadSize
+  {
+    std::uint32_t size_;
+    std::uint32_t weight_;
+  };
+
+  /*
+   * Request sizes. "64" is a fixed size, "64-1024" uniform between the two and "64*90,4096*10" picks one of
+   * the listed sizes in proportion to its weight. The bytes are a repeating 0..255 sequence.
+   */
+  struct PayloadPattern
+  {
+    std::vector<PayloadSize> sizes_{{64, 1}};
+    bool uniform_ = false;   // sizes_ holds the bounds of a uniform range
+
+    std::uint32_t pick(std::mt19937_64& rng) const;
+    std::uint32_t largest() const;
+  };
+
+  bool parse_payload(std::string_view text, PayloadPattern& out);
+
+  struct LoadConfig
+  {
+    std::vector<firelink::Endpoint> targets_;   // connections are spread round-robin over these
+    std::uint32_t connections_ = 1000;
+    double chatty_fraction_ = 0.1;             // share of connections that send requests, the others stay idle
+    double request_rate_ = 10000.0;            // requests per second over all chatty connections, open loop
+    bool poisson_ = false;                     // exponential gaps between requests instead of a fixed interval
+    std::uint32_t ramp_up_rate_ = 1000;        // connections opened per second
+    std::uint32_t max_connecting_ = 512;       // connects outstanding at once
+    std::uint32_t duration_s_ = 30;            // request phase, after the ramp-up
+    std::uint32_t drain_timeout_ms_ = 2000;    // wait for outstanding responses before closing
+    PayloadPattern payload_{};
+    std::uint32_t io_threads_ = 4;
+    std::uint32_t user_threads_ = 4;
+  };
+
+  class LoadGenerator;
+
+  /*
+   * One client connection. Requests queue behind the ones still unanswered, each remembers when the schedule
+   * meant to send it. Responses are matched in order by byte count, the server is expected to echo.
+   */
+  class Connection : public std::enable_shared_from_this<Connection>
+  {
+    public:
+    Connection(LoadGenerator* generator, std::uint32_t id, std::shared_ptr<firelink::Socket> socket, bool chatty);
+
+    void start_reading();
+    void send_request(std::uint64_t intended_ns, std::span<std::byte> payload);
+    void close();
+
+    private:
+    struct Pending
+    {
+      std::uint64_t intended_ns_;
+      std::uint32_t remaining_;
+    };
+
+    void on_recv(firelink::ErrorCode error, std::int32_t bytes_transferred);
+
+    LoadGenerator* generator_;
+    std::uint32_t id_;
+    std::shared_ptr<firelink::Socket> socket_;
+    std::vector<std::byte> recv_buffer_;
+    std::atomic<bool> closed_;
+
+    std::mutex mutex_;
+    std::deque<Pending> pending_;
+  };
+
+  struct LoadTotals
+  {
+    std::uint64_t connected_ = 0;
+    std::uint64_t connect_errors_ = 0;
+    std::uint64_t disconnected_ = 0;
+    std::uint64_t requests_sent_ = 0;
+    std::uint64_t send_errors_ = 0;
+    std::uint64_t responses_ = 0;
+    std::uint64_t unanswered_ = 0;     // requests still pending when their connection closed
+    std::uint64_t bytes_sent_ = 0;
+    std::uint64_t bytes_received_ = 0;
+  };
+
+  // Counters since the start, the reporter prints the difference every second
+  struct LoadCounters
+  {
+    std::atomic<std::uint64_t> connected_{0};
+    std::atomic<std::uint64_t> connect_errors_{0};
+    std::atomic<std::uint64_t> disconnected_{0};
+    std::atomic<std::uint64_t> requests_sent_{0};
+    std::atomic<std::uint64_t> send_errors_{0};
+    std::atomic<std::uint64_t> responses_{0};
+    std::atomic<std::uint64_t> unanswered_{0};
+    std::atomic<std::uint64_t> bytes_sent_{0};
+    std::atomic<std::uint64_t> bytes_received_{0};
+
+    LoadTotals load() const;
+  };
+
+  enum class LoadPhase : int
+  {
+    RampUp,
+    Load,
+    Drain
+  };
+
+  /*
+   * Opens the connections at the configured ramp-up rate, then sends requests on an open-loop schedule: the
+   * time of request n is fixed in advance (n / rate, or Poisson arrivals), no matter how long earlier responses
+   * take. Latency is measured from that intended time, so a stalled server or a late generator shows up in the
+   * percentiles instead of silently lowering the request rate (coordinated omission).
+   */
+  class LoadGenerator
+  {
+    public:
+    explicit LoadGenerator(const LoadConfig& config);
+
+    // Runs the whole test on the calling thread and prints per-second and summary statistics. Returns 0 on success.
+    int run();
+
+    // Called by the connections
+    void record_latency(std::uint32_t connection_id, std::uint64_t latency_ns);
+    inline LoadCounters& counters() { return counters_; }
+
+    private:
+    struct HistogramShard
+    {
+      std::mutex mutex_;
+      firelink::LatencyHistogram histogram_;
+    };
+
+    void ramp_up();
+    void start_connect(std::uint32_t id);
+    void on_connect(std::uint32_t id, std::shared_ptr<firelink::Socket> socket, firelink::ErrorCode error);
+    bool is_chatty(std::uint32_t id) const;
+    std::uint64_t send_requests();
+    void drain();
+    void report_loop();
+    void report_interval();
+    void report_summary(std::uint64_t load_phase_ns);
+
+    LoadConfig conf_;
+    std::shared_ptr<firelink::IOCore> io_core_;
+    std::vector<std::byte> payload_;
+
+    std::mutex connections_mutex_;
+    std::vector<std::shared_ptr<Connection>> connections_;
+    std::vector<std::shared_ptr<Connection>> chatty_;
+    std::atomic<std::uint32_t> connecting_;
+
+    LoadCounters counters_;
+    std::array<HistogramShard, LOADGEN_HISTOGRAM_SHARDS> shards_;
+
+    // Owned by the reporter thread until it is joined
+    firelink::LatencyHistogram total_;
+    LoadTotals last_;
+
+    std::atomic<LoadPhase> phase_;
+    std::atomic<bool> done_;
+    std::uint64_t start_ns_;
+  };
+
+  inline std::uint64_t now_ns()
+  {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+}
+
+#endif /* FIRELINK_LOADGEN_H */
@@ -0,0 +1,117 @@
+#include "loadgen.hpp"
+
+#include <charconv>
+#include <iostream>
+#include <string>
+
+namespace
+{
+  template<typename T>
+  bool parse_number(std::string_view text, T& value)
+  {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc{} && result.ptr == text.data() + text.size();
+  }
+
+  // "a.b.c.d:port,[v6]:port,..."
+  bool parse_targets(std::string_view text, std::vector<firelink::Endpoint>& out)
+  {
+    while (!text.empty())
+    {
+      std::size_t comma = text.find(',');
+      std::string_view item = text.substr(0, comma);
+      text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+
+      firelink::Endpoint endpoint{};
+      auto result = firelink::from_chars(item.data(), item.data() + item.size(), endpoint);
+      if (result.ec != std::errc{} || result.ptr != item.data() + item.size() || endpoint.port() == 0)
+        return false;
+
+      out.push_back(endpoint);
+    }
+
+    return !out.empty();
+  }
+
+  void print_usage()
+  {
+    std::cerr << "Usage: firelink_loadgen.exe --target addr:port[,addr:port...] [options]" << std::endl
+              << "  --connections n      connections to open (1000)" << std::endl
+              << "  --chatty f           share of the connections that send requests, 0..1 (0.1)" << std::endl
+              << "  --rate r             requests per second over all chatty connections, open loop (10000)" << std::endl
+              << "  --poisson            Poisson arrivals instead of evenly spaced requests" << std::endl
+              << "  --ramp-up r          connections opened per second, 0 for as fast as possible (1000)" << std::endl
+              << "  --max-connecting n   connects outstanding at once (512)" << std::endl
+              << "  --duration s         seconds of requests after the ramp-up (30)" << std::endl
+              << "  --payload p          request sizes: 64, 64-1024 (uniform) or 64*90,4096*10 (weighted) (64)" << std::endl
+              << "  --io-threads n       IO threads (4)" << std::endl
+              << "  --user-threads n     user threads (4)" << std::endl;
+  }
+}
+
+/*
+ * Opens many connections to echo servers and drives an open-loop request load over a share of them, printing
+ * throughput and latency percentiles every second and a summary at the end. The servers must send back
+ * every byte they receive.
+ */
+int main(int argc, char** argv)
+{
+  firelink_loadgen::LoadConfig config{};
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string_view arg(argv[i]);
+    if (arg == "--poisson")
+    {
+      config.poisson_ = true;
+      continue;
+    }
+
+    if (i + 1 >= argc)
+    {
+      print_usage();
+      return 1;
+    }
+
+    std::string value(argv[++i]);
+    bool valid = true;
+    if (arg == "--target")
+      valid = parse_targets(value, config.targets_);
+    else if (arg == "--connections")
+      valid = parse_number(value, config.connections_);
+    else if (arg == "--chatty")
+      valid = parse_number(value, config.chatty_fraction_) && config.chatty_fraction_ >= 0.0 && config.chatty_fraction_ <= 1.0;
+    else if (arg == "--rate")
+      valid = parse_number(value, config.request_rate_) && config.request_rate_ >= 0.0;
+    else if (arg == "--ramp-up")
+      valid = parse_number(value, config.ramp_up_rate_);
+    else if (arg == "--max-connecting")
+      valid = parse_number(value, config.max_connecting_) && config.max_connecting_ > 0;
+    else if (arg == "--duration")
+      valid = parse_number(value, config.duration_s_);
+    else if (arg == "--payload")
+      valid = firelink_loadgen::parse_payload(value, config.payload_);
+    else if (arg == "--io-threads")
+      valid = parse_number(value, config.io_threads_) && config.io_threads_ > 0;
+    else if (arg == "--user-threads")
+      valid = parse_number(value, config.user_threads_) && config.user_threads_ > 0;
+    else
+      valid = false;
+
+    if (!valid)
+    {
+      std::cerr << "Invalid argument " << arg << " " << value << std::endl;
+      print_usage();
+      return 1;
+    }
+  }
+
+  if (config.targets_.empty())
+  {
+    print_usage();
+    return 1;
+  }
+
+  firelink_loadgen::LoadGenerator generator(config);
+  return generator.run();
+}
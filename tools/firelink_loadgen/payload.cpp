@@ -0,0 +1,90 @@
+#include "loadgen.hpp"
+
+#include <algorithm>
+#include <charconv>
+
+namespace
+{
+  bool parse_uint(std::string_view text, std::uint32_t& value)
+  {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc{} && result.ptr == text.data() + text.size();
+  }
+}
+
+std::uint32_t firelink_loadgen::PayloadPattern::pick(std::mt19937_64& rng) const
+{
+  if (uniform_)
+    return std::uniform_int_distribution<std::uint32_t>(sizes_[0].size_, sizes_[1].size_)(rng);
+
+  if (sizes_.size() == 1)
+    return sizes_[0].size_;
+
+  std::uint64_t total = 0;
+  for (const PayloadSize& size : sizes_)
+    total += size.weight_;
+
+  std::uint64_t point = std::uniform_int_distribution<std::uint64_t>(0, total - 1)(rng);
+  for (const PayloadSize& size : sizes_)
+  {
+    if (point < size.weight_)
+      return size.size_;
+    point -= size.weight_;
+  }
+
+  return sizes_.back().size_;
+}
+
+std::uint32_t firelink_loadgen::PayloadPattern::largest() const
+{
+  std::uint32_t largest = 0;
+  for (const PayloadSize& size : sizes_)
+    largest = std::max(largest, size.size_);
+
+  return largest;
+}
+
+/*
+ * Parses "size", "min-max" or "size*weight,size*weight,...". Sizes must be at least 1 byte.
+ */
+bool firelink_loadgen::parse_payload(std::string_view text, PayloadPattern& out)
+{
+  PayloadPattern pattern{};
+  pattern.sizes_.clear();
+
+  std::size_t dash = text.find('-');
+  if (dash != std::string_view::npos)
+  {
+    std::uint32_t min = 0;
+    std::uint32_t max = 0;
+    if (!parse_uint(text.substr(0, dash), min) || !parse_uint(text.substr(dash + 1), max) || min == 0 || min > max)
+      return false;
+
+    pattern.sizes_ = {{min, 1}, {max, 1}};
+    pattern.uniform_ = true;
+    out = std::move(pattern);
+    return true;
+  }
+
+  while (!text.empty())
+  {
+    std::size_t comma = text.find(',');
+    std::string_view item = text.substr(0, comma);
+    text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+
+    PayloadSize size{0, 1};
+    std::size_t star = item.find('*');
+    if (!parse_uint(item.substr(0, star), size.size_) || size.size_ == 0)
+      return false;
+    if (star != std::string_view::npos && (!parse_uint(item.substr(star + 1), size.weight_) || size.weight_ == 0))
+      return false;
+
+    pattern.sizes_.push_back(size);
+  }
+
+  if (pattern.sizes_.empty())
+    return false;
+
+  out = std::move(pattern);
+  return true;
+}